@@ -12,8 +12,11 @@ class Type;
 class ASTNode;
 class ASTVarDecl;
 class InitializeValue;
+class ConstantValue;
 template<typename T>
 class TensorData;
+template<typename T>
+class PlainTensorBuilder;
 
 class Antlr2AstVisitor final : SysYBaseVisitor
 {
@@ -25,6 +28,8 @@ class Antlr2AstVisitor final : SysYBaseVisitor
 	std::stack<TensorData<InitializeValue>*> _initTensorConstraint;
 	// 为初始化的约束, 标记初始化节点, 用于列表中维护 ASTExpression 的内存
 	std::stack<ASTVarDecl*> _initVarNodeConstraint;
+	// 为全局数组初始化的约束, 非空时初始化的值直接写入铺平的张量
+	PlainTensorBuilder<ConstantValue>* _initPlainConstraint = nullptr;
 	// 结构约束, 目前的前置节点. 这些节点是拥有符号表的节点
 	std::vector<HaveScope*> _structConstraint;
 	// 结构约束, 目前的循环节点. 用于 break 等
@@ -50,6 +55,9 @@ class Antlr2AstVisitor final : SysYBaseVisitor
 
 	std::any visitConstDecl(SysYParser::ConstDeclContext* context) override;
 
+	// 向 _initPlainConstraint 添加初始化列表中的一个值 exp, add 是其唯一的子节点. checkFloat 表示禁止用浮点数初始化整数
+	void appendPlainInitValue(antlr4::ParserRuleContext* exp, SysYParser::AddExpContext* add, bool checkFloat);
+
 	std::any visitBType(SysYParser::BTypeContext* context) override;
 
 	std::any visitConstDef(SysYParser::ConstDefContext* context) override;
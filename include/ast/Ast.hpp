@@ -8,6 +8,8 @@
 class Value;
 template <typename T>
 class Tensor;
+template <typename T>
+class PlainTensor;
 class Type;
 
 class SysYVisitor;
@@ -220,6 +222,7 @@ public:
 class ASTNode
 {
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	// 输出为字符串列表, 默认是以行分割
@@ -233,6 +236,11 @@ public:
 	ASTNode(const ASTNode&&) = delete;
 	ASTNode& operator=(const ASTNode&&) = delete;
 	virtual Value* accept(AST2IRVisitor* visitor) = 0;
+	// 节点开始的源代码行, 从 1 开始, 0 表示未知. 语句, 局部定义与函数会记录, 表达式不记录
+	[[nodiscard]] int line() const { return _line; }
+
+private:
+	int _line = 0;
 };
 
 // AST 树的根节点. 同时管理了整棵树的额外数据 *
@@ -266,6 +274,7 @@ public:
 
 private:
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	friend class ASTNumber;
 	// 变量声明 *
 	std::vector<ASTVarDecl*> _var_declarations;
@@ -289,6 +298,7 @@ class ASTDecl : public ASTNode
 {
 	friend class ASTCompUnit;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 protected:
 	// 声明 ID
@@ -304,6 +314,7 @@ class ASTVarDecl final : public ASTDecl
 {
 	std::list<std::string> toStringList() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTVarDecl(const ASTVarDecl& other) = delete;
@@ -322,6 +333,7 @@ public:
 
 private:
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	friend class ASTFuncDecl;
 
 	// 是否是常量
@@ -332,6 +344,8 @@ private:
 	Type* _type{};
 	// 初始值列表, 没有则为空 *
 	Tensor<InitializeValue>* _initList = nullptr;
+	// 全局数组的初始值, 在解析时直接铺平为常量段, 此时 _initList 为空 *
+	PlainTensor<ConstantValue>* _plainInitList = nullptr;
 	// 需要被计算的非常量初始化表达式, 用于维护内存 *
 	std::vector<ASTExpression*> _expressions;
 
@@ -340,8 +354,12 @@ public:
 	[[nodiscard]] bool isConst() const;
 	// 是否是全局变量
 	[[nodiscard]] bool isGlobal() const;
-	// 获取初始化列表
+	// 获取初始化列表, 全局数组没有初始化列表, 见 getPlainInitList
 	[[nodiscard]] const Tensor<InitializeValue>* getInitList() const;
+	// 获取全局数组铺平的初始值
+	[[nodiscard]] const PlainTensor<ConstantValue>* getPlainInitList() const;
+	// 取走全局数组铺平的初始值, 之后由调用者维护
+	[[nodiscard]] PlainTensor<ConstantValue>* movePlainInitList();
 	// 变量的类型
 	[[nodiscard]] Type* getType() const;
 	Value* accept(AST2IRVisitor* visitor) override;
@@ -362,6 +380,7 @@ private:
 	std::list<std::string> toStringList() override;
 	~ASTFuncDecl() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTFuncDecl(const ASTFuncDecl& other) = delete;
@@ -416,6 +435,7 @@ class ASTExpression : public ASTStmt
 {
 	friend std::list<ASTExpression*> AST::cutExpressionToOnlyLeaveFuncCall(ASTExpression* input);
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 protected:
 	// 该表达式是否调用了函数
@@ -469,6 +489,7 @@ public:
 class ASTRVal final : public ASTExpression
 {
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	[[nodiscard]] const std::vector<ASTExpression*>& index() const
@@ -506,6 +527,7 @@ class ASTNumber final : public ASTExpression
 {
 	std::list<std::string> toStringList() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	friend class ASTCompUnit;
 
 	ConstantValue _field{};
@@ -649,6 +671,7 @@ private:
 	};
 
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	// 算符
 	LogicOP _op{};
 	// 操作数 *
@@ -696,6 +719,7 @@ private:
 	~ASTEqual() override;
 	friend std::list<ASTExpression*> AST::cutExpressionToOnlyLeaveFuncCall(ASTExpression* input);
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTEqual(const ASTEqual& other) = delete;
@@ -712,6 +736,7 @@ public:
 
 private:
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	// 算符 true 为 ==; false 为 !=
 	bool _op_equal{};
 	// 左操作数 *
@@ -748,6 +773,7 @@ private:
 	~ASTRelation() override;
 	friend std::list<ASTExpression*> AST::cutExpressionToOnlyLeaveFuncCall(ASTExpression* input);
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTRelation(const ASTRelation& other) = delete;
@@ -764,6 +790,7 @@ public:
 
 private:
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	// 比较算符
 	RelationOP _op{};
 	// 左操作数 *
@@ -827,6 +854,7 @@ private:
 	~ASTNeg() override;
 	friend std::list<ASTExpression*> AST::cutExpressionToOnlyLeaveFuncCall(ASTExpression* input);
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	// 操作数 *
 	ASTExpression* _hold{};
 
@@ -855,6 +883,7 @@ private:
 	~ASTNot() override;
 	friend std::list<ASTExpression*> AST::cutExpressionToOnlyLeaveFuncCall(ASTExpression* input);
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	friend class ASTExpression;
 	friend class ASTCast;
 
@@ -887,6 +916,7 @@ private:
 
 	~ASTBlock() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 	friend class ASTFuncDecl;
 
 protected:
@@ -967,6 +997,7 @@ private:
 	std::list<std::string> toStringList() override;
 	~ASTIf() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTIf(const ASTIf& other) = delete;
@@ -1007,6 +1038,7 @@ private:
 	std::list<std::string> toStringList() override;
 	~ASTWhile() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTWhile(const ASTWhile& other) = delete;
@@ -1032,6 +1064,7 @@ class ASTBreak final : public ASTStmt
 {
 	std::list<std::string> toStringList() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTBreak(ASTWhile* target) : _target(target)
@@ -1050,6 +1083,7 @@ class ASTContinue final : public ASTStmt
 {
 	std::list<std::string> toStringList() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTContinue(ASTWhile* target) : _target(target)
@@ -1089,6 +1123,7 @@ private:
 
 	~ASTReturn() override;
 	friend class Antlr2AstVisitor;
+	friend class Source2AstParser;
 
 public:
 	ASTReturn(ASTExpression* return_value, ASTFuncDecl* function) : _return_value(return_value), _function(function)
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// SysY 词法单元类型, 与 antlr/SysY.g4 中的词法规则一一对应
+enum class TokenType : int8_t
+{
+	END,
+	// 关键字
+	INT,
+	FLOAT,
+	VOID,
+	IF,
+	ELSE,
+	WHILE,
+	CONTINUE,
+	BREAK,
+	RETURN,
+	CONST,
+	// 符号
+	ASSIGN,
+	ADD,
+	SUB,
+	MUL,
+	DIV,
+	MOD,
+	EQ,
+	NE,
+	LT,
+	GT,
+	LE,
+	GE,
+	OR,
+	AND,
+	NOT,
+	LPAREN,
+	RPAREN,
+	LBRACK,
+	RBRACK,
+	LBRACE,
+	RBRACE,
+	COMMA,
+	SEMICO,
+	// 标识符与常量
+	ID,
+	INT_CONST,
+	FLOAT_CONST
+};
+
+// 词法单元, 文本直接指向源码缓冲区, 不做拷贝
+struct Token
+{
+	TokenType type = TokenType::END;
+	const char* text = nullptr;
+	unsigned length = 0;
+	// 所在行, 从 1 开始
+	int line = 1;
+
+	[[nodiscard]] std::string str() const { return {text, length}; }
+	[[nodiscard]] bool is(const char* s) const;
+};
+
+std::string tokenTypeName(TokenType type);
+
+// 手写的 SysY 词法分析器, 对 [begin, end) 按需切分词法单元, 跳过空白和注释
+class Lexer
+{
+public:
+	Lexer(const char* begin, const char* end);
+
+	// 读取下一个词法单元, 到达末尾后总是返回 END
+	Token next();
+
+	// 回到某个已读取的词法单元之后继续读取, 用于重新解析一段源码
+	void rewindTo(const Token& token);
+
+private:
+	const char* cur_;
+	const char* end_;
+	int line_ = 1;
+
+	void skipSpaceAndComment();
+	Token lexNumber();
+	Token lexIdentifier();
+	Token make(TokenType type, const char* begin) const;
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include <deque>
+#include <list>
+#include <stack>
+#include <string>
+#include <vector>
+
+#include "Lexer.hpp"
+
+class ASTFuncDecl;
+class HaveScope;
+class ASTDecl;
+class ASTWhile;
+class ASTCompUnit;
+class Type;
+class ASTStmt;
+class ASTExpression;
+class ASTVarDecl;
+class InitializeValue;
+class ConstantValue;
+template<typename T>
+class TensorData;
+template<typename T>
+class PlainTensorBuilder;
+
+// 手写的递归下降前端, 直接由源码生成 AST, 不经过 antlr 的解析树.
+// 语义检查与常量折叠规则与 Antlr2AstVisitor 完全一致, 每个 parseXxx 对应 SysY.g4 中的同名规则
+class Source2AstParser final
+{
+	// 定义约束, 与 Antlr2AstVisitor 相同. 约束调用要求谁插入, 谁弹出
+
+	// 为初始化的约束, 标记初始化张量
+	std::stack<TensorData<InitializeValue>*> _initTensorConstraint;
+	// 为初始化的约束, 标记初始化节点, 用于列表中维护 ASTExpression 的内存
+	std::stack<ASTVarDecl*> _initVarNodeConstraint;
+	// 为全局数组初始化的约束, 非空时初始化的值直接写入铺平的张量
+	PlainTensorBuilder<ConstantValue>* _initPlainConstraint = nullptr;
+	// 结构约束, 目前的前置节点. 这些节点是拥有符号表的节点
+	std::vector<HaveScope*> _structConstraint;
+	// 结构约束, 目前的循环节点. 用于 break 等
+	std::stack<ASTWhile*> _whileConstraint;
+	// 目前所在函数
+	ASTFuncDecl* _currentFunction = nullptr;
+	// 逻辑约束, 表达式是否允许使用 ! 运算
+	bool _allowLogic = false;
+
+	Lexer lexer_;
+	// 当前词法单元
+	Token cur_;
+	// 预读的词法单元, 仅在区分函数定义与变量定义时使用
+	std::deque<Token> ahead_;
+
+	// 当前词法单元之后第 k 个词法单元, k 从 1 开始
+	const Token& peek(int k);
+	Token advance();
+	bool acceptToken(TokenType type);
+	Token expect(TokenType type);
+	// 从某个词法单元重新开始解析
+	void seek(const Token& token);
+	[[noreturn]] void syntaxError(const std::string& expected) const;
+
+	// 插入符号. 尝试在 _structConstraint 最右侧插入符号, 若重名则返回 false; 否则插入并返回 true.
+	bool pushScope(ASTDecl* decl) const;
+	// 寻找符号. 尝试在 _structConstraint 从右往左寻找符号; 所有表均未找到则返回 false.
+	ASTDecl* findScope(const std::string& id, bool isFunc);
+
+	ASTCompUnit* parseCompUnit();
+	// 常量与变量声明, 声明的节点按顺序加入 out
+	void parseDecl(std::list<ASTVarDecl*>& out);
+	Type* parseBType();
+	ASTVarDecl* parseVarDef(Type* bType, bool isConst);
+	// 解析初始化列表的一项, top 表示是否是最外层(即 constInitVal/initVal, 否则是 constArrayInitVal/arrayInitVal)
+	void parseInitVal(bool isConst, bool top);
+	void parsePlainInitVal(bool isConst, bool top);
+	bool acceptBareLiteral(Type* type, ConstantValue& value);
+	void parseFuncDef();
+	ASTVarDecl* parseFuncFParam();
+	void parseBlock();
+	// 语句生成的节点按顺序加入 out, 可能被折叠为 0 个或多个节点; 还未记录行号的节点记录语句开始的行
+	void parseStmt(std::list<ASTStmt*>& out);
+	void parseStmtWithoutLine(std::list<ASTStmt*>& out);
+	void parseIf(std::list<ASTStmt*>& out);
+	void parseWhile(std::list<ASTStmt*>& out);
+
+	ASTExpression* parseExp();
+	ASTExpression* parseConstExp();
+	ASTExpression* parseCond();
+	ASTExpression* parseLVal();
+	ASTExpression* parsePrimaryExp();
+	ASTExpression* parseNumber();
+	static ConstantValue literalValue(const Token& tk);
+	ASTExpression* parseUnaryExp();
+	ASTExpression* parseCall();
+	ASTExpression* parseMulExp();
+	ASTExpression* parseAddExp();
+	ASTExpression* parseRelExp();
+	ASTExpression* parseEqExp();
+	ASTExpression* parseLAndExp();
+	ASTExpression* parseLOrExp();
+
+	// 合并二元表达式, 与 Antlr2AstVisitor 中对应的 visit 函数的折叠逻辑相同
+	ASTExpression* combineMul(ASTExpression* l, TokenType op, ASTExpression* r) const;
+	ASTExpression* combineAdd(ASTExpression* l, TokenType op, ASTExpression* r) const;
+	static ASTExpression* combineRel(ASTExpression* l, TokenType op, ASTExpression* r);
+	static ASTExpression* combineEq(ASTExpression* l, TokenType op, ASTExpression* r);
+	static ASTExpression* combineLAnd(std::vector<ASTExpression*>& operands);
+	static ASTExpression* combineLOr(std::vector<ASTExpression*>& operands);
+
+public:
+	// 源码为 [begin, end), 在 astTree 返回前必须保持有效
+	Source2AstParser(const char* begin, const char* end);
+	ASTCompUnit* astTree();
+};
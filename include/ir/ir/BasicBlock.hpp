@@ -115,6 +115,11 @@ public:
 
 	std::string print() override;
 
+	// 基本块开始的源代码行, 即第一条记录了行号的指令的行, 0 表示未知
+	[[nodiscard]] int get_source_line();
+	// 用于诊断信息的名字, 未命名时是它在函数中的序号
+	[[nodiscard]] std::string get_diagnostic_name();
+
 	explicit BasicBlock(Module* m, const std::string& name, Function* parent);
 
 private:
@@ -45,6 +45,8 @@ public:
 	 * @param bb 要移除的基本块
 	 */
 	void remove(BasicBlock* bb);
+	// 删除所有基本块, 只保留函数与参数, 调用它的指令仍可以使用它们
+	void releaseBody();
 	[[nodiscard]] BasicBlock* get_entry_block() const { return *basic_blocks_.begin(); }
 
 	std::list<BasicBlock*>& get_basic_blocks() { return basic_blocks_; }
@@ -58,6 +60,20 @@ public:
 	[[nodiscard]] bool is_declaration() const { return basic_blocks_.empty(); }
 
 	void set_instr_name();
+	/**
+	 * 为参数, 基本块和指令分配连续的稠密编号, 以便 ValueMap 用数组代替哈希表
+	 * 编号从模块的计数器中分配, 因此不同函数(或同一函数不同次编号)的编号不会重复
+	 * @return 编号的值的数量
+	 */
+	int number_values();
+	// 函数中参数, 基本块和指令的数量
+	[[nodiscard]] int count_values();
+	// 从 base 开始为函数中的值编号, 编号数量必须等于 count_values()
+	void number_values_from(int base, int count);
+	// 最近一次编号的第一个编号
+	[[nodiscard]] int dense_base() const { return dense_base_; }
+	// 最近一次编号的值的数量
+	[[nodiscard]] int dense_count() const { return dense_count_; }
 	std::string print() override;
 
 	Value* ret_alloca_;
@@ -73,6 +89,8 @@ private:
 	std::vector<Argument*> arguments_;
 	Module* parent_;
 	int seq_cnt_; // print use
+	int dense_base_ = 0;
+	int dense_count_ = 0;
 public:
 	std::unordered_set<GlobalVariable*> constForSelf_;
 	// 是否是库函数, 以对函数参数进行不同的处理
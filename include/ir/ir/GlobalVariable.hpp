@@ -34,6 +34,11 @@ public:
 	                              const Tensor<InitializeValue>* init);
 	GlobalVariable(std::string name, Module* m, Type* ty, bool is_const,
 	               const Tensor<InitializeValue>* init);
+	// 创建全局常量, 直接接管已经铺平的初始值 init
+	static GlobalVariable* create(const std::string& name, Module* m, Type* ty, bool is_const,
+	                              PlainTensor<ConstantValue>* init);
+	GlobalVariable(std::string name, Module* m, Type* ty, bool is_const,
+	               PlainTensor<ConstantValue>* init);
 
 	~GlobalVariable() override;
 
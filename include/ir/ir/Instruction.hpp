@@ -11,6 +11,8 @@ class FuncType;
 class Module;
 class BasicBlock;
 class Function;
+template <typename T>
+class ValueMap;
 
 class Instruction : public User
 {
@@ -68,6 +70,8 @@ public:
 		zext, // zero extend
 		fptosi,
 		sitofp,
+		// 条件选择, 由 IfConversion 把只做计算的分支合并得到
+		select,
 		// float binary operators Logical operators
 
 		// mem 系列, 对内存使用 
@@ -98,7 +102,7 @@ public:
    */
 	Instruction(Type* ty, OpID id, BasicBlock* parent = nullptr);
 	virtual Instruction* copy(BasicBlock* parent) = 0;
-	virtual Instruction* copy(std::unordered_map<Value*, Value*>& valMap) = 0;
+	virtual Instruction* copy(ValueMap<Value*>& valMap) = 0;
 	~Instruction() override = default;
 
 	// 指令所属基本块
@@ -150,6 +154,7 @@ public:
 	[[nodiscard]] bool is_call() const { return op_id_ == call; }
 	[[nodiscard]] bool is_gep() const { return op_id_ == getelementptr; }
 	[[nodiscard]] bool is_zext() const { return op_id_ == zext; }
+	[[nodiscard]] bool is_select() const { return op_id_ == select; }
 	[[nodiscard]] bool is_memcpy() const { return op_id_ == memcpy_; }
 	[[nodiscard]] bool is_memclear() const { return op_id_ == memclear_; }
 	[[nodiscard]] bool is_nump2charp() const { return op_id_ == nump2charp; }
@@ -168,9 +173,20 @@ public:
 
 	bool replaceAllOperandMatchs(const Value* from, Value* to);
 
+	// 指令来自的源代码行, 0 表示未知
+	[[nodiscard]] int get_line() const { return line_; }
+	void set_line(int line) { line_ = line; }
+	// 用于诊断信息的源代码行, 指令自身未知时用所在基本块的行
+	[[nodiscard]] int get_diagnostic_line() const;
+	// 之后新建的指令记录的源代码行, 由 AST2IR 在翻译每条语句时设置
+	static int get_current_line() { return current_line_; }
+	static void set_current_line(int line) { current_line_ = line; }
+
 private:
 	BasicBlock* parent_;
 	OpID op_id_;
+	int line_;
+	static thread_local int current_line_;
 };
 
 template <typename Inst>
@@ -197,7 +213,7 @@ class IBinaryInst : public BaseInst<IBinaryInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static IBinaryInst* create_add(Value* v1, Value* v2, BasicBlock* bb);
 	static IBinaryInst* create_sub(Value* v1, Value* v2, BasicBlock* bb);
 	static IBinaryInst* create_mul(Value* v1, Value* v2, BasicBlock* bb);
@@ -219,7 +235,7 @@ class FBinaryInst : public BaseInst<FBinaryInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static FBinaryInst* create_fadd(Value* v1, Value* v2, BasicBlock* bb);
 	static FBinaryInst* create_fsub(Value* v1, Value* v2, BasicBlock* bb);
 	static FBinaryInst* create_fmul(Value* v1, Value* v2, BasicBlock* bb);
@@ -237,7 +253,7 @@ class ICmpInst : public BaseInst<ICmpInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static ICmpInst* create_ge(Value* v1, Value* v2, BasicBlock* bb);
 	static ICmpInst* create_gt(Value* v1, Value* v2, BasicBlock* bb);
 	static ICmpInst* create_le(Value* v1, Value* v2, BasicBlock* bb);
@@ -256,7 +272,7 @@ class FCmpInst : public BaseInst<FCmpInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	bool needStore = false;
 	static FCmpInst* create_fge(Value* v1, Value* v2, BasicBlock* bb);
 	static FCmpInst* create_fgt(Value* v1, Value* v2, BasicBlock* bb);
@@ -277,7 +293,7 @@ protected:
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static CallInst* create_call(Function* func, const std::vector<Value*>& args,
 	                             BasicBlock* bb);
 	[[nodiscard]] FuncType* get_function_type() const;
@@ -295,7 +311,7 @@ class BranchInst : public BaseInst<BranchInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	BranchInst(const BranchInst&) = delete;
 	BranchInst(BranchInst&&) = delete;
 	BranchInst& operator=(const BranchInst&) = delete;
@@ -318,7 +334,7 @@ class ReturnInst : public BaseInst<ReturnInst>
 public:
 	bool discarded_ = false;
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static ReturnInst* create_ret(Value* val, BasicBlock* bb);
 	static ReturnInst* create_void_ret(BasicBlock* bb);
 	[[nodiscard]] bool is_void_ret() const;
@@ -334,7 +350,7 @@ class GetElementPtrInst : public BaseInst<GetElementPtrInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static Type* get_element_type(const Value* ptr, const std::vector<Value*>& idxs);
 	static GetElementPtrInst* create_gep(Value* ptr, const std::vector<Value*>& idxs,
 	                                     BasicBlock* bb);
@@ -351,7 +367,7 @@ class StoreInst : public BaseInst<StoreInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static StoreInst* create_store(Value* val, Value* ptr, BasicBlock* bb);
 
 	[[nodiscard]] Value* get_rval() const { return this->get_operand(0); }
@@ -375,7 +391,7 @@ class MemCpyInst : public BaseInst<MemCpyInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static MemCpyInst* create_memcpy(Value* from, Value* to, int size, BasicBlock* bb);
 
 	[[nodiscard]] Value* get_from() const { return this->get_operand(0); }
@@ -397,7 +413,7 @@ class MemClearInst : public BaseInst<MemClearInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static MemClearInst* create_memclear(Value* target, int size, BasicBlock* bb);
 
 	[[nodiscard]] Value* get_target() const { return this->get_operand(0); }
@@ -415,7 +431,7 @@ class Nump2CharpInst : public BaseInst<Nump2CharpInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static Nump2CharpInst* create_nump2charp(Value* val, BasicBlock* bb);
 
 	[[nodiscard]] Value* get_val() const { return this->get_operand(0); }
@@ -434,7 +450,7 @@ class GlobalFixInst : public BaseInst<GlobalFixInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static GlobalFixInst* create_global_fix(GlobalVariable* val, BasicBlock* bb);
 
 	[[nodiscard]] GlobalVariable* get_var() const;
@@ -451,7 +467,7 @@ class LoadInst : public BaseInst<LoadInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static LoadInst* create_load(Value* ptr, BasicBlock* bb);
 
 	[[nodiscard]] Value* get_lval() const { return this->get_operand(0); }
@@ -468,7 +484,7 @@ class AllocaInst : public BaseInst<AllocaInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static AllocaInst* create_alloca(Type* ty, BasicBlock* bb);
 
 	[[nodiscard]] Type* get_alloca_type() const;
@@ -484,7 +500,7 @@ class ZextInst : public BaseInst<ZextInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static ZextInst* create_zext_to_i32(Value* val, BasicBlock* bb);
 
 	[[nodiscard]] Type* get_dest_type() const { return get_type(); }
@@ -500,7 +516,7 @@ class FpToSiInst : public BaseInst<FpToSiInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static FpToSiInst* create_fptosi(Value* val, Type* ty, BasicBlock* bb);
 	static FpToSiInst* create_fptosi_to_i32(Value* val, BasicBlock* bb);
 
@@ -517,7 +533,7 @@ class SiToFpInst : public BaseInst<SiToFpInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static SiToFpInst* create_sitofp(Value* val, BasicBlock* bb);
 
 	[[nodiscard]] Type* get_dest_type() const { return get_type(); }
@@ -525,6 +541,25 @@ public:
 	std::string print() override;
 };
 
+// cond 为真时取 true value, 否则取 false value
+class SelectInst : public BaseInst<SelectInst>
+{
+	friend BaseInst<SelectInst>;
+
+	SelectInst(Value* cond, Value* t, Value* f, BasicBlock* bb);
+
+public:
+	Instruction* copy(BasicBlock* parent) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
+	static SelectInst* create_select(Value* cond, Value* t, Value* f, BasicBlock* bb);
+
+	[[nodiscard]] Value* get_cond() const { return get_operand(0); }
+	[[nodiscard]] Value* get_true_value() const { return get_operand(1); }
+	[[nodiscard]] Value* get_false_value() const { return get_operand(2); }
+
+	std::string print() override;
+};
+
 class PhiInst : public BaseInst<PhiInst>
 {
 	friend BaseInst<PhiInst>;
@@ -534,7 +569,7 @@ class PhiInst : public BaseInst<PhiInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static PhiInst* create_phi(Type* ty, BasicBlock* bb,
 	                           const std::vector<Value*>& vals = {},
 	                           const std::vector<BasicBlock*>& val_bbs = {});
@@ -597,7 +632,7 @@ class MulIntegratedInst : public BaseInst<MulIntegratedInst>
 
 public:
 	Instruction* copy(BasicBlock* parent) override;
-	Instruction* copy(std::unordered_map<Value*, Value*>& valMap) override;
+	Instruction* copy(ValueMap<Value*>& valMap) override;
 	static MulIntegratedInst* create_msub(Value* ml, Value* mr, Value* val, BasicBlock* bb);
 	static MulIntegratedInst* create_madd(Value* ml, Value* mr, Value* val, BasicBlock* bb);
 	static MulIntegratedInst* create_mneg(Value* ml, Value* mr, BasicBlock* bb);
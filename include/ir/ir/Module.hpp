@@ -7,6 +7,7 @@
 #include <map>
 #include <string>
 
+class CompilationContext;
 class Constant;
 class GlobalVariable;
 class Function;
@@ -33,6 +34,20 @@ public:
 	void set_print_name();
 	std::string print();
 
+	// 分配 count 个连续的稠密编号, 返回第一个
+	int allocate_dense_ids(int count);
+	/**
+	 * 为全局变量, 函数以及所有函数中的值分配连续的稠密编号, 用于跨函数的 ValueMap
+	 * @return 编号的值的数量
+	 */
+	int number_values();
+	// 最近一次模块级编号的第一个编号
+	[[nodiscard]] int dense_base() const { return dense_base_; }
+	// 最近一次模块级编号的值的数量
+	[[nodiscard]] int dense_count() const { return dense_count_; }
+	// 创建模块时线程绑定的编译上下文, 运行 pass 时会重新绑定它
+	[[nodiscard]] CompilationContext* context() const { return context_; }
+
 private:
 	// The global variables in the module *
 	std::list<GlobalVariable*> global_list_;
@@ -44,4 +59,9 @@ private:
 	std::map<float, Constant*> float_constants_;
 	Constant* true_constant_;
 	Constant* false_constant_;
+	// 下一个可分配的稠密编号
+	int dense_id_cnt_ = 0;
+	int dense_base_ = 0;
+	int dense_count_ = 0;
+	CompilationContext* context_;
 };
@@ -6,6 +6,7 @@
 #include "System.hpp"
 
 class Function;
+class Module;
 class Type;
 class User;
 class Use;
@@ -15,6 +16,7 @@ class Use;
 class Value
 {
 	friend Function;
+	friend Module;
 public:
 	Value(const Value& other) = delete;
 	Value(Value&& other) = delete;
@@ -59,10 +61,15 @@ public:
 	 * @param pred 条件
 	 */
 	void replace_use_with_if(Value* new_val, const std::function<bool(Use)>& pred);
+	// 稠密编号, 由 Function::number_values / Module::number_values 分配, 未编号时为 -1
+	// 编号在同一模块内不会重复, 编号后新建的值没有编号, 见 ValueMap
+	[[nodiscard]] int get_dense_id() const { return dense_id_; }
 
 	virtual std::string print() = 0;
 
 private:
+	// 稠密编号
+	int dense_id_ = -1;
 	// 该值的类型
 	Type* type_;
 	// 该值的被使用列表
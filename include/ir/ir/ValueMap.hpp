@@ -0,0 +1,145 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "DynamicBitset.hpp"
+#include "Function.hpp"
+#include "Module.hpp"
+
+/**
+ * 以 Value 为键的表, 用于代替 std::unordered_map<Value*, T>
+ *
+ * 在编号范围内(Function::number_values / Module::number_values 分配)的值直接用数组下标访问,
+ * 常数, 全局变量以及编号后新建的值退回到哈希表.
+ * 因此表在建立后函数被修改也是安全的, 只是新值的访问会变慢.
+ *
+ * 注意 T 不应为 bool, 因为 std::vector<bool> 无法返回引用
+ */
+template <typename T>
+class ValueMap
+{
+public:
+	// 不使用数组的表, 所有值都存入哈希表
+	ValueMap() : base_(0), size_(0)
+	{
+	}
+
+	// 使用函数最近一次编号的表, 不会重新编号
+	explicit ValueMap(const Function* f)
+	{
+		reset(f);
+	}
+
+	// 使用模块最近一次编号的表, 不会重新编号
+	explicit ValueMap(const Module* m)
+	{
+		reset(m);
+	}
+
+	void reset(const Function* f) { reset(f->dense_base(), f->dense_count()); }
+	void reset(const Module* m) { reset(m->dense_base(), m->dense_count()); }
+
+	void reset(int base, int size)
+	{
+		base_ = base;
+		size_ = size;
+		dense_.assign(size, T{});
+		present_ = DynamicBitset{size};
+		sparse_.clear();
+	}
+
+	// 清空所有项, 保留编号范围
+	void clear()
+	{
+		if (!present_.allZeros())
+		{
+			for (int i : present_) dense_[i] = T{};
+			present_.reset();
+		}
+		sparse_.clear();
+	}
+
+	// 获取值对应的项, 不存在则默认构造
+	T& operator[](const Value* v)
+	{
+		int idx = index(v);
+		if (idx >= 0)
+		{
+			present_.set(idx);
+			return dense_[idx];
+		}
+		return sparse_[v];
+	}
+
+	// 获取值对应的项, 不存在返回 nullptr
+	T* find(const Value* v)
+	{
+		int idx = index(v);
+		if (idx >= 0) return present_.test(idx) ? &dense_[idx] : nullptr;
+		auto fd = sparse_.find(v);
+		return fd == sparse_.end() ? nullptr : &fd->second;
+	}
+
+	[[nodiscard]] const T* find(const Value* v) const
+	{
+		return const_cast<ValueMap*>(this)->find(v);
+	}
+
+	[[nodiscard]] bool count(const Value* v) const
+	{
+		return find(v) != nullptr;
+	}
+
+	// 获取值对应的项, 不存在则返回 def
+	[[nodiscard]] T get_or(const Value* v, const T& def) const
+	{
+		auto fd = find(v);
+		return fd == nullptr ? def : *fd;
+	}
+
+	// 仅在不存在时插入, 与 std::unordered_map::emplace 语义一致
+	bool emplace(const Value* v, const T& val)
+	{
+		int idx = index(v);
+		if (idx >= 0)
+		{
+			if (!present_.setAndGet(idx)) return false;
+			dense_[idx] = val;
+			return true;
+		}
+		return sparse_.emplace(v, val).second;
+	}
+
+	void erase(const Value* v)
+	{
+		int idx = index(v);
+		if (idx >= 0)
+		{
+			if (present_.resetAndGet(idx)) dense_[idx] = T{};
+			return;
+		}
+		sparse_.erase(v);
+	}
+
+private:
+	// 值在数组中的下标, 不在编号范围内返回 -1
+	[[nodiscard]] int index(const Value* v) const
+	{
+		auto idx = static_cast<unsigned>(v->get_dense_id() - base_);
+		return idx < static_cast<unsigned>(size_) ? static_cast<int>(idx) : -1;
+	}
+
+	int base_;
+	int size_;
+	std::vector<T> dense_;
+	DynamicBitset present_;
+	std::unordered_map<const Value*, T> sparse_;
+};
+
+// 对值进行映射, 没有映射则返回它自身, 用于复制指令
+inline Value* getOrSelf(const ValueMap<Value*>& m, Value* v)
+{
+	auto fd = m.find(v);
+	return fd == nullptr ? v : *fd;
+}
@@ -3,7 +3,8 @@
 #include "Dominators.hpp"
 #include "PassManager.hpp"
 #include <memory>
-#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "Instruction.hpp"
 
@@ -31,14 +32,22 @@ class GVN final : public Pass
 		~ValueHash();
 
 		bool operator<(const ValueHash& r) const;
+		bool operator==(const ValueHash& r) const;
+	};
+
+	// 使用操作数的稠密编号计算哈希, 避免按指针排序的红黑树
+	struct ValueHashHasher
+	{
+		size_t operator()(const ValueHash& h) const;
 	};
 
 	enum gvn_state_t : uint8_t { firstdef, redundant, invalid };
 
-	std::map<ValueHash, Value*> expr_val_map_;
+	std::unordered_map<ValueHash, Value*, ValueHashHasher> expr_val_map_;
 	Dominators* dom_;
 
 	gvn_state_t visit_inst(Instruction* i);
+	static void remarkRepeatedLoad(Instruction* i, std::unordered_set<Value*>& loaded);
 
 public:
 	GVN(const GVN&) = delete;
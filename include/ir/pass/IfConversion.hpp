@@ -0,0 +1,46 @@
+#pragma once
+
+#include <unordered_set>
+
+#include "PassManager.hpp"
+#include "Remarks.hpp"
+
+class BasicBlock;
+
+/**
+ * 把只做计算的小分支合并为 select, 后端用 CSEL/FCSEL/CSINC/CSNEG 实现, 消除难以预测的条件跳转.
+ * 处理两种形状, B 以条件跳转结束, 分支块只有 B 一个前驱, 以无条件跳转到 M 结束, 且没有 phi:
+ * 菱形 B -> T, F -> M, 与三角形 B -> T -> M, B -> M.
+ * 分支中的指令被提前到 B 中执行, 所以只能是没有副作用且不会出错的计算(没有 load, store, call 和除法),
+ * 总数不超过 ifConversionMaxInsts. M 的 phi 变为以 B 的条件选择的 select, 随后 M 并入 B.
+ * 指针与 i1 的 phi 不合并, 因为 FuncInfo 等沿 phi 追踪指针来源, 而 i1 的值要由 CmpCombine 处理.
+ */
+class IfConversion final : public Pass
+{
+public:
+	IfConversion(const IfConversion&) = delete;
+	IfConversion(IfConversion&&) = delete;
+	IfConversion& operator=(const IfConversion&) = delete;
+	IfConversion& operator=(IfConversion&&) = delete;
+	~IfConversion() override = default;
+
+	explicit IfConversion(PassManager* manager, Module* m) : Pass(manager, m)
+	{
+		f_ = nullptr;
+	}
+
+	void run() override;
+
+private:
+	Function* f_;
+	// 当前函数中已被删除的基本块
+	std::unordered_set<BasicBlock*> removed_;
+	// 尝试合并以 bb 开始的分支, 成功时返回 true, bb 吸收了整个分支
+	bool runOnBlock(BasicBlock* bb);
+	// 分支块可以提前执行时返回空字符串, 否则返回原因, count 累加其指令数
+	static std::string checkArm(BasicBlock* arm, int& count);
+	// 把 from 的指令与后继并入 to, 然后删除 from
+	void mergeInto(BasicBlock* from, BasicBlock* to);
+	void remark(Remarks::Kind kind, const char* name, BasicBlock* bb, const std::string& message,
+	            const std::string& reason) const;
+};
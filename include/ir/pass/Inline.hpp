@@ -69,6 +69,8 @@ private:
 	void merge(IBBNode* pre, IBBNode* next) const;
 	void done2WaitList();
 	void mergeFunc();
+	// 为 f_ 的每个调用点输出没有内联的备注
+	void remarkNotInlined(const char* name, const std::string& reason) const;
 	[[nodiscard]] IBBNode* node(int i) const;
 	IBBNode* firstNext(const IBBNode* n) const;
 	IBBNode* firstPre(const IBBNode* n) const;
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+class BasicBlock;
+class Function;
+class GlobalVariable;
+
+/**
+ * IR 解释器, 以 -interp 启用. 它是一个普通的 pass, 可以加在任意 pass 之后, 执行模块的 main 函数.
+ * sylib 中的函数由解释器直接实现, 程序的输入输出就是编译器进程的标准输入输出.
+ * 执行前每个函数被预先翻译为以稠密编号为寄存器下标的指令序列, phi 在跳转的边上并行赋值.
+ * 整数运算按 32 位回绕, 除零, INT_MIN / -1 与浮点转整数的饱和都与 ARM64 一致; 越界访存与栈溢出抛出异常.
+ * 执行结束后向 interpretReportFile(为空时是标准错误)输出动态计数报告:
+ * 每种指令, 每个函数, 最热的基本块的执行次数以及访存量;
+ * interpretProfileFile 非空时向其输出每个基本块的执行次数, 作为 profile 供后续优化使用.
+ */
+class Interpret final : public Pass
+{
+public:
+	Interpret(const Interpret&) = delete;
+	Interpret(Interpret&&) = delete;
+	Interpret& operator=(const Interpret&) = delete;
+	Interpret& operator=(Interpret&&) = delete;
+
+	// main 的返回值写入 exitCode
+	Interpret(PassManager* mng, Module* m, int* exitCode);
+	~Interpret() override;
+
+	void run() override;
+
+private:
+	// 寄存器, 指针是 memory_ 中的偏移
+	union Slot
+	{
+		int i;
+		float f;
+		uint64_t p;
+	};
+
+	// 翻译后的指令, 比 Instruction::OpID 更细, 区分了整数与浮点, 访存宽度等
+	enum class Code : uint8_t
+	{
+		Add, Sub, Mul, SDiv, SRem, Shl, AShr, And,
+		FAdd, FSub, FMul, FDiv,
+		MAdd, MSub, MNeg, FMAdd, FMSub, FMNeg,
+		Ge, Gt, Le, Lt, Eq, Ne,
+		FGe, FGt, FLe, FLt, FEq, FNe,
+		Alloca, Load4, Load8, Store4, Store8,
+		Gep, Copy, FpToSi, SiToFp, Select, MemCpy, MemClear,
+		Call, LibCall, Br, CondBr, Ret, RetVoid
+	};
+
+	// sylib 中的函数
+	enum class Lib : uint8_t
+	{
+		StartTime, StopTime, GetInt, GetCh, GetFloat, GetArray, GetFArray,
+		PutInt, PutCh, PutArray, PutFloat, PutFArray
+	};
+
+	// dst, a, b, c 是寄存器下标或其它表的下标, imm 是立即数(常数偏移, 栈帧偏移, 字节数)
+	struct Op
+	{
+		Code code;
+		int dst;
+		int a;
+		int b;
+		int c;
+		int64_t imm;
+	};
+
+	// getelementptr 中的非常数下标
+	struct GepTerm
+	{
+		int slot;
+		int64_t stride;
+	};
+
+	// 跳转到 block, 同时执行 moves 中 [moveBegin, moveEnd) 的 phi 赋值
+	struct Edge
+	{
+		int block;
+		int moveBegin;
+		int moveEnd;
+	};
+
+	// 基本块与它的静态计数, 动态计数等于静态计数乘以执行次数
+	struct Block
+	{
+		BasicBlock* bb;
+		int begin;
+		int instructions;
+		int loads;
+		int stores;
+		int64_t loadBytes;
+		int64_t storeBytes;
+		int memcpys;
+		int memclears;
+		int64_t memcpyBytes;
+		int64_t memclearBytes;
+		std::array<int, Instruction::mneg + 1> opcodes;
+	};
+
+	struct LoweredFunction
+	{
+		Function* f;
+		std::vector<Block> blocks;
+		std::vector<Op> ops;
+		std::vector<Edge> edges;
+		// (目标寄存器, 源寄存器)
+		std::vector<std::pair<int, int>> moves;
+		std::vector<GepTerm> gepTerms;
+		std::vector<int> callArgs;
+		// 参数对应的寄存器
+		std::vector<int> args;
+		// 寄存器初值, 常数与全局变量地址占据编号之后的寄存器
+		std::vector<Slot> init;
+		int64_t frameBytes = 0;
+		std::vector<long long> blockCounts;
+		long long calls = 0;
+	};
+
+	// 调用者的状态
+	struct Frame
+	{
+		LoweredFunction* fn;
+		int pc;
+		size_t base;
+		uint64_t frame;
+		uint64_t sp;
+		int dst;
+	};
+
+	struct Timer
+	{
+		int beginLine;
+		int endLine;
+		long long us;
+	};
+
+	int* exitCode_;
+	std::vector<LoweredFunction*> functions_;
+	std::unordered_map<Function*, int> functionIndex_;
+	std::unordered_map<GlobalVariable*, uint64_t> globalAddress_;
+	std::vector<char> memory_;
+	// 栈顶, 其下是全局变量与活跃的栈帧
+	uint64_t sp_ = 0;
+	std::vector<Slot> regs_;
+	std::vector<Slot> moveBuffer_;
+	std::vector<Timer> timers_;
+	std::chrono::steady_clock::time_point timerBegin_;
+
+	void layoutGlobals();
+	LoweredFunction* lower(Function* f);
+	int execute(LoweredFunction* main);
+	// 进入 fn 的第 e 条边, 返回目标基本块的第一条指令
+	int takeEdge(LoweredFunction* fn, size_t base, int e);
+	uint64_t allocateFrame(int64_t bytes);
+	// 检查 [addr, addr + bytes) 可以访问
+	char* access(uint64_t addr, int64_t bytes);
+	Slot callLibrary(Lib lib, const Slot* args);
+	void printTimers() const;
+	void report(std::ostream& out) const;
+	void writeProfile(std::ostream& out) const;
+};
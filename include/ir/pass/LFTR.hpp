@@ -0,0 +1,35 @@
+#pragma once
+#include "PassManager.hpp"
+#include "Remarks.hpp"
+
+class Function;
+class Loop;
+
+/**
+ * 线性函数测试替换: 把只用于循环头退出判断的归纳变量换成向下计数到 0 的剩余次数.
+ * 处理步长为 1 且以 i < n, i <= n, i != n 继续, 或步长为 -1 且以 i > n, i >= n, i != n 继续的循环,
+ * n 在循环外定义, i 只被这次比较与自己的递增使用.
+ * 前置块中计算剩余次数 r = i op n ? n - i (+ 1) : 0, 循环头改为判断 r != 0, latch 中 r 减 1,
+ * 原来的 i, 它的递增与比较随之删除, n 在循环中也不再活跃. 后端把与 0 的相等比较输出为 CBZ/CBNZ.
+ * 次数按 32 位回绕计算, 在原循环不溢出时与原来的执行次数相同.
+ * 需要 LoopSimplify 与 LCSSA 作为前置, 在 LoopRotate 之后运行, 只处理没有被旋转、仍由循环头退出的循环.
+ */
+class LinearFunctionTestReplace final : public Pass
+{
+	Function* f_;
+	Loop* loop_;
+	bool runOnLoops(const std::vector<Loop*>& loops);
+	bool runOnLoop();
+	// 以当前循环的头为位置输出备注
+	void remark(Remarks::Kind kind, const char* name, const std::string& message, const std::string& reason) const;
+
+public:
+	void run() override;
+
+	LinearFunctionTestReplace(PassManager* manager, Module* m)
+		: Pass(manager, m)
+	{
+		f_ = nullptr;
+		loop_ = nullptr;
+	}
+};
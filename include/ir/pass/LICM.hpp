@@ -3,6 +3,7 @@
 #include "FuncInfo.hpp"
 #include "LoopDetection.hpp"
 #include "PassManager.hpp"
+#include "Remarks.hpp"
 #include <memory>
 #include <unordered_map>
 
@@ -31,4 +32,7 @@ private:
 	void run_on_loop(Loop* loop) const;
 	static void collect_loop_info(Loop* loop,
 	                              InstructionList& loop_instructions);
+	// 以指令所在位置输出备注
+	static void remark(Remarks::Kind kind, const char* name, Instruction* inst, const std::string& message,
+	                   const std::string& reason);
 };
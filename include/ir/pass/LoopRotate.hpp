@@ -1,6 +1,8 @@
 #pragma once
 #include "LoopDetection.hpp"
 #include "PassManager.hpp"
+#include "Remarks.hpp"
+#include "ValueMap.hpp"
 
 class Dominators;
 class Loop;
@@ -18,17 +20,22 @@ class LoopRotate : public Pass
 	Function* f_;
 	Dominators* dominators_;
 	Loop* loop_;
+	// 复制的循环头指令到其副本的映射, 每个函数编号一次, 每次旋转清空
+	ValueMap<Value*> vmap_;
+	// 循环头 phi 到其在 latch 中值的映射
+	ValueMap<Value*> phiReplace_;
 	void runOnFunc();
 	bool runOnLoops(const std::vector<Loop*>& loops);
 	void splicePreheader() const;
-	static void copyInst2(const BasicBlock* enter, BasicBlock* from, BasicBlock* to, std::unordered_map<Value*, Value*>& v_map);
-	void moveHeadInst2Latch(const std::unordered_map<Value*, Value*>& v_map) const;
-	static Value* getOrDefault(const std::unordered_map<Value*, Value*>& vmap, Value* val);
-	void toWhileTrue(const Loop::Iterator& msg) const;
-	void erasePhi(const Loop::Iterator& msg) const;
-	void rotate(const Loop::Iterator& msg) const;
-	void forceRotate() const;
-	bool runOnLoop() const;
+	static void copyInst2(const BasicBlock* enter, BasicBlock* from, BasicBlock* to, ValueMap<Value*>& v_map);
+	void moveHeadInst2Latch(const ValueMap<Value*>& v_map);
+	void toWhileTrue(const Loop::Iterator& msg);
+	void erasePhi(const Loop::Iterator& msg);
+	void rotate(const Loop::Iterator& msg);
+	void forceRotate();
+	bool runOnLoop();
+	// 以当前循环的头为位置输出备注
+	void remark(Remarks::Kind kind, const char* name, const std::string& message, const std::string& reason) const;
 
 public:
 	void run() override;
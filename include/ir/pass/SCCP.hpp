@@ -6,6 +6,7 @@
 #include "Type.hpp"
 #include "Constant.hpp"
 #include "BasicBlock.hpp"
+#include "ValueMap.hpp"
 
 #include <iostream>
 #include <set>
@@ -88,25 +89,28 @@ struct ValStatus{
     }
 };
 
-class ValueMap {
+// 每个值的格状态, 常数总是 CONST
+class StatusMap {
   public:
-    void clear() { value_map_.clear(); }
+    void reset(const Function* f) { value_map_.reset(f); }
     ValStatus get(Value* key) {
         if (auto constant = dynamic_cast<Constant*>(key))
-            value_map_[key] = {ValStatus::CONST, constant};
+            return {ValStatus::CONST, constant};
         return value_map_[key];
     }
     void set(Value* key, ValStatus value) { value_map_[key] = value; }
 
   private:
-    std::map<Value*, ValStatus> value_map_;
+    ValueMap<ValStatus> value_map_;
 };
 
 class SCCPVisitor;
 class SCCP final : public Pass
 {
-    ValueMap value_map;
+    StatusMap value_map;
     std::set<std::pair<BasicBlock*, BasicBlock*>> visited;
+    // 基本块是否已经由控制流可达
+    ValueMap<char> executable;
     std::vector<std::pair<BasicBlock*, BasicBlock*>> flow_worklist; // first->second由控制流可达
     std::vector<Instruction*> value_worklist;
     std::unique_ptr<SCCPVisitor> visitor_;
@@ -121,7 +125,7 @@ public:
 
 	void run() override;
     void run(Function* f);
-    ValueMap& get_map() { return value_map; }
+    StatusMap& get_map() { return value_map; }
     ValStatus get_mapped_val(Value* key) { return value_map.get(key); }
 
     void replace_with_constant(Function* f);
@@ -148,10 +152,11 @@ public:
 private:
     void visit_br(const BranchInst* inst); // 仅检查基本块的可达性
     void visit_phi(PhiInst* inst);
+    void visit_select(const SelectInst* inst);
     void visit_fold(Instruction* inst);
 
     SCCP& sccp;
-    ValueMap& val_map;
+    StatusMap& val_map;
     std::vector<std::pair<BasicBlock *, BasicBlock *>>& flow_worklist;
     std::vector<Instruction *>& value_worklist;
 
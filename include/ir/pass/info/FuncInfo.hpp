@@ -1,6 +1,7 @@
 #pragma once
 
 #include "PassManager.hpp"
+#include "ValueMap.hpp"
 
 #include <unordered_map>
 #include <unordered_set>
@@ -59,8 +60,10 @@ private:
 	std::unordered_map<Function*, UseMessage> loads;
 	// 函数是否因为调用库函数而变得非纯函数
 	std::unordered_map<Function*, bool> useImpureLibs;
+	// 指针值到它来源的全局变量或参数, 编号范围在 run 中确定, flush 时只清空
+	ValueMap<Value*> spMap_;
 
-	void spread(Value* val, std::unordered_map<Value*, Value*>& spMap);
-	void spreadLoadsIn(Value* val, std::unordered_map<Value*, Value*>& spMap, std::unordered_set<Function*>& fs);
-	void spreadGlobalIn(Value* val, std::unordered_map<Value*, Value*>& spMap, std::unordered_set<Function*>& fs);
+	void spread(Value* val, ValueMap<Value*>& spMap);
+	void spreadLoadsIn(Value* val, ValueMap<Value*>& spMap, std::unordered_set<Function*>& fs);
+	void spreadGlobalIn(Value* val, ValueMap<Value*>& spMap, std::unordered_set<Function*>& fs);
 };
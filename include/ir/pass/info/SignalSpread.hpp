@@ -28,6 +28,7 @@ class SignalSpread : public GlobalInfoPass
 	void spreadFDiv(Instruction* inst);
 	void spreadLoad(Instruction* inst);
 	void spreadPhi(Instruction* inst);
+	void spreadSelect(Instruction* inst);
 	void spreadFP2SI(Instruction* inst);
 	void spreadSI2FP(Instruction* inst);
 	void spreadCall(const Instruction* inst);
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <vector>
+#include "CompilationContext.hpp"
 #include "Module.hpp"
 
 class PassManager;
@@ -83,6 +84,7 @@ public:
 
 	void run() const
 	{
+		CompilationContext::Bind bind{m_->context()};
 		for (auto& pass : passes_)
 		{
 			pass->run();
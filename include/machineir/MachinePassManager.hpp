@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <vector>
+#include "CompilationContext.hpp"
 #include "MachineModule.hpp"
 
 class MachinePass
@@ -37,6 +38,7 @@ public:
 
 	void run() const
 	{
+		CompilationContext::Bind bind{m_->context()};
 		for (auto& pass : passes_)
 		{
 			pass->run();
@@ -78,8 +78,13 @@ public:
 
 	~MBasicBlock();
 	float weight_ = 1;
+	// 对应的 IR 基本块开始的源代码行, 0 表示未知
+	int line_ = 0;
 
 	CodeString* blockPrefix_ = nullptr;
+	// BlockLayout 决定的对齐, 标签前输出 .p2align alignLog2_,,alignMaxPadding_, 0 表示不对齐
+	int alignLog2_ = 0;
+	int alignMaxPadding_ = 0;
 
 	static MBasicBlock* createBasicBlock(const std::string& name, MFunction* function);
 	void accept(BasicBlock* block, std::map<Value*, MOperand*>& opMap, std::map<BasicBlock*, MBasicBlock*>& blockMap,
@@ -103,6 +108,7 @@ public:
 	                             , MBasicBlock* block);
 	void mergePhiCopies(std::list<MCopy*>& copies);
 	void acceptZextInst(Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block);
+	void acceptSelectInst(Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block);
 	void acceptFpToSiInst(Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block);
 	void acceptSiToFpInst(Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block);
 	void acceptMemCpyInst(Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block);
@@ -34,6 +34,8 @@ public:
 	CodeString* funcPrefix_ = nullptr;
 	CodeString* funcSuffix_ = nullptr;
 	std::string sizeSuffix_;
+	// BlockLayout 决定的函数入口对齐, 输出 .p2align alignLog2_, 0 表示不对齐
+	int alignLog2_ = 0;
 
 	[[nodiscard]] const std::string& name() const
 	{
@@ -51,6 +53,8 @@ public:
 	}
 
 	~MFunction();
+	// 删除函数体, 保留调用者仍要使用的栈参数, 栈帧大小, 调用关系与破坏的寄存器
+	void releaseBody();
 
 private:
 	friend class FrameIndex;
@@ -148,6 +152,8 @@ public:
 	[[nodiscard]] std::string print() const;
 	MOperand* getOperandFor(Value* value, std::map<Value*, MOperand*>& opMap);
 	void spill(VirtualRegister* vreg, LiveMessage* message);
+	// 删除已经没有指令与前驱的基本块, 并重新编号
+	void removeBlock(MBasicBlock* bb);
 	void replaceAllOperands(MOperand* from, MOperand* to);
 	void replaceAllOperands(std::unordered_map<FrameIndex*, FrameIndex*>& rpm);
 	void addUse(MOperand* op, MInstruction* ins);
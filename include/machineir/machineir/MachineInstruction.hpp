@@ -6,7 +6,9 @@
 
 
 class MCMP;
+class MCCMP;
 class MCSET;
+class MCSEL;
 class MMAddSUB;
 class MFunction;
 class VirtualRegister;
@@ -162,6 +164,8 @@ class MB final : public MInstruction
 public:
 	MCMP* tiedWith_ = nullptr;
 	Instruction::OpID op_;
+	// CodeGen 把只被跳转使用的与 0 的相等比较合并进跳转时, 被比较的寄存器名, 输出 CBZ/CBNZ
+	std::string zeroTest_;
 
 	[[nodiscard]] Instruction::OpID op() const
 	{
@@ -231,11 +235,27 @@ public:
 	void replaceR(MBasicBlock* to);
 };
 
+// 第二个操作数参与运算前的移位或扩展, 由 ShiftFold 把只在这里使用的左移, 右移与 SXTW 合并得到
+enum class OperandShift : uint8_t
+{
+	none,
+	lsl,
+	asr,
+	// 32 位寄存器符号扩展到 64 位后再左移
+	sxtw
+};
+
+std::string printShift(OperandShift shift, int amount);
+
 class MMathInst final : public MInstruction
 {
 public:
 	int width_;
 	Instruction::OpID op_;
+	OperandShift shift_ = OperandShift::none;
+	int shiftAmount_ = 0;
+	// FlagFold 删除了之后与 0 的比较, 输出 ADDS/SUBS/ANDS 设置 NZCV
+	bool setFlags_ = false;
 
 	[[nodiscard]] Instruction::OpID op() const
 	{
@@ -252,6 +272,7 @@ public:
 	void onlyAddUseReplace(const MOperand* from, MOperand* to, MFunction* parent) override;
 	void stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent) override;
 	static MInstruction* createOptimizedNNegMul(MBasicBlock* block, MOperand* l, MOperand* r, MOperand* t, int width);
+	void setFlags();
 	std::string print() override;
 };
 
@@ -288,12 +309,113 @@ public:
 	void stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent) override;
 };
 
-class MCMP final : public MInstruction
+// 带偏移寻址的访存 [base, offset], 由 AddressFold 把地址计算合并进 LDR/STR 得到.
+// offset 是立即数时为字节偏移; 是寄存器时为下标, 地址为 base + (extend(offset) << shift_),
+// sxtw_ 时下标是 32 位, 用 SXTW 扩展, 否则是 64 位, 用 LSL
+class MIndexedMem : public MInstruction
+{
+	int width_;
+	int shift_;
+	bool sxtw_;
+	// 第一个使用的操作数, LDR 的 0 号操作数是定义
+	int firstUse_;
+
+protected:
+	explicit MIndexedMem(MBasicBlock* block, MOperand* regLike, MOperand* base, MOperand* offset, int width,
+	                     int shift, bool sxtw, bool isLoad);
+	// 相同的操作数只使用一次
+	void resetUses();
+	std::string printAddress() const;
+
+public:
+	[[nodiscard]] int width() const
+	{
+		return width_;
+	}
+
+	[[nodiscard]] int shift() const
+	{
+		return shift_;
+	}
+
+	[[nodiscard]] bool sxtw() const
+	{
+		return sxtw_;
+	}
+
+	void replace(MOperand* from, MOperand* to, MFunction* parent) override;
+	void onlyAddUseReplace(const MOperand* from, MOperand* to, MFunction* parent) override;
+	void stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent) override;
+};
+
+class MLDRIdx final : public MIndexedMem
+{
+public:
+	explicit MLDRIdx(MBasicBlock* block, MOperand* regLike, MOperand* base, MOperand* offset, int width, int shift,
+	                 bool sxtw);
+	std::string print() override;
+};
+
+class MSTRIdx final : public MIndexedMem
+{
+public:
+	explicit MSTRIdx(MBasicBlock* block, MOperand* regLike, MOperand* base, MOperand* offset, int width, int shift,
+	                 bool sxtw);
+	std::string print() override;
+};
+
+// 成对访存 [stackLike + offset] 与紧随其后的 width_ 位, 由 LoadStorePair 合并相邻的 LDR/STR 得到.
+// stackLike 是栈帧或基址寄存器, offset 是立即数字节偏移
+class MPairMem : public MInstruction
+{
+	int width_;
+	// 第一个使用的操作数, LDP 的 0, 1 号操作数是定义
+	int firstUse_;
+
+protected:
+	explicit MPairMem(MBasicBlock* block, MOperand* first, MOperand* second, MOperand* stackLike, MOperand* offset,
+	                  int width, bool isLoad);
+	std::string printAddress() const;
+
+public:
+	// 给被调用函数传递栈上参数
+	bool forCall_ = false;
+
+	[[nodiscard]] int width() const
+	{
+		return width_;
+	}
+};
+
+class MLDP final : public MPairMem
+{
+public:
+	explicit MLDP(MBasicBlock* block, MOperand* first, MOperand* second, MOperand* stackLike, MOperand* offset,
+	              int width);
+	std::string print() override;
+};
+
+class MSTP final : public MPairMem
+{
+public:
+	explicit MSTP(MBasicBlock* block, MOperand* first, MOperand* second, MOperand* stackLike, MOperand* offset,
+	              int width);
+	std::string print() override;
+};
+
+class MCMP : public MInstruction
 {
 public:
 	MCSET* tiedC_ = nullptr;
 	MB* tiedB_ = nullptr;
+	// 使用这次比较结果的条件比较
+	MCCMP* tiedCC_ = nullptr;
+	// 使用这次比较结果的条件选择, 可以有多个
+	std::vector<MCSEL*> tiedS_;
 	bool itff_;
+	// 右操作数的移位, 只用于整数比较
+	OperandShift shift_ = OperandShift::none;
+	int shiftAmount_ = 0;
 	explicit MCMP(MBasicBlock* block, MOperand* l, MOperand* r, bool itff);
 	std::string print() override;
 	void replace(MOperand* from, MOperand* to, MFunction* parent) override;
@@ -301,6 +423,19 @@ public:
 	void stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent) override;
 };
 
+// 条件比较 CCMP/CCMN/FCCMP, 由 CondCompare 合并短路求值的比较链得到.
+// 紧挨在前面的比较 tiedWith_ 满足 cond_ 时比较两个操作数, 否则直接设置 NZCV,
+// 使使用者(tiedB_ 或 tiedCC_)的条件取 skipValue_
+class MCCMP final : public MCMP
+{
+public:
+	MCMP* tiedWith_ = nullptr;
+	Instruction::OpID cond_;
+	bool skipValue_;
+	explicit MCCMP(MBasicBlock* block, MOperand* l, MOperand* r, bool itff, Instruction::OpID cond, bool skipValue);
+	std::string print() override;
+};
+
 class MBL final : public MInstruction
 {
 public:
@@ -320,6 +455,36 @@ public:
 	std::string print() override;
 };
 
+// 由 select 翻译得到, 按紧挨在前面的 MCMP 设置的 NZCV 选择两个操作数之一
+class MCSEL final : public MInstruction
+{
+public:
+	enum Kind : uint8_t
+	{
+		// t = cond ? a : b, CSEL/FCSEL
+		SELECT,
+		// t = cond ? a : a + 1, CSINC
+		INCREMENT,
+		// t = cond ? a : -a, CSNEG
+		NEGATE
+	};
+
+	MCMP* tiedWith_ = nullptr;
+	Instruction::OpID op_;
+	Kind kind_;
+	int width_;
+	// INCREMENT 与 NEGATE 的 b 与 a 相同
+	explicit MCSEL(MBasicBlock* block, Instruction::OpID op, Kind kind, MOperand* t, MOperand* a, MOperand* b,
+	               int width);
+	std::string print() override;
+	void replace(MOperand* from, MOperand* to, MFunction* parent) override;
+	void onlyAddUseReplace(const MOperand* from, MOperand* to, MFunction* parent) override;
+	void stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent) override;
+
+private:
+	void resetUse();
+};
+
 class MFCVTZS final : public MInstruction
 {
 public:
@@ -367,6 +532,24 @@ public:
 	std::string print() override;
 };
 
+// 位域指令 UBFX/SBFX/UBFIZ/SBFIZ, 由 ShiftFold 合并移位与掩码得到.
+// 提取取 from 的 [lsb_, lsb_ + bits_) 位放到最低位; insert_ 时取 from 的低 bits_ 位放到 lsb_ 开始的位置.
+// signed_ 时高位用最高的有效位填充, 否则填 0
+class MBitField final : public MInstruction
+{
+public:
+	int width_;
+	bool signed_;
+	bool insert_;
+	int lsb_;
+	int bits_;
+	explicit MBitField(MBasicBlock* block, MOperand* from, MOperand* to, int width, bool isSigned, bool insert, int lsb,
+	                   int bits);
+	// 指令名, 例如 UBFX
+	[[nodiscard]] std::string name() const;
+	std::string print() override;
+};
+
 class MMAddSUB final : public MInstruction
 {
 public:
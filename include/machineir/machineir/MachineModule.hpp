@@ -5,7 +5,10 @@
 #include "DynamicBitset.hpp"
 
 class CodeString;
+class CompilationContext;
 class Module;
+class Function;
+class GlobalVariable;
 class MFunction;
 class GlobalAddress;
 class FuncAddress;
@@ -43,12 +46,15 @@ private:
 	std::vector<MFunction*> functions_;
 	std::vector<MFunction*> lib_functions_;
 	std::vector<MFunction*> allFuncs_;
+	std::map<Function*, MFunction*> funcMap_;
+	std::map<GlobalVariable*, GlobalAddress*> globalMap_;
 	std::map<MFunction*, FuncAddress*> func_address_;
 	std::map<unsigned long long, Immediate*> imm_cache_;
 	std::vector<Register*> iregs_;
 	std::vector<Register*> fregs_;
 	MFunction* memcpy_;
 	MFunction* memclr_;
+	CompilationContext* context_;
 
 public:
 	[[nodiscard]] const std::vector<MFunction*>& all_funcs() const
@@ -58,6 +64,14 @@ public:
 
 	MModule();
 	void accept(Module* module);
+	// 为所有函数创建 MFunction 并确定栈参数, 之后可以用 lower 逐批降级函数体
+	void declare(Module* module);
+	// 降级一批函数, 并让 functions() 只包含它们, 之后的 pass 只处理这一批
+	void lower(const std::vector<Function*>& window);
+	// 释放 functions() 中函数的函数体, 只保留调用者需要的栈参数, 栈帧大小与破坏的寄存器
+	void release();
+	// 调用图的强连通分量, 被调用者在调用者之前, 互相递归的函数在同一个分量中
+	[[nodiscard]] static std::vector<std::vector<Function*>> callGraphOrder(Module* module);
 
 	[[nodiscard]] MFunction* memcpyFunc() const
 	{
@@ -69,7 +83,15 @@ public:
 		return memclr_;
 	}
 
+	// 创建模块时线程绑定的编译上下文, 运行 pass 时会重新绑定它
+	[[nodiscard]] CompilationContext* context() const
+	{
+		return context_;
+	}
+
 	[[nodiscard]] std::string print() const;
+	// 输出 functions() 中函数的汇编, operator<< 在它前后加上模块的前缀与后缀
+	void printFunctions(std::ostream& os) const;
 	[[nodiscard]] int IRegisterCount() const;
 	[[nodiscard]] int FRegisterCount() const;
 	[[nodiscard]] int RegisterCount() const;
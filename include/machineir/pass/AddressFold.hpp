@@ -0,0 +1,33 @@
+#pragma once
+
+#include "MachinePassManager.hpp"
+
+class MBasicBlock;
+class MMathInst;
+class MOperand;
+
+/**
+ * 把数组元素的地址计算合并进 LDR/STR 的寻址方式.
+ * getelementptr 降级为 64 位 add base, offset, 结果只被同一块中之后的 LDR/STR 用作地址时, 删除 add,
+ * 访存改为 [base, #imm], [base, Wm, SXTW #2] 或 [base, Xm, LSL #2], 下标的左移与 SXTW 也一并合并.
+ * 在寄存器分配之前运行, 少一个地址寄存器, 循环中每次访问少一到两条指令.
+ */
+class AddressFold final : public MachinePass
+{
+public:
+	explicit AddressFold(MModule* m)
+		: MachinePass(m)
+	{
+	}
+
+	void run() override;
+
+private:
+	MFunction* f_ = nullptr;
+	// 尝试合并 bb 中的地址计算 add, 成功时返回 true
+	bool fold(MBasicBlock* bb, MMathInst* add) const;
+	// bb 中 (from, to) 之间的指令都不定义 op
+	static bool unchanged(MBasicBlock* bb, int from, int to, const MOperand* op);
+	// bb 中 before 之前最近的定义 op 的指令的下标, 没有时返回 -1
+	static int defBefore(MBasicBlock* bb, int before, const MOperand* op);
+};
@@ -11,6 +11,7 @@ class Loop;
 /**
  * 基本块排序
  * 将环中的基本块排在一起(并非自然循环)
+ * 排序后对齐函数入口与最内层循环头, 见 alignLoops
  **/
 class BlockLayout final : public MachinePass
 {
@@ -83,6 +84,8 @@ class BlockLayout final : public MachinePass
 	unsigned* costMap_ = nullptr;
 	unsigned workListGate_ = 0;
 	int blockCount_ = 0;
+	// 排序前的最内层循环的头与块集合, 排序会修改 MachineLoop 中的块集合
+	std::vector<std::pair<MBasicBlock*, DynamicBitset>> innerLoops_;
 	void runOnFunc();
 	void runOnLoops(const std::vector<MachineLoop*>& loops);
 	void runOnLoop(MachineLoop* loop);
@@ -97,6 +100,9 @@ class BlockLayout final : public MachinePass
 	unsigned cost(const BBNode* from, const BBNode* to) const;
 	void merge(BBNode* from, BBNode* to, DynamicBitset& care);
 	static unsigned lenOf(BBNode* node);
+	// 函数入口对齐到 16 字节. 不大的最内层循环的头也对齐, 最多填充 loopAlignMaxPadding 字节,
+	// 按布局落入循环头的块每次执行都要经过填充, 它在循环中或者不比循环头冷时不对齐
+	void alignLoops() const;
 
 public:
 	BlockLayout(const BlockLayout& other) = delete;
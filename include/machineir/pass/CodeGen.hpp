@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <list>
 #include <string>
 #include <vector>
@@ -9,6 +10,11 @@
 class MMAddSUB;
 class MMathInst;
 class MCMP;
+class MCCMP;
+class MIndexedMem;
+class MPairMem;
+class MBitField;
+class MCSEL;
 class FuncAddress;
 class Instruction;
 class FrameIndex;
@@ -21,18 +27,45 @@ class MFunction;
 class ConstantValue;
 class GlobalAddress;
 class MModule;
+enum class OperandShift : uint8_t;
 
 // 生成实际的汇编指令
 class CodeGen : public MachinePass
 {
+public:
+	// 生成的部分, 逐函数编译时模块的前缀, 每批函数与后缀分别生成
+	enum Part : uint8_t
+	{
+		// 全部
+		WHOLE_MODULE,
+		// 全局变量与 .incbin 数据
+		GLOBALS,
+		// functions() 中的函数
+		FUNCTIONS,
+		// 用到的 memcpy/memclr
+		LIBRARY
+	};
+
+private:
+	Part part_;
 	MFunction* func_ = nullptr;
 	MFunction* func2Call_ = nullptr;
+	// 通过 .incbin 引用的全局数据, 在 run 结束时写入 globalDataIncbinFile
+	std::string incbinData_;
 	static std::string word(const std::vector<ConstantValue>* v);
+	static std::string word(const std::vector<ConstantValue>& v, int begin, int end);
 	static std::string zero(int count);
+	static std::string fill(int count, const ConstantValue& v);
 	static std::string size(const std::string& globName, int bytes);
 	static std::string size(const std::string& globName, long long bytes);
-	void makeGlobal(const GlobalAddress* address) const;
+	void makeGlobal(const GlobalAddress* address);
+	// 输出一段全局数据, 连续相同的值使用 .fill/.zero, 重复的模式使用 .rept, 其余使用 .word
+	void makeGlobalWords(const std::vector<ConstantValue>& v);
 	void makeFunction();
+	// 模块前缀: 全局变量与 .text 段的开头, 同时写出 .incbin 数据
+	void makeGlobals();
+	// 模块后缀: 用到的 memcpy/memclr 实现
+	void makeLibrary();
 	void functionPrefix();
 	void functionSuffix();
 	static void add(const Register* to, const Register* l, const Register* r, int len, CodeString* toStr);
@@ -50,6 +83,13 @@ class CodeGen : public MachinePass
 	static void ldp(const Register* a, const Register* b, const Register* c, int offset, int len, CodeString* toStr);
 	void ldr(const Register* a, const Register* baseOffsetReg, long long offset, int len, CodeString* toStr);
 	void ldr(const MOperand* a, const MOperand* stackLike, int len, CodeString* toStr);
+	// 以 ADRP 与 :lo12: 访问全局变量 glob 偏移 offset 处, op 为 LDR 或 STR; 加载整数时用目标寄存器保存页地址
+	void globalMem(const char* op, const Register* value, const GlobalAddress* glob, long long offset, int len,
+	               CodeString* toStr);
+	// AddressFold 得到的带偏移寻址的 LDR/STR
+	void indexedMem(const MIndexedMem* inst, bool isLoad, CodeString* toStr);
+	// LoadStorePair 合并得到的 LDP/STP
+	void pairMem(const MPairMem* inst, bool isLoad, CodeString* toStr);
 	void ld1(const Register* stackLike, int count, int offset, CodeString* toStr);
 	void ld1(const MOperand* stackLike, int count, int offset, CodeString* toStr);
 	static void clearV(int count, CodeString* toStr);
@@ -57,6 +97,10 @@ class CodeGen : public MachinePass
 	void mathInst(const MOperand* t, const MOperand* l, const MOperand* r,
 	              Instruction::OpID op,
 	              int len, CodeString* toStr);
+	// ShiftFold 得到的第二个操作数带移位或扩展的 ADD/SUB
+	void shiftedMathInst(const MMathInst* inst, CodeString* toStr);
+	// FlagFold 得到的设置 NZCV 的 ADDS/SUBS/ANDS
+	void flagMathInst(const MMathInst* inst, CodeString* toStr);
 	void add32(const Register* to, const Register* l, int imm, CodeString* toStr);
 	static void lsl32(const Register* to, const Register* l, int imm, CodeString* toStr);
 	static void lsl64(const Register* to, const Register* l, long long imm, CodeString* toStr);
@@ -70,14 +114,21 @@ class CodeGen : public MachinePass
 	void call(const MOperand* address, CodeString* toStr);
 	static void ret(CodeString* toStr);
 	void cset(const MOperand* to, Instruction::OpID cond, CodeString* toStr);
+	void csel(const MCSEL* inst, CodeString* toStr);
 	void f2i(const MOperand* from, const MOperand* to, CodeString* toStr);
 	void i2f(const MOperand* from, const MOperand* to, CodeString* toStr);
 	void extend32To64(const MOperand* from, const MOperand* to, CodeString* toStr);
+	// ShiftFold 得到的位域提取与插入
+	void bitField(const MBitField* inst, CodeString* toStr);
 	void compare(const MCMP* inst, const MOperand* l, const MOperand* r, bool flt, CodeString* toStr);
+	void condCompare(const MCCMP* inst, CodeString* toStr);
 	static void reverseCmpOp(const MCMP* inst);
 	static void sub(const Register* to, const Register* l, const Register* r, int len, CodeString* toStr);
 	void mathRRInst(const Register* to, const Register* l, const Register* r, Instruction::OpID op,
 	                int len, CodeString* toStr);
+	// r 先移位或扩展, 只用于 add 与 sub; SXTW 时 r 是 32 位寄存器
+	void mathRRInst(const Register* to, const Register* l, const Register* r, Instruction::OpID op,
+	                int len, OperandShift shift, int amount, CodeString* toStr);
 	void maddsub(MOperand* to, MOperand* l, MOperand* r, MOperand* s, bool isAdd, int width, CodeString* toStr);
 	void mneg(MOperand* to, MOperand* l, MOperand* r, CodeString* toStr);
 	static void fsub(const Register* to, const Register* l, const Register* r, CodeString* toStr);
@@ -109,7 +160,11 @@ class CodeGen : public MachinePass
 	static std::string functionSize(const std::string& name);
 	static std::string regDataOffset(const Register* reg, int offset);
 	static std::string regDataRegLSLOffset(const Register* reg, const Register* regofs, int offset);
+	// [Xn, Wm, SXTW #shift] 或 [Xn, Xm, LSL #shift], shift 为 0 时省略
+	static std::string regDataRegExtendOffset(const Register* reg, const Register* regofs, bool sxtw, int shift);
 	static std::string regData(const Register* reg);
+	// 全局变量加上字节偏移的符号表达式, 如 a+16
+	static std::string globalSymbol(const GlobalAddress* glob, long long offset);
 	static const char* genMemcpy();
 	static const char* genMemclr();
 	static bool canLSInOneSPMove(const std::vector<std::pair<Register*, long long>>& offsets);
@@ -134,8 +189,12 @@ public:
 	static bool immCanInlineInAddSub(int imm);
 	static bool immCanInlineInAddSub(long long imm);
 	static int ldrNeedInstCount(long long offset, int len);
+	// 立即数偏移可以直接编码在 LDR/STR 中(9 位有符号偏移或按访存大小缩放的 12 位无符号偏移)
+	static bool ldrOffsetCanInline(long long offset, int len);
+	// 立即数偏移可以直接编码在 LDP/STP 中(按访存大小缩放的 7 位有符号偏移)
+	static bool pairOffsetCanInline(long long offset, int len);
 	static int copyFrameNeedInstCount(long long offset);
 	static int makeI64ImmediateNeedInstCount(long long i);
-	CodeGen(MModule* m);
+	CodeGen(MModule* m, Part part = WHOLE_MODULE);
 	void run() override;
 };
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "MachinePassManager.hpp"
+
+class MB;
+class MBasicBlock;
+
+/**
+ * 把短路求值 && 与 || 得到的比较链合并为 CMP + CCMP/FCCMP, 只留下最后一个条件跳转.
+ * B1 以比较与条件跳转结束, 一侧跳到 B2, 另一侧跳到 S; B2 只有 B1 一个前驱, 只有一次比较与条件跳转,
+ * 且其中一侧也跳到 S. 此时 B2 的比较成为 B1 中的条件比较: B1 的条件使控制流到达 B2 时才比较,
+ * 否则直接设置 NZCV, 使 B2 的跳转去往 S. 随后 B2 被删除, 链上的块可以反复合并.
+ * B2 中不能有其他指令, 所以条件比较不会提前执行任何有副作用或会出错的计算.
+ * S 有 phi 时 CriticalEdgeRemove 为 B1 -> S 与 B2 -> S 各插入一个块, 两个块只做相同的复制时也可以合并.
+ * 在寄存器分配之前运行, 分配插入的 spill 代码不修改 NZCV.
+ */
+class CondCompare final : public MachinePass
+{
+public:
+	explicit CondCompare(MModule* m)
+		: MachinePass(m)
+	{
+	}
+
+	void run() override;
+
+private:
+	MFunction* f_ = nullptr;
+	// 尝试把 bb 跳转到的比较块并入 bb, 成功时返回 true
+	bool runOnBlock(MBasicBlock* bb) const;
+	// bb 的最后两条指令是比较与使用它的条件跳转时返回条件跳转
+	static MB* condBranch(MBasicBlock* bb);
+};
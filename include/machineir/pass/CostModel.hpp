@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MachineLoopDetection.hpp"
+#include "MachinePassManager.hpp"
+
+/**
+ * 静态的机器码耗时估计, 类似 llvm-mca, 以 -mca-report 启用. 它必须在 CodeGen 之后运行, 分析的是将要输出的汇编.
+ * 处理器模型是 Cortex-A72: 每周期发射 3 条指令, 执行端口为 B, I0, I1, M, L, S, F0, F1,
+ * 每条指令有延迟, 可用的端口和占用端口的周期数. 模拟按程序顺序发射, 乱序执行, 只考虑寄存器与 NZCV 的依赖.
+ * 循环体重复模拟多次, 取每次迭代的平均周期作为稳态吞吐; 循环之外的代码只模拟一次.
+ * 函数的估计 = 循环外代码 + 每层循环按 useMultiplierPerLoop 次迭代加权的循环体.
+ */
+class CostModel final : public MachinePass
+{
+public:
+	enum Port : uint8_t
+	{
+		B, I0, I1, M, L, S, F0, F1, PORT_COUNT
+	};
+
+	// 一条汇编指令的资源与依赖
+	struct Uop
+	{
+		int latency;
+		// 可用端口的位掩码
+		unsigned ports;
+		// 占用端口的周期数, 不能流水的除法等于延迟
+		int occupancy;
+		std::vector<int> srcs;
+		std::vector<int> dsts;
+	};
+
+	// 一次模拟的结果, 均为每次迭代的平均值
+	struct Estimate
+	{
+		double cycles = 0;
+		int instructions = 0;
+		std::array<double, PORT_COUNT> pressure{};
+		// 限制吞吐的因素, 端口名, dispatch 或 latency
+		std::string bottleneck;
+	};
+
+	CostModel(const CostModel&) = delete;
+	CostModel(CostModel&&) = delete;
+	CostModel& operator=(const CostModel&) = delete;
+	CostModel& operator=(CostModel&&) = delete;
+
+	explicit CostModel(MModule* m);
+	~CostModel() override = default;
+
+	void run() override;
+
+	// 解析一行汇编, 不是指令(标签, 伪指令)时返回 false
+	static bool parse(const std::string& line, Uop& uop);
+	// 模拟 uops 重复执行 iterations 次
+	static Estimate simulate(const std::vector<Uop>& uops, int iterations);
+
+private:
+	MFunction* func_ = nullptr;
+	MachineLoopDetection detect_;
+	// 报告文件在构造时打开, 逐函数编译时每批函数的报告接在后面
+	std::ofstream file_;
+	std::ostream* out_ = nullptr;
+	// 循环检测重新编号之前的基本块名, 以新编号为下标
+	std::vector<std::string> names_;
+	// 每个基本块将要输出的指令
+	std::vector<std::vector<Uop>> blockUops_;
+
+	void runOnFunc();
+	void collectBlock(MBasicBlock* bb);
+	// 返回循环一次进入的总周期(含子循环), 并输出该循环的报告
+	double runOnLoop(MachineLoop* loop, int depth);
+	static std::string portName(int port);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "MachinePassManager.hpp"
+
+class MBasicBlock;
+class MCMP;
+class Register;
+
+/**
+ * 把 32 位整数与 0 的比较合并进定义被比较值的 ADD/SUB/AND, 输出 ADDS/SUBS/ANDS 并删除 CMP.
+ * 比较的使用者只有跳转与条件选择, 都在同一块中紧跟比较, 所以 NZCV 不跨块活跃,
+ * 只需检查定义与比较之间的指令不定义也不使用 NZCV.
+ * ADDS/SUBS 的 C 与 V 和 CMP Wd, #0 不同, 只有使用者的条件都是 eq/ne 时合并; ANDS 清零 C 与 V,
+ * 所有有符号条件都可以. 在 ShiftFold 之后, 寄存器分配之前运行, 分配插入的 spill 代码不修改 NZCV.
+ */
+class FlagFold final : public MachinePass
+{
+public:
+	explicit FlagFold(MModule* m)
+		: MachinePass(m)
+	{
+	}
+
+	void run() override;
+
+private:
+	Register* nzcv_ = nullptr;
+	// 尝试把比较 cmp 合并进被比较值的定义, 成功时返回 true
+	bool fold(MBasicBlock* bb, MCMP* cmp) const;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "MachinePassManager.hpp"
+
+class MBasicBlock;
+
+/**
+ * 把同一基址上相邻的两次 LDR/STR 合并为 LDP/STP, 包括 spill 与 reload, 函数入口读取栈上参数,
+ * 调用前写入栈上参数以及 AddressFold 得到的立即数偏移访存.
+ * 在 FrameOffset 之后运行, 此时栈帧的偏移已经确定. 两次访存之间最多隔 window 条指令:
+ * 加载对把后一次提前到前一次的位置, 中间不能有写内存的指令或调用; 存储对把前一次推迟到后一次的位置,
+ * 中间不能访问内存. 被移动的访存使用的寄存器在中间不能被重新定义, 加载的结果在中间也不能被使用.
+ * 偏移在 CodeGen 中超出 LDP/STP 的范围时拆回两条指令.
+ */
+class LoadStorePair final : public MachinePass
+{
+public:
+	explicit LoadStorePair(MModule* m)
+		: MachinePass(m)
+	{
+	}
+
+	void run() override;
+
+private:
+	// 两次访存之间最多隔的指令数
+	static constexpr int window = 8;
+	void runOnBlock(MBasicBlock* bb) const;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <vector>
+
+#include "MachineLoopDetection.hpp"
+#include "MachinePassManager.hpp"
+
+/**
+ * 寄存器压力与 spill 热图, 以 -reg-pressure-report 启用. 它在寄存器分配(以及 RegSpill, CleanCode)之后,
+ * FrameOffset 之前运行, 此时 spill 与 reload 仍是访问 %spilledFrame 的 STR/LDR, 或 RegSpill 生成的 FSIMDMOV.
+ * 每条指令的压力由 LiveMessage 计算: 指令执行时占用的整数寄存器与浮点寄存器数(指令后活跃, 使用与显式定值之并),
+ * 以及由 FrameLiveMessage 计算的活跃的 spill 栈槽数, 即被挤到内存中的值.
+ * 报告先给出每个函数, 每层循环与每个循环深度的汇总, 再给出标注了压力与 spill/reload 位置的指令清单.
+ * 只做分析, 不改变输出.
+ */
+class RegPressure final : public MachinePass
+{
+public:
+	enum Mark : uint8_t
+	{
+		NONE, SPILL, RELOAD, SPILL_FPR, RELOAD_FPR
+	};
+
+	// 一条指令处的压力
+	struct Point
+	{
+		int ints = 0;
+		int floats = 0;
+		// 活跃的 spill 栈槽
+		int slots = 0;
+		Mark mark = NONE;
+		// spill/reload 读写内存的字节数
+		int bytes = 0;
+	};
+
+	// 一组基本块的汇总
+	struct Summary
+	{
+		int maxInts = 0;
+		int maxFloats = 0;
+		int spills = 0;
+		int reloads = 0;
+		// spill 到浮点寄存器以及从中取回的次数
+		int fprMoves = 0;
+		int bytes = 0;
+		// 按基本块权重加权的 spill/reload 字节数
+		double weightedBytes = 0;
+	};
+
+	RegPressure(const RegPressure&) = delete;
+	RegPressure(RegPressure&&) = delete;
+	RegPressure& operator=(const RegPressure&) = delete;
+	RegPressure& operator=(RegPressure&&) = delete;
+
+	explicit RegPressure(MModule* m);
+	~RegPressure() override = default;
+
+	void run() override;
+
+private:
+	MFunction* func_ = nullptr;
+	MachineLoopDetection detect_;
+	// 构造时打开, 多次 run 的报告写在同一个文件中
+	std::ofstream file_;
+	std::ostream* out_ = nullptr;
+	// 以基本块编号为下标
+	std::vector<std::vector<Point>> points_;
+	std::vector<int> depth_;
+	// 可分配的整数与浮点寄存器数
+	int intRegs_ = 0;
+	int floatRegs_ = 0;
+
+	void runOnFunc();
+	// 计算整数(isInt)或浮点寄存器的压力
+	void collectRegs(bool isInt);
+	// 计算活跃的 spill 栈槽数, 并标记 spill 与 reload
+	void collectSpills();
+	void add(Summary& summary, int bb) const;
+	void printLoop(MachineLoop* loop, int depth, const std::vector<std::string>& names);
+	static void print(std::ostream& out, const Summary& summary);
+};
@@ -40,5 +40,6 @@ public:
 	}
 
 	RegisterAllocate(MModule* module);
+	~RegisterAllocate() override;
 	void run() override;
 };
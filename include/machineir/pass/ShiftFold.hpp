@@ -0,0 +1,33 @@
+#pragma once
+
+#include "MachinePassManager.hpp"
+
+class MBasicBlock;
+class MInstruction;
+class MMathInst;
+
+/**
+ * 把只被一条 ADD/SUB/CMP 使用的左移, 算术右移与 SXTW 合并进它的第二个操作数,
+ * 得到 ADD Wd, Wn, Wm, LSL #k 与 ADD Xd, Xn, Wm, SXTW #k 这样的移位寄存器与扩展寄存器形式.
+ * 在 AddressFold 之后, 寄存器分配之前运行: 地址计算先合并进访存, 剩下的 getelementptr 的 add 与
+ * 乘以 2 的幂得到的左移在这里合并. SXTW 之后左移不超过 4 位时两条指令一起合并.
+ * 之后把 Arithmetic 得到的移位与掩码对合并为位域指令: (x >> a) & (2^n - 1) 为 UBFX,
+ * (x & (2^n - 1)) << a 为 UBFIZ, (x << a) >> b 为 SBFX 或 SBFIZ.
+ */
+class ShiftFold final : public MachinePass
+{
+public:
+	explicit ShiftFold(MModule* m)
+		: MachinePass(m)
+	{
+	}
+
+	void run() override;
+
+private:
+	MFunction* f_ = nullptr;
+	// 尝试把 user 的第 idx 个操作数的定义合并进 user, 成功时返回 true
+	bool fold(MBasicBlock* bb, MInstruction* user, int idx) const;
+	// 尝试把 inst 与它的第一个操作数的定义合并为位域指令, 成功时返回 true
+	bool foldBitField(MBasicBlock* bb, MMathInst* inst) const;
+};
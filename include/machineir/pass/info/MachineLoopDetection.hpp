@@ -51,6 +51,28 @@ class MachineLoopDetection : public MachinePass
 	void removeUnreachable() const;
 
 public:
+	// 循环检测会删除不可达的基本块, 并按位置重新编号与命名. 只做分析的 pass 在检测前构造它:
+	// 先摘下不可达的块(它们不会执行), 析构时复原块列表, 编号与名字, 不改变输出
+	class PreserveBlocks
+	{
+		MFunction* func_;
+		std::vector<MBasicBlock*> all_;
+		std::vector<std::pair<int, std::string>> saved_;
+		std::vector<std::string> names_;
+		// 有不可达前驱的块与原来的前驱集合
+		std::vector<std::pair<MBasicBlock*, std::set<MBasicBlock*>>> preds_;
+
+	public:
+		PreserveBlocks(const PreserveBlocks&) = delete;
+		PreserveBlocks(PreserveBlocks&&) = delete;
+		PreserveBlocks& operator=(const PreserveBlocks&) = delete;
+		PreserveBlocks& operator=(PreserveBlocks&&) = delete;
+		explicit PreserveBlocks(MFunction* f);
+		~PreserveBlocks();
+		// 重新编号之前的基本块名, 以新编号为下标
+		[[nodiscard]] const std::vector<std::string>& names() const { return names_; }
+	};
+
 	MachineLoopDetection(const MachineLoopDetection&) = delete;
 	MachineLoopDetection(MachineLoopDetection&&) = delete;
 	MachineLoopDetection& operator=(const MachineLoopDetection&) = delete;
@@ -66,4 +88,6 @@ public:
 	void run_on_func(MFunction* f);
 	void print() const;
 	std::vector<MachineLoop*>& get_loops() { return loops_; }
+	// 按循环头在布局中的位置排序, 分析报告按这个顺序输出
+	static std::vector<MachineLoop*> byHeader(std::vector<MachineLoop*> loops);
 };
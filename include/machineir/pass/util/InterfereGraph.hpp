@@ -2,8 +2,10 @@
 
 #include "DynamicBitset.hpp"
 #include "LiveMessage.hpp"
+#include "Remarks.hpp"
 
 struct MoveInstNode;
+class MBasicBlock;
 class MCopy;
 class RegisterAllocate;
 
@@ -27,6 +29,8 @@ struct InterfereGraphNode
 	InterfereGraphNode* alias_ = nullptr;
 	// 颜色
 	Register* color_ = nullptr;
+	// 使用或定义该寄存器的基本块中 weight_ 最大的, 用于优化备注
+	MBasicBlock* hottest_ = nullptr;
 
 	void add(InterfereGraphNode* target);
 	void remove(InterfereGraphNode* target) const;
@@ -144,6 +148,9 @@ class InterfereGraph
 	bool inGraph(const InterfereGraphNode* n) const;
 
 	bool adj(const InterfereGraphNode* l, const InterfereGraphNode* r) const;
+	// 以节点最热的基本块为位置输出寄存器分配的备注
+	void remark(Remarks::Kind kind, const char* name, const InterfereGraphNode* node, const std::string& message,
+	            const std::string& reason) const;
 
 public:
 	InterfereGraph(const InterfereGraph& other) = delete;
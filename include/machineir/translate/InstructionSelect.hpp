@@ -1,6 +1,8 @@
 #pragma once
 #include "PassManager.hpp"
 
+class Instruction;
+
 // 合并 IR 中的一些指令为新的指令
 // 合并后的 IR 不再是合法的 LLVM IR
 class InstructionSelect : public Pass
@@ -8,6 +10,10 @@ class InstructionSelect : public Pass
 	Function* f_;
 	BasicBlock* b_;
 	void runInner() const;
+	// ninst 替代了 inst 与 use, 继承 use 的行号并输出备注
+	void fused(const Instruction* inst, Instruction* use, Instruction* ninst, const char* name) const;
+	// 乘法没有与它的加减合并
+	void notFused(Instruction* inst, const std::string& reason) const;
 public:
 
 	explicit InstructionSelect(PassManager* mng, Module* m)
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Config.hpp"
+
+class TypeAllocator;
+
+// 一次编译使用的全部选项的值
+struct CompilationOptions
+{
+#define SYSY_CONFIG_OPTION_FIELD(type, name) type name;
+	SYSY_CONFIG_OPTIONS(SYSY_CONFIG_OPTION_FIELD)
+#undef SYSY_CONFIG_OPTION_FIELD
+
+	// 读取当前线程的选项
+	static CompilationOptions capture();
+	// 写入当前线程的选项
+	void apply() const;
+};
+
+/**
+ * 一次编译的上下文, 持有这次编译的选项和类型表(数组, 函数, 指针类型); 常量池由 Module 持有.
+ * 选项和类型表都按线程查找, 上下文通过 Bind 绑定到当前线程后, 不同线程上的编译互不干扰.
+ * Module 和 MModule 在创建时记录当前上下文, PassManager 和 MachinePassManager 运行时重新绑定它.
+ * 基础类型(Types::INT 等)不可变, 仍由所有上下文共享.
+ */
+class CompilationContext
+{
+public:
+	CompilationContext(const CompilationContext& other) = delete;
+	CompilationContext(CompilationContext&& other) = delete;
+	CompilationContext& operator=(const CompilationContext& other) = delete;
+	CompilationContext& operator=(CompilationContext&& other) = delete;
+
+	// 以当前线程的选项创建上下文
+	CompilationContext();
+	explicit CompilationContext(const CompilationOptions& options);
+	~CompilationContext();
+
+	[[nodiscard]] const CompilationOptions& options() const { return options_; }
+	[[nodiscard]] TypeAllocator* types() const { return types_; }
+
+	// 当前线程绑定的上下文, 没有时返回 nullptr
+	static CompilationContext* current();
+
+	// 在作用域内将上下文绑定到当前线程, 离开时恢复之前的上下文和选项
+	class Bind
+	{
+	public:
+		explicit Bind(CompilationContext* context);
+		~Bind();
+		Bind(const Bind& other) = delete;
+		Bind(Bind&& other) = delete;
+		Bind& operator=(const Bind& other) = delete;
+		Bind& operator=(Bind&& other) = delete;
+
+	private:
+		CompilationContext* context_;
+		CompilationContext* previous_;
+		CompilationOptions previousOptions_;
+	};
+
+private:
+	CompilationOptions options_;
+	TypeAllocator* types_;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+
+/**
+ * 以内容寻址的编译缓存, 以 -fcache-dir=<dir> 启用.
+ * 键是源文件内容, 编译器构建(可执行文件的大小与修改时间)和所有影响输出的选项的哈希,
+ * 值是编译输出(汇编, IR 或 AST), 命中时直接复制输出而不运行编译流程.
+ * 缓存目录的总大小超过上限时, 按最近使用时间淘汰最旧的条目.
+ * 统计信息(命中, 未命中, 淘汰次数)保存在缓存目录的 stats 文件中, 多个进程可以共享同一个缓存目录.
+ */
+class CompileCache
+{
+public:
+	CompileCache(std::string dir, long long maxBytes);
+
+	// 计算当前线程的选项下编译 source 的键
+	[[nodiscard]] static std::string key(const char* begin, const char* end);
+	// 命中时将缓存的输出写入 outfile 并返回 true
+	bool fetch(const std::string& key, const std::string& outfile) const;
+	// 将编译得到的 outfile 存入缓存, 必要时淘汰旧条目
+	void store(const std::string& key, const std::string& outfile) const;
+	// 统计信息的文字描述
+	[[nodiscard]] std::string stats() const;
+
+private:
+	std::string dir_;
+	long long maxBytes_;
+
+	[[nodiscard]] std::string entryPath(const std::string& key) const;
+	// 在缓存目录的锁内更新统计信息, 给出的计数累加到 stats 文件中
+	void addStats(long long hits, long long misses, long long evictions) const;
+	// 在缓存目录的锁内淘汰条目直到总大小不超过上限
+	void evict() const;
+};
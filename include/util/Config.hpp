@@ -1,90 +1,222 @@
 #pragma once
+#include <string>
 
 // 全局变量在函数的使用次数大于等于这个阈值时，它的地址在函数开始时会加载到寄存器中，而非直接寻址
-extern int replaceGlobalAddressWithRegisterNeedUseCount;
+extern thread_local int replaceGlobalAddressWithRegisterNeedUseCount;
 // alloca 对象的地址在函数的使用次数 * spill 开销大于等于这个阈值时，它的地址在函数开始时会加载到寄存器中，而非直接寻址
-extern float replaceAllocaAddressWithRegisterNeedTotalCost;
+extern thread_local float replaceAllocaAddressWithRegisterNeedTotalCost;
 // alloca 对象的地址在函数的使用次数大于等于这个阈值时，它的地址在函数开始时会加载到寄存器中，而非直接寻址, 这只在不使用 stackOffset 计算 cost 时有效
-extern int replaceAllocaAddressWithRegisterNeedUseCount;
+extern thread_local int replaceAllocaAddressWithRegisterNeedUseCount;
 // 常量的使用次数 * spill 开销大于等于这个阈值时, 它会被加载到寄存器而非每次使用拼凑
-extern float prefillConstantNeedTotalCost;
+extern thread_local float prefillConstantNeedTotalCost;
 // 假定每个循环会运行几次, 在循环内的一次使用就相当于循环外的几次使用
-extern int useMultiplierPerLoop;
+extern thread_local int useMultiplierPerLoop;
 // 全局变量存在寄存器中的地址在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高(全局变量一般使用文字池加载地址)
-extern float globalRegisterSpillPriority;
+extern thread_local float globalRegisterSpillPriority;
 // 常全局变量存在寄存器中的地址在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高(全局变量一般使用文字池加载地址)
-extern float constGlobalRegisterSpillPriority;
+extern thread_local float constGlobalRegisterSpillPriority;
 // 大的 alloca 变量存在寄存器中的地址在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高
-extern float bigAllocaRegisterSpillPriority;
+extern thread_local float bigAllocaRegisterSpillPriority;
 // 小的 alloca 变量存在寄存器中的地址在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高
-extern float smallAllocaRegisterSpillPriority;
+extern thread_local float smallAllocaRegisterSpillPriority;
 // 多大的 alloca 变量被视为大的. 通常越大的变量离 sp 越远(因为栈排序), 使用单指令完成寻址越困难
-extern int bigAllocaVariableGate;
+extern thread_local int bigAllocaVariableGate;
 // 在溢出之后, 是否使用图着色尝试合并不冲突的 FrameIndex, 以缩减栈的大小
-extern bool mergeStackFrameSpilledWithGraphColoring;
+extern thread_local bool mergeStackFrameSpilledWithGraphColoring;
 // 是否在图着色时首先使用调用者保存的寄存器. 对于较为简单的函数调用可以省去保存寄存器的工作, 但这会造成更大的编译器运行压力.
-extern bool useCallerSaveRegsFirst;
+extern thread_local bool useCallerSaveRegsFirst;
 // 对于不能用一条 FMOV 拼凑的浮点数, 使用一条 LDR 而非两条 MOV 一条 FMOV 拼凑.
-extern bool useLDRInsteadOfMovFMove2CreateFloat;
+extern thread_local bool useLDRInsteadOfMovFMove2CreateFloat;
 // 对于要用 MOV 拼凑的整数, 当需要的 MOV 数量大于这个数量, 改为用 LDR.
-extern int useLDRInsteadOfMov2CreateIntegerWhenMovCountBiggerThan;
+extern thread_local int useLDRInsteadOfMov2CreateIntegerWhenMovCountBiggerThan;
 // 对于要用 MOV 拼凑的浮点数, 当需要的 MOV 数量大于这个数量, 改为用 LDR. 如果不用 LDR, 会多一条 FMOV, 所以这个值一般比整数小 1.
-extern int useLDRInsteadOfMov2CreateFloatWhenMovCountBiggerThan;
+extern thread_local int useLDRInsteadOfMov2CreateFloatWhenMovCountBiggerThan;
 // 栈中传递的参数在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高
-extern float fixFrameIndexParameterRegisterSpillPriority;
+extern thread_local float fixFrameIndexParameterRegisterSpillPriority;
 // 大于多少字节的数组需要对齐到 16 字节(ABI 强制要求大于 8 字节全局数组对齐到 16 字节, 不受该选项控制)
-extern int alignTo16NeedBytes;
+extern thread_local int alignTo16NeedBytes;
 // 当 memcpy 的字节数小于等于这个选项 x 16 时, 使用内联实现而非调用函数(一般而言这个数字 -4, 指令减少 2 条, 12 的时候是 8 条)
-extern int maxCopyInstCountToInlineMemcpy;
+extern thread_local int maxCopyInstCountToInlineMemcpy;
 // 当 memset 的字节数小于等于这个选项 x 16 时, 使用内联实现而非调用函数(一般而言这个数字 -4, 指令减少 1 条, 8 的时候是 8 条)
-extern int maxCopyInstCountToInlineMemclr;
+extern thread_local int maxCopyInstCountToInlineMemclr;
 // 当开启该选项时, 对指针偏移量的运算使用 64 位计算(例如 getelement), 否则使用 32 位 (由于没做上游支持, 大概率都达不到预期功能)
-extern bool use64BitsMathOperationInPointerOp;
+extern thread_local bool use64BitsMathOperationInPointerOp;
 // 是否像普通寄存器一样使用零寄存器, 因此生成的一些指令 ADD W0, WZR, #2 在某些环境下会报错
-extern bool useZRRegisterAsCommonRegister;
+extern thread_local bool useZRRegisterAsCommonRegister;
 // 当开启时, 忽略图着色中的部分 ASSERT 检查
-extern bool graphColoringWeakNodeCheck;
+extern thread_local bool graphColoringWeakNodeCheck;
 // 测试 AST, 生成 C 文件
-extern bool emitAST;
+extern thread_local bool emitAST;
 // 测试 IR, 生成 LLVM 文件
-extern bool emitIR;
+extern thread_local bool emitIR;
+// 连续相同的全局数据达到这个数量时使用 .fill 输出; 重复模式覆盖的全局数据达到这个数量时使用 .rept 输出
+extern thread_local int globalDataFillGate;
+// 全局数据中检测的重复模式的最大长度
+extern thread_local int globalDataReptMaxPattern;
+// 全局数据中长度不超过这个数量的默认值段合并到相邻的 .word 中, 而不是单独输出 .zero
+extern thread_local int globalDataZeroMergeGate;
+// 将较长的全局数据写入旁路文件, 在汇编中通过 .incbin 引用, 以减小汇编文件体积
+extern thread_local bool emitGlobalDataAsIncbin;
+// 长度大于等于这个数量的全局数据才写入旁路文件
+extern thread_local int globalDataIncbinGate;
+// 旁路文件的路径, 由命令行根据输出文件设置
+extern thread_local std::string globalDataIncbinFile;
+// 使用手写的词法与语法分析器而非 antlr 生成 AST, 源文件通过内存映射读取
+extern thread_local bool useFastFrontend;
+// IR 优化后按调用图逐批降级, 分配寄存器, 输出并释放函数, 峰值内存只与最大的一批函数有关; 关闭时整个模块一起处理
+extern thread_local bool streamFunctions;
+// 编译缓存目录, 为空时不使用缓存
+extern thread_local std::string compileCacheDir;
+// 编译缓存目录的大小上限(MB), 超过时淘汰最久未使用的条目
+extern thread_local int compileCacheMaxMegabytes;
+// 编译结束后打印编译缓存的统计信息
+extern thread_local bool printCompileCacheStats;
+// 编译结束后打印各阶段的耗时与峰值内存
+extern thread_local bool printTimeReport;
+// 不生成输出文件, 而是用 Interpret pass 解释执行程序并报告动态计数
+extern thread_local bool interpretModule;
+// 解释执行的时机: ast2ir(不运行任何 pass), ir(IR 优化之后), lower(IR2MIR 的准备 pass 之后)
+extern thread_local std::string interpretStage;
+// 动态计数报告的输出文件, 为空时输出到标准错误
+extern thread_local std::string interpretReportFile;
+// 每个基本块执行次数的 profile 输出文件, 为空时不输出
+extern thread_local std::string interpretProfileFile;
+// 代码生成后打印静态耗时估计(CostModel)的报告
+extern thread_local bool printMcaReport;
+// 静态耗时估计报告的输出文件, 为空时输出到标准错误
+extern thread_local std::string mcaReportFile;
+// 寄存器分配后打印每条指令的寄存器压力与 spill 位置的报告
+extern thread_local bool printRegPressureReport;
+// 寄存器压力报告的输出文件, 为空时输出到标准错误
+extern thread_local std::string regPressureReportFile;
+// 优化备注: 输出 pass 名匹配这个正则的 pass 完成的变换, 为空时不输出
+extern thread_local std::string remarkPassFilter;
+// 优化备注: 输出 pass 名匹配这个正则的 pass 没能完成的变换及原因, 为空时不输出
+extern thread_local std::string remarkMissedFilter;
+// 优化备注: 输出 pass 名匹配这个正则的 pass 的分析结果, 为空时不输出
+extern thread_local std::string remarkAnalysisFilter;
+// 所有优化备注的输出文件, 以 .json 结尾时输出 JSON, 否则输出 YAML, 为空时不输出
+extern thread_local std::string remarkFile;
 // 使用 O1 优化
-extern bool o1Optimization;
+extern thread_local bool o1Optimization;
 // 进行运行前检查, 检测目标架构的某些功能是否符合预期
-extern bool testArchi;
+extern thread_local bool testArchi;
 // 当函数的指令数(无跳转)小于等于该值时(包括 ret), 它会被内联
-extern int funcInlineGate;
+extern thread_local int funcInlineGate;
 // 函数的所有函数结束尾声加起来大于等于这个数字, 需要单独开辟一个返回基本块, 而不是将尾声内联到 RET
-extern int epilogShouldMerge;
+extern thread_local int epilogShouldMerge;
 // 推断 srem 的左操作数和结果符号保持相同, 这并不总是有效的, 尤其是当 ar[op % 4], 此时推断 op >= 0, 但是其可能是 -4 的倍数
-extern bool dangerousSignalInfer;
+extern thread_local bool dangerousSignalInfer;
 // 忽略可能存在的负数组偏移, 这代表不再使用 SXTW 将 getelement 的偏移计算从 32 拓展到 64 位
-extern bool ignoreNegativeArrayIndexes;
+extern thread_local bool ignoreNegativeArrayIndexes;
 // 在一个虚拟寄存器需要 spill 时, 首先尝试将它的定值放置到尽可能靠后的地方(这称为 sink) 而非存入栈
-extern bool useSinkForVirtualRegister;
+extern thread_local bool useSinkForVirtualRegister;
 // 是否使用算数指令合并
-extern bool useBinaryInstMerge;
+extern thread_local bool useBinaryInstMerge;
 // 是否尝试合并浮点指令, 例如将 FMUL 和 FSUB 合并为 FMSUB, 这可能导致与分开时不同的结果(由于舍入误差)
-extern bool mergeFloatBinaryInst;
+extern thread_local bool mergeFloatBinaryInst;
 // 只有当加减指令的操作数全是寄存器, 才尝试与乘法合并, 这样可以确保合并不会增加指令
-extern bool onlyMergeMulAndASWhenASUseAllReg;
+extern thread_local bool onlyMergeMulAndASWhenASUseAllReg;
 // 使用 stackOffset 来计算 spill 的消耗
-extern bool useStackOffset2GetspillCost;
+extern thread_local bool useStackOffset2GetspillCost;
 // 在 AST 中就进行循环旋转和添加 loop guard
-extern bool loopRotateAndAddGuardInAST;
+extern thread_local bool loopRotateAndAddGuardInAST;
 // 即使没有循环不变量, 只要循环旋转可以消除 phi 或 cbr, 就进行旋转
-extern bool rotateLoopEvenIfNotHaveInvariant;
+extern thread_local bool rotateLoopEvenIfNotHaveInvariant;
 // 大于等于这个数量的循环不变量才会导致循环被旋转
-extern int invariantNeed2RotateLoop;
+extern thread_local int invariantNeed2RotateLoop;
 // 禁止条件比较变量的循环外提, 因为 i1 外提后还必须 cset 再在比较处用到
-extern bool disableCondLICM;
+extern thread_local bool disableCondLICM;
 // 禁止条件比较变量的 GVN, 出于 disableCondLICM 同样的原因
-extern bool disableCondGVN;
+extern thread_local bool disableCondGVN;
 // 使用 sink 并不能就很有效的在少量 spill 下减小寄存器压力(因为使用相同操作数的概率较小), 只有在 spill 大于等于这个数字才使用 sink
-extern int useSinkGate;
+extern thread_local int useSinkGate;
 // 使用浮点寄存器进行 spill, 使用 FMOV 而非 LDR/STR
-extern bool useFloatRegAsStack2Spill;
+extern thread_local bool useFloatRegAsStack2Spill;
 // 使用符号推断来发掘隐藏的强度削弱机会，符号推断会在存在有符号数字溢出时出错
-extern bool useSignalInfer;
+extern thread_local bool useSignalInfer;
 // 使用尾递归消除
-extern bool removeTailRecursive;
\ No newline at end of file
+extern thread_local bool removeTailRecursive;
+// IfConversion 把分支合并为 select 时, 两个分支中可以提前执行的指令总数上限, 负数表示不合并
+extern thread_local int ifConversionMaxInsts;
+// BlockLayout 把最内层循环头对齐到 16 字节时最多填充的字节数, 0 表示不对齐循环头
+extern thread_local int loopAlignMaxPadding;
+// 以逗号分隔的 IR 优化 pass 序列, 替换 addPasses4IR 中的默认流水线, 为空时使用默认流水线
+extern thread_local std::string irPassPipeline;
+// 以逗号分隔的 pass 名, 这些 pass 在流水线中被跳过
+extern thread_local std::string disabledPasses;
+
+// 所有选项的列表, X(类型, 名称), 用于在编译上下文中保存与恢复选项; 选项的默认值与说明在 Config.cpp 中注册到 OptionRegistry
+#define SYSY_CONFIG_OPTIONS(X) \
+	X(int, replaceGlobalAddressWithRegisterNeedUseCount) \
+	X(float, replaceAllocaAddressWithRegisterNeedTotalCost) \
+	X(int, replaceAllocaAddressWithRegisterNeedUseCount) \
+	X(float, prefillConstantNeedTotalCost) \
+	X(int, useMultiplierPerLoop) \
+	X(float, globalRegisterSpillPriority) \
+	X(float, constGlobalRegisterSpillPriority) \
+	X(float, bigAllocaRegisterSpillPriority) \
+	X(float, smallAllocaRegisterSpillPriority) \
+	X(int, bigAllocaVariableGate) \
+	X(bool, mergeStackFrameSpilledWithGraphColoring) \
+	X(bool, useCallerSaveRegsFirst) \
+	X(bool, useLDRInsteadOfMovFMove2CreateFloat) \
+	X(int, useLDRInsteadOfMov2CreateIntegerWhenMovCountBiggerThan) \
+	X(int, useLDRInsteadOfMov2CreateFloatWhenMovCountBiggerThan) \
+	X(float, fixFrameIndexParameterRegisterSpillPriority) \
+	X(int, alignTo16NeedBytes) \
+	X(int, maxCopyInstCountToInlineMemcpy) \
+	X(int, maxCopyInstCountToInlineMemclr) \
+	X(bool, use64BitsMathOperationInPointerOp) \
+	X(bool, useZRRegisterAsCommonRegister) \
+	X(bool, graphColoringWeakNodeCheck) \
+	X(bool, emitAST) \
+	X(bool, emitIR) \
+	X(int, globalDataFillGate) \
+	X(int, globalDataReptMaxPattern) \
+	X(int, globalDataZeroMergeGate) \
+	X(bool, emitGlobalDataAsIncbin) \
+	X(int, globalDataIncbinGate) \
+	X(std::string, globalDataIncbinFile) \
+	X(bool, useFastFrontend) \
+	X(bool, streamFunctions) \
+	X(std::string, compileCacheDir) \
+	X(int, compileCacheMaxMegabytes) \
+	X(bool, printCompileCacheStats) \
+	X(bool, printTimeReport) \
+	X(bool, interpretModule) \
+	X(std::string, interpretStage) \
+	X(std::string, interpretReportFile) \
+	X(std::string, interpretProfileFile) \
+	X(bool, printMcaReport) \
+	X(std::string, mcaReportFile) \
+	X(bool, printRegPressureReport) \
+	X(std::string, regPressureReportFile) \
+	X(std::string, remarkPassFilter) \
+	X(std::string, remarkMissedFilter) \
+	X(std::string, remarkAnalysisFilter) \
+	X(std::string, remarkFile) \
+	X(bool, o1Optimization) \
+	X(bool, testArchi) \
+	X(int, funcInlineGate) \
+	X(int, epilogShouldMerge) \
+	X(bool, dangerousSignalInfer) \
+	X(bool, ignoreNegativeArrayIndexes) \
+	X(bool, useSinkForVirtualRegister) \
+	X(bool, useBinaryInstMerge) \
+	X(bool, mergeFloatBinaryInst) \
+	X(bool, onlyMergeMulAndASWhenASUseAllReg) \
+	X(bool, useStackOffset2GetspillCost) \
+	X(bool, loopRotateAndAddGuardInAST) \
+	X(bool, rotateLoopEvenIfNotHaveInvariant) \
+	X(int, invariantNeed2RotateLoop) \
+	X(bool, disableCondLICM) \
+	X(bool, disableCondGVN) \
+	X(int, useSinkGate) \
+	X(bool, useFloatRegAsStack2Spill) \
+	X(bool, useSignalInfer) \
+	X(bool, removeTailRecursive) \
+	X(int, ifConversionMaxInsts) \
+	X(int, loopAlignMaxPadding) \
+	X(std::string, irPassPipeline) \
+	X(std::string, disabledPasses)
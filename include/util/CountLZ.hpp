@@ -18,3 +18,12 @@ inline int m_countr_zero(unsigned long long x) noexcept
      return __builtin_ctzll(x);
 #endif
 }
+
+inline int m_popcount(unsigned long long x) noexcept
+{
+#if CZ_MSVC
+	return static_cast<int>(__popcnt64(x));
+#else
+	return __builtin_popcountll(x);
+#endif
+}
@@ -45,6 +45,8 @@ public:
 	bool operator!=(const DynamicBitset& bit) const;
 	[[nodiscard]] bool allZeros() const;
 	[[nodiscard]] bool include(const DynamicBitset& bit) const;
+	// 置位的比特数
+	[[nodiscard]] int count() const;
 	[[nodiscard]] unsigned len() const;
 	[[nodiscard]] std::string print() const;
 	[[nodiscard]] std::string print(const std::function<std::string(int)>& sf) const;
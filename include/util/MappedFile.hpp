@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+// 只读映射整个文件, 在 POSIX 下使用 mmap, 否则退化为一次性读入内存
+// 映射的内容不以 '\0' 结尾, 只能通过 [begin, end) 访问
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	[[nodiscard]] const char* begin() const { return data_; }
+	[[nodiscard]] const char* end() const { return data_ + size_; }
+	[[nodiscard]] size_t size() const { return size_; }
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	// 是否由 mmap 得到, 否则是 new 出的缓冲区
+	bool mapped_ = false;
+};
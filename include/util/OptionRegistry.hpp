@@ -0,0 +1,52 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * 选项注册表. Config.cpp 中的每个选项在定义时注册自己的名字, 类型, 默认值与说明,
+ * 命令行的 -opt 名字=值 与 -opt-file=<文件> 通过它按名字写入当前线程的选项, 不需要重新编译.
+ * 注册在静态初始化时完成, 之后只读, 可以被多个编译线程同时查询.
+ */
+class OptionRegistry
+{
+public:
+	struct Option
+	{
+		const char* name;
+		const char* type;
+		std::string defaultValue;
+		const char* description;
+		// 当前线程的值
+		std::string (*get)();
+		// 解析并写入当前线程, 格式错误时抛出异常
+		void (*set)(const std::string& value);
+	};
+
+	// 定义为静态变量时注册一个选项
+	class Registrar
+	{
+	public:
+		explicit Registrar(const Option& option);
+	};
+
+	// 按注册顺序(即 Config.cpp 中的顺序)排列的所有选项
+	static const std::vector<Option>& options();
+	// 按名字查找, 找不到时返回 nullptr
+	static const Option* find(const std::string& name);
+	// 解析 "名字=值" 并写入当前线程, 出错时抛出异常
+	static void assign(const std::string& assignment);
+	// 读取选项文件, 返回其中的每个 "名字=值"; 空行与 # 开头的行被忽略
+	static std::vector<std::string> load(const std::string& path);
+	// 打印所有选项的名字, 类型, 当前值, 默认值与说明
+	static void print(std::ostream& os);
+
+	static std::string toString(int value);
+	static std::string toString(float value);
+	static std::string toString(bool value);
+	static std::string toString(const std::string& value);
+	static void parse(const std::string& text, int& value);
+	static void parse(const std::string& text, float& value);
+	static void parse(const std::string& text, bool& value);
+	static void parse(const std::string& text, std::string& value);
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * 优化备注, 说明 pass 完成了或没能完成某个变换以及原因, 类似 clang 的 -Rpass.
+ * -Rpass=<正则> 输出名字匹配的 pass 完成的变换, -Rpass-missed=<正则> 输出没能完成的变换,
+ * -Rpass-analysis=<正则> 输出分析结果, 格式为 "<文件>:<行>: remark: <函数>/<基本块>: <信息> [-Rpass=<pass>]", 写到标准错误.
+ * -remarks-file=<文件> 把所有备注写入文件, 文件名以 .json 结尾时每行一个 JSON 对象, 否则是与 LLVM opt-viewer 相同的 YAML 文档流.
+ * 备注按线程记录, 在 Scope 结束即一次编译结束时输出. 批量模式中各次编译的备注追加到同一个文件.
+ */
+class Remarks
+{
+public:
+	enum Kind : uint8_t
+	{
+		Passed, Missed, Analysis
+	};
+
+	struct Remark
+	{
+		Kind kind;
+		// pass 名, -Rpass 等的正则匹配它
+		const char* pass;
+		// 备注的种类, 如 Inlined, NotInlined
+		const char* name;
+		std::string function;
+		std::string block;
+		// 源代码行, 0 表示未知
+		int line;
+		std::string message;
+		// 没能完成的原因或补充说明, 可以为空
+		std::string reason;
+	};
+
+	// 一次编译, 构造时记录源文件, 析构时输出记录的备注
+	class Scope
+	{
+	public:
+		explicit Scope(const std::string& file);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	// 是否设置了任何备注选项
+	static bool requested();
+	// pass 的这类备注是否会被输出, 生成备注的信息前先检查, 以免拖慢编译
+	static bool enabled(Kind kind, const char* pass);
+	static void emit(Remark remark);
+};
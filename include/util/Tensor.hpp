@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <algorithm>
 #include <functional>
 #include <stack>
 #include <stdexcept>
@@ -49,6 +50,8 @@ public:
 private:
 	template <typename U>
 	friend class Tensor;
+	template <typename U>
+	friend class PlainTensorBuilder;
 
 public:
 	PlainTensor(const PlainTensor&) = delete;
@@ -68,9 +71,13 @@ public:
 	int segmentCount();
 	std::pair<std::vector<Element>*, int> segment(int index);
 	bool segmentIsDefault(int index);
+	// 获取铺平后下标为 index 的元素, 二分查找所在段
+	[[nodiscard]] Element getElement(int index) const;
 
 private:
 	Element _defaultValue;
+	// 每一段结束位置(不含)的前缀和, 在首次 getElement 时计算
+	mutable std::vector<int> _segmentEnds;
 
 	// 铺平的张量段
 	union PlainTensorSegment
@@ -128,6 +135,66 @@ private:
 	std::vector<PlainTensorSegment*> _segments;
 };
 
+// 流式构建铺平的张量. 接口与 TensorData 的 append/makeSubTensor 对应, 对齐规则完全相同,
+// 但不保存初始化列表的结构, 而是按铺平后的位置直接把值写入 PlainTensor 的段中.
+// 用于只含常量的大型初始化列表, 避免为每个元素分配 TensorData. 两个前端用它直接铺平全局数组的初始值(都是常量),
+// gate 取 1 与 GlobalVariable 相同
+template <typename Element>
+class PlainTensorBuilder
+{
+public:
+	PlainTensorBuilder(const PlainTensorBuilder&) = delete;
+	PlainTensorBuilder(PlainTensorBuilder&&) = delete;
+	PlainTensorBuilder& operator=(const PlainTensorBuilder&) = delete;
+	PlainTensorBuilder& operator=(PlainTensorBuilder&&) = delete;
+
+	// 小于等于 gate 个的默认值会被视为附加值, 与 Tensor::toPlain 相同
+	PlainTensorBuilder(const std::vector<int>& shape, const Element& defaultV, int gate = 0);
+	~PlainTensorBuilder();
+
+	[[nodiscard]] const std::vector<int>& getShape() const;
+	[[nodiscard]] Element defaultValue() const;
+	// 在当前子张量中添加一个值, 没有空间则返回 false
+	bool append(const Element& element);
+	// 尝试在当前子张量中开始一个子张量, 规则同 TensorData::makeSubTensor, 失败返回 false
+	bool beginSubTensor();
+	// 结束当前子张量, 其剩余空间填充默认值
+	void endSubTensor();
+	// 结束构建, 返回的 PlainTensor 由调用者维护. 调用后构建器不能再使用
+	[[nodiscard]] PlainTensor<Element>* build();
+
+private:
+	// 正在填充的(子)张量
+	struct Frame
+	{
+		// 起始维度, 对标量而言是 -1
+		int _beginDim;
+		// 在铺平的张量中的起始位置
+		int _base;
+		// 已经分配的空间大小
+		int _size;
+	};
+
+	std::vector<int> _shape;
+	std::vector<int> _dimLen;
+	int _gate;
+	std::vector<Frame> _frames;
+	// 已经写入 _plain 的元素个数(含尚未成段的默认值 _pendingDefaults)
+	int _written = 0;
+	// 尚未成段的连续默认值个数
+	int _pendingDefaults = 0;
+	// 正在填充的附加值段 *
+	std::vector<Element>* _values = nullptr;
+	// *
+	PlainTensor<Element>* _plain;
+
+	[[nodiscard]] int frameCapacity(const Frame& frame) const;
+	// 把铺平位置 [_written, pos) 视为默认值, 并在 pos 处写入 element
+	void put(int pos, const Element& element);
+	void addDefaults(int count);
+	void flushValues();
+};
+
 // 初始化张量
 template <typename Element>
 class Tensor
@@ -335,6 +402,181 @@ bool PlainTensor<Element>::segmentIsDefault(int index)
 	return true;
 }
 
+template <typename Element>
+Element PlainTensor<Element>::getElement(int index) const
+{
+	if (_segmentEnds.size() != _segments.size())
+	{
+		_segmentEnds.clear();
+		int end = 0;
+		for (auto& i : _segments)
+		{
+			end += i->isVector() ? u2iNegThrow(i->asVec()->size()) : i->asLen();
+			_segmentEnds.emplace_back(end);
+		}
+	}
+	if (index < 0 || _segmentEnds.empty() || index >= _segmentEnds.back())
+		throw std::runtime_error("PlainTensor index out of bound");
+	const int seg = u2iNegThrow(std::upper_bound(_segmentEnds.begin(), _segmentEnds.end(), index) -
+	                            _segmentEnds.begin());
+	auto i = _segments[seg];
+	if (!i->isVector()) return _defaultValue;
+	const int begin = seg == 0 ? 0 : _segmentEnds[seg - 1];
+	return (*i->asVec())[index - begin];
+}
+
+template <typename Element>
+PlainTensorBuilder<Element>::PlainTensorBuilder(const std::vector<int>& shape, const Element& defaultV,
+                                                const int gate) : _shape(shape), _gate(gate)
+{
+	_plain = new PlainTensor<Element>{};
+	_plain->_defaultValue = defaultV;
+	_dimLen.resize(_shape.size());
+	int i = u2iNegThrow(shape.size()) - 1;
+	if (i >= 0)
+	{
+		_dimLen[i] = 1;
+		for (; i > 0; --i)
+		{
+			if (_shape[i] <= 0) throw error::TensorInit(shape);
+			_dimLen[i - 1] = _dimLen[i] * _shape[i];
+		}
+		if (_shape[0] <= 0) throw error::TensorInit(shape);
+		_frames.push_back({0, 0, 0});
+	}
+	else _frames.push_back({-1, 0, 0});
+}
+
+template <typename Element>
+PlainTensorBuilder<Element>::~PlainTensorBuilder()
+{
+	delete _values;
+	delete _plain;
+}
+
+template <typename Element>
+const std::vector<int>& PlainTensorBuilder<Element>::getShape() const
+{
+	return _shape;
+}
+
+template <typename Element>
+Element PlainTensorBuilder<Element>::defaultValue() const
+{
+	return _plain->_defaultValue;
+}
+
+template <typename Element>
+int PlainTensorBuilder<Element>::frameCapacity(const Frame& frame) const
+{
+	return frame._beginDim == -1 ? 1 : _shape[frame._beginDim] * _dimLen[frame._beginDim];
+}
+
+template <typename Element>
+bool PlainTensorBuilder<Element>::append(const Element& element)
+{
+	auto& f = _frames.back();
+	if (f._size >= frameCapacity(f)) return false;
+	put(f._base + f._size, element);
+	f._size++;
+	return true;
+}
+
+template <typename Element>
+bool PlainTensorBuilder<Element>::beginSubTensor()
+{
+	auto& f = _frames.back();
+	// 维度小于等于 1
+	if (u2iNegThrow(_shape.size()) <= 1 + f._beginDim) return false;
+	int nextBegin = f._beginDim + 1;
+	int currentDataTake = f._size / _dimLen[nextBegin - 1];
+	while (f._size - currentDataTake * _dimLen[nextBegin - 1] != 0)
+	{
+		nextBegin++;
+		// 不能整除
+		if (nextBegin >= u2iNegThrow(_shape.size())) return false;
+		currentDataTake = f._size / _dimLen[nextBegin - 1];
+	}
+	// 满了
+	if (currentDataTake + 1 > _shape[nextBegin - 1]) return false;
+	const Frame sub{nextBegin, f._base + f._size, 0};
+	f._size += frameCapacity(sub);
+	_frames.push_back(sub);
+	return true;
+}
+
+template <typename Element>
+void PlainTensorBuilder<Element>::endSubTensor()
+{
+	if (_frames.size() <= 1) throw std::runtime_error("PlainTensorBuilder has no sub tensor to end");
+	_frames.pop_back();
+}
+
+template <typename Element>
+PlainTensor<Element>* PlainTensorBuilder<Element>::build()
+{
+	addDefaults(frameCapacity(_frames.front()) - _written);
+	if (_pendingDefaults > 0)
+	{
+		if (_pendingDefaults > _gate)
+			_plain->_segments.emplace_back(new typename PlainTensor<Element>::PlainTensorSegment{_pendingDefaults});
+		else
+		{
+			if (_values == nullptr) _values = new std::vector<Element>{};
+			for (; _pendingDefaults > 0; _pendingDefaults--) _values->emplace_back(_plain->_defaultValue);
+		}
+	}
+	flushValues();
+	auto ret = _plain;
+	_plain = nullptr;
+	return ret;
+}
+
+template <typename Element>
+void PlainTensorBuilder<Element>::put(const int pos, const Element& element)
+{
+	addDefaults(pos - _written);
+	_written++;
+	if (element == _plain->_defaultValue)
+	{
+		_pendingDefaults++;
+		if (_pendingDefaults > _gate) flushValues();
+		return;
+	}
+	if (_pendingDefaults > 0)
+	{
+		if (_pendingDefaults > _gate)
+		{
+			_plain->_segments.emplace_back(new typename PlainTensor<Element>::PlainTensorSegment{_pendingDefaults});
+			_pendingDefaults = 0;
+		}
+		else
+		{
+			if (_values == nullptr) _values = new std::vector<Element>{};
+			for (; _pendingDefaults > 0; _pendingDefaults--) _values->emplace_back(_plain->_defaultValue);
+		}
+	}
+	if (_values == nullptr) _values = new std::vector<Element>{};
+	_values->emplace_back(element);
+}
+
+template <typename Element>
+void PlainTensorBuilder<Element>::addDefaults(const int count)
+{
+	if (count <= 0) return;
+	_written += count;
+	_pendingDefaults += count;
+	if (_pendingDefaults > _gate) flushValues();
+}
+
+template <typename Element>
+void PlainTensorBuilder<Element>::flushValues()
+{
+	if (_values == nullptr) return;
+	_plain->_segments.emplace_back(new typename PlainTensor<Element>::PlainTensorSegment{_values});
+	_values = nullptr;
+}
+
 template <typename Element>
 Tensor<Element>::~Tensor()
 {
@@ -0,0 +1,31 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * 编译各阶段的耗时统计, 以 -ftime-report 启用.
+ * 每个线程独立记录, 同名阶段的耗时累加.
+ * 输出格式为每行 "time-report <阶段> <毫秒>", 最后一行是 "time-report peak-rss-kb <KB>", 供 tests/bench.cpp 解析.
+ */
+class TimeReport
+{
+public:
+	// 作用域内的耗时计入阶段 name, 未开启 printTimeReport 时不计时
+	class Stage
+	{
+	public:
+		explicit Stage(const char* name);
+		~Stage();
+		Stage(const Stage&) = delete;
+		Stage& operator=(const Stage&) = delete;
+
+	private:
+		const char* name_;
+		std::chrono::steady_clock::time_point begin_;
+	};
+
+	// 打印当前线程记录的阶段与进程的峰值内存, 并清空记录
+	static void print(std::ostream& os);
+};
@@ -5,6 +5,7 @@
 class PointerType;
 class FuncType;
 class ArrayType;
+class TypeAllocator;
 
 enum class TypeIDs : int8_t
 {
@@ -89,6 +90,9 @@ namespace Types
 	FuncType* functionType(const TypeIDs& returnType);
 	// 它是 functionType(const TypeIDs& returnType) 的一个重载
 	FuncType* functionType(const Type* returnType);
+	// 创建一张独立的复合类型表, 由 CompilationContext 持有, 表中的类型随表一同释放
+	TypeAllocator* createTypeTable();
+	void destroyTypeTable(const TypeAllocator* table);
 }
 
 class ArrayType final : public Type
@@ -11,6 +11,57 @@
 using namespace Types;
 using namespace std;
 
+namespace
+{
+	// number : IntConst | FloatConst
+	ConstantValue literalValue(SysYParser::NumberContext* context)
+	{
+		if (context->IntConst() != nullptr)
+		{
+			int c;
+			auto str = context->IntConst()->toString();
+			if (str.size() >= 2)
+			{
+				if (str[0] == '0')
+				{
+					if (str[1] == 'x' || str[1] == 'X')
+						c = std::stoi(str, nullptr, 16);
+					else if (str[1] == 'b' || str[1] == 'B')
+						c = std::stoi(str, nullptr, 2);
+					else c = std::stoi(str, nullptr, 8);
+				}
+				else c = std::stoi(str);
+			}
+			else c = std::stoi(str);
+			return ConstantValue{c};
+		}
+		return ConstantValue{stof(context->FloatConst()->toString())};
+	}
+
+	// 初始化列表中最常见的元素是形如 [-]字面量 的常数, 直接读出其值, 不生成 AST 节点.
+	// 其它形式或需要经过 castTypeTo 检查的类型转换返回 false
+	bool bareLiteral(SysYParser::AddExpContext* add, Type* type, ConstantValue& value)
+	{
+		if (add->addExp() != nullptr) return false;
+		const auto mul = add->mulExp();
+		if (mul->mulExp() != nullptr) return false;
+		auto unary = mul->unaryExp();
+		const bool neg = unary->SUB() != nullptr;
+		if (neg) unary = unary->unaryExp();
+		if (unary->primaryExp() == nullptr || unary->primaryExp()->number() == nullptr) return false;
+		const auto number = unary->primaryExp()->number();
+		if (number->FloatConst() != nullptr && type != FLOAT) return false;
+		value = literalValue(number);
+		if (neg)
+		{
+			if (value.isIntConstant()) value = ConstantValue{-value.getIntConstant()};
+			else value = ConstantValue{-value.getFloatConstant()};
+		}
+		if (value.isIntConstant() && type == FLOAT) value = ConstantValue{static_cast<float>(value.getIntConstant())};
+		return true;
+	}
+}
+
 
 ASTCompUnit* Antlr2AstVisitor::astTree(antlr4::tree::ParseTree* parseTree)
 {
@@ -109,6 +160,26 @@ std::any Antlr2AstVisitor::visitConstDecl(SysYParser::ConstDeclContext* context)
 	return {};
 }
 
+void Antlr2AstVisitor::appendPlainInitValue(antlr4::ParserRuleContext* exp, SysYParser::AddExpContext* add,
+                                            bool checkFloat)
+{
+	const auto b = _initPlainConstraint;
+	const auto dft = b->defaultValue();
+	ConstantValue value;
+	if (!bareLiteral(add, dft.getType(), value))
+	{
+		exp->accept(this);
+		const auto e = dynamic_cast<ASTExpression*>(poll());
+		ASSERT(dynamic_cast<ASTNumber*>(e) != nullptr);
+		if (checkFloat) ASSERT(e->getExpressionType() != FLOAT || dft.getType() != INT);
+		const auto num = dynamic_cast<ASTNumber*>(e->castTypeTo(dft.getType(), TypeCastEnvironment::INITIALIZE_LIST));
+		value = num->_field;
+		delete num;
+	}
+	if (!b->append(value))
+		throw runtime_error("fail to append value to initialize list. context " + exp->getText());
+}
+
 std::any Antlr2AstVisitor::visitBType(SysYParser::BTypeContext* context)
 {
 	LOG(color::green("visitBType ") + (context->INT() != nullptr ? "INT" : "FLOAT"));
@@ -138,6 +209,17 @@ std::any Antlr2AstVisitor::visitConstDef(SysYParser::ConstDefContext* context)
 	decl->_id = context->ID()->toString();
 	if (t->getTypeID() == TypeIDs::Array)
 		t = dynamic_cast<ArrayType*>(t)->typeContained();
+	if (_structConstraint.size() == 1 && !dims.empty())
+	{
+		PlainTensorBuilder builder{dims, t == INT ? ConstantValue{0} : ConstantValue{0.0f}, 1};
+		_initPlainConstraint = &builder;
+		context->constInitVal()->accept(this);
+		_initPlainConstraint = nullptr;
+		decl->_plainInitList = builder.build();
+		returnSlot_.emplace(decl);
+		POP;
+		return {};
+	}
 	if (t == INT)
 		decl->_initList = new Tensor{dims, InitializeValue{0}};
 	else decl->_initList = new Tensor{dims, InitializeValue{0.0f}};
@@ -153,6 +235,13 @@ std::any Antlr2AstVisitor::visitConstInitVal(SysYParser::ConstInitValContext* co
 {
 	LOG(color::cyan("visitConstInitVal"));
 	PUSH;
+	if (_initPlainConstraint != nullptr)
+	{
+		ASSERT(context->constExp() == nullptr);
+		for (const auto& i : context->constArrayInitVal()) i->accept(this);
+		POP;
+		return {};
+	}
 	const auto t = _initTensorConstraint.top();
 	const auto dft = t->tensorBelong()->defaultValue();
 	if (context->constExp() != nullptr)
@@ -181,6 +270,20 @@ std::any Antlr2AstVisitor::visitConstArrayInitVal(SysYParser::ConstArrayInitValC
 {
 	LOG(color::cyan("visitConstArrayInitVal"));
 	PUSH;
+	if (_initPlainConstraint != nullptr)
+	{
+		if (ctx->constExp() != nullptr)
+			appendPlainInitValue(ctx->constExp(), ctx->constExp()->addExp(), false);
+		else
+		{
+			const bool sub = _initPlainConstraint->beginSubTensor();
+			ASSERT(sub);
+			for (const auto& i : ctx->constArrayInitVal()) i->accept(this);
+			_initPlainConstraint->endSubTensor();
+		}
+		POP;
+		return {};
+	}
 	const auto t = _initTensorConstraint.top();
 	const auto dft = t->tensorBelong()->defaultValue();
 	if (ctx->constExp() != nullptr)
@@ -253,6 +356,20 @@ std::any Antlr2AstVisitor::visitVarDef(SysYParser::VarDefContext* context)
 	decl->_id = context->ID()->toString();
 	if (t->getTypeID() == TypeIDs::Array)
 		t = dynamic_cast<ArrayType*>(t)->typeContained();
+	if (_structConstraint.size() == 1 && !dims.empty())
+	{
+		PlainTensorBuilder builder{dims, t == INT ? ConstantValue{0} : ConstantValue{0.0f}, 1};
+		if (context->initVal() != nullptr)
+		{
+			_initPlainConstraint = &builder;
+			context->initVal()->accept(this);
+			_initPlainConstraint = nullptr;
+		}
+		decl->_plainInitList = builder.build();
+		returnSlot_.emplace(decl);
+		POP;
+		return {};
+	}
 	if (context->initVal() == nullptr)
 	{
 		if (t == INT)
@@ -279,6 +396,13 @@ std::any Antlr2AstVisitor::visitInitVal(SysYParser::InitValContext* context)
 {
 	LOG(color::cyan("visitInitVal"));
 	PUSH;
+	if (_initPlainConstraint != nullptr)
+	{
+		ASSERT(context->exp() == nullptr);
+		for (const auto& i : context->arrayInitVal()) i->accept(this);
+		POP;
+		return {};
+	}
 	const auto t = _initTensorConstraint.top();
 	const auto dft = t->tensorBelong()->defaultValue();
 	if (context->exp() != nullptr)
@@ -319,6 +443,20 @@ std::any Antlr2AstVisitor::visitArrayInitVal(SysYParser::ArrayInitValContext* ct
 {
 	LOG(color::cyan("visitArrayInitVal"));
 	PUSH;
+	if (_initPlainConstraint != nullptr)
+	{
+		if (ctx->exp() != nullptr)
+			appendPlainInitValue(ctx->exp(), ctx->exp()->addExp(), true);
+		else
+		{
+			const bool sub = _initPlainConstraint->beginSubTensor();
+			ASSERT(sub);
+			for (const auto& i : ctx->arrayInitVal()) i->accept(this);
+			_initPlainConstraint->endSubTensor();
+		}
+		POP;
+		return {};
+	}
 	const auto t = _initTensorConstraint.top();
 	const auto dft = t->tensorBelong()->defaultValue();
 	if (ctx->exp() != nullptr)
@@ -365,6 +503,7 @@ std::any Antlr2AstVisitor::visitFuncDef(SysYParser::FuncDefContext* context)
 	PUSH;
 	context->funcType()->accept(this);
 	const auto decl = new ASTFuncDecl(context->ID()->toString(), typeReturnSlot_);
+	decl->_line = static_cast<int>(context->getStart()->getLine());
 	const auto top = dynamic_cast<ASTCompUnit*>(_structConstraint.front());
 	top->_func_declarations.push_back(decl);
 	_currentFunction = decl;
@@ -470,9 +609,12 @@ std::any Antlr2AstVisitor::visitBlockItem(SysYParser::BlockItemContext* context)
 	{
 		context->stmt()->accept(this);
 	}
+	const int line = static_cast<int>(context->getStart()->getLine());
 	while (!returnSlot_.empty())
 	{
-		block->_stmts.emplace_back(poll());
+		const auto node = poll();
+		if (node->_line == 0) node->_line = line;
+		block->_stmts.emplace_back(node);
 	}
 	POP;
 	return {};
@@ -803,6 +945,14 @@ std::any Antlr2AstVisitor::visitLVal(SysYParser::LValContext* context)
 				constIndexes.emplace_back(dynamic_cast<ASTNumber*>(i)->toInteger());
 				delete i;
 			}
+			if (const auto plain = decl->getPlainInitList(); plain != nullptr)
+			{
+				int flat = 0;
+				for (int i = 0; i < indexCount; i++) flat = flat * ar->dimensions()[i] + constIndexes[i];
+				returnSlot_.emplace(new ASTNumber(plain->getElement(flat).toInitializeValue()));
+				POP;
+				return {};
+			}
 			const auto l = decl->getInitList();
 			returnSlot_.emplace(new ASTNumber(l->visitData()->getElement(constIndexes)));
 			POP;
@@ -853,28 +1003,9 @@ std::any Antlr2AstVisitor::visitNumber(SysYParser::NumberContext* context)
 	LOG(color::green("visitNumber ") + (context->IntConst() != nullptr ? context->IntConst()->toString() : context->
 		FloatConst()->toString()));
 	PUSH;
-	if (context->IntConst() != nullptr)
-	{
-		int c;
-		auto str = context->IntConst()->toString();
-		if (str.size() >= 2)
-		{
-			if (str[0] == '0')
-			{
-				if (str[1] == 'x' || str[1] == 'X')
-					c = std::stoi(str, nullptr, 16);
-				else if (str[1] == 'b' || str[1] == 'B')
-					c = std::stoi(str, nullptr, 2);
-				else c = std::stoi(str, nullptr, 8);
-			}
-			else c = std::stoi(str);
-		}
-		else c = std::stoi(str);
-		returnSlot_.emplace(new ASTNumber(c));
-		POP;
-		return {};
-	}
-	returnSlot_.emplace(new ASTNumber(stof(context->FloatConst()->toString())));
+	const auto v = literalValue(context);
+	if (v.isIntConstant()) returnSlot_.emplace(new ASTNumber(v.getIntConstant()));
+	else returnSlot_.emplace(new ASTNumber(v.getFloatConstant()));
 	POP;
 	return {};
 }
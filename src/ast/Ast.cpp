@@ -429,12 +429,34 @@ std::list<std::string> ASTVarDecl::toStringList()
 			return v.toString();
 		});
 	}
+	else if (_plainInitList != nullptr)
+	{
+		// 铺平的初始值输出为一维初始化列表, 省略末尾的默认值
+		int last = _plainInitList->segmentCount() - 1;
+		if (last >= 0 && _plainInitList->segmentIsDefault(last)) last--;
+		ret += " = {";
+		for (int i = 0; i <= last; i++)
+		{
+			auto [vec, len] = _plainInitList->segment(i);
+			if (vec != nullptr)
+				for (auto& v : *vec) ret += v.toString() + ", ";
+			else
+				for (int j = 0; j < len; j++) ret += _plainInitList->default_value().toString() + ", ";
+		}
+		if (ret.back() == ' ')
+		{
+			ret.pop_back();
+			ret.pop_back();
+		}
+		ret += '}';
+	}
 	return {ret};
 }
 
 ASTVarDecl::~ASTVarDecl()
 {
 	delete _initList;
+	delete _plainInitList;
 	for (auto& i : _expressions)delete i;
 }
 
@@ -453,6 +475,18 @@ const Tensor<InitializeValue>* ASTVarDecl::getInitList() const
 	return _initList;
 }
 
+const PlainTensor<ConstantValue>* ASTVarDecl::getPlainInitList() const
+{
+	return _plainInitList;
+}
+
+PlainTensor<ConstantValue>* ASTVarDecl::movePlainInitList()
+{
+	auto ret = _plainInitList;
+	_plainInitList = nullptr;
+	return ret;
+}
+
 Type* ASTVarDecl::getType() const
 {
 	return _type;
@@ -0,0 +1,247 @@
+#include "Lexer.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+	bool isDigit(const char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	bool isHexDigit(const char c)
+	{
+		return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+	}
+
+	bool isNonDigit(const char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+	}
+
+	struct Keyword
+	{
+		const char* text;
+		unsigned length;
+		TokenType type;
+	};
+
+	const Keyword KEYWORDS[] = {
+		{"int", 3, TokenType::INT},
+		{"float", 5, TokenType::FLOAT},
+		{"void", 4, TokenType::VOID},
+		{"if", 2, TokenType::IF},
+		{"else", 4, TokenType::ELSE},
+		{"while", 5, TokenType::WHILE},
+		{"continue", 8, TokenType::CONTINUE},
+		{"break", 5, TokenType::BREAK},
+		{"return", 6, TokenType::RETURN},
+		{"const", 5, TokenType::CONST}
+	};
+
+	const char* TOKEN_NAMES[] = {
+		"<EOF>", "int", "float", "void", "if", "else", "while", "continue", "break", "return", "const",
+		"=", "+", "-", "*", "/", "%", "==", "!=", "<", ">", "<=", ">=", "||", "&&", "!",
+		"(", ")", "[", "]", "{", "}", ",", ";",
+		"identifier", "integer constant", "float constant"
+	};
+}
+
+bool Token::is(const char* s) const
+{
+	return strlen(s) == length && memcmp(s, text, length) == 0;
+}
+
+std::string tokenTypeName(TokenType type)
+{
+	return TOKEN_NAMES[static_cast<int>(type)];
+}
+
+Lexer::Lexer(const char* begin, const char* end) : cur_(begin), end_(end)
+{
+}
+
+void Lexer::rewindTo(const Token& token)
+{
+	cur_ = token.text + token.length;
+	line_ = token.line;
+}
+
+Token Lexer::make(TokenType type, const char* begin) const
+{
+	Token t;
+	t.type = type;
+	t.text = begin;
+	t.length = static_cast<unsigned>(cur_ - begin);
+	t.line = line_;
+	return t;
+}
+
+void Lexer::skipSpaceAndComment()
+{
+	while (cur_ < end_)
+	{
+		const char c = *cur_;
+		if (c == '\n')
+		{
+			++line_;
+			++cur_;
+		}
+		else if (c == ' ' || c == '\t' || c == '\r') ++cur_;
+		else if (c == '/' && cur_ + 1 < end_ && cur_[1] == '/')
+		{
+			cur_ += 2;
+			while (cur_ < end_ && *cur_ != '\n' && *cur_ != '\r') ++cur_;
+		}
+		else if (c == '/' && cur_ + 1 < end_ && cur_[1] == '*')
+		{
+			const int startLine = line_;
+			cur_ += 2;
+			while (true)
+			{
+				if (cur_ + 1 >= end_)
+					throw runtime_error("unterminated block comment from line " + to_string(startLine));
+				if (cur_[0] == '*' && cur_[1] == '/')
+				{
+					cur_ += 2;
+					break;
+				}
+				if (*cur_ == '\n') ++line_;
+				++cur_;
+			}
+		}
+		else return;
+	}
+}
+
+Token Lexer::lexIdentifier()
+{
+	const char* begin = cur_;
+	while (cur_ < end_ && (isNonDigit(*cur_) || isDigit(*cur_))) ++cur_;
+	const auto len = static_cast<unsigned>(cur_ - begin);
+	for (const auto& k : KEYWORDS)
+	{
+		if (k.length == len && memcmp(k.text, begin, len) == 0) return make(k.type, begin);
+	}
+	return make(TokenType::ID, begin);
+}
+
+// 与 antlr 的最长匹配保持一致, 例如 "1e" 会被切分为 1 与 e
+Token Lexer::lexNumber()
+{
+	const char* begin = cur_;
+	auto digits = [this](bool hex)
+	{
+		const char* b = cur_;
+		while (cur_ < end_ && (hex ? isHexDigit(*cur_) : isDigit(*cur_))) ++cur_;
+		return cur_ != b;
+	};
+	// 尝试读取指数部分, 失败则不移动
+	auto exponent = [this](char lower, char upper)
+	{
+		if (cur_ >= end_ || (*cur_ != lower && *cur_ != upper)) return false;
+		const char* p = cur_ + 1;
+		if (p < end_ && (*p == '+' || *p == '-')) ++p;
+		if (p >= end_ || !isDigit(*p)) return false;
+		while (p < end_ && isDigit(*p)) ++p;
+		cur_ = p;
+		return true;
+	};
+	if (*cur_ == '0' && cur_ + 1 < end_ && (cur_[1] == 'x' || cur_[1] == 'X'))
+	{
+		cur_ += 2;
+		const bool intPart = digits(true);
+		if (cur_ < end_ && *cur_ == '.')
+		{
+			const char* dot = cur_;
+			++cur_;
+			const bool fracPart = digits(true);
+			if ((intPart || fracPart) && exponent('p', 'P')) return make(TokenType::FLOAT_CONST, begin);
+			cur_ = dot;
+		}
+		else if (intPart && exponent('p', 'P')) return make(TokenType::FLOAT_CONST, begin);
+		// 只有 0, x 属于后面的标识符
+		if (!intPart) cur_ = begin + 1;
+		return make(TokenType::INT_CONST, begin);
+	}
+	const bool intPart = digits(false);
+	bool isFloat = false;
+	if (cur_ < end_ && *cur_ == '.')
+	{
+		const char* dot = cur_;
+		++cur_;
+		const bool fracPart = digits(false);
+		if (intPart || fracPart) isFloat = true;
+		else cur_ = dot;
+	}
+	if (intPart || isFloat)
+	{
+		if (exponent('e', 'E')) isFloat = true;
+	}
+	if (isFloat) return make(TokenType::FLOAT_CONST, begin);
+	// 八进制常量只允许 0-7, 遇到 8/9 时停止
+	if (*begin == '0')
+	{
+		cur_ = begin + 1;
+		while (cur_ < end_ && *cur_ >= '0' && *cur_ <= '7') ++cur_;
+	}
+	return make(TokenType::INT_CONST, begin);
+}
+
+Token Lexer::next()
+{
+	skipSpaceAndComment();
+	if (cur_ >= end_)
+	{
+		Token t;
+		t.text = end_;
+		t.line = line_;
+		return t;
+	}
+	const char* begin = cur_;
+	const char c = *cur_;
+	if (isNonDigit(c)) return lexIdentifier();
+	if (isDigit(c) || (c == '.' && cur_ + 1 < end_ && isDigit(cur_[1]))) return lexNumber();
+	const char n = cur_ + 1 < end_ ? cur_[1] : '\0';
+	auto single = [&](TokenType type)
+	{
+		++cur_;
+		return make(type, begin);
+	};
+	auto twice = [&](TokenType type)
+	{
+		cur_ += 2;
+		return make(type, begin);
+	};
+	switch (c)
+	{
+		case '=': return n == '=' ? twice(TokenType::EQ) : single(TokenType::ASSIGN);
+		case '!': return n == '=' ? twice(TokenType::NE) : single(TokenType::NOT);
+		case '<': return n == '=' ? twice(TokenType::LE) : single(TokenType::LT);
+		case '>': return n == '=' ? twice(TokenType::GE) : single(TokenType::GT);
+		case '|':
+			if (n == '|') return twice(TokenType::OR);
+			break;
+		case '&':
+			if (n == '&') return twice(TokenType::AND);
+			break;
+		case '+': return single(TokenType::ADD);
+		case '-': return single(TokenType::SUB);
+		case '*': return single(TokenType::MUL);
+		case '/': return single(TokenType::DIV);
+		case '%': return single(TokenType::MOD);
+		case '(': return single(TokenType::LPAREN);
+		case ')': return single(TokenType::RPAREN);
+		case '[': return single(TokenType::LBRACK);
+		case ']': return single(TokenType::RBRACK);
+		case '{': return single(TokenType::LBRACE);
+		case '}': return single(TokenType::RBRACE);
+		case ',': return single(TokenType::COMMA);
+		case ';': return single(TokenType::SEMICO);
+		default: break;
+	}
+	throw runtime_error("line " + to_string(line_) + ": unexpected character '" + string(1, c) + "'");
+}
@@ -0,0 +1,1270 @@
+#include "Source2Ast.hpp"
+#include "Ast.hpp"
+#include "Type.hpp"
+#include "Tensor.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+#define DEBUG 0
+#include "Config.hpp"
+#include "System.hpp"
+#include "Util.hpp"
+
+
+using namespace Types;
+using namespace std;
+
+Source2AstParser::Source2AstParser(const char* begin, const char* end) : lexer_(begin, end)
+{
+	cur_ = lexer_.next();
+}
+
+ASTCompUnit* Source2AstParser::astTree()
+{
+	return parseCompUnit();
+}
+
+const Token& Source2AstParser::peek(int k)
+{
+	while (static_cast<int>(ahead_.size()) < k) ahead_.emplace_back(lexer_.next());
+	return ahead_[k - 1];
+}
+
+Token Source2AstParser::advance()
+{
+	Token ret = cur_;
+	if (ahead_.empty()) cur_ = lexer_.next();
+	else
+	{
+		cur_ = ahead_.front();
+		ahead_.pop_front();
+	}
+	return ret;
+}
+
+bool Source2AstParser::acceptToken(TokenType type)
+{
+	if (cur_.type != type) return false;
+	advance();
+	return true;
+}
+
+Token Source2AstParser::expect(TokenType type)
+{
+	if (cur_.type != type) syntaxError(tokenTypeName(type));
+	return advance();
+}
+
+void Source2AstParser::seek(const Token& token)
+{
+	ahead_.clear();
+	lexer_.rewindTo(token);
+	cur_ = token;
+}
+
+void Source2AstParser::syntaxError(const std::string& expected) const
+{
+	const string got = cur_.type == TokenType::END ? "<EOF>" : cur_.str();
+	throw runtime_error("line " + to_string(cur_.line) + ": syntax error, expected " + expected + " but got '" + got + "'");
+}
+
+bool Source2AstParser::pushScope(ASTDecl* decl) const
+{
+	return _structConstraint.back()->pushScope(decl);
+}
+
+ASTDecl* Source2AstParser::findScope(const std::string& id, bool isFunc)
+{
+	for (auto it = _structConstraint.rbegin(); it != _structConstraint.rend(); ++it)
+	{
+		const auto node = *it;
+		if (const auto fd = node->findScope(id, isFunc); fd != nullptr) return fd;
+	}
+	return nullptr;
+}
+
+// compUnit : compDecl+ EOF
+// compDecl : decl | funcDef
+ASTCompUnit* Source2AstParser::parseCompUnit()
+{
+	auto comp_unit = new ASTCompUnit();
+	_structConstraint.emplace_back(comp_unit);
+	do
+	{
+		const bool isFunc = cur_.type == TokenType::VOID ||
+		                    ((cur_.type == TokenType::INT || cur_.type == TokenType::FLOAT) &&
+		                     peek(1).type == TokenType::ID && peek(2).type == TokenType::LPAREN);
+		if (isFunc) parseFuncDef();
+		else
+		{
+			list<ASTVarDecl*> decls;
+			parseDecl(decls);
+			for (auto i : decls) comp_unit->_var_declarations.emplace_back(i);
+		}
+	}
+	while (cur_.type != TokenType::END);
+	auto main_ = dynamic_cast<ASTFuncDecl*>(comp_unit->findScope("main", true));
+	ASSERT(main_ != nullptr);
+	ASSERT(main_->args().empty());
+	ASSERT(main_->returnType() == INT);
+	_structConstraint.pop_back();
+	return comp_unit;
+}
+
+// constDecl : CONST bType constDef ( COMMA constDef )* SEMICO
+// varDecl : bType varDef ( COMMA varDef )* SEMICO
+void Source2AstParser::parseDecl(std::list<ASTVarDecl*>& out)
+{
+	const bool isConst = acceptToken(TokenType::CONST);
+	const auto block = _structConstraint.back();
+	const auto ty = parseBType();
+	do
+	{
+		auto decl = parseVarDef(ty, isConst);
+		out.emplace_back(decl);
+		if (!block->pushScope(decl))
+			throw runtime_error("duplicate var declaration of id " + decl->id());
+	}
+	while (acceptToken(TokenType::COMMA));
+	expect(TokenType::SEMICO);
+}
+
+Type* Source2AstParser::parseBType()
+{
+	if (acceptToken(TokenType::INT)) return INT;
+	if (acceptToken(TokenType::FLOAT)) return FLOAT;
+	syntaxError("int or float");
+}
+
+// constDef : ID ( LBRACK constExp RBRACK )* ASSIGN constInitVal
+// varDef : ID ( LBRACK constExp RBRACK )* ( ASSIGN initVal )?
+ASTVarDecl* Source2AstParser::parseVarDef(Type* bType, bool isConst)
+{
+	const auto id = expect(TokenType::ID).str();
+	vector<int> dims;
+	while (acceptToken(TokenType::LBRACK))
+	{
+		const auto n = dynamic_cast<ASTNumber*>(parseConstExp());
+		ASSERT(!n->isFloat());
+		ASSERT(n->toInteger() > 0);
+		dims.emplace_back(n->toInteger());
+		delete n;
+		expect(TokenType::RBRACK);
+	}
+	Type* t = bType;
+	if (!dims.empty())
+		t = arrayType(t, false, dims);
+	auto decl = new ASTVarDecl(isConst, _structConstraint.size() == 1, t);
+	decl->_id = id;
+	if (_structConstraint.size() == 1 && !dims.empty())
+	{
+		PlainTensorBuilder builder{dims, bType == INT ? ConstantValue{0} : ConstantValue{0.0f}, 1};
+		if (isConst) expect(TokenType::ASSIGN);
+		if (isConst || acceptToken(TokenType::ASSIGN))
+		{
+			_initPlainConstraint = &builder;
+			parsePlainInitVal(isConst, true);
+			_initPlainConstraint = nullptr;
+		}
+		decl->_plainInitList = builder.build();
+		return decl;
+	}
+	if (bType == INT)
+		decl->_initList = new Tensor{dims, InitializeValue{0}};
+	else decl->_initList = new Tensor{dims, InitializeValue{0.0f}};
+	if (isConst) expect(TokenType::ASSIGN);
+	else if (!acceptToken(TokenType::ASSIGN)) return decl;
+	_initTensorConstraint.push(decl->_initList->getData());
+	_initVarNodeConstraint.push(decl);
+	parseInitVal(isConst, true);
+	_initVarNodeConstraint.pop();
+	_initTensorConstraint.pop();
+	return decl;
+}
+
+// constInitVal : constExp | LBRACE ( constArrayInitVal ( COMMA constArrayInitVal )* )? RBRACE
+// initVal : exp | LBRACE ( arrayInitVal ( COMMA arrayInitVal )* )? RBRACE
+void Source2AstParser::parseInitVal(bool isConst, bool top)
+{
+	const auto t = _initTensorConstraint.top();
+	const auto dft = t->tensorBelong()->defaultValue();
+	if (cur_.type != TokenType::LBRACE)
+	{
+		const int line = cur_.line;
+		if (top) ASSERT(t->tensorBelong()->getShape().empty());
+		const auto exp = isConst ? parseConstExp() : parseExp();
+		ASSERT(_structConstraint.size() != 1 || dynamic_cast<ASTNumber*>(exp) != nullptr);
+		if (!isConst && !top) ASSERT(exp->getExpressionType() != FLOAT || dft.getExpressionType() != INT);
+		const auto exp2 = top
+			                  ? exp->castTypeTo(dft.getExpressionType())
+			                  : exp->castTypeTo(dft.getExpressionType(), TypeCastEnvironment::INITIALIZE_LIST);
+		if (const auto num = dynamic_cast<ASTNumber*>(exp2); num != nullptr)
+		{
+			const InitializeValue ret = num->toInitializeValue();
+			delete num;
+			if (!t->append(ret))
+				throw runtime_error("fail to append value to initialize list. line " + to_string(line));
+		}
+		else
+		{
+			if (!t->append(InitializeValue{exp2}))
+				throw runtime_error("fail to append value to initialize list. line " + to_string(line));
+			_initVarNodeConstraint.top()->_expressions.emplace_back(exp2);
+		}
+		return;
+	}
+	advance();
+	if (top) ASSERT(!t->tensorBelong()->getShape().empty());
+	else
+	{
+		const auto tensor = t->makeSubTensor();
+		ASSERT(tensor != nullptr);
+		_initTensorConstraint.push(tensor);
+	}
+	if (cur_.type != TokenType::RBRACE)
+	{
+		do parseInitVal(isConst, false);
+		while (acceptToken(TokenType::COMMA));
+	}
+	expect(TokenType::RBRACE);
+	if (!top) _initTensorConstraint.pop();
+}
+
+// 与 parseInitVal 相同, 但值直接写入 _initPlainConstraint
+void Source2AstParser::parsePlainInitVal(bool isConst, bool top)
+{
+	const auto b = _initPlainConstraint;
+	const auto dft = b->defaultValue();
+	if (cur_.type != TokenType::LBRACE)
+	{
+		const int line = cur_.line;
+		if (top) ASSERT(b->getShape().empty());
+		ConstantValue value;
+		if (!acceptBareLiteral(dft.getType(), value))
+		{
+			const auto exp = isConst ? parseConstExp() : parseExp();
+			ASSERT(dynamic_cast<ASTNumber*>(exp) != nullptr);
+			if (!isConst) ASSERT(exp->getExpressionType() != FLOAT || dft.getType() != INT);
+			const auto num = dynamic_cast<ASTNumber*>(
+				exp->castTypeTo(dft.getType(), TypeCastEnvironment::INITIALIZE_LIST));
+			value = num->_field;
+			delete num;
+		}
+		if (!b->append(value))
+			throw runtime_error("fail to append value to initialize list. line " + to_string(line));
+		return;
+	}
+	advance();
+	if (top) ASSERT(!b->getShape().empty());
+	else
+	{
+		const bool sub = b->beginSubTensor();
+		ASSERT(sub);
+	}
+	if (cur_.type != TokenType::RBRACE)
+	{
+		do parsePlainInitVal(isConst, false);
+		while (acceptToken(TokenType::COMMA));
+	}
+	expect(TokenType::RBRACE);
+	if (!top) b->endSubTensor();
+}
+
+// 初始化列表中最常见的元素是形如 [-]字面量 的常数, 直接读出其值, 不生成 AST 节点.
+// 其它形式或需要经过 castTypeTo 检查的类型转换返回 false, 不消耗词法单元
+bool Source2AstParser::acceptBareLiteral(Type* type, ConstantValue& value)
+{
+	const bool neg = cur_.type == TokenType::SUB;
+	const Token lit = neg ? peek(1) : cur_;
+	if (lit.type != TokenType::INT_CONST && lit.type != TokenType::FLOAT_CONST) return false;
+	const auto follow = peek(neg ? 2 : 1).type;
+	if (follow != TokenType::COMMA && follow != TokenType::RBRACE) return false;
+	if (lit.type == TokenType::FLOAT_CONST && type != FLOAT) return false;
+	value = literalValue(lit);
+	if (neg)
+	{
+		if (value.isIntConstant()) value = ConstantValue{-value.getIntConstant()};
+		else value = ConstantValue{-value.getFloatConstant()};
+	}
+	if (value.isIntConstant() && type == FLOAT) value = ConstantValue{static_cast<float>(value.getIntConstant())};
+	advance();
+	if (neg) advance();
+	return true;
+}
+
+// funcDef : funcType ID LPAREN (funcFParams)? RPAREN block
+void Source2AstParser::parseFuncDef()
+{
+	const int line = cur_.line;
+	Type* retType;
+	if (acceptToken(TokenType::VOID)) retType = VOID;
+	else retType = parseBType();
+	const auto decl = new ASTFuncDecl(expect(TokenType::ID).str(), retType);
+	decl->_line = line;
+	const auto top = dynamic_cast<ASTCompUnit*>(_structConstraint.front());
+	top->_func_declarations.push_back(decl);
+	_currentFunction = decl;
+	if (!pushScope(decl))
+		throw runtime_error("duplicate function " + decl->id());
+	_structConstraint.emplace_back(decl);
+	expect(TokenType::LPAREN);
+	if (cur_.type != TokenType::RPAREN)
+	{
+		do decl->_args.emplace_back(parseFuncFParam());
+		while (acceptToken(TokenType::COMMA));
+	}
+	expect(TokenType::RPAREN);
+	_structConstraint.emplace_back(decl->_block);
+	parseBlock();
+	_structConstraint.pop_back();
+	_structConstraint.pop_back();
+}
+
+// funcFParam : bType ID (LBRACK RBRACK ( LBRACK exp RBRACK )*)?
+ASTVarDecl* Source2AstParser::parseFuncFParam()
+{
+	const auto btype = parseBType();
+	const auto id = expect(TokenType::ID).str();
+	auto decl = new ASTVarDecl(false, false, btype);
+	decl->_id = id;
+	if (acceptToken(TokenType::LBRACK))
+	{
+		expect(TokenType::RBRACK);
+		vector<int> dims;
+		while (acceptToken(TokenType::LBRACK))
+		{
+			const auto num = dynamic_cast<ASTNumber*>(parseExp());
+			ASSERT(num != nullptr);
+			ASSERT(num->getExpressionType() == INT);
+			int n = num->toInteger();
+			ASSERT(n > 0);
+			dims.emplace_back(n);
+			delete num;
+			expect(TokenType::RBRACK);
+		}
+		decl->_type = arrayType(btype, true, dims);
+	}
+	if (!_structConstraint.back()->pushScope(decl))
+		throw runtime_error("duplicate scope " + decl->id());
+	return decl;
+}
+
+// block : LBRACE ( blockItem )* RBRACE
+// blockItem : decl | stmt
+void Source2AstParser::parseBlock()
+{
+	const auto block = dynamic_cast<ASTBlock*>(_structConstraint.back());
+	expect(TokenType::LBRACE);
+	while (cur_.type != TokenType::RBRACE)
+	{
+		if (cur_.type == TokenType::CONST || cur_.type == TokenType::INT || cur_.type == TokenType::FLOAT)
+		{
+			const int line = cur_.line;
+			list<ASTVarDecl*> decls;
+			parseDecl(decls);
+			for (auto i : decls)
+			{
+				i->_line = line;
+				block->_stmts.emplace_back(i);
+			}
+		}
+		else
+		{
+			list<ASTStmt*> stmts;
+			parseStmt(stmts);
+			for (auto i : stmts) block->_stmts.emplace_back(i);
+		}
+	}
+	advance();
+}
+
+void Source2AstParser::parseStmt(std::list<ASTStmt*>& out)
+{
+	const int line = cur_.line;
+	const bool empty = out.empty();
+	const auto last = empty ? out.end() : prev(out.end());
+	parseStmtWithoutLine(out);
+	for (auto it = empty ? out.begin() : next(last); it != out.end(); ++it)
+		if ((*it)->_line == 0) (*it)->_line = line;
+}
+
+void Source2AstParser::parseStmtWithoutLine(std::list<ASTStmt*>& out)
+{
+	switch (cur_.type)
+	{
+		case TokenType::SEMICO:
+			advance();
+			return;
+		case TokenType::LBRACE:
+			{
+				auto block = new ASTBlock();
+				_structConstraint.push_back(block);
+				parseBlock();
+				_structConstraint.pop_back();
+				if (block->isEmpty())
+				{
+					delete block;
+					return;
+				}
+				out.emplace_back(block);
+				return;
+			}
+		case TokenType::IF:
+			parseIf(out);
+			return;
+		case TokenType::WHILE:
+			parseWhile(out);
+			return;
+		case TokenType::BREAK:
+			advance();
+			expect(TokenType::SEMICO);
+			out.emplace_back(new ASTBreak{_whileConstraint.top()});
+			return;
+		case TokenType::CONTINUE:
+			advance();
+			expect(TokenType::SEMICO);
+			out.emplace_back(new ASTContinue{_whileConstraint.top()});
+			return;
+		case TokenType::RETURN:
+			{
+				advance();
+				if (acceptToken(TokenType::SEMICO))
+				{
+					ASSERT(_currentFunction->returnType() == VOID);
+					out.emplace_back(new ASTReturn{nullptr, _currentFunction});
+					return;
+				}
+				ASSERT(_currentFunction->returnType() != VOID);
+				auto ret = parseExp();
+				expect(TokenType::SEMICO);
+				ret = ret->castTypeTo(_currentFunction->returnType());
+				out.emplace_back(new ASTReturn{ret, _currentFunction});
+				return;
+			}
+		default:
+			break;
+	}
+	// lVal ASSIGN exp SEMICO 与 exp SEMICO 的前缀相同, 左值作为表达式解析时不会被折叠, 因此先解析表达式再检查 =
+	auto exp = parseExp();
+	if (acceptToken(TokenType::ASSIGN))
+	{
+		const auto rv = dynamic_cast<ASTRVal*>(exp);
+		ASSERT(rv != nullptr);
+		ASSERT(!rv->getDeclaration()->isConst());
+		const auto lv = rv->toLVal();
+		auto v = parseExp();
+		expect(TokenType::SEMICO);
+		v = v->castTypeTo(rv->getExpressionType());
+		rv->_index.clear();
+		delete rv;
+		out.emplace_back(new ASTAssign(lv, v));
+		return;
+	}
+	expect(TokenType::SEMICO);
+	for (auto i : AST::cutExpressionToOnlyLeaveFuncCall(exp)) out.emplace_back(i);
+}
+
+// IF LPAREN cond RPAREN stmt ( ELSE stmt )?
+void Source2AstParser::parseIf(std::list<ASTStmt*>& out)
+{
+	advance();
+	expect(TokenType::LPAREN);
+	auto cond = parseCond();
+	expect(TokenType::RPAREN);
+	list<ASTStmt*> if_st;
+	parseStmt(if_st);
+	list<ASTStmt*> else_st;
+	if (acceptToken(TokenType::ELSE)) parseStmt(else_st);
+	if (const auto condNum = dynamic_cast<ASTNumber*>(cond); condNum != nullptr)
+	{
+		if (condNum->toBoolean())
+		{
+			delete cond;
+			for (auto& i : else_st) delete i;
+			out.splice(out.end(), if_st);
+			return;
+		}
+		for (auto& i : if_st) delete i;
+		delete cond;
+		out.splice(out.end(), else_st);
+		return;
+	}
+	if (const auto condLogic = dynamic_cast<ASTLogicExp*>(cond);
+		condLogic != nullptr && condLogic->_have_result != ASTLogicExp::UNDEFINE)
+	{
+		if (condLogic->_have_result == ASTLogicExp::TRUE)
+		{
+			for (auto& i : else_st) delete i;
+			if_st.push_front(cond);
+			out.splice(out.end(), if_st);
+			return;
+		}
+		for (auto& i : if_st) delete i;
+		else_st.push_front(cond);
+		out.splice(out.end(), else_st);
+		return;
+	}
+	if (if_st.empty())
+	{
+		if (else_st.empty())
+		{
+			for (auto& i : AST::cutExpressionToOnlyLeaveFuncCall(cond)) out.emplace_back(i);
+			return;
+		}
+		if (const auto not_ = dynamic_cast<ASTNot*>(cond); not_ != nullptr)
+		{
+			cond = not_->_hold;
+			cond = cond->castTypeTo(BOOL, TypeCastEnvironment::LOGIC_EXPRESSION);
+			not_->_hold = nullptr;
+			delete not_;
+		}
+		else
+			cond = new ASTNot{cond};
+		auto if_node = new ASTIf{cond};
+		for (auto& i : else_st)
+			if_node->_if_stmt.emplace_back(i);
+		out.emplace_back(if_node);
+		return;
+	}
+	auto if_node = new ASTIf{cond};
+	for (auto& i : if_st)
+		if_node->_if_stmt.emplace_back(i);
+	for (auto& i : else_st)
+		if_node->_else_stmt.emplace_back(i);
+	out.emplace_back(if_node);
+}
+
+// WHILE LPAREN cond RPAREN stmt
+void Source2AstParser::parseWhile(std::list<ASTStmt*>& out)
+{
+	advance();
+	expect(TokenType::LPAREN);
+	// 记录条件的起点, 在 AST 中旋转循环时需要再次解析条件
+	const Token condBegin = cur_;
+	auto cond = parseCond();
+	expect(TokenType::RPAREN);
+	auto loop = new ASTWhile{cond};
+	_whileConstraint.push(loop);
+	list<ASTStmt*> stmt;
+	parseStmt(stmt);
+	_whileConstraint.pop();
+	for (auto& i : stmt) loop->_stmt.emplace_back(i);
+	if (const auto condNum = dynamic_cast<ASTNumber*>(cond); condNum != nullptr && !condNum->toBoolean())
+	{
+		delete loop;
+		return;
+	}
+	if (const auto condLogic = dynamic_cast<ASTLogicExp*>(cond);
+		condLogic != nullptr && condLogic->_have_result == ASTLogicExp::FALSE)
+	{
+		loop->_cond = nullptr;
+		delete loop;
+		out.emplace_back(condLogic);
+		return;
+	}
+	if (loop->_stmt.empty())
+	{
+		if (!cond->_haveFuncCall)
+		{
+			delete loop;
+			return;
+		}
+		out.emplace_back(loop);
+		return;
+	}
+	if (loopRotateAndAddGuardInAST)
+	{
+		const Token resume = cur_;
+		seek(condBegin);
+		auto cond2 = parseCond();
+		seek(resume);
+		auto ifNode = new ASTIf{cond2};
+		ifNode->_if_stmt.emplace_back(loop);
+		out.emplace_back(ifNode);
+		return;
+	}
+	out.emplace_back(loop);
+}
+
+// exp : addExp
+ASTExpression* Source2AstParser::parseExp()
+{
+	return parseAddExp();
+}
+
+// constExp : addExp
+ASTExpression* Source2AstParser::parseConstExp()
+{
+	const auto ret = parseAddExp();
+	ASSERT(dynamic_cast<ASTNumber*>(ret) != nullptr);
+	return ret;
+}
+
+// cond : lOrExp
+ASTExpression* Source2AstParser::parseCond()
+{
+	_allowLogic = true;
+	auto cond = parseLOrExp();
+	_allowLogic = false;
+	return cond->castTypeTo(BOOL, TypeCastEnvironment::LOGIC_EXPRESSION);
+}
+
+// lVal : ID (LBRACK exp RBRACK)*
+ASTExpression* Source2AstParser::parseLVal()
+{
+	const auto d = findScope(expect(TokenType::ID).str(), false);
+	ASSERT(d != nullptr);
+	const auto decl = dynamic_cast<ASTVarDecl*>(d);
+	if (decl->getType()->isArrayType())
+	{
+		const auto ar = dynamic_cast<ArrayType*>(decl->getType());
+		const int ori = u2iNegThrow(ar->dimensions().size()) +
+		                (ar->getTypeID() == TypeIDs::ArrayInParameter ? 1 : 0);
+		vector<ASTExpression*> indexes;
+		bool allConst = decl->isConst();
+		int dimIdx = 0;
+		while (acceptToken(TokenType::LBRACK))
+		{
+			const auto idx = parseExp();
+			expect(TokenType::RBRACK);
+			ASSERT(ori > dimIdx);
+			ASSERT(idx->getExpressionType() == INT);
+			if (const auto num = dynamic_cast<ASTNumber*>(idx); num != nullptr)
+			{
+				int m = INT_MAX;
+				if (ar->getTypeID() == TypeIDs::Array)
+				{
+					m = ar->dimensions()[dimIdx];
+				}
+				else if (dimIdx > 0)
+					m = ar->dimensions()[dimIdx - 1];
+				ASSERT(num->toInteger() >= 0 && num->toInteger() < m);
+			}
+			else allConst = false;
+			indexes.emplace_back(idx);
+			dimIdx++;
+		}
+		if (allConst && ori == dimIdx)
+		{
+			vector<int> constIndexes;
+			for (const auto& i : indexes)
+			{
+				constIndexes.emplace_back(dynamic_cast<ASTNumber*>(i)->toInteger());
+				delete i;
+			}
+			if (const auto plain = decl->getPlainInitList(); plain != nullptr)
+			{
+				int flat = 0;
+				for (int i = 0; i < dimIdx; i++) flat = flat * ar->dimensions()[i] + constIndexes[i];
+				return new ASTNumber(plain->getElement(flat).toInitializeValue());
+			}
+			const auto l = decl->getInitList();
+			return new ASTNumber(l->visitData()->getElement(constIndexes));
+		}
+		auto ret = static_cast<ASTExpression*>(new ASTRVal(decl, indexes));
+		for (auto& i : indexes)
+			ret->_haveFuncCall = ret->_haveFuncCall || i->_haveFuncCall;
+		return ret;
+	}
+	ASSERT(cur_.type != TokenType::LBRACK);
+	if (decl->isConst())
+		return new ASTNumber{decl->_initList->getData()->getElement({})};
+	return new ASTRVal(decl, {});
+}
+
+// primaryExp : LPAREN exp RPAREN | lVal | number
+ASTExpression* Source2AstParser::parsePrimaryExp()
+{
+	switch (cur_.type)
+	{
+		case TokenType::LPAREN:
+			{
+				advance();
+				const auto ret = parseExp();
+				expect(TokenType::RPAREN);
+				return ret;
+			}
+		case TokenType::ID:
+			return parseLVal();
+		case TokenType::INT_CONST:
+		case TokenType::FLOAT_CONST:
+			return parseNumber();
+		default:
+			syntaxError("expression");
+	}
+}
+
+// number : IntConst | FloatConst
+ASTExpression* Source2AstParser::parseNumber()
+{
+	const auto v = literalValue(advance());
+	if (v.isIntConstant()) return new ASTNumber(v.getIntConstant());
+	return new ASTNumber(v.getFloatConstant());
+}
+
+ConstantValue Source2AstParser::literalValue(const Token& tk)
+{
+	const auto str = tk.str();
+	if (tk.type == TokenType::INT_CONST)
+	{
+		int base = 10;
+		if (str.size() >= 2 && str[0] == '0')
+			base = str[1] == 'x' || str[1] == 'X' ? 16 : 8;
+		// 与 stoi 不同, 超出 int 范围的字面量(例如 -2147483648 中的 2147483648)按位截断而不是抛出异常
+		return ConstantValue{u2iKeepBits(static_cast<unsigned>(strtoull(str.c_str(), nullptr, base)))};
+	}
+	return ConstantValue{strtof(str.c_str(), nullptr)};
+}
+
+// unaryExp : primaryExp | ID LPAREN (funcRParams)? rParen | (ADD | SUB | NOT) unaryExp
+ASTExpression* Source2AstParser::parseUnaryExp()
+{
+	const auto op = cur_.type;
+	if (op == TokenType::ID && peek(1).type == TokenType::LPAREN) return parseCall();
+	if (op != TokenType::ADD && op != TokenType::SUB && op != TokenType::NOT) return parsePrimaryExp();
+	advance();
+	auto exp = parseUnaryExp();
+	if (op == TokenType::ADD)
+	{
+		if (exp->getExpressionType() == BOOL)
+			exp = exp->castTypeTo(INT, TypeCastEnvironment::LOGIC_EXPRESSION);
+		return exp;
+	}
+	if (op == TokenType::SUB)
+	{
+		if (exp->getExpressionType() == BOOL)
+			exp = exp->castTypeTo(INT, TypeCastEnvironment::LOGIC_EXPRESSION);
+		if (auto n = dynamic_cast<ASTNeg*>(exp); n != nullptr)
+		{
+			exp = n->_hold;
+			n->_hold = nullptr;
+			delete n;
+			return exp;
+		}
+		if (const auto n = dynamic_cast<ASTNumber*>(exp); n != nullptr)
+		{
+			if (n->getExpressionType() == INT)
+				n->_field = ConstantValue{-n->_field.getIntConstant()};
+			else n->_field = ConstantValue{-n->_field.getFloatConstant()};
+			return exp;
+		}
+		ASTNeg* n = new ASTNeg(exp);
+		n->_haveFuncCall = exp->_haveFuncCall;
+		return n;
+	}
+	if (!_allowLogic) throw runtime_error("math expression don't allow logic!");
+	if (const auto logic = dynamic_cast<ASTNot*>(exp); logic != nullptr)
+	{
+		auto ret = logic->_hold;
+		logic->_hold = nullptr;
+		delete logic;
+		return ret;
+	}
+	if (auto n = dynamic_cast<ASTNumber*>(exp); n != nullptr)
+	{
+		n = dynamic_cast<ASTNumber*>(n->castTypeTo(BOOL, TypeCastEnvironment::LOGIC_EXPRESSION));
+		n->_field = ConstantValue{!n->_field.getBoolConstant()};
+		return n;
+	}
+	exp = exp->castTypeTo(BOOL, TypeCastEnvironment::LOGIC_EXPRESSION);
+	const auto n = new ASTNot(exp);
+	n->_haveFuncCall = exp->_haveFuncCall;
+	return n;
+}
+
+// ID LPAREN (funcRParams)? rParen
+ASTExpression* Source2AstParser::parseCall()
+{
+	bool special = false;
+	auto id = advance().str();
+	if (id == "starttime")
+	{
+		id = "_sysy_starttime";
+		special = true;
+	}
+	else if (id == "stoptime")
+	{
+		id = "_sysy_stoptime";
+		special = true;
+	}
+	const auto f = findScope(id, true);
+	if (f == nullptr) throw runtime_error("Undeclared function " + id);
+	const auto func = dynamic_cast<ASTFuncDecl*>(f);
+	expect(TokenType::LPAREN);
+	vector<ASTExpression*> getArgs;
+	if (cur_.type != TokenType::RPAREN)
+	{
+		do getArgs.emplace_back(parseExp());
+		while (acceptToken(TokenType::COMMA));
+	}
+	const auto rParen = expect(TokenType::RPAREN);
+	if (special)
+	{
+		ASSERT(getArgs.empty());
+		getArgs.emplace_back(new ASTNumber{rParen.line});
+	}
+	const auto typeArgs = func->args();
+	ASSERT(typeArgs.size() == getArgs.size());
+	const int size = u2iNegThrow(getArgs.size());
+	for (int i = 0; i < size; i++)
+	{
+		auto& get = getArgs[i];
+		const auto& arg = typeArgs[i];
+		const auto& type = arg->getType();
+		const auto getType = get->getExpressionType();
+		if (type == FLOAT || type == INT)
+		{
+			if (getType == FLOAT || getType == INT) get = get->castTypeTo(type);
+		}
+		if (type->getTypeID() == TypeIDs::ArrayInParameter)
+		{
+			ASSERT(getType->getTypeID() == TypeIDs::Array || getType->getTypeID() == TypeIDs::ArrayInParameter);
+			const auto arT = dynamic_cast<ArrayType*>(type);
+			const auto arGT = dynamic_cast<ArrayType*>(getType);
+			ASSERT(arT->typeContained() == arGT->typeContained());
+			// 库函数的输入参数并不满足维度要求
+			if (func->isLibFunc()) continue;
+			if (const auto tlv = dynamic_cast<ASTLVal*>(get); tlv != nullptr)
+			{
+				ASSERT(!tlv->getDeclaration()->isConst());
+			}
+			ASSERT(arGT->canPassToFuncOf(arT));
+		}
+	}
+	return new ASTCall{func, getArgs};
+}
+
+// mulExp : unaryExp | mulExp (MUL | DIV | MOD) unaryExp
+ASTExpression* Source2AstParser::parseMulExp()
+{
+	auto l = parseUnaryExp();
+	while (cur_.type == TokenType::MUL || cur_.type == TokenType::DIV || cur_.type == TokenType::MOD)
+	{
+		const auto op = advance().type;
+		l = combineMul(l, op, parseUnaryExp());
+	}
+	return l;
+}
+
+// addExp : mulExp | addExp (ADD | SUB) mulExp
+ASTExpression* Source2AstParser::parseAddExp()
+{
+	auto l = parseMulExp();
+	while (cur_.type == TokenType::ADD || cur_.type == TokenType::SUB)
+	{
+		const auto op = advance().type;
+		l = combineAdd(l, op, parseMulExp());
+	}
+	return l;
+}
+
+// relExp : addExp | relExp (LT | GT | LE | GE) addExp
+ASTExpression* Source2AstParser::parseRelExp()
+{
+	auto l = parseAddExp();
+	while (cur_.type == TokenType::LT || cur_.type == TokenType::GT || cur_.type == TokenType::LE || cur_.type ==
+	       TokenType::GE)
+	{
+		const auto op = advance().type;
+		l = combineRel(l, op, parseAddExp());
+	}
+	return l;
+}
+
+// eqExp : relExp | eqExp (EQ | NE) relExp
+ASTExpression* Source2AstParser::parseEqExp()
+{
+	auto l = parseRelExp();
+	while (cur_.type == TokenType::EQ || cur_.type == TokenType::NE)
+	{
+		const auto op = advance().type;
+		l = combineEq(l, op, parseRelExp());
+	}
+	return l;
+}
+
+// lAndExp : eqExp ( AND eqExp )*
+ASTExpression* Source2AstParser::parseLAndExp()
+{
+	auto first = parseEqExp();
+	if (cur_.type != TokenType::AND) return first;
+	vector<ASTExpression*> operands{first};
+	while (acceptToken(TokenType::AND)) operands.emplace_back(parseEqExp());
+	return combineLAnd(operands);
+}
+
+// lOrExp : lAndExp ( OR lAndExp )*
+ASTExpression* Source2AstParser::parseLOrExp()
+{
+	auto first = parseLAndExp();
+	if (cur_.type != TokenType::OR) return first;
+	vector<ASTExpression*> operands{first};
+	while (acceptToken(TokenType::OR)) operands.emplace_back(parseLAndExp());
+	return combineLOr(operands);
+}
+
+ASTExpression* Source2AstParser::combineMul(ASTExpression* l, TokenType opType, ASTExpression* r) const
+{
+	const auto op = opType == TokenType::MUL ? MathOP::MUL : opType == TokenType::DIV ? MathOP::DIV : MathOP::MOD;
+	const auto env = _allowLogic ? TypeCastEnvironment::LOGIC_EXPRESSION : TypeCastEnvironment::MATH_EXPRESSION;
+	auto tyT = ASTExpression::maxType(l, r, env);
+	if (tyT == BOOL) tyT = INT;
+	l = l->castTypeTo(tyT, env);
+	r = r->castTypeTo(tyT, env);
+	if (const auto rnum = dynamic_cast<ASTNumber*>(r); rnum != nullptr)
+	{
+		if (op != MathOP::MUL)
+		{
+			const auto ty = r->getExpressionType();
+			ASSERT(ty != FLOAT || rnum->toFloat() != 0.0f);
+			ASSERT(ty != INT || rnum->toInteger() != 0);
+		}
+	}
+	ASSERT(op != MathOP::MOD || tyT != FLOAT);
+	const auto lnum = dynamic_cast<ASTNumber*>(l);
+	const auto rnum = dynamic_cast<ASTNumber*>(r);
+	if (lnum != nullptr && rnum != nullptr)
+	{
+		if (tyT == INT)
+		{
+			const int a = lnum->forceToInteger();
+			const int b = rnum->forceToInteger();
+			delete rnum;
+			if (op == MathOP::MUL) lnum->_field = ConstantValue{a * b};
+			else if (op == MathOP::DIV) lnum->_field = ConstantValue{a / b};
+			else lnum->_field = ConstantValue{a % b};
+			return lnum;
+		}
+		const float a = lnum->forceToFloat();
+		const float b = rnum->forceToFloat();
+		delete rnum;
+		if (op == MathOP::MUL) lnum->_field = ConstantValue{a * b};
+		else lnum->_field = ConstantValue{a / b};
+		return lnum;
+	}
+	auto ln = dynamic_cast<ASTNeg*>(l);
+	if (auto rn = dynamic_cast<ASTNeg*>(r); ln != nullptr && rn != nullptr)
+	{
+		l = ln->_hold;
+		ln->_hold = nullptr;
+		delete ln;
+		r = rn->_hold;
+		rn->_hold = nullptr;
+		delete rn;
+	}
+	else if (ln != nullptr || rn != nullptr)
+	{
+		auto n = ln != nullptr ? ln : rn;
+		if (ln != nullptr) l = n->_hold;
+		else r = n->_hold;
+		const auto node = new ASTMathExp(tyT, op, l, r);
+		node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+		n->_hold = node;
+		n->_haveFuncCall = node->_haveFuncCall;
+		return n;
+	}
+	const auto node = new ASTMathExp(tyT, op, l, r);
+	node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+	return node;
+}
+
+ASTExpression* Source2AstParser::combineAdd(ASTExpression* l, TokenType opType, ASTExpression* r) const
+{
+	const auto op = opType == TokenType::ADD ? MathOP::ADD : MathOP::SUB;
+	const auto env = _allowLogic ? TypeCastEnvironment::LOGIC_EXPRESSION : TypeCastEnvironment::MATH_EXPRESSION;
+	auto tyT = ASTExpression::maxType(l, r, env);
+	if (tyT == BOOL) tyT = INT;
+	l = l->castTypeTo(tyT, env);
+	r = r->castTypeTo(tyT, env);
+	const auto lm = dynamic_cast<ASTNumber*>(l);
+	const auto rm = dynamic_cast<ASTNumber*>(r);
+	if (lm != nullptr && rm != nullptr)
+	{
+		if (tyT == INT)
+		{
+			int a = lm->forceToInteger();
+			int b = rm->forceToInteger();
+			delete rm;
+			if (op == MathOP::ADD) lm->_field = ConstantValue{a + b};
+			else lm->_field = ConstantValue{a - b};
+			return lm;
+		}
+		float a = lm->forceToFloat();
+		float b = rm->forceToFloat();
+		delete rm;
+		if (op == MathOP::ADD) lm->_field = ConstantValue{a + b};
+		else lm->_field = ConstantValue{a - b};
+		return lm;
+	}
+	auto ln = dynamic_cast<ASTNeg*>(l);
+	auto rn = dynamic_cast<ASTNeg*>(r);
+	if (ln != nullptr)
+	{
+		if (rn != nullptr)
+		{
+			// (-a) + (-b) = -(a + b)
+			if (op == MathOP::ADD)
+			{
+				l = ln->_hold;
+				ln->_hold = nullptr;
+				delete ln;
+				r = rn->_hold;
+				l = l->castTypeTo(tyT);
+				r = r->castTypeTo(tyT);
+				const auto node = new ASTMathExp(tyT, op, l, r);
+				node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+				rn->_hold = node;
+				rn->_haveFuncCall = node->_haveFuncCall;
+				return rn;
+			}
+			// (-a) - (-b) = b - a
+			l = ln->_hold;
+			ln->_hold = nullptr;
+			delete ln;
+			r = rn->_hold;
+			rn->_hold = nullptr;
+			delete rn;
+			l = l->castTypeTo(tyT);
+			r = r->castTypeTo(tyT);
+			const auto node = new ASTMathExp(tyT, op, r, l);
+			node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+			return node;
+		}
+		// (-a) + b = b - a
+		if (op == MathOP::ADD)
+		{
+			l = ln->_hold;
+			ln->_hold = nullptr;
+			delete ln;
+			l = l->castTypeTo(tyT);
+			r = r->castTypeTo(tyT);
+			const auto node = new ASTMathExp(tyT, MathOP::SUB, r, l);
+			node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+			return node;
+		}
+		// (-a) - b = -(a + b)
+		l = ln->_hold;
+		l = l->castTypeTo(tyT);
+		r = r->castTypeTo(tyT);
+		const auto node = new ASTMathExp(tyT, MathOP::ADD, l, r);
+		node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+		ln->_haveFuncCall = node->_haveFuncCall;
+		ln->_hold = node;
+		return ln;
+	}
+	if (rn != nullptr)
+	{
+		// a + (-b) = a - b, a - (-b) = a + b
+		r = rn->_hold;
+		rn->_hold = nullptr;
+		delete rn;
+		l = l->castTypeTo(tyT);
+		r = r->castTypeTo(tyT);
+		const auto node = new ASTMathExp(tyT, op == MathOP::ADD ? MathOP::SUB : MathOP::ADD, l, r);
+		node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+		return node;
+	}
+	const auto node = new ASTMathExp(tyT, op, l, r);
+	node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+	return node;
+}
+
+ASTExpression* Source2AstParser::combineRel(ASTExpression* l, TokenType opType, ASTExpression* r)
+{
+	auto tyT = ASTExpression::maxType(l, r, TypeCastEnvironment::LOGIC_EXPRESSION);
+	if (tyT == BOOL) tyT = INT;
+	l = l->castTypeTo(tyT, TypeCastEnvironment::LOGIC_EXPRESSION);
+	r = r->castTypeTo(tyT, TypeCastEnvironment::LOGIC_EXPRESSION);
+	auto lNum = dynamic_cast<ASTNumber*>(l);
+	auto rNum = dynamic_cast<ASTNumber*>(r);
+	if (lNum != nullptr && rNum != nullptr)
+	{
+		bool res;
+		if (opType == TokenType::LT)
+		{
+			if (lNum->isInteger())
+				res = lNum->toInteger() < rNum->toInteger();
+			else res = lNum->toFloat() < rNum->toFloat();
+		}
+		else if (opType == TokenType::GT)
+		{
+			if (lNum->isInteger())
+				res = lNum->toInteger() > rNum->toInteger();
+			else res = lNum->toFloat() > rNum->toFloat();
+		}
+		else if (opType == TokenType::LE)
+		{
+			if (lNum->isInteger())
+				res = lNum->toInteger() <= rNum->toInteger();
+			else res = lNum->toFloat() <= rNum->toFloat();
+		}
+		else
+		{
+			if (lNum->isInteger())
+				res = lNum->toInteger() >= rNum->toInteger();
+			else res = lNum->toFloat() >= rNum->toFloat();
+		}
+		delete rNum;
+		lNum->_field = ConstantValue{res};
+		return lNum;
+	}
+	RelationOP op;
+	if (opType == TokenType::LT) op = RelationOP::LT;
+	else if (opType == TokenType::GT) op = RelationOP::GT;
+	else if (opType == TokenType::LE) op = RelationOP::LE;
+	else op = RelationOP::GE;
+	auto node = new ASTRelation{op, l, r};
+	node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+	return node;
+}
+
+ASTExpression* Source2AstParser::combineEq(ASTExpression* l, TokenType opType, ASTExpression* r)
+{
+	auto tyT = ASTExpression::maxType(l, r, TypeCastEnvironment::LOGIC_EXPRESSION);
+	if (tyT == BOOL) tyT = INT;
+	l = l->castTypeTo(tyT, TypeCastEnvironment::LOGIC_EXPRESSION);
+	r = r->castTypeTo(tyT, TypeCastEnvironment::LOGIC_EXPRESSION);
+	auto lNum = dynamic_cast<ASTNumber*>(l);
+	auto rNum = dynamic_cast<ASTNumber*>(r);
+	if (lNum != nullptr && rNum != nullptr)
+	{
+		bool res;
+		if (lNum->isInteger())
+			res = lNum->toInteger() == rNum->toInteger();
+		else if (lNum->isFloat()) res = lNum->toFloat() == rNum->toFloat();
+		else res = lNum->toBoolean() == rNum->toBoolean();
+		if (opType == TokenType::NE) res = !res;
+		delete rNum;
+		lNum->_field = ConstantValue{res};
+		return lNum;
+	}
+	auto node = new ASTEqual{opType == TokenType::EQ, l, r};
+	node->_haveFuncCall = l->_haveFuncCall || r->_haveFuncCall;
+	return node;
+}
+
+ASTExpression* Source2AstParser::combineLAnd(std::vector<ASTExpression*>& operands)
+{
+	bool cut = false;
+	bool comp = false;
+	vector<ASTExpression*> exps;
+	for (auto exp : operands)
+	{
+		ASSERT(exp != nullptr);
+		exp = exp->castTypeTo(BOOL, TypeCastEnvironment::LOGIC_EXPRESSION);
+		if (auto num = dynamic_cast<ASTNumber*>(exp); num != nullptr)
+		{
+			// 既然可以编译期间计算得到结果, 就不存在副作用
+			if (num->toBoolean() == false) cut = true;
+			delete exp;
+		}
+		else if (!cut)
+		{
+			exps.emplace_back(exp);
+			if (exp->_haveFuncCall) comp = true;
+		}
+		else delete exp;
+	}
+	if (!comp)
+	{
+		if (cut)
+		{
+			for (auto& i : exps) delete i;
+			return new ASTNumber(false);
+		}
+		if (exps.empty()) return new ASTNumber(true);
+		if (exps.size() == 1) return exps[0];
+		return new ASTLogicExp{LogicOP::AND, exps, ASTLogicExp::UNDEFINE};
+	}
+	if (cut)
+	{
+		// 只保留有副作用的表达式
+		vector<ASTExpression*> e;
+		for (auto& i : exps)
+		{
+			if (i->_haveFuncCall) e.push_back(i);
+			else delete i;
+		}
+		e.emplace_back(new ASTNumber{false});
+		auto ret = new ASTLogicExp{LogicOP::AND, e, ASTLogicExp::FALSE};
+		ret->_haveFuncCall = true;
+		return ret;
+	}
+	auto ret = new ASTLogicExp{LogicOP::AND, exps, ASTLogicExp::UNDEFINE};
+	ret->_haveFuncCall = true;
+	return ret;
+}
+
+ASTExpression* Source2AstParser::combineLOr(std::vector<ASTExpression*>& operands)
+{
+	bool cut = false;
+	bool comp = false;
+	bool undef = false;
+	vector<ASTExpression*> exps;
+	for (auto exp : operands)
+	{
+		ASSERT(exp != nullptr);
+		exp = exp->castTypeTo(BOOL, TypeCastEnvironment::LOGIC_EXPRESSION);
+		if (auto num = dynamic_cast<ASTNumber*>(exp); num != nullptr)
+		{
+			// 既然可以编译期间计算得到结果, 就不存在副作用
+			if (num->toBoolean() == true) cut = true;
+			delete exp;
+		}
+		else if (!cut)
+		{
+			if (auto log = dynamic_cast<ASTLogicExp*>(exp); log != nullptr)
+			{
+				// 如果 have_result_, 一定 haveFuncCall_; 否则该是 Number
+				if (log->_have_result == ASTLogicExp::TRUE)
+				{
+					cut = true;
+					comp = true;
+				}
+				else if (log->_have_result == ASTLogicExp::UNDEFINE)
+					undef = true;
+			}
+			else
+				undef = true;
+			exps.emplace_back(exp);
+			if (exp->_haveFuncCall) comp = true;
+		}
+		else delete exp;
+	}
+	if (!comp)
+	{
+		if (cut)
+		{
+			for (auto& i : exps) delete i;
+			return new ASTNumber{true};
+		}
+		if (exps.empty()) return new ASTNumber{false};
+		if (exps.size() == 1) return exps[0];
+		return new ASTLogicExp{LogicOP::OR, exps, ASTLogicExp::UNDEFINE};
+	}
+	if (cut)
+	{
+		// 只保留有副作用的表达式
+		vector<ASTExpression*> e;
+		for (auto& i : exps)
+		{
+			if (i->_haveFuncCall) e.push_back(i);
+			else delete i;
+		}
+		if (auto log = dynamic_cast<ASTLogicExp*>(e.back()); log != nullptr && log->_have_result == ASTLogicExp::TRUE)
+		{
+			if (e.size() == 1) return e[0];
+			auto ret = new ASTLogicExp{LogicOP::OR, e, ASTLogicExp::TRUE};
+			ret->_haveFuncCall = true;
+			return ret;
+		}
+		e.emplace_back(new ASTNumber{true});
+		auto ret = new ASTLogicExp{LogicOP::OR, e, ASTLogicExp::TRUE};
+		ret->_haveFuncCall = true;
+		return ret;
+	}
+	auto ret = new ASTLogicExp{LogicOP::OR, exps, undef ? ASTLogicExp::UNDEFINE : ASTLogicExp::FALSE};
+	ret->_haveFuncCall = true;
+	return ret;
+}
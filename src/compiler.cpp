@@ -6,40 +6,58 @@
 #include <Antlr2Ast.hpp>
 #include <cfloat>
 
+#include "AddressFold.hpp"
 #include "Arithmetic.hpp"
 #include "BlockLayout.hpp"
 #include "CleanCode.hpp"
 #include "CmpCombine.hpp"
 #include "CodeGen.hpp"
+#include "CompileCache.hpp"
+#include "CostModel.hpp"
+#include "CompilationContext.hpp"
+#include "CondCompare.hpp"
 #include "Config.hpp"
 #include "ConstGlobalEliminate.hpp"
 #include "CountLZ.hpp"
 #include "CriticalEdgeRemove.hpp"
 #include "DeadCode.hpp"
+#include "FlagFold.hpp"
 #include "FrameOffset.hpp"
+#include "Function.hpp"
 #include "GCM.hpp"
 #include "GVN.hpp"
 #include "GetElementSplit.hpp"
 #include "GlobalArrayReverse.hpp"
+#include "IfConversion.hpp"
 #include "Inline.hpp"
+#include "Interpret.hpp"
 #include "InstructionSelect.hpp"
 #include "LCSSA.hpp"
+#include "LFTR.hpp"
 #include "LICM.hpp"
 #include "LoadStoreEliminate.hpp"
+#include "LoadStorePair.hpp"
 #include "LocalConstGlobalMatching.hpp"
 #include "LoopRotate.hpp"
 #include "LoopSimplify.hpp"
 #include "MachineModule.hpp"
+#include "MappedFile.hpp"
 #include "Mem2Reg.hpp"
 #include "Module.hpp"
+#include "OptionRegistry.hpp"
 #include "PassManager.hpp"
 #include "PhiEliminate.hpp"
 #include "Print.hpp"
 #include "RegPrefill.hpp"
+#include "RegPressure.hpp"
 #include "RegSpill.hpp"
 #include "RegisterAllocate.hpp"
+#include "Remarks.hpp"
 #include "ReturnMerge.hpp"
 #include "SCCP.hpp"
+#include "ShiftFold.hpp"
+#include "TimeReport.hpp"
+#include "Source2Ast.hpp"
 
 #include "Ast.hpp"
 #include "System.hpp"
@@ -50,44 +68,345 @@
 #include <tree/ParseTreeVisitor.h>
 #include <tree/ParseTreeWalker.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <vector>
 
-std::tuple<std::string, std::string> parseArgs(int argc, char **argv) {
-  // compiler -S -o <testcase.s> <testcase.sy> [-O1]
-  if (argc < 5) {
-    std::cerr << "Usage: " << argv[0]
-              << " -S -o <testcase.s> <testcase.sy> [-O1] [-ast/ir/stack]\n";
-    std::exit(EXIT_FAILURE);
+// 命令行上以 -opt 与 -opt-file 显式设置的选项, 在 -O0 的默认值之后重新写入
+thread_local std::vector<std::string> optionAssignments;
+
+// 按逗号切分, 忽略空项
+std::vector<std::string> splitComma(const std::string &list) {
+  std::vector<std::string> items;
+  std::istringstream in{list};
+  std::string item;
+  while (std::getline(in, item, ','))
+    if (!item.empty())
+      items.emplace_back(item);
+  return items;
+}
+
+using AddPass = void (*)(PassManager *);
+
+// IR 优化 pass 对流水线的约束
+enum IRPassFlags : unsigned {
+  // 后端依赖它的结果, 不能用 -disable-pass 跳过
+  requiredPass = 1u << 0,
+  // 改变控制流图或丢弃 LoopSimplify 记录的前置块, 之后的循环 pass 之前要重新运行
+  // LoopSimplify 与 LCSSA
+  invalidatesLoops = 1u << 1,
+  // 留下的不可达块要由之后的 DeadCode 删除, 否则后端会出错
+  needsDeadCodeAfter = 1u << 2,
+  // 不允许没有使用的指令, 前一个 pass 必须是 DeadCode
+  needsDeadCodeBefore = 1u << 3,
+};
+
+// 可以在 -passes= 中使用的 IR 优化 pass
+struct IRPass {
+  std::string name;
+  AddPass add;
+  // 流水线中必须先运行的 pass, 它们建立这个 pass 依赖的 IR 形式
+  std::vector<std::string> prerequisites;
+  unsigned flags = 0;
+};
+
+const std::vector<IRPass> &irPasses() {
+  // 除 ConstGlobalEliminate 外都要求 SSA 形式, 并由 DeadCode 删除不可达块与无用的 phi
+  static const std::vector<std::string> ssa = {"Mem2Reg", "DeadCode"};
+  static const std::vector<std::string> loop = {"Mem2Reg", "DeadCode",
+                                                "LoopSimplify"};
+  static const std::vector<std::string> lcssa = {"Mem2Reg", "DeadCode",
+                                                 "LoopSimplify", "LCSSA"};
+  static const std::vector<IRPass> passes = {
+      {"ConstGlobalEliminate",
+       [](PassManager *pm) { pm->add_pass<ConstGlobalEliminate>(false); },
+       {}},
+      {"Mem2Reg", [](PassManager *pm) { pm->add_pass<Mem2Reg>(); }, {},
+       requiredPass},
+      {"DeadCode", [](PassManager *pm) { pm->add_pass<DeadCode>(); },
+       {"Mem2Reg"}, requiredPass},
+      {"SCCP", [](PassManager *pm) { pm->add_pass<SCCP>(); }, ssa,
+       invalidatesLoops | needsDeadCodeAfter},
+      {"Arithmetic", [](PassManager *pm) { pm->add_pass<Arithmetic>(); }, ssa},
+      {"Inline", [](PassManager *pm) { pm->add_pass<Inline>(); }, ssa,
+       invalidatesLoops},
+      {"LoopSimplify", [](PassManager *pm) { pm->add_pass<LoopSimplify>(); },
+       ssa},
+      {"GlobalArrayReverse",
+       [](PassManager *pm) { pm->add_pass<GlobalArrayReverse>(); }, ssa},
+      {"GetElementSplit",
+       [](PassManager *pm) { pm->add_pass<GetElementSplit>(); }, ssa},
+      {"LoopInvariantCodeMotion",
+       [](PassManager *pm) { pm->add_pass<LoopInvariantCodeMotion>(); }, loop},
+      {"LCSSA", [](PassManager *pm) { pm->add_pass<LCSSA>(); }, loop},
+      {"LoopRotate", [](PassManager *pm) { pm->add_pass<LoopRotate>(); },
+       lcssa},
+      {"LinearFunctionTestReplace",
+       [](PassManager *pm) { pm->add_pass<LinearFunctionTestReplace>(); },
+       lcssa, invalidatesLoops},
+      {"PhiEliminate", [](PassManager *pm) { pm->add_pass<PhiEliminate>(); },
+       ssa},
+      {"GlobalCodeMotion",
+       [](PassManager *pm) { pm->add_pass<GlobalCodeMotion>(); }, ssa,
+       needsDeadCodeBefore},
+      {"GVN", [](PassManager *pm) { pm->add_pass<GVN>(); }, ssa},
+      {"IfConversion", [](PassManager *pm) { pm->add_pass<IfConversion>(); },
+       ssa, invalidatesLoops},
+  };
+  return passes;
+}
+
+// IR 优化之外可以用 -disable-pass 跳过的 pass, 其余 pass 是生成正确代码所必需的
+const std::vector<std::string> &optionalPasses() {
+  static const std::vector<std::string> passes = {
+      "InstructionSelect", "LocalConstGlobalMatching", "CondCompare",
+      "AddressFold", "ShiftFold", "FlagFold", "RegPrefill", "LoadStoreEliminate", "CleanCode",
+      "LoadStorePair", "BlockLayout"};
+  return passes;
+}
+
+// 检查列表中的 pass 名都存在, allowOptional 为真时也接受 optionalPasses 中的 pass
+void checkPassNames(const std::string &list, bool allowOptional) {
+  for (auto &name : splitComma(list)) {
+    bool found = false;
+    for (auto &pass : irPasses())
+      found |= pass.name == name;
+    if (allowOptional)
+      for (auto &pass : optionalPasses())
+        found |= pass == name;
+    if (!found)
+      throw std::runtime_error("Unknown pass " + name + ".");
+  }
+}
+
+// 没有被 -disable-pass 跳过
+bool passEnabled(const std::string &name) {
+  for (auto &disabled : splitComma(disabledPasses))
+    if (disabled == name)
+      return false;
+  return true;
+}
+
+// 按名字加入一个 IR 优化 pass
+void addIRPass(PassManager *pm, const std::string &name) {
+  if (!passEnabled(name))
+    return;
+  for (auto &pass : irPasses())
+    if (pass.name == name)
+      return pass.add(pm);
+  throw std::runtime_error("Unknown pass " + name + ".");
+}
+
+// IR 优化的流水线, -passes= 可以替换默认流水线
+std::vector<std::string> irPipeline() {
+  if (!irPassPipeline.empty())
+    return splitComma(irPassPipeline);
+  std::vector<std::string> names;
+  if (o1Optimization)
+    names.emplace_back("ConstGlobalEliminate");
+  names.insert(names.end(), {"Mem2Reg", "DeadCode"});
+  if (o1Optimization)
+    names.insert(names.end(),
+                 {"SCCP",
+                  "DeadCode",
+                  "Arithmetic",
+                  "DeadCode",
+                  "Inline",
+                  "ConstGlobalEliminate",
+                  "Mem2Reg",
+                  "DeadCode",
+                  "LoopSimplify",
+                  "GlobalArrayReverse",
+                  "GetElementSplit",
+                  "LoopInvariantCodeMotion",
+                  "LCSSA",
+                  "LoopRotate",
+                  "LinearFunctionTestReplace",
+                  "SCCP",
+                  "DeadCode",
+                  "Arithmetic",
+                  "DeadCode",
+                  "PhiEliminate",
+                  "DeadCode",
+                  "GlobalCodeMotion",
+                  "Inline",
+                  "GVN",
+                  "DeadCode",
+                  "IfConversion",
+                  "DeadCode"});
+  return names;
+}
+
+// 检查跳过 -disable-pass 后的流水线满足各个 pass 的约束, 违反时抛出异常
+void checkPipeline() {
+  for (auto &name : splitComma(disabledPasses))
+    for (auto &pass : irPasses())
+      if (pass.name == name && (pass.flags & requiredPass))
+        throw std::runtime_error("Pass " + name + " cannot be disabled.");
+  std::vector<std::string> ran;
+  std::string needsDeadCode;
+  for (auto &name : irPipeline()) {
+    if (!passEnabled(name))
+      continue;
+    for (auto &pass : irPasses()) {
+      if (pass.name != name)
+        continue;
+      for (auto &pre : pass.prerequisites)
+        if (std::find(ran.begin(), ran.end(), pre) == ran.end())
+          throw std::runtime_error("Pass " + name + " requires " + pre +
+                                   " to run before it.");
+      if ((pass.flags & needsDeadCodeBefore) &&
+          (ran.empty() || ran.back() != "DeadCode"))
+        throw std::runtime_error("Pass " + name +
+                                 " requires DeadCode to run right before it.");
+      if (pass.flags & needsDeadCodeAfter)
+        needsDeadCode = name;
+      if (pass.flags & invalidatesLoops)
+        ran.erase(std::remove_if(ran.begin(), ran.end(),
+                                 [](const std::string &r) {
+                                   return r == "LoopSimplify" || r == "LCSSA";
+                                 }),
+                  ran.end());
+    }
+    if (name == "DeadCode")
+      needsDeadCode.clear();
+    ran.emplace_back(name);
   }
+  if (!needsDeadCode.empty())
+    throw std::runtime_error("Pass " + needsDeadCode +
+                             " requires DeadCode to run after it.");
+}
+
+// 解析一次编译的参数, 写入当前线程的选项, 参数有误时抛出异常
+std::tuple<std::string, std::string>
+parseArgList(const std::vector<std::string> &args) {
   o1Optimization = false;
-  int i = 1;
+  optionAssignments.clear();
   std::string input_filename, output_filename;
-  for (int i = 1; i < argc; ++i) {
-    std::string arg = argv[i];
+  for (size_t i = 0; i < args.size(); ++i) {
+    const std::string &arg = args[i];
     if (arg == "-S")
       continue;
     if (arg == "-o") {
-      if (i + 1 < argc)
-        output_filename = argv[++i];
-      else {
-        std::cerr << "Missing output filename.\n";
-        std::exit(EXIT_FAILURE);
-      }
+      if (i + 1 < args.size())
+        output_filename = args[++i];
+      else
+        throw std::runtime_error("Missing output filename.");
     } else if (arg == "-ast")
       emitAST = true;
     else if (arg == "-ir")
       emitIR = true;
     else if (arg == "-O1")
       o1Optimization = true;
+    else if (arg == "-frontend=fast")
+      useFastFrontend = true;
+    else if (arg == "-frontend=antlr")
+      useFastFrontend = false;
+    else if (arg == "-fdata-incbin")
+      emitGlobalDataAsIncbin = true;
+    else if (arg.compare(0, 12, "-fcache-dir=") == 0)
+      compileCacheDir = arg.substr(12);
+    else if (arg.compare(0, 13, "-fcache-size=") == 0)
+      compileCacheMaxMegabytes = std::stoi(arg.substr(13));
+    else if (arg == "-fcache-stats")
+      printCompileCacheStats = true;
+    else if (arg == "-ftime-report")
+      printTimeReport = true;
+    else if (arg == "-interp")
+      interpretModule = true;
+    else if (arg.compare(0, 8, "-interp=") == 0) {
+      interpretModule = true;
+      interpretStage = arg.substr(8);
+      if (interpretStage != "ast2ir" && interpretStage != "ir" &&
+          interpretStage != "lower")
+        throw std::runtime_error("Unknown interpret stage " + interpretStage +
+                                 ", expected ast2ir, ir or lower.");
+    } else if (arg.compare(0, 15, "-interp-report=") == 0)
+      interpretReportFile = arg.substr(15);
+    else if (arg.compare(0, 16, "-interp-profile=") == 0)
+      interpretProfileFile = arg.substr(16);
+    else if (arg == "-opt") {
+      if (i + 1 >= args.size())
+        throw std::runtime_error("Missing option after -opt.");
+      OptionRegistry::assign(args[++i]);
+      optionAssignments.emplace_back(args[i]);
+    } else if (arg.compare(0, 10, "-opt-file=") == 0) {
+      for (auto &assignment : OptionRegistry::load(arg.substr(10))) {
+        OptionRegistry::assign(assignment);
+        optionAssignments.emplace_back(assignment);
+      }
+    } else if (arg.compare(0, 8, "-passes=") == 0) {
+      irPassPipeline = arg.substr(8);
+      checkPassNames(irPassPipeline, false);
+    } else if (arg.compare(0, 14, "-disable-pass=") == 0) {
+      checkPassNames(arg.substr(14), true);
+      disabledPasses += (disabledPasses.empty() ? "" : ",") + arg.substr(14);
+    } else if (arg == "-mca-report")
+      printMcaReport = true;
+    else if (arg.compare(0, 12, "-mca-report=") == 0) {
+      printMcaReport = true;
+      mcaReportFile = arg.substr(12);
+    } else if (arg == "-reg-pressure-report")
+      printRegPressureReport = true;
+    else if (arg.compare(0, 21, "-reg-pressure-report=") == 0) {
+      printRegPressureReport = true;
+      regPressureReportFile = arg.substr(21);
+    } else if (arg.compare(0, 7, "-Rpass=") == 0)
+      remarkPassFilter = arg.substr(7);
+    else if (arg.compare(0, 14, "-Rpass-missed=") == 0)
+      remarkMissedFilter = arg.substr(14);
+    else if (arg.compare(0, 16, "-Rpass-analysis=") == 0)
+      remarkAnalysisFilter = arg.substr(16);
+    else if (arg.compare(0, 14, "-remarks-file=") == 0)
+      remarkFile = arg.substr(14);
     else
       input_filename = arg;
   }
+  checkPipeline();
   return std::make_tuple(input_filename, output_filename);
 }
 
+std::tuple<std::string, std::string> parseArgs(int argc, char **argv) {
+  // compiler -S -o <testcase.s> <testcase.sy> [-O1]
+  std::string infile, outfile;
+  try {
+    std::tie(infile, outfile) = parseArgList({argv + 1, argv + argc});
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+  // 解释执行不需要输出文件
+  if (infile.empty() || (outfile.empty() && !interpretModule)) {
+    std::cerr << "Usage: " << argv[0]
+              << " -S -o <testcase.s> <testcase.sy> [-O1] [-ast/ir/stack]"
+                 " [-frontend=fast] [-fdata-incbin]"
+                 " [-fcache-dir=<dir>] [-fcache-size=<MB>] [-fcache-stats]"
+                 " [-ftime-report] [-mca-report[=<file>]]\n"
+                 "         [-reg-pressure-report[=<file>]]"
+                 " [-Rpass=<regex>] [-Rpass-missed=<regex>]"
+                 " [-Rpass-analysis=<regex>] [-remarks-file=<file>]\n"
+                 "         [-opt <name>=<value>] [-opt-file=<file>]"
+                 " [-passes=<p1,p2,...>] [-disable-pass=<p1,...>]\n"
+              << "       " << argv[0]
+              << " -interp[=ast2ir|ir|lower] <testcase.sy> [-O1]"
+                 " [-interp-report=<file>] [-interp-profile=<file>]\n"
+              << "       " << argv[0]
+              << " --batch <list.txt> [-j N] [options...]\n"
+              << "       " << argv[0] << " --server [-j N] [options...]\n";
+    std::exit(EXIT_FAILURE);
+  }
+  return std::make_tuple(infile, outfile);
+}
+
 void toggleNO1DefaultSettings() {
   if (!o1Optimization) {
     replaceGlobalAddressWithRegisterNeedUseCount = INT_MAX;
@@ -101,51 +420,36 @@ void toggleNO1DefaultSettings() {
     useSinkForVirtualRegister = false;
     removeTailRecursive = false;
   }
+  // 显式设置的选项优先于 -O0 的默认值
+  for (auto &assignment : optionAssignments)
+    OptionRegistry::assign(assignment);
 }
 
+// IR 优化的流水线, -passes= 可以替换它
 void addPasses4IR(PassManager *pm) {
-  if (o1Optimization)
-    pm->add_pass<ConstGlobalEliminate>(false);
-  pm->add_pass<Mem2Reg>();
-  pm->add_pass<DeadCode>();
-  if (o1Optimization) {
-    pm->add_pass<SCCP>();
-    pm->add_pass<DeadCode>();
-    pm->add_pass<Arithmetic>();
-    pm->add_pass<DeadCode>();
-    pm->add_pass<Inline>();
-    pm->add_pass<ConstGlobalEliminate>(false);
-    pm->add_pass<Mem2Reg>();
-    pm->add_pass<DeadCode>();
-    pm->add_pass<LoopSimplify>();
-    pm->add_pass<GlobalArrayReverse>();
-    pm->add_pass<GetElementSplit>();
-    pm->add_pass<LoopInvariantCodeMotion>();
-    pm->add_pass<LCSSA>();
-    pm->add_pass<LoopRotate>();
-    pm->add_pass<SCCP>();
-    pm->add_pass<DeadCode>();
-    pm->add_pass<Arithmetic>();
-    pm->add_pass<DeadCode>();
-    pm->add_pass<PhiEliminate>();
-    pm->add_pass<DeadCode>();
-    pm->add_pass<GlobalCodeMotion>();
-    pm->add_pass<Inline>();
-    pm->add_pass<GVN>();
-    pm->add_pass<DeadCode>();
-  }
+  for (auto &name : irPipeline())
+    addIRPass(pm, name);
 }
 
 void addPasses4IR2MIR(PassManager *pm) {
   pm->add_pass<CriticalEdgeRemove>();
   pm->add_pass<CmpCombine>();
   if (o1Optimization) {
-    pm->add_pass<InstructionSelect>();
-    pm->add_pass<LocalConstGlobalMatching>();
+    if (passEnabled("InstructionSelect"))
+      pm->add_pass<InstructionSelect>();
+    if (passEnabled("LocalConstGlobalMatching"))
+      pm->add_pass<LocalConstGlobalMatching>();
   }
 }
 
-void ir(std::string infile, std::string outfile) {
+// 解析源文件得到 AST, 根据 useFastFrontend 选择前端
+ASTCompUnit *parseSource(const std::string &infile) {
+  TimeReport::Stage stage{"parse"};
+  if (useFastFrontend) {
+    MappedFile source{infile};
+    Source2AstParser parser{source.begin(), source.end()};
+    return parser.astTree();
+  }
   std::ifstream input_file(infile);
   antlr4::ANTLRInputStream inputStream(input_file);
   SysYLexer lexer{&inputStream};
@@ -155,16 +459,29 @@ void ir(std::string infile, std::string outfile) {
   Antlr2AstVisitor MakeAst;
   auto ast = MakeAst.astTree(ptree);
   input_file.close();
-  AST2IRVisitor MakeIR;
-  MakeIR.visit(ast);
-  delete ast;
-  auto m = MakeIR.getModule();
+  return ast;
+}
+
+void ir(std::string infile, std::string outfile) {
+  auto ast = parseSource(infile);
+  Module *m;
+  {
+    TimeReport::Stage stage{"ast2ir"};
+    AST2IRVisitor MakeIR;
+    MakeIR.visit(ast);
+    delete ast;
+    m = MakeIR.getModule();
+  }
 
   PassManager *pm = new PassManager{m};
   addPasses4IR(pm);
-  pm->run();
+  {
+    TimeReport::Stage stage{"ir-passes"};
+    pm->run();
+  }
   delete pm;
 
+  TimeReport::Stage stage{"emit"};
   std::ofstream output_file(outfile);
   output_file << m->print();
   output_file.close();
@@ -172,33 +489,142 @@ void ir(std::string infile, std::string outfile) {
 }
 
 void ast(std::string infile, std::string outfile) {
-  std::ifstream input_file(infile);
-  antlr4::ANTLRInputStream inputStream(input_file);
-  SysYLexer lexer{&inputStream};
-  antlr4::CommonTokenStream tokens(&lexer);
-  SysYParser parser(&tokens);
-  antlr4::tree::ParseTree *ptree = parser.compUnit();
-  Antlr2AstVisitor MakeAst;
-  auto ast = MakeAst.astTree(ptree);
-  input_file.close();
+  auto ast = parseSource(infile);
+  TimeReport::Stage stage{"emit"};
   std::ofstream output_file(outfile);
   output_file << ast->toString();
   output_file.close();
   delete ast;
 }
 
+// 寄存器分配与代码生成的流水线, part 是 CodeGen 生成的部分
+void addPasses4MIR(MachinePassManager *mng, CodeGen::Part part) {
+  if (o1Optimization && passEnabled("CondCompare")) {
+    mng->add_pass<CondCompare>();
+  }
+  if (o1Optimization && passEnabled("AddressFold")) {
+    mng->add_pass<AddressFold>();
+  }
+  if (o1Optimization && passEnabled("ShiftFold")) {
+    mng->add_pass<ShiftFold>();
+  }
+  if (o1Optimization && passEnabled("FlagFold")) {
+    mng->add_pass<FlagFold>();
+  }
+  if (o1Optimization && passEnabled("RegPrefill")) {
+    mng->add_pass<RegPrefill>();
+  }
+  mng->add_pass<RegisterAllocate>();
+
+  if (o1Optimization) {
+    if (passEnabled("LoadStoreEliminate"))
+      mng->add_pass<LoadStoreEliminate>();
+    mng->add_pass<RegSpill>();
+    if (passEnabled("CleanCode"))
+      mng->add_pass<CleanCode>();
+  }
+  if (printRegPressureReport)
+    mng->add_pass<RegPressure>();
+  mng->add_pass<FrameOffset>();
+  if (o1Optimization && passEnabled("LoadStorePair")) {
+    mng->add_pass<LoadStorePair>();
+  }
+  mng->add_pass<CodeGen>(part);
+  mng->add_pass<ReturnMerge>();
+  if (o1Optimization && passEnabled("BlockLayout")) {
+    mng->add_pass<BlockLayout>();
+  }
+  if (printMcaReport)
+    mng->add_pass<CostModel>();
+}
+
+// 整个模块一起降级, 运行 MIR 流水线后输出
+void compileModule(Module *m, const std::string &outfile) {
+  auto mir = new MModule();
+  {
+    TimeReport::Stage stage{"ir2mir"};
+    mir->accept(m);
+    delete m;
+  }
+
+  MachinePassManager *mng = new MachinePassManager{mir};
+  addPasses4MIR(mng, CodeGen::WHOLE_MODULE);
+  {
+    TimeReport::Stage stage{"mir-passes"};
+    mng->run();
+  }
+  delete mng;
+
+  TimeReport::Stage stage{"emit"};
+  std::ofstream output_file(outfile);
+  output_file << mir;
+  output_file.close();
+
+  delete mir;
+}
+
+// 逐批编译: 按调用图的强连通分量, 从被调用者到调用者逐批降级, 运行 MIR 流水线, 输出后释放.
+// 被调用者先完成, 调用者降级时能看到它最终的栈参数偏移与破坏的寄存器;
+// 互相递归的函数在同一批中. 同一时刻只有一批函数的 MIR, 峰值内存不再随函数数量增长
+void compileByFunction(Module *m, const std::string &outfile) {
+  auto mir = new MModule();
+  std::vector<std::vector<Function *>> windows;
+  {
+    TimeReport::Stage stage{"ir2mir"};
+    windows = MModule::callGraphOrder(m);
+    mir->declare(m);
+  }
+  std::ofstream output_file(outfile);
+  {
+    TimeReport::Stage stage{"mir-passes"};
+    MachinePassManager globals{mir};
+    globals.add_pass<CodeGen>(CodeGen::GLOBALS);
+    globals.run();
+  }
+  {
+    TimeReport::Stage stage{"emit"};
+    output_file << mir->modulePrefix_;
+  }
+
+  // pass 在各批之间复用
+  MachinePassManager *mng = new MachinePassManager{mir};
+  addPasses4MIR(mng, CodeGen::FUNCTIONS);
+  for (auto &window : windows) {
+    {
+      TimeReport::Stage stage{"ir2mir"};
+      mir->lower(window);
+      for (auto f : window)
+        f->releaseBody();
+    }
+    {
+      TimeReport::Stage stage{"mir-passes"};
+      mng->run();
+    }
+    TimeReport::Stage stage{"emit"};
+    mir->printFunctions(output_file);
+    mir->release();
+  }
+  delete mng;
+
+  {
+    TimeReport::Stage stage{"mir-passes"};
+    MachinePassManager library{mir};
+    library.add_pass<CodeGen>(CodeGen::LIBRARY);
+    library.run();
+  }
+  TimeReport::Stage stage{"emit"};
+  output_file << mir->moduleSuffix_;
+  output_file.close();
+
+  delete m;
+  delete mir;
+}
+
 void compiler(std::string infile, std::string outfile) {
   Module *m = nullptr;
   {
-    ASTCompUnit *ast;
-    std::ifstream input_file(infile);
-    antlr4::ANTLRInputStream inputStream(input_file);
-    SysYLexer lexer{&inputStream};
-    antlr4::CommonTokenStream tokens(&lexer);
-    SysYParser parser(&tokens);
-    Antlr2AstVisitor MakeAst;
-    ast = MakeAst.astTree(parser.compUnit());
-    input_file.close();
+    ASTCompUnit *ast = parseSource(infile);
+    TimeReport::Stage stage{"ast2ir"};
     AST2IRVisitor MakeIR;
     MakeIR.visit(ast);
     delete ast;
@@ -208,53 +634,297 @@ void compiler(std::string infile, std::string outfile) {
   PassManager *pm = new PassManager{m};
   addPasses4IR(pm);
   addPasses4IR2MIR(pm);
-  pm->run();
+  {
+    TimeReport::Stage stage{"ir-passes"};
+    pm->run();
+  }
 
-  auto mir = new MModule();
-  mir->accept(m);
+  if (streamFunctions)
+    compileByFunction(m, outfile);
+  else
+    compileModule(m, outfile);
+}
+
+// 在 IR 上解释执行程序, 程序使用进程的标准输入输出, 返回 main 的返回值
+int interpret(const std::string &infile) {
+  Remarks::Scope remarks{infile};
+  Module *m = nullptr;
+  {
+    ASTCompUnit *ast = parseSource(infile);
+    TimeReport::Stage stage{"ast2ir"};
+    AST2IRVisitor MakeIR;
+    MakeIR.visit(ast);
+    delete ast;
+    m = MakeIR.getModule();
+  }
+
+  int exitCode = 0;
+  PassManager *pm = new PassManager{m};
+  if (interpretStage != "ast2ir")
+    addPasses4IR(pm);
+  if (interpretStage == "lower")
+    addPasses4IR2MIR(pm);
+  pm->add_pass<Interpret>(&exitCode);
+  pm->run();
+  delete pm;
   delete m;
+  return exitCode;
+}
 
-  MachinePassManager *mng = new MachinePassManager{mir};
+void beforeRun() {}
 
-  if (o1Optimization) {
-    mng->add_pass<RegPrefill>();
+// 按当前线程的选项编译一个文件, 设置了编译缓存目录时先查询缓存
+void compileFile(const std::string &infile, const std::string &outfile) {
+  auto run = [&] {
+    Remarks::Scope remarks{infile};
+    if (emitAST)
+      ast(infile, outfile);
+    else if (emitIR)
+      ir(infile, outfile);
+    else
+      compiler(infile, outfile);
+  };
+  // .incbin 的旁路文件不在缓存中, 耗时估计, 寄存器压力报告与优化备注需要完整的编译
+  if (compileCacheDir.empty() || emitGlobalDataAsIncbin || printMcaReport ||
+      printRegPressureReport || Remarks::requested()) {
+    run();
+    return;
   }
-  mng->add_pass<RegisterAllocate>();
+  CompileCache cache{compileCacheDir, compileCacheMaxMegabytes * 1024LL * 1024LL};
+  std::string key;
+  {
+    TimeReport::Stage stage{"cache"};
+    MappedFile source{infile};
+    key = CompileCache::key(source.begin(), source.end());
+  }
+  if (cache.fetch(key, outfile))
+    return;
+  run();
+  cache.store(key, outfile);
+}
 
-  if (o1Optimization) {
-    mng->add_pass<LoadStoreEliminate>();
-    mng->add_pass<RegSpill>();
-    mng->add_pass<CleanCode>();
+// 打印编译缓存的统计信息
+void reportCompileCache() {
+  if (printCompileCacheStats && !compileCacheDir.empty())
+    std::cerr << CompileCache{compileCacheDir,
+                              compileCacheMaxMegabytes * 1024LL * 1024LL}
+                     .stats()
+              << "\n";
+}
+
+// 以 base 为初始选项, 在当前线程完成一个批量任务, 成功时返回空串, 否则返回错误信息
+std::string compileJob(const CompilationOptions &base,
+                       const std::vector<std::string> &args) {
+  try {
+    base.apply();
+    std::string infile, outfile;
+    std::tie(infile, outfile) = parseArgList(args);
+    if (infile.empty() || outfile.empty())
+      return "missing input or output file";
+    if (interpretModule)
+      return "-interp is not supported in batch mode";
+    if (emitGlobalDataAsIncbin)
+      globalDataIncbinFile = outfile + ".bin";
+    toggleNO1DefaultSettings();
+    CompilationContext context;
+    CompilationContext::Bind bind{&context};
+    compileFile(infile, outfile);
+    return {};
+  } catch (const std::exception &e) {
+    return e.what();
+  } catch (...) {
+    return "unknown error";
   }
-  mng->add_pass<FrameOffset>();
-  mng->add_pass<CodeGen>();
-  mng->add_pass<ReturnMerge>();
-  if (o1Optimization) {
-    mng->add_pass<BlockLayout>();
+}
+
+// 按空白切分一行任务, 空行和 # 开头的行没有参数
+std::vector<std::string> splitJobLine(const std::string &line) {
+  std::vector<std::string> args;
+  std::istringstream in{line};
+  std::string arg;
+  while (in >> arg) {
+    if (args.empty() && arg[0] == '#')
+      break;
+    args.emplace_back(arg);
   }
-  mng->run();
-  delete mng;
+  return args;
+}
 
-  std::ofstream output_file(outfile);
-  output_file << mir;
-  output_file.close();
+/**
+ * 批量模式与服务模式, 在一个进程中用 -j 个线程并发编译多个文件.
+ * compiler --batch <list.txt> [-j N] [options...]
+ *   list.txt 每行是一次编译的参数, 与单次调用相同, 例如 -S -o a.s a.sy -O1
+ * compiler --server [-j N] [options...]
+ *   从标准输入(可以是管道或命名管道)逐行读取任务, 每完成一个任务向标准输出写一行
+ *   "<任务序号> ok" 或 "<任务序号> error <信息>", 任务序号从 0 开始, 标准输入结束后退出
+ * 命令行上的 options 会加在每个任务的参数之前. 每个任务使用独立的 CompilationContext,
+ * 基础类型等进程级的状态只初始化一次.
+ */
+int runJobs(int argc, char **argv) {
+  const bool server = std::string{argv[1]} == "--server";
+  std::string listFile;
+  int threadCount = static_cast<int>(std::thread::hardware_concurrency());
+  std::vector<std::string> common;
+  int i = 2;
+  if (!server) {
+    if (argc < 3) {
+      std::cerr << "Missing batch list file.\n";
+      return EXIT_FAILURE;
+    }
+    listFile = argv[i++];
+  }
+  for (; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc)
+      threadCount = std::atoi(argv[++i]);
+    else if (arg.size() > 2 && arg.compare(0, 2, "-j") == 0)
+      threadCount = std::atoi(arg.c_str() + 2);
+    else
+      common.emplace_back(arg);
+  }
+  if (threadCount < 1)
+    threadCount = 1;
+  const CompilationOptions base = CompilationOptions::capture();
+  try {
+    parseArgList(common);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  auto jobArgs = [&common](const std::string &line) {
+    auto args = splitJobLine(line);
+    if (!args.empty())
+      args.insert(args.begin(), common.begin(), common.end());
+    return args;
+  };
 
-  delete mir;
-}
+  if (!server) {
+    std::ifstream list{listFile};
+    if (!list) {
+      std::cerr << "Can not open batch list " << listFile << "\n";
+      return EXIT_FAILURE;
+    }
+    std::vector<std::vector<std::string>> jobs;
+    std::string line;
+    while (std::getline(list, line)) {
+      auto args = jobArgs(line);
+      if (!args.empty())
+        jobs.emplace_back(std::move(args));
+    }
+    std::vector<std::string> errors(jobs.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; ++t)
+      workers.emplace_back([&] {
+        for (size_t j = next++; j < jobs.size(); j = next++)
+          errors[j] = compileJob(base, jobs[j]);
+      });
+    for (auto &w : workers)
+      w.join();
+    int failed = 0;
+    for (size_t j = 0; j < jobs.size(); ++j) {
+      if (errors[j].empty())
+        continue;
+      ++failed;
+      std::cerr << "job " << j << " (";
+      for (size_t k = common.size(); k < jobs[j].size(); ++k)
+        std::cerr << (k == common.size() ? "" : " ") << jobs[j][k];
+      std::cerr << "): " << errors[j] << "\n";
+    }
+    std::cerr << jobs.size() - failed << "/" << jobs.size()
+              << " jobs compiled\n";
+    reportCompileCache();
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
 
-void beforeRun() {}
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<std::pair<size_t, std::vector<std::string>>> queue;
+  bool closed = false;
+  std::mutex outMutex;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threadCount; ++t)
+    workers.emplace_back([&] {
+      while (true) {
+        std::pair<size_t, std::vector<std::string>> job;
+        {
+          std::unique_lock<std::mutex> lock{mutex};
+          ready.wait(lock, [&] { return closed || !queue.empty(); });
+          if (queue.empty())
+            return;
+          job = std::move(queue.front());
+          queue.pop_front();
+        }
+        auto error = compileJob(base, job.second);
+        std::lock_guard<std::mutex> lock{outMutex};
+        if (error.empty())
+          std::cout << job.first << " ok" << std::endl;
+        else
+          std::cout << job.first << " error " << error << std::endl;
+      }
+    });
+  std::string line;
+  size_t id = 0;
+  while (std::getline(std::cin, line)) {
+    auto args = jobArgs(line);
+    if (args.empty())
+      continue;
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      queue.emplace_back(id++, std::move(args));
+    }
+    ready.notify_one();
+  }
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    closed = true;
+  }
+  ready.notify_all();
+  for (auto &w : workers)
+    w.join();
+  reportCompileCache();
+  return EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[]) {
   if (testArchi)
     beforeRun();
+  if (argc == 2 && std::string{argv[1]} == "-opt-list") {
+    OptionRegistry::print(std::cout);
+    std::cout << "passes:";
+    for (auto &pass : irPasses())
+      std::cout << " " << pass.name;
+    std::cout << "\noptional passes:";
+    for (auto &pass : optionalPasses())
+      std::cout << " " << pass;
+    std::cout << "\n";
+    return 0;
+  }
+  if (argc >= 2 && (std::string{argv[1]} == "--batch" ||
+                    std::string{argv[1]} == "--server"))
+    return runJobs(argc, argv);
   std::string infile, outfile;
   std::tie(infile, outfile) = parseArgs(argc, argv);
+  if (emitGlobalDataAsIncbin)
+    globalDataIncbinFile = outfile + ".bin";
   toggleNO1DefaultSettings();
-  if (emitAST)
-    ast(infile, outfile);
-  else if (emitIR)
-    ir(infile, outfile);
-  else
-    compiler(infile, outfile);
+  // 选项解析完成后创建编译上下文, 之后的类型和选项都从上下文中读取
+  CompilationContext context;
+  CompilationContext::Bind bind{&context};
+  if (interpretModule) {
+    try {
+      const int exitCode = interpret(infile);
+      if (printTimeReport)
+        TimeReport::print(std::cerr);
+      return exitCode;
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+  compileFile(infile, outfile);
+  reportCompileCache();
+  if (printTimeReport)
+    TimeReport::print(std::cerr);
   return 0;
 }
\ No newline at end of file
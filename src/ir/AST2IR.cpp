@@ -65,8 +65,11 @@ Value* AST2IRVisitor::visit(const ASTCompUnit* comp_unit)
 	{
 		// 常数非数组全局变量的值已经被内联, 不会被使用
 		if (i->isConst() && i->getType()->isBasicType()) continue;
-		const auto glob = GlobalVariable::create(i->id(), _builder->get_module(), i->getType(), i->isConst(),
-		                                         i->getInitList());
+		const auto glob = i->getPlainInitList() != nullptr
+			                  ? GlobalVariable::create(i->id(), _builder->get_module(), i->getType(), i->isConst(),
+			                                           i->movePlainInitList())
+			                  : GlobalVariable::create(i->id(), _builder->get_module(), i->getType(), i->isConst(),
+			                                           i->getInitList());
 		_var_scope.push(i->id(), glob);
 	}
 
@@ -314,6 +317,7 @@ Value* AST2IRVisitor::visit(ASTFuncDecl* func_decl)
 	                                   _module);
 	_func_scope.push(func_decl->id(), func);
 	_functionBelong = func;
+	Instruction::set_current_line(func_decl->line());
 	const auto funBB = BasicBlock::create(_module, "entry", func);
 	_builder->set_insert_point(funBB);
 	_var_scope.enter();
@@ -345,6 +349,7 @@ Value* AST2IRVisitor::visit(ASTFuncDecl* func_decl)
 			_builder->create_ret(_builder->create_constant(0));
 	}
 	_var_scope.exit();
+	Instruction::set_current_line(0);
 	return nullptr;
 }
 
@@ -877,8 +882,10 @@ Value* AST2IRVisitor::visit(ASTReturn* return_node)
 
 void AST2IRVisitor::visitStmts(const std::vector<ASTStmt*>& vec)
 {
+	const int outer = Instruction::get_current_line();
 	for (auto& stmt : vec)
 	{
+		if (stmt->line() != 0) Instruction::set_current_line(stmt->line());
 		auto block2 = dynamic_cast<ASTBlock*>(stmt);
 		if (block2 != nullptr)
 		{
@@ -909,12 +916,16 @@ void AST2IRVisitor::visitStmts(const std::vector<ASTStmt*>& vec)
 		if (_builder->get_insert_block()->is_terminated())
 			break;
 	}
+	// 之后生成的指令(如循环的条件与跳转)属于外层语句
+	Instruction::set_current_line(outer);
 }
 
 void AST2IRVisitor::visitStmts(const std::vector<ASTNode*>& vec)
 {
+	const int outer = Instruction::get_current_line();
 	for (auto& stmt : vec)
 	{
+		if (stmt->line() != 0) Instruction::set_current_line(stmt->line());
 		auto block2 = dynamic_cast<ASTBlock*>(stmt);
 		if (block2 != nullptr)
 		{
@@ -945,6 +956,8 @@ void AST2IRVisitor::visitStmts(const std::vector<ASTNode*>& vec)
 		if (_builder->get_insert_block()->is_terminated())
 			break;
 	}
+	// 之后生成的指令(如循环的条件与跳转)属于外层语句
+	Instruction::set_current_line(outer);
 }
 
 std::string AST2IRVisitor::createPrivateGlobalVarID()
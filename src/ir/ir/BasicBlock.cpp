@@ -359,6 +359,25 @@ Instruction* BasicBlock::get_terminator_or_null() const
 	return nullptr;
 }
 
+int BasicBlock::get_source_line()
+{
+	for (auto i : instr_list_)
+		if (i->get_line() != 0) return i->get_line();
+	return 0;
+}
+
+std::string BasicBlock::get_diagnostic_name()
+{
+	if (!get_name().empty()) return get_name();
+	int idx = 0;
+	for (auto bb : parent_->get_basic_blocks())
+	{
+		if (bb == this) break;
+		++idx;
+	}
+	return "#" + std::to_string(idx);
+}
+
 void BasicBlock::add_instruction(Instruction* instr)
 {
 	ifThenOrThrow(instr->is_phi(), !is_entry_block(), "Phi can only insert to not entry block");
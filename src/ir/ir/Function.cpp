@@ -30,6 +30,12 @@ Function::~Function()
 	for (auto i : arguments_) delete i;
 }
 
+void Function::releaseBody()
+{
+	for (const auto& i : basic_blocks_) delete i;
+	basic_blocks_.clear();
+}
+
 Function* Function::create(FuncType* ty, const std::string& name,
                            Module* parent, const bool is_lib)
 {
@@ -149,6 +155,34 @@ void Function::set_instr_name()
 	seq_cnt_ += u2iNegThrow(seq.size());
 }
 
+int Function::count_values()
+{
+	int count = u2iNegThrow(arguments_.size() + basic_blocks_.size());
+	for (auto bb : basic_blocks_) count += bb->get_num_of_instr();
+	return count;
+}
+
+void Function::number_values_from(int base, int count)
+{
+	dense_base_ = base;
+	dense_count_ = count;
+	int id = base;
+	for (auto arg : arguments_) arg->dense_id_ = id++;
+	for (auto bb : basic_blocks_)
+	{
+		bb->dense_id_ = id++;
+		for (auto instr : bb->get_instructions()) instr->dense_id_ = id++;
+	}
+	ASSERT(id == base + count);
+}
+
+int Function::number_values()
+{
+	int count = count_values();
+	number_values_from(parent_->allocate_dense_ids(count), count);
+	return count;
+}
+
 std::string Function::print()
 {
 	set_instr_name();
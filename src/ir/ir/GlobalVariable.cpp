@@ -27,6 +27,19 @@ GlobalVariable::GlobalVariable(std::string name, Module* m, Type* ty, bool is_co
 	}, 1);
 }
 
+GlobalVariable* GlobalVariable::create(const std::string& name, Module* m, Type* ty, bool is_const,
+                                       PlainTensor<ConstantValue>* init)
+{
+	return new GlobalVariable{name, m, ty, is_const, init};
+}
+
+GlobalVariable::GlobalVariable(std::string name, Module* m, Type* ty, bool is_const,
+                               PlainTensor<ConstantValue>* init): Value(Types::pointerType(ty), std::move(name)),
+                                                                  init_val_(init), is_const_(is_const)
+{
+	m->add_global_variable(this);
+}
+
 GlobalVariable::~GlobalVariable()
 {
 	delete init_val_;
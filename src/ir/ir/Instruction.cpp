@@ -17,11 +17,14 @@
 
 #include "Constant.hpp"
 #include "Util.hpp"
+#include "ValueMap.hpp"
 
 using namespace Types;
 
+thread_local int Instruction::current_line_ = 0;
+
 Instruction::Instruction(Type* ty, OpID id, BasicBlock* parent)
-	: User(ty, ""), parent_(parent), op_id_(id)
+	: User(ty, ""), parent_(parent), op_id_(id), line_(current_line_)
 {
 	if (parent)
 	{
@@ -29,17 +32,12 @@ Instruction::Instruction(Type* ty, OpID id, BasicBlock* parent)
 	}
 }
 
-namespace
+int Instruction::get_diagnostic_line() const
 {
-	Value* getOrDefault(std::unordered_map<Value*, Value*>& m, Value* t)
-	{
-		auto fd = m.find(t);
-		if (fd == m.end()) return t;
-		return fd->second;
-	}
+	if (line_ != 0 || parent_ == nullptr) return line_;
+	return parent_->get_source_line();
 }
 
-
 Value* ptrFrom(Value* ptr)
 {
 	auto g = dynamic_cast<GlobalVariable*>(ptr);
@@ -114,10 +112,10 @@ Instruction* IBinaryInst::copy(BasicBlock* parent)
 	return new IBinaryInst{get_instr_type(), get_operand(0), get_operand(1), parent};
 }
 
-Instruction* IBinaryInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* IBinaryInst::copy(ValueMap<Value*>& valMap)
 {
 	auto ret = new IBinaryInst{
-		get_instr_type(), getOrDefault(valMap, get_operand(0)), getOrDefault(valMap, get_operand(1)), nullptr
+		get_instr_type(), getOrSelf(valMap, get_operand(0)), getOrSelf(valMap, get_operand(1)), nullptr
 	};
 	valMap[this] = ret;
 	return ret;
@@ -187,10 +185,10 @@ Instruction* FBinaryInst::copy(BasicBlock* parent)
 	return new FBinaryInst{get_instr_type(), get_operand(0), get_operand(1), parent};
 }
 
-Instruction* FBinaryInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* FBinaryInst::copy(ValueMap<Value*>& valMap)
 {
 	auto ret = new FBinaryInst{
-		get_instr_type(), getOrDefault(valMap, get_operand(0)), getOrDefault(valMap, get_operand(1)), nullptr
+		get_instr_type(), getOrSelf(valMap, get_operand(0)), getOrSelf(valMap, get_operand(1)), nullptr
 	};
 	valMap[this] = ret;
 	return ret;
@@ -236,10 +234,10 @@ Instruction* ICmpInst::copy(BasicBlock* parent)
 	return new ICmpInst{get_instr_type(), get_operand(0), get_operand(1), parent};
 }
 
-Instruction* ICmpInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* ICmpInst::copy(ValueMap<Value*>& valMap)
 {
 	auto ret = new ICmpInst{
-		get_instr_type(), getOrDefault(valMap, get_operand(0)), getOrDefault(valMap, get_operand(1)), nullptr
+		get_instr_type(), getOrSelf(valMap, get_operand(0)), getOrSelf(valMap, get_operand(1)), nullptr
 	};
 	valMap[this] = ret;
 	return ret;
@@ -290,10 +288,10 @@ Instruction* FCmpInst::copy(BasicBlock* parent)
 	return new FCmpInst{get_instr_type(), get_operand(0), get_operand(1), parent};
 }
 
-Instruction* FCmpInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* FCmpInst::copy(ValueMap<Value*>& valMap)
 {
 	auto ret = new FCmpInst{
-		get_instr_type(), getOrDefault(valMap, get_operand(0)), getOrDefault(valMap, get_operand(1)), nullptr
+		get_instr_type(), getOrSelf(valMap, get_operand(0)), getOrSelf(valMap, get_operand(1)), nullptr
 	};
 	valMap[this] = ret;
 	return ret;
@@ -317,10 +315,10 @@ Instruction* MemCpyInst::copy(BasicBlock* parent)
 	return new MemCpyInst{get_operand(0), get_operand(1), length_, parent};
 }
 
-Instruction* MemCpyInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* MemCpyInst::copy(ValueMap<Value*>& valMap)
 {
 	auto inst = new MemCpyInst{
-		getOrDefault(valMap, get_operand(0)), getOrDefault(valMap, get_operand(1)), length_, nullptr
+		getOrSelf(valMap, get_operand(0)), getOrSelf(valMap, get_operand(1)), length_, nullptr
 	};
 	return inst;
 }
@@ -346,9 +344,9 @@ Instruction* MemClearInst::copy(BasicBlock* parent)
 	return new MemClearInst{get_operand(0), length_, parent};
 }
 
-Instruction* MemClearInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* MemClearInst::copy(ValueMap<Value*>& valMap)
 {
-	auto ret = new MemClearInst{getOrDefault(valMap, get_operand(0)), length_, nullptr};
+	auto ret = new MemClearInst{getOrSelf(valMap, get_operand(0)), length_, nullptr};
 	return ret;
 }
 
@@ -373,9 +371,9 @@ Instruction* Nump2CharpInst::copy(BasicBlock* parent)
 	return new Nump2CharpInst{get_operand(0), parent};
 }
 
-Instruction* Nump2CharpInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* Nump2CharpInst::copy(ValueMap<Value*>& valMap)
 {
-	auto ret = new Nump2CharpInst{getOrDefault(valMap, get_operand(0)), nullptr};
+	auto ret = new Nump2CharpInst{getOrSelf(valMap, get_operand(0)), nullptr};
 	valMap[this] = ret;
 	return ret;
 }
@@ -396,7 +394,7 @@ Instruction* GlobalFixInst::copy(BasicBlock* parent)
 	return new GlobalFixInst{dynamic_cast<GlobalVariable*>(get_operand(0)), parent};
 }
 
-Instruction* GlobalFixInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* GlobalFixInst::copy(ValueMap<Value*>& valMap)
 {
 	auto ret = new GlobalFixInst{dynamic_cast<GlobalVariable*>(get_operand(0)), nullptr};
 	valMap[this] = ret;
@@ -463,12 +461,12 @@ Instruction* CallInst::copy(BasicBlock* parent)
 	return new CallInst{dynamic_cast<Function*>(get_operand(0)), args, parent};
 }
 
-Instruction* CallInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* CallInst::copy(ValueMap<Value*>& valMap)
 {
 	std::vector<Value*> args;
 	args.resize(get_operands().size() - 1);
 	for (int i = 0, size = u2iNegThrow(get_operands().size()) - 1; i < size; i++)
-		args[i] = getOrDefault(valMap, get_operand(i + 1));
+		args[i] = getOrSelf(valMap, get_operand(i + 1));
 	auto ret = new CallInst{dynamic_cast<Function*>(get_operand(0)), args, nullptr};
 	valMap[this] = ret;
 	return ret;
@@ -547,7 +545,7 @@ Instruction* BranchInst::copy(BasicBlock* parent)
 	return nullptr;
 }
 
-Instruction* BranchInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* BranchInst::copy(ValueMap<Value*>& valMap)
 {
 	return nullptr;
 }
@@ -587,7 +585,7 @@ Instruction* ReturnInst::copy(BasicBlock* parent)
 	return new ReturnInst{nullptr, parent};
 }
 
-Instruction* ReturnInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* ReturnInst::copy(ValueMap<Value*>& valMap)
 {
 	return nullptr;
 }
@@ -625,13 +623,13 @@ Instruction* GetElementPtrInst::copy(BasicBlock* parent)
 	return new GetElementPtrInst{get_operand(0), args, parent};
 }
 
-Instruction* GetElementPtrInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* GetElementPtrInst::copy(ValueMap<Value*>& valMap)
 {
 	std::vector<Value*> args;
 	args.resize(get_operands().size() - 1);
 	for (int i = 0, size = u2iNegThrow(get_operands().size()) - 1; i < size; i++)
-		args[i] = getOrDefault(valMap, get_operand(i + 1));
-	auto ret = new GetElementPtrInst{getOrDefault(valMap, get_operand(0)), args, nullptr};
+		args[i] = getOrSelf(valMap, get_operand(i + 1));
+	auto ret = new GetElementPtrInst{getOrSelf(valMap, get_operand(0)), args, nullptr};
 	valMap[this] = ret;
 	return ret;
 }
@@ -717,9 +715,9 @@ Instruction* StoreInst::copy(BasicBlock* parent)
 	return new StoreInst{get_operand(0), get_operand(1), parent};
 }
 
-Instruction* StoreInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* StoreInst::copy(ValueMap<Value*>& valMap)
 {
-	auto ret = new StoreInst{getOrDefault(valMap, get_operand(0)), getOrDefault(valMap, get_operand(1)), nullptr};
+	auto ret = new StoreInst{getOrSelf(valMap, get_operand(0)), getOrSelf(valMap, get_operand(1)), nullptr};
 	return ret;
 }
 
@@ -746,9 +744,9 @@ Instruction* LoadInst::copy(BasicBlock* parent)
 	return new LoadInst{get_operand(0), parent};
 }
 
-Instruction* LoadInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* LoadInst::copy(ValueMap<Value*>& valMap)
 {
-	auto ret = new LoadInst{getOrDefault(valMap, get_operand(0)), nullptr};
+	auto ret = new LoadInst{getOrSelf(valMap, get_operand(0)), nullptr};
 	valMap[this] = ret;
 	return ret;
 }
@@ -774,7 +772,7 @@ Instruction* AllocaInst::copy(BasicBlock* parent)
 	return new AllocaInst{get_alloca_type(), parent};
 }
 
-Instruction* AllocaInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* AllocaInst::copy(ValueMap<Value*>& valMap)
 {
 	return nullptr;
 }
@@ -803,9 +801,9 @@ Instruction* ZextInst::copy(BasicBlock* parent)
 	return new ZextInst{get_operand(0), get_type(), parent};
 }
 
-Instruction* ZextInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* ZextInst::copy(ValueMap<Value*>& valMap)
 {
-	auto ret = new ZextInst{getOrDefault(valMap, get_operand(0)), get_type(), nullptr};
+	auto ret = new ZextInst{getOrSelf(valMap, get_operand(0)), get_type(), nullptr};
 	valMap[this] = ret;
 	return ret;
 }
@@ -830,9 +828,9 @@ Instruction* FpToSiInst::copy(BasicBlock* parent)
 	return new FpToSiInst{get_operand(0), get_type(), parent};
 }
 
-Instruction* FpToSiInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* FpToSiInst::copy(ValueMap<Value*>& valMap)
 {
-	auto ret = new FpToSiInst{getOrDefault(valMap, get_operand(0)), get_type(), nullptr};
+	auto ret = new FpToSiInst{getOrSelf(valMap, get_operand(0)), get_type(), nullptr};
 	valMap[this] = ret;
 	return ret;
 }
@@ -861,9 +859,9 @@ Instruction* SiToFpInst::copy(BasicBlock* parent)
 	return new SiToFpInst{get_operand(0), get_type(), parent};
 }
 
-Instruction* SiToFpInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* SiToFpInst::copy(ValueMap<Value*>& valMap)
 {
-	auto ret = new SiToFpInst{getOrDefault(valMap, get_operand(0)), get_type(), nullptr};
+	auto ret = new SiToFpInst{getOrSelf(valMap, get_operand(0)), get_type(), nullptr};
 	valMap[this] = ret;
 	return ret;
 }
@@ -873,6 +871,35 @@ SiToFpInst* SiToFpInst::create_sitofp(Value* val, BasicBlock* bb)
 	return create(val, FLOAT, bb);
 }
 
+SelectInst::SelectInst(Value* cond, Value* t, Value* f, BasicBlock* bb)
+	: BaseInst<SelectInst>(t->get_type(), select, bb)
+{
+	ASSERT(cond->get_type() == BOOL && "SelectInst condition is not bool");
+	ASSERT(t->get_type() == f->get_type() && "SelectInst values have different types");
+	add_operand(cond);
+	add_operand(t);
+	add_operand(f);
+}
+
+Instruction* SelectInst::copy(BasicBlock* parent)
+{
+	return new SelectInst{get_operand(0), get_operand(1), get_operand(2), parent};
+}
+
+Instruction* SelectInst::copy(ValueMap<Value*>& valMap)
+{
+	auto ret = new SelectInst{
+		getOrSelf(valMap, get_operand(0)), getOrSelf(valMap, get_operand(1)), getOrSelf(valMap, get_operand(2)), nullptr
+	};
+	valMap[this] = ret;
+	return ret;
+}
+
+SelectInst* SelectInst::create_select(Value* cond, Value* t, Value* f, BasicBlock* bb)
+{
+	return create(cond, t, f, bb);
+}
+
 PhiInst::PhiInst(Type* ty, const std::vector<Value*>& vals,
                  const std::vector<BasicBlock*>& val_bbs, BasicBlock* bb)
 	: BaseInst<PhiInst>(ty, phi, bb)
@@ -900,7 +927,7 @@ Instruction* PhiInst::copy(BasicBlock* parent)
 	return new PhiInst{get_type(), vals, val_bbs, parent};
 }
 
-Instruction* PhiInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* PhiInst::copy(ValueMap<Value*>& valMap)
 {
 	return nullptr;
 }
@@ -1002,7 +1029,7 @@ Instruction* MulIntegratedInst::copy(BasicBlock* parent)
 	return nullptr;
 }
 
-Instruction* MulIntegratedInst::copy(std::unordered_map<Value*, Value*>& valMap)
+Instruction* MulIntegratedInst::copy(ValueMap<Value*>& valMap)
 {
 	return nullptr;
 }
@@ -2,9 +2,11 @@
 #include <Function.hpp>
 #include <GlobalVariable.hpp>
 #include <Constant.hpp>
+#include <CompilationContext.hpp>
 #include <string>
+#include <vector>
 
-Module::Module()
+Module::Module() : context_(CompilationContext::current())
 {
 	true_constant_ = new Constant{true};
 	false_constant_ = new Constant{false};
@@ -43,6 +45,37 @@ void Module::set_print_name()
 	return;
 }
 
+int Module::allocate_dense_ids(int count)
+{
+	int base = dense_id_cnt_;
+	dense_id_cnt_ += count;
+	return base;
+}
+
+int Module::number_values()
+{
+	std::vector<int> counts;
+	counts.reserve(function_list_.size());
+	int count = static_cast<int>(global_list_.size() + function_list_.size());
+	for (auto func : function_list_)
+	{
+		counts.emplace_back(func->count_values());
+		count += counts.back();
+	}
+	dense_base_ = allocate_dense_ids(count);
+	dense_count_ = count;
+	int id = dense_base_;
+	for (auto glob : global_list_) glob->dense_id_ = id++;
+	for (auto func : function_list_) func->dense_id_ = id++;
+	int idx = 0;
+	for (auto func : function_list_)
+	{
+		func->number_values_from(id, counts[idx]);
+		id += counts[idx++];
+	}
+	return count;
+}
+
 std::string Module::print()
 {
 	set_print_name();
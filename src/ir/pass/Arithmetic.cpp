@@ -127,6 +127,7 @@ void Arithmetic::simplify(Instruction* i)
 		case Instruction::zext:
 		case Instruction::fptosi:
 		case Instruction::sitofp:
+		case Instruction::select:
 		case Instruction::memcpy_:
 		case Instruction::memclear_:
 		case Instruction::nump2charp:
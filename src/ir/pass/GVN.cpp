@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "Instruction.hpp"
+#include "Remarks.hpp"
 #include <iostream>
 
 #define DEBUG 0
@@ -26,27 +27,34 @@ void GVN::run(Function* f)
 {
 	LOG(color::green("Visiting function "+f->get_name()));
 	expr_val_map_.clear();
+	f->number_values();
 	dom_ = manager_->getFuncInfo<Dominators>(f);
 	const auto& PostOrder = dom_->get_dom_post_order(f);
 	// 逆拓扑序访问基本块
+	const bool remarkPassed = Remarks::enabled(Remarks::Passed, "gvn");
+	const bool remarkMissed = Remarks::enabled(Remarks::Missed, "gvn");
 	for (auto it = PostOrder.rbegin(); it != PostOrder.rend(); ++it)
 	{
 		auto bb = *it;
-		std::unordered_set<Instruction*> visited_insts_;
 		std::vector<Instruction*> to_delete_;
+		std::unordered_set<Value*> loaded;
 		for (auto i : bb->get_instructions())
 		{
-			auto ret = visit_inst(i);
-			if (ret == firstdef)
-				visited_insts_.emplace(i);
-			else if (ret == redundant)
+			if (visit_inst(i) == redundant)
 				to_delete_.emplace_back(i);
+			else if (remarkMissed)
+				remarkRepeatedLoad(i, loaded);
 		}
 		expr_val_map_.clear();
 		LOG(color::yellow("Replaced "+std::to_string(to_delete_.size())+
 			" redundant expression(s) from basic block " + bb->get_name()));
 		for (auto i : to_delete_)
 		{
+			if (remarkPassed)
+				Remarks::emit({
+					Remarks::Passed, "gvn", "Eliminated", f->get_name(), bb->get_diagnostic_name(), i->get_diagnostic_line(),
+					i->get_instr_op_name() + " eliminated", "it repeats an earlier expression in the block"
+				});
 			i->get_parent()->erase_instr(i);
 			LOG("Replaced expression: " + i->print());
 			delete i;
@@ -54,16 +62,29 @@ void GVN::run(Function* f)
 	}
 }
 
+// 块内重复读取同一地址, 中间没有写内存的指令, 但 GVN 不为内存操作编号
+void GVN::remarkRepeatedLoad(Instruction* i, std::unordered_set<Value*>& loaded)
+{
+	if (i->is_store() || i->is_call() || i->is_memcpy() || i->is_memclear())
+	{
+		loaded.clear();
+		return;
+	}
+	if (!i->is_load() || loaded.emplace(i->get_operand(0)).second) return;
+	auto bb = i->get_parent();
+	Remarks::emit({
+		Remarks::Missed, "gvn", "LoadNotEliminated", bb->get_parent()->get_name(), bb->get_diagnostic_name(),
+		i->get_diagnostic_line(), "load not eliminated",
+		"the same address is loaded earlier in the block with no store in between, GVN does not number loads"
+	});
+}
+
 GVN::gvn_state_t GVN::visit_inst(Instruction* i)
 {
 	auto hash = ValueHash(i);
 	if (hash.vc_ == 0) return invalid;
-	auto get = expr_val_map_.find(hash);
-	if (get == expr_val_map_.end())
-	{
-		expr_val_map_[hash] = i;
-		return firstdef;
-	}
+	auto [get, inserted] = expr_val_map_.emplace(std::move(hash), i);
+	if (inserted) return firstdef;
 	i->replace_all_use_with(get->second);
 	return redundant;
 }
@@ -184,6 +205,7 @@ GVN::ValueHash::ValueHash(const Instruction* inst)
 			}
 		case Instruction::msub:
 		case Instruction::madd:
+		case Instruction::select:
 			{
 				Value* op1 = inst->get_operand(0);
 				Value* op2 = inst->get_operand(1);
@@ -225,15 +247,15 @@ GVN::ValueHash& GVN::ValueHash::operator=(const ValueHash& other)
 	if (other.vc_ == 0)
 	{
 		vc_ = other.vc_;
-		delete vals_;
+		delete[] vals_;
 		vals_ = nullptr;
 	}
 	else
 	{
 		if (other.vc_ > vc_)
 		{
-			delete vals_;
-			vals_ = new Value*[vc_];
+			delete[] vals_;
+			vals_ = new Value*[other.vc_];
 		}
 		vc_ = other.vc_;
 		memcpy(static_cast<void*>(vals_), static_cast<void*>(other.vals_), vc_ << 3);
@@ -245,7 +267,7 @@ GVN::ValueHash& GVN::ValueHash::operator=(ValueHash&& other) noexcept
 {
 	if (this == &other)
 		return *this;
-	delete vals_;
+	delete[] vals_;
 	vals_ = other.vals_;
 	vc_ = other.vc_;
 	type_ = other.type_;
@@ -256,7 +278,7 @@ GVN::ValueHash& GVN::ValueHash::operator=(ValueHash&& other) noexcept
 
 GVN::ValueHash::~ValueHash()
 {
-	delete vals_;
+	delete[] vals_;
 }
 
 bool GVN::ValueHash::operator<(const ValueHash& r) const
@@ -276,3 +298,27 @@ bool GVN::ValueHash::operator<(const ValueHash& r) const
 	}
 	return false;
 }
+
+bool GVN::ValueHash::operator==(const ValueHash& r) const
+{
+	if (vc_ != r.vc_) return false;
+	if (vc_ == 0) return true;
+	if (type_ != r.type_) return false;
+	for (int i = 0; i < vc_; i++)
+		if (vals_[i] != r.vals_[i]) return false;
+	return true;
+}
+
+size_t GVN::ValueHashHasher::operator()(const ValueHash& h) const
+{
+	size_t ret = h.vc_ == 0 ? 0 : h.type_;
+	for (int i = 0; i < h.vc_; i++)
+	{
+		auto v = h.vals_[i];
+		int id = v->get_dense_id();
+		// 常数和全局变量没有编号, 使用指针
+		size_t part = id >= 0 ? static_cast<size_t>(id) : reinterpret_cast<size_t>(v) >> 3;
+		ret ^= part + 0x9e3779b97f4a7c15ull + (ret << 6) + (ret >> 2);
+	}
+	return ret;
+}
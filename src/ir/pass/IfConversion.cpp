@@ -0,0 +1,233 @@
+#include "IfConversion.hpp"
+
+#include <unordered_set>
+#include <vector>
+
+#include "BasicBlock.hpp"
+#include "Config.hpp"
+#include "Function.hpp"
+#include "Instruction.hpp"
+#include "Type.hpp"
+
+#define DEBUG 0
+#include "Util.hpp"
+
+using namespace std;
+
+void IfConversion::run()
+{
+	PREPARE_PASS_MSG;
+	LOG(color::cyan("Run IfConversion Pass"));
+	PUSH;
+	if (ifConversionMaxInsts >= 0)
+	{
+		for (auto f : m_->get_functions())
+		{
+			if (f->is_lib_) continue;
+			f_ = f;
+			removed_.clear();
+			// 合并会删除基本块, 所以遍历副本, 并跳过已删除的块
+			vector<BasicBlock*> blocks{f->get_basic_blocks().begin(), f->get_basic_blocks().end()};
+			for (auto bb : blocks)
+			{
+				if (removed_.count(bb)) continue;
+				while (runOnBlock(bb))
+				{
+				}
+			}
+			if (!removed_.empty()) manager_->flushFuncInfo(f);
+		}
+	}
+	POP;
+	PASS_SUFFIX;
+	LOG(color::cyan("IfConversion Done"));
+}
+
+string IfConversion::checkArm(BasicBlock* arm, int& count)
+{
+	for (auto inst : arm->get_instructions())
+	{
+		switch (inst->get_instr_type()) // NOLINT(clang-diagnostic-switch-enum)
+		{
+			case Instruction::add:
+			case Instruction::sub:
+			case Instruction::mul:
+			case Instruction::mull:
+			case Instruction::shl:
+			case Instruction::ashr:
+			case Instruction::and_:
+			case Instruction::fadd:
+			case Instruction::fsub:
+			case Instruction::fmul:
+			case Instruction::getelementptr:
+			case Instruction::fptosi:
+			case Instruction::sitofp:
+				count++;
+				break;
+			case Instruction::br:
+				if (dynamic_cast<BranchInst*>(inst)->is_cond_br()) return "it ends with a conditional branch";
+				break;
+			default:
+				return "it contains " + inst->get_instr_op_name() + ", which can not be executed speculatively";
+		}
+	}
+	return "";
+}
+
+bool IfConversion::runOnBlock(BasicBlock* bb)
+{
+	auto br = dynamic_cast<BranchInst*>(bb->get_terminator());
+	if (br == nullptr || !br->is_cond_br()) return false;
+	auto cond = dynamic_cast<Instruction*>(br->get_operand(0));
+	if (cond == nullptr || !(cond->is_cmp() || cond->is_fcmp())) return false;
+	auto t = dynamic_cast<BasicBlock*>(br->get_operand(1));
+	auto e = dynamic_cast<BasicBlock*>(br->get_operand(2));
+	if (t == e) return false;
+	// 只有一个前驱 bb 与一个后继的块可以作为分支, 其中的指令由 checkArm 检查
+	auto isArm = [bb](BasicBlock* b)
+	{
+		return b != bb && b->get_pre_basic_blocks().size() == 1 && b->get_succ_basic_blocks().size() == 1 &&
+			b->get_succ_basic_blocks().front() != b;
+	};
+	// 每个形状中跳转到 m 的块: 它是分支块, 或是 bb 本身
+	BasicBlock* m;
+	BasicBlock* fromT;
+	BasicBlock* fromE;
+	if (isArm(t) && isArm(e) && t->get_succ_basic_blocks().front() == e->get_succ_basic_blocks().front())
+	{
+		m = t->get_succ_basic_blocks().front();
+		fromT = t;
+		fromE = e;
+	}
+	else if (isArm(t) && t->get_succ_basic_blocks().front() == e)
+	{
+		m = e;
+		fromT = t;
+		fromE = bb;
+	}
+	else if (isArm(e) && e->get_succ_basic_blocks().front() == t)
+	{
+		m = t;
+		fromT = bb;
+		fromE = e;
+	}
+	else return false;
+	if (m == bb || m->is_entry_block() || m->get_pre_basic_blocks().size() != 2) return false;
+	int count = 0;
+	for (auto arm : {fromT, fromE})
+	{
+		if (arm == bb) continue;
+		auto reason = checkArm(arm, count);
+		if (!reason.empty())
+		{
+			remark(Remarks::Missed, "NotIfConverted", bb, "branch not converted to select", reason);
+			return false;
+		}
+	}
+	if (count > ifConversionMaxInsts)
+	{
+		remark(Remarks::Missed, "NotIfConverted", bb, "branch not converted to select",
+		       "its arms have " + to_string(count) + " instructions, more than ifConversionMaxInsts (" +
+		       to_string(ifConversionMaxInsts) + ")");
+		return false;
+	}
+	vector<Instruction*> phis;
+	for (auto phi : m->get_instructions().phi_and_allocas()) phis.emplace_back(phi);
+	for (auto phi : phis)
+	{
+		auto ty = phi->get_type();
+		if (ty != Types::INT && ty != Types::FLOAT)
+		{
+			remark(Remarks::Missed, "NotIfConverted", bb, "branch not converted to select",
+			       "a merged value has type " + ty->print() + ", only int and float can be selected");
+			return false;
+		}
+	}
+	LOG(color::green("Convert branch of ") + bb->get_name() + color::green(" to select"));
+	remark(Remarks::Passed, "IfConverted", bb, "branch converted to select", "");
+
+	// 提前分支中的指令
+	for (auto arm : {t, e})
+	{
+		if (arm == m) continue;
+		vector<Instruction*> insts;
+		for (auto inst : arm->get_instructions()) insts.emplace_back(inst);
+		insts.pop_back();
+		for (auto inst : insts)
+		{
+			arm->erase_instr(inst);
+			bb->get_instructions().emplace_common_inst_from_end(inst, 1);
+			inst->set_parent(bb);
+		}
+	}
+	// phi 变为 select, 两边的值相同时直接替换
+	for (auto inst : phis)
+	{
+		auto phi = dynamic_cast<PhiInst*>(inst);
+		Value* tv = nullptr;
+		Value* ev = nullptr;
+		for (auto& [val, from] : phi->get_phi_pairs())
+		{
+			if (from == fromT) tv = val;
+			else if (from == fromE) ev = val;
+		}
+		ASSERT(tv != nullptr && ev != nullptr);
+		Value* rep = tv;
+		if (tv != ev)
+		{
+			auto sel = SelectInst::create_select(cond, tv, ev, nullptr);
+			sel->set_parent(bb);
+			bb->get_instructions().emplace_common_inst_from_end(sel, 1);
+			rep = sel;
+		}
+		phi->replace_all_use_with(rep);
+		m->erase_instr(phi);
+		delete phi;
+	}
+	// 删除跳转与分支块, m 成为 bb 唯一的后继
+	delete bb->get_instructions().pop_back();
+	for (auto arm : {t, e})
+	{
+		if (arm == m) continue;
+		removed_.emplace(arm);
+		f_->remove(arm);
+	}
+	bb->remove_succ_basic_block(m);
+	m->remove_pre_basic_block(bb);
+	mergeInto(m, bb);
+	return true;
+}
+
+void IfConversion::mergeInto(BasicBlock* from, BasicBlock* to)
+{
+	vector<Instruction*> insts;
+	for (auto inst : from->get_instructions()) insts.emplace_back(inst);
+	for (auto inst : insts)
+	{
+		from->erase_instr(inst);
+		to->add_instruction(inst);
+		inst->set_parent(to);
+	}
+	for (auto succ : from->get_succ_basic_blocks())
+	{
+		succ->remove_pre_basic_block(from);
+		succ->add_pre_basic_block(to);
+		to->add_succ_basic_block(succ);
+		for (auto phi : succ->get_instructions().phi_and_allocas())
+			phi->replaceAllOperandMatchs(from, to);
+	}
+	from->get_succ_basic_blocks().clear();
+	from->get_pre_basic_blocks().clear();
+	removed_.emplace(from);
+	f_->remove(from);
+}
+
+void IfConversion::remark(Remarks::Kind kind, const char* name, BasicBlock* bb, const string& message,
+                          const string& reason) const
+{
+	if (!Remarks::enabled(kind, "ifcvt")) return;
+	Remarks::emit({
+		kind, "ifcvt", name, f_->get_name(), bb->get_diagnostic_name(), bb->get_terminator()->get_diagnostic_line(),
+		message, reason
+	});
+}
@@ -5,7 +5,9 @@
 #include "BasicBlock.hpp"
 #include "Instruction.hpp"
 #include "Config.hpp"
+#include "Remarks.hpp"
 #include "Type.hpp"
+#include "ValueMap.hpp"
 
 #define DEBUG 0
 #include "FuncInfo.hpp"
@@ -220,7 +222,7 @@ bool Inline::mergeReturns()
 				c = true;
 				auto& insts = preNode->block_->get_instructions();
 				delete insts.pop_back();
-				inst->copy(preNode->block_);
+				inst->copy(preNode->block_)->set_line(inst->get_line());
 				removeEdge(preNode, ret);
 				if (insts.size() == 1)
 				{
@@ -522,16 +524,6 @@ void Inline::done2WaitList()
 	waitlist_ = d;
 }
 
-namespace
-{
-	Value* getOrDefault(std::unordered_map<Value*, Value*>& m, Value* t)
-	{
-		auto fd = m.find(t);
-		if (fd == m.end()) return t;
-		return fd->second;
-	}
-}
-
 void Inline::mergeFunc()
 {
 	LOG(color::blue("Merge Func ") + f_->get_name());
@@ -545,11 +537,18 @@ void Inline::mergeFunc()
 		ASSERT(usage);
 		uses.emplace_back(usage);
 	}
+	f_->number_values();
 	for (auto call : uses)
 	{
 		auto bb = call->get_parent();
 		auto f = bb->get_parent();
 		LOG(color::yellow("Merge Func ") + f_->get_name() + color::yellow(" in ") + f->get_name());
+		if (Remarks::enabled(Remarks::Passed, "inline"))
+			Remarks::emit({
+				Remarks::Passed, "inline", "Inlined", f->get_name(), bb->get_diagnostic_name(), call->get_diagnostic_line(),
+				"'" + f_->get_name() + "' inlined into '" + f->get_name() + "'",
+				std::to_string(ii.size()) + " instructions"
+			});
 		auto& insts = bb->get_instructions();
 		auto begin = insts.begin();
 		auto ed = insts.end();
@@ -559,7 +558,7 @@ void Inline::mergeFunc()
 			if (nod == call)
 			{
 				auto pos = begin;
-				std::unordered_map<Value*, Value*> valMap;
+				ValueMap<Value*> valMap{f_};
 				int idx = 0;
 				for (auto& arg : f_->get_args())
 				{
@@ -571,6 +570,7 @@ void Inline::mergeFunc()
 					auto inst = in->copy(valMap);
 					if (inst != nullptr)
 					{
+						inst->set_line(in->get_line());
 						inst->set_parent(bb);
 						insts.emplace_common_inst_after(inst, pos);
 						++pos;
@@ -582,7 +582,7 @@ void Inline::mergeFunc()
 					delete insts.remove(begin);
 					break;
 				}
-				nod->replace_all_use_with(getOrDefault(valMap, ret->get_operand(0)));
+				nod->replace_all_use_with(getOrSelf(valMap, ret->get_operand(0)));
 				delete insts.remove(begin);
 				break;
 			}
@@ -632,16 +632,39 @@ void Inline::runOnFunc()
 			{
 				if (i->is_alloca())
 				{
+					remarkNotInlined("NoInlineAlloca", "it has a local array");
 					POP;
 					return;
 				}
 			}
 			mergeFunc();
 		}
+		else
+			remarkNotInlined("TooCostly", "it has " + std::to_string(insts.size()) +
+			                              " instructions, more than funcInlineGate (" + std::to_string(funcInlineGate) +
+			                              ")");
 	}
+	else
+		remarkNotInlined("NotSingleBlock", "it has " + std::to_string(f_->get_basic_blocks().size()) +
+		                                   " basic blocks, only single-block functions are inlined");
 	POP;
 }
 
+void Inline::remarkNotInlined(const char* name, const std::string& reason) const
+{
+	if (!Remarks::enabled(Remarks::Missed, "inline")) return;
+	for (auto use : f_->get_use_list())
+	{
+		auto call = dynamic_cast<CallInst*>(use.val_);
+		if (call == nullptr) continue;
+		auto bb = call->get_parent();
+		Remarks::emit({
+			Remarks::Missed, "inline", name, bb->get_parent()->get_name(), bb->get_diagnostic_name(), call->get_diagnostic_line(),
+			"'" + f_->get_name() + "' not inlined into '" + bb->get_parent()->get_name() + "'", reason
+		});
+	}
+}
+
 void Inline::removeEdge(IBBNode* from, IBBNode* to)
 {
 	bool f = from->next_.resetAndGet(to->id_);
@@ -0,0 +1,835 @@
+#include "Interpret.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "BasicBlock.hpp"
+#include "Config.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "GlobalVariable.hpp"
+#include "Instruction.hpp"
+#include "Module.hpp"
+#include "Tensor.hpp"
+#include "Type.hpp"
+
+namespace
+{
+	// 地址 0 到 16 不可访问, 用于发现空指针
+	constexpr uint64_t NULL_GUARD_BYTES = 16;
+	// 全局变量与栈的总大小上限
+	constexpr uint64_t MEMORY_LIMIT_BYTES = 1ULL << 30;
+
+	const char* opcodeName(const int op)
+	{
+		static const char* names[] = {
+			"ret", "br", "add", "sub", "mul", "mull", "sdiv", "srem", "shl", "ashr", "and",
+			"fadd", "fsub", "fmul", "fdiv", "alloca", "load", "store",
+			"ge", "gt", "le", "lt", "eq", "ne", "fge", "fgt", "fle", "flt", "feq", "fne",
+			"phi", "call", "getelementptr", "zext", "fptosi", "sitofp", "select",
+			"memcpy", "memclear", "nump2charp", "global_fix", "msub", "madd", "mneg"
+		};
+		static_assert(sizeof(names) / sizeof(names[0]) == Instruction::mneg + 1);
+		return names[op];
+	}
+
+	int64_t sizeInBytes(Type* ty)
+	{
+		return ty->sizeInBitsInArm64() / 8;
+	}
+
+	int64_t alignTo(const int64_t v, const int64_t align)
+	{
+		return (v + align - 1) / align * align;
+	}
+
+	// 与 ARM64 的 FCVTZS 一致, 超出范围时饱和, NaN 转换为 0
+	int saturateToInt(const float f)
+	{
+		if (std::isnan(f)) return 0;
+		if (f >= 2147483648.0f) return INT_MAX;
+		if (f < -2147483648.0f) return INT_MIN;
+		return static_cast<int>(f);
+	}
+
+	int wrap(const long long v)
+	{
+		return static_cast<int>(static_cast<unsigned>(v));
+	}
+}
+
+Interpret::Interpret(PassManager* mng, Module* m, int* exitCode) : Pass(mng, m), exitCode_(exitCode)
+{
+}
+
+Interpret::~Interpret()
+{
+	for (auto f : functions_) delete f;
+}
+
+void Interpret::run()
+{
+	m_->set_print_name();
+	layoutGlobals();
+	Function* mainFunc = nullptr;
+	for (auto f : m_->get_functions())
+	{
+		if (f->is_declaration()) continue;
+		functionIndex_[f] = static_cast<int>(functions_.size());
+		functions_.emplace_back(nullptr);
+		if (f->get_name() == "main") mainFunc = f;
+	}
+	if (mainFunc == nullptr) throw std::runtime_error("interp: no main function");
+	for (auto [f, idx] : functionIndex_) functions_[idx] = lower(f);
+
+	const int ret = execute(functions_[functionIndex_[mainFunc]]);
+	fflush(stdout);
+	printTimers();
+	if (exitCode_ != nullptr) *exitCode_ = ret;
+
+	if (interpretReportFile.empty()) report(std::cerr);
+	else
+	{
+		std::ofstream out{interpretReportFile};
+		report(out);
+	}
+	if (!interpretProfileFile.empty())
+	{
+		std::ofstream out{interpretProfileFile};
+		writeProfile(out);
+	}
+}
+
+void Interpret::layoutGlobals()
+{
+	uint64_t top = NULL_GUARD_BYTES;
+	for (auto g : m_->get_global_variable())
+	{
+		const int64_t bytes = sizeInBytes(g->get_type()->toPointerType()->typeContained());
+		top = alignTo(static_cast<int64_t>(top), bytes >= 16 ? 16 : 8);
+		globalAddress_[g] = top;
+		top += bytes;
+	}
+	sp_ = alignTo(static_cast<int64_t>(top), 16);
+	memory_.assign(std::max<uint64_t>(sp_, 1ULL << 20), 0);
+	for (auto g : m_->get_global_variable())
+	{
+		auto init = g->get_init();
+		if (init == nullptr) continue;
+		char* dst = memory_.data() + globalAddress_[g];
+		auto write = [&dst](const ConstantValue& v)
+		{
+			if (v.isFloatConstant())
+			{
+				float f = v.getFloatConstant();
+				memcpy(dst, &f, 4);
+			}
+			else
+			{
+				int i = v.isBoolConstant() ? v.getBoolConstant() : v.getIntConstant();
+				memcpy(dst, &i, 4);
+			}
+			dst += 4;
+		};
+		for (int s = 0, count = init->segmentCount(); s < count; s++)
+		{
+			auto [elements, len] = init->segment(s);
+			if (elements != nullptr)
+			{
+				for (auto& e : *elements) write(e);
+				continue;
+			}
+			// 默认值几乎总是 0, 内存已经清零
+			if (init->default_value() == ConstantValue{0}) dst += 4LL * len;
+			else for (int i = 0; i < len; i++) write(init->default_value());
+		}
+	}
+}
+
+Interpret::LoweredFunction* Interpret::lower(Function* f)
+{
+	auto fn = new LoweredFunction;
+	fn->f = f;
+	const int count = f->number_values();
+	const int denseBase = f->dense_base();
+	fn->init.assign(count, Slot{});
+	std::unordered_map<Value*, int> constSlots;
+	auto slot = [&](Value* v) -> int
+	{
+		const auto idx = static_cast<unsigned>(v->get_dense_id() - denseBase);
+		if (idx < static_cast<unsigned>(count)) return static_cast<int>(idx);
+		auto fd = constSlots.find(v);
+		if (fd != constSlots.end()) return fd->second;
+		Slot s{};
+		if (auto c = dynamic_cast<Constant*>(v))
+		{
+			if (c->isFloatConstant()) s.f = c->getFloatConstant();
+			else if (c->isBoolConstant()) s.i = c->getBoolConstant();
+			else s.i = c->getIntConstant();
+		}
+		else if (auto g = dynamic_cast<GlobalVariable*>(v)) s.p = globalAddress_[g];
+		else throw std::runtime_error("interp: unknown operand " + v->get_name() + " in @" + f->get_name());
+		const int ret = static_cast<int>(fn->init.size());
+		fn->init.emplace_back(s);
+		constSlots.emplace(v, ret);
+		return ret;
+	};
+	for (auto arg : f->get_args()) fn->args.emplace_back(slot(arg));
+
+	std::unordered_map<BasicBlock*, int> blockIndex;
+	for (auto bb : f->get_basic_blocks())
+	{
+		blockIndex[bb] = static_cast<int>(fn->blocks.size());
+		Block b{};
+		b.bb = bb;
+		fn->blocks.emplace_back(b);
+	}
+	fn->blockCounts.assign(fn->blocks.size(), 0);
+
+	auto edge = [&](BasicBlock* from, Value* to) -> int
+	{
+		auto target = dynamic_cast<BasicBlock*>(to);
+		Edge e{blockIndex.at(target), static_cast<int>(fn->moves.size()), 0};
+		for (auto inst : target->get_instructions())
+		{
+			if (!inst->is_phi()) break;
+			auto v = dynamic_cast<PhiInst*>(inst)->get_phi_val(from);
+			// 缺少的入边是 undef, 不需要赋值
+			if (v != nullptr) fn->moves.emplace_back(slot(inst), slot(v));
+		}
+		e.moveEnd = static_cast<int>(fn->moves.size());
+		fn->edges.emplace_back(e);
+		return static_cast<int>(fn->edges.size()) - 1;
+	};
+
+	for (auto& b : fn->blocks)
+	{
+		auto bb = b.bb;
+		b.begin = static_cast<int>(fn->ops.size());
+		for (auto inst : bb->get_instructions())
+		{
+			const auto id = inst->get_instr_type();
+			b.instructions++;
+			b.opcodes[id]++;
+			if (id == Instruction::phi) continue;
+			Op op{Code::Copy, inst->is_void() ? -1 : slot(inst), -1, -1, -1, 0};
+			auto operand = [&](const int i) { return slot(inst->get_operand(i)); };
+			const bool isFloat = inst->get_type() == Types::FLOAT;
+			switch (id)
+			{
+				case Instruction::ret:
+					if (dynamic_cast<ReturnInst*>(inst)->is_void_ret()) op.code = Code::RetVoid;
+					else
+					{
+						op.code = Code::Ret;
+						op.a = operand(0);
+					}
+					break;
+				case Instruction::br:
+					if (dynamic_cast<BranchInst*>(inst)->is_cond_br())
+					{
+						op.code = Code::CondBr;
+						op.a = operand(0);
+						op.b = edge(bb, inst->get_operand(1));
+						op.c = edge(bb, inst->get_operand(2));
+					}
+					else
+					{
+						op.code = Code::Br;
+						op.a = edge(bb, inst->get_operand(0));
+					}
+					break;
+				case Instruction::add:
+				case Instruction::sub:
+				case Instruction::mul:
+				case Instruction::mull:
+				case Instruction::sdiv:
+				case Instruction::srem:
+				case Instruction::shl:
+				case Instruction::ashr:
+				case Instruction::and_:
+				case Instruction::fadd:
+				case Instruction::fsub:
+				case Instruction::fmul:
+				case Instruction::fdiv:
+				case Instruction::ge:
+				case Instruction::gt:
+				case Instruction::le:
+				case Instruction::lt:
+				case Instruction::eq:
+				case Instruction::ne:
+				case Instruction::fge:
+				case Instruction::fgt:
+				case Instruction::fle:
+				case Instruction::flt:
+				case Instruction::feq:
+				case Instruction::fne:
+				{
+					static const Code codes[] = {
+						Code::Add, Code::Sub, Code::Mul, Code::Mul, Code::SDiv, Code::SRem, Code::Shl, Code::AShr,
+						Code::And, Code::FAdd, Code::FSub, Code::FMul, Code::FDiv
+					};
+					static const Code cmpCodes[] = {
+						Code::Ge, Code::Gt, Code::Le, Code::Lt, Code::Eq, Code::Ne,
+						Code::FGe, Code::FGt, Code::FLe, Code::FLt, Code::FEq, Code::FNe
+					};
+					op.code = id <= Instruction::fdiv ? codes[id - Instruction::add] : cmpCodes[id - Instruction::ge];
+					op.a = operand(0);
+					op.b = operand(1);
+					break;
+				}
+				case Instruction::msub:
+				case Instruction::madd:
+				case Instruction::mneg:
+					op.code = id == Instruction::msub
+						          ? (isFloat ? Code::FMSub : Code::MSub)
+						          : id == Instruction::madd
+						          ? (isFloat ? Code::FMAdd : Code::MAdd)
+						          : (isFloat ? Code::FMNeg : Code::MNeg);
+					op.a = operand(0);
+					op.b = operand(1);
+					if (id != Instruction::mneg) op.c = operand(2);
+					break;
+				case Instruction::alloca_:
+				{
+					const int64_t bytes = sizeInBytes(dynamic_cast<AllocaInst*>(inst)->get_alloca_type());
+					fn->frameBytes = alignTo(fn->frameBytes, bytes >= 16 ? 16 : 8);
+					op.code = Code::Alloca;
+					op.imm = fn->frameBytes;
+					fn->frameBytes += bytes;
+					break;
+				}
+				case Instruction::load:
+				{
+					const int64_t bytes = sizeInBytes(inst->get_type());
+					op.code = bytes == 8 ? Code::Load8 : Code::Load4;
+					op.a = operand(0);
+					b.loads++;
+					b.loadBytes += bytes == 8 ? 8 : 4;
+					break;
+				}
+				case Instruction::store:
+				{
+					const int64_t bytes = sizeInBytes(inst->get_operand(0)->get_type());
+					op.code = bytes == 8 ? Code::Store8 : Code::Store4;
+					op.a = operand(0);
+					op.b = operand(1);
+					b.stores++;
+					b.storeBytes += bytes == 8 ? 8 : 4;
+					break;
+				}
+				case Instruction::call:
+				{
+					auto callee = dynamic_cast<Function*>(inst->get_operand(0));
+					op.b = static_cast<int>(fn->callArgs.size());
+					op.c = inst->get_num_operand() - 1;
+					for (int i = 1; i < inst->get_num_operand(); i++) fn->callArgs.emplace_back(operand(i));
+					if (!callee->is_declaration())
+					{
+						op.code = Code::Call;
+						op.a = functionIndex_.at(callee);
+						break;
+					}
+					static const std::unordered_map<std::string, Lib> libs = {
+						{"_sysy_starttime", Lib::StartTime}, {"_sysy_stoptime", Lib::StopTime},
+						{"getint", Lib::GetInt}, {"getch", Lib::GetCh}, {"getfloat", Lib::GetFloat},
+						{"getarray", Lib::GetArray}, {"getfarray", Lib::GetFArray},
+						{"putint", Lib::PutInt}, {"putch", Lib::PutCh}, {"putarray", Lib::PutArray},
+						{"putfloat", Lib::PutFloat}, {"putfarray", Lib::PutFArray}
+					};
+					auto fd = libs.find(callee->get_name());
+					if (fd == libs.end())
+						throw std::runtime_error("interp: unknown external function @" + callee->get_name());
+					op.code = Code::LibCall;
+					op.a = static_cast<int>(fd->second);
+					break;
+				}
+				case Instruction::getelementptr:
+				{
+					op.code = Code::Gep;
+					op.a = operand(0);
+					op.b = static_cast<int>(fn->gepTerms.size());
+					Type* ty = inst->get_operand(0)->get_type()->toPointerType()->typeContained();
+					for (int i = 1; i < inst->get_num_operand(); i++)
+					{
+						if (i > 1) ty = ty->toArrayType()->getSubType(1);
+						const int64_t stride = sizeInBytes(ty);
+						if (auto c = dynamic_cast<Constant*>(inst->get_operand(i)))
+							op.imm += stride * c->getIntConstant();
+						else fn->gepTerms.emplace_back(GepTerm{operand(i), stride});
+					}
+					op.c = static_cast<int>(fn->gepTerms.size()) - op.b;
+					break;
+				}
+				case Instruction::zext:
+				case Instruction::nump2charp:
+				case Instruction::global_fix:
+					op.code = Code::Copy;
+					op.a = operand(0);
+					break;
+				case Instruction::fptosi:
+					op.code = Code::FpToSi;
+					op.a = operand(0);
+					break;
+				case Instruction::sitofp:
+					op.code = Code::SiToFp;
+					op.a = operand(0);
+					break;
+				case Instruction::select:
+					op.code = Code::Select;
+					op.a = operand(0);
+					op.b = operand(1);
+					op.c = operand(2);
+					break;
+				case Instruction::memcpy_:
+				{
+					auto mem = dynamic_cast<MemCpyInst*>(inst);
+					op.code = Code::MemCpy;
+					op.a = slot(mem->get_from());
+					op.b = slot(mem->get_to());
+					op.imm = mem->get_copy_bytes();
+					b.memcpys++;
+					b.memcpyBytes += op.imm;
+					break;
+				}
+				case Instruction::memclear_:
+				{
+					auto mem = dynamic_cast<MemClearInst*>(inst);
+					op.code = Code::MemClear;
+					op.a = slot(mem->get_target());
+					op.imm = mem->get_clear_bytes();
+					b.memclears++;
+					b.memclearBytes += op.imm;
+					break;
+				}
+				case Instruction::phi:
+					break;
+			}
+			fn->ops.emplace_back(op);
+		}
+	}
+	return fn;
+}
+
+uint64_t Interpret::allocateFrame(const int64_t bytes)
+{
+	const uint64_t frame = alignTo(static_cast<int64_t>(sp_), 16);
+	sp_ = frame + bytes;
+	if (sp_ > memory_.size())
+	{
+		if (sp_ > MEMORY_LIMIT_BYTES) throw std::runtime_error("stack overflow");
+		memory_.resize(std::min(std::max<uint64_t>(sp_, memory_.size() * 2), MEMORY_LIMIT_BYTES));
+	}
+	return frame;
+}
+
+char* Interpret::access(const uint64_t addr, const int64_t bytes)
+{
+	if (addr < NULL_GUARD_BYTES || addr + bytes > sp_)
+		throw std::runtime_error("invalid memory access at " + std::to_string(addr) + " (" + std::to_string(bytes) +
+		                         " bytes)");
+	return memory_.data() + addr;
+}
+
+int Interpret::takeEdge(LoweredFunction* fn, const size_t base, const int e)
+{
+	const Edge& edge = fn->edges[e];
+	Slot* r = regs_.data() + base;
+	const int n = edge.moveEnd - edge.moveBegin;
+	if (n == 1)
+	{
+		auto [dst, src] = fn->moves[edge.moveBegin];
+		r[dst] = r[src];
+	}
+	else if (n > 1)
+	{
+		// phi 并行赋值, 先读出所有源再写入
+		moveBuffer_.resize(n);
+		for (int i = 0; i < n; i++) moveBuffer_[i] = r[fn->moves[edge.moveBegin + i].second];
+		for (int i = 0; i < n; i++) r[fn->moves[edge.moveBegin + i].first] = moveBuffer_[i];
+	}
+	fn->blockCounts[edge.block]++;
+	return fn->blocks[edge.block].begin;
+}
+
+int Interpret::execute(LoweredFunction* main)
+{
+	std::vector<Frame> stack;
+	LoweredFunction* fn = main;
+	size_t base = 0;
+	int pc = 0;
+	try
+	{
+		regs_.assign(fn->init.begin(), fn->init.end());
+		uint64_t frame = allocateFrame(fn->frameBytes);
+		fn->calls++;
+		fn->blockCounts[0]++;
+		while (true)
+		{
+			const Op& op = fn->ops[pc++];
+			Slot* r = regs_.data() + base;
+			switch (op.code)
+			{
+				case Code::Add:
+					r[op.dst].i = wrap(static_cast<long long>(r[op.a].i) + r[op.b].i);
+					break;
+				case Code::Sub:
+					r[op.dst].i = wrap(static_cast<long long>(r[op.a].i) - r[op.b].i);
+					break;
+				case Code::Mul:
+					r[op.dst].i = wrap(static_cast<long long>(r[op.a].i) * r[op.b].i);
+					break;
+				case Code::SDiv:
+				{
+					// SDIV 除以 0 得到 0, INT_MIN / -1 得到 INT_MIN
+					const int a = r[op.a].i, b = r[op.b].i;
+					r[op.dst].i = b == 0 ? 0 : b == -1 ? wrap(-static_cast<long long>(a)) : a / b;
+					break;
+				}
+				case Code::SRem:
+				{
+					// 与 SDIV + MSUB 一致
+					const int a = r[op.a].i, b = r[op.b].i;
+					r[op.dst].i = b == 0 ? a : b == -1 ? 0 : a % b;
+					break;
+				}
+				case Code::Shl:
+					r[op.dst].i = static_cast<int>(static_cast<unsigned>(r[op.a].i) << (r[op.b].i & 31));
+					break;
+				case Code::AShr:
+					r[op.dst].i = r[op.a].i >> (r[op.b].i & 31);
+					break;
+				case Code::And:
+					r[op.dst].i = r[op.a].i & r[op.b].i;
+					break;
+				case Code::FAdd:
+					r[op.dst].f = r[op.a].f + r[op.b].f;
+					break;
+				case Code::FSub:
+					r[op.dst].f = r[op.a].f - r[op.b].f;
+					break;
+				case Code::FMul:
+					r[op.dst].f = r[op.a].f * r[op.b].f;
+					break;
+				case Code::FDiv:
+					r[op.dst].f = r[op.a].f / r[op.b].f;
+					break;
+				case Code::MAdd:
+					r[op.dst].i = wrap(static_cast<long long>(r[op.a].i) * r[op.b].i + r[op.c].i);
+					break;
+				case Code::MSub:
+					r[op.dst].i = wrap(r[op.c].i - static_cast<long long>(r[op.a].i) * r[op.b].i);
+					break;
+				case Code::MNeg:
+					r[op.dst].i = wrap(-(static_cast<long long>(r[op.a].i) * r[op.b].i));
+					break;
+				// 与 FMADD / FMSUB 一致, 只舍入一次
+				case Code::FMAdd:
+					r[op.dst].f = std::fmaf(r[op.a].f, r[op.b].f, r[op.c].f);
+					break;
+				case Code::FMSub:
+					r[op.dst].f = std::fmaf(-r[op.a].f, r[op.b].f, r[op.c].f);
+					break;
+				case Code::FMNeg:
+					r[op.dst].f = -(r[op.a].f * r[op.b].f);
+					break;
+				case Code::Ge:
+					r[op.dst].i = r[op.a].i >= r[op.b].i;
+					break;
+				case Code::Gt:
+					r[op.dst].i = r[op.a].i > r[op.b].i;
+					break;
+				case Code::Le:
+					r[op.dst].i = r[op.a].i <= r[op.b].i;
+					break;
+				case Code::Lt:
+					r[op.dst].i = r[op.a].i < r[op.b].i;
+					break;
+				case Code::Eq:
+					r[op.dst].i = r[op.a].i == r[op.b].i;
+					break;
+				case Code::Ne:
+					r[op.dst].i = r[op.a].i != r[op.b].i;
+					break;
+				// 浮点比较是无序比较, 与 IR 输出的 uge/ugt/... 一致
+				case Code::FGe:
+					r[op.dst].i = !(r[op.a].f < r[op.b].f);
+					break;
+				case Code::FGt:
+					r[op.dst].i = !(r[op.a].f <= r[op.b].f);
+					break;
+				case Code::FLe:
+					r[op.dst].i = !(r[op.a].f > r[op.b].f);
+					break;
+				case Code::FLt:
+					r[op.dst].i = !(r[op.a].f >= r[op.b].f);
+					break;
+				case Code::FEq:
+					r[op.dst].i = !(r[op.a].f < r[op.b].f || r[op.a].f > r[op.b].f);
+					break;
+				case Code::FNe:
+					r[op.dst].i = !(r[op.a].f == r[op.b].f);
+					break;
+				case Code::Alloca:
+					r[op.dst].p = frame + op.imm;
+					break;
+				case Code::Load4:
+					memcpy(&r[op.dst].i, access(r[op.a].p, 4), 4);
+					break;
+				case Code::Load8:
+					memcpy(&r[op.dst].p, access(r[op.a].p, 8), 8);
+					break;
+				case Code::Store4:
+					memcpy(access(r[op.b].p, 4), &r[op.a].i, 4);
+					break;
+				case Code::Store8:
+					memcpy(access(r[op.b].p, 8), &r[op.a].p, 8);
+					break;
+				case Code::Gep:
+				{
+					int64_t offset = op.imm;
+					for (int i = op.b, end = op.b + op.c; i < end; i++)
+						offset += fn->gepTerms[i].stride * r[fn->gepTerms[i].slot].i;
+					r[op.dst].p = r[op.a].p + offset;
+					break;
+				}
+				case Code::Copy:
+					r[op.dst] = r[op.a];
+					break;
+				case Code::FpToSi:
+					r[op.dst].i = saturateToInt(r[op.a].f);
+					break;
+				case Code::SiToFp:
+					r[op.dst].f = static_cast<float>(r[op.a].i);
+					break;
+				case Code::Select:
+					r[op.dst] = r[op.a].i ? r[op.b] : r[op.c];
+					break;
+				case Code::MemCpy:
+				{
+					const char* from = access(r[op.a].p, op.imm);
+					memmove(access(r[op.b].p, op.imm), from, op.imm);
+					break;
+				}
+				case Code::MemClear:
+					memset(access(r[op.a].p, op.imm), 0, op.imm);
+					break;
+				case Code::Call:
+				{
+					LoweredFunction* callee = functions_[op.a];
+					stack.emplace_back(Frame{fn, pc, base, frame, sp_, op.dst});
+					const size_t calleeBase = regs_.size();
+					regs_.insert(regs_.end(), callee->init.begin(), callee->init.end());
+					r = regs_.data() + base;
+					Slot* cr = regs_.data() + calleeBase;
+					for (int i = 0; i < op.c; i++) cr[callee->args[i]] = r[fn->callArgs[op.b + i]];
+					fn = callee;
+					base = calleeBase;
+					frame = allocateFrame(fn->frameBytes);
+					fn->calls++;
+					fn->blockCounts[0]++;
+					pc = 0;
+					break;
+				}
+				case Code::LibCall:
+				{
+					Slot args[2]{};
+					for (int i = 0; i < op.c; i++) args[i] = r[fn->callArgs[op.b + i]];
+					const Slot ret = callLibrary(static_cast<Lib>(op.a), args);
+					if (op.dst >= 0) regs_[base + op.dst] = ret;
+					break;
+				}
+				case Code::Br:
+					pc = takeEdge(fn, base, op.a);
+					break;
+				case Code::CondBr:
+					pc = takeEdge(fn, base, r[op.a].i ? op.b : op.c);
+					break;
+				case Code::Ret:
+				case Code::RetVoid:
+				{
+					const Slot ret = op.code == Code::Ret ? r[op.a] : Slot{};
+					regs_.resize(base);
+					if (stack.empty()) return ret.i;
+					const Frame& caller = stack.back();
+					fn = caller.fn;
+					pc = caller.pc;
+					base = caller.base;
+					frame = caller.frame;
+					sp_ = caller.sp;
+					if (caller.dst >= 0) regs_[base + caller.dst] = ret;
+					stack.pop_back();
+					break;
+				}
+			}
+		}
+	}
+	catch (const std::runtime_error& e)
+	{
+		// 定位到出错指令所在的基本块
+		auto block = std::upper_bound(fn->blocks.begin(), fn->blocks.end(), pc - 1,
+		                              [](const int p, const Block& b) { return p < b.begin; });
+		std::string where = "@" + fn->f->get_name();
+		if (block != fn->blocks.begin()) where += " %" + std::prev(block)->bb->get_name();
+		throw std::runtime_error(std::string{"interp: "} + e.what() + " in " + where);
+	}
+}
+
+Interpret::Slot Interpret::callLibrary(const Lib lib, const Slot* args)
+{
+	Slot ret{};
+	switch (lib)
+	{
+		case Lib::StartTime:
+			timers_.emplace_back(Timer{args[0].i, 0, 0});
+			timerBegin_ = std::chrono::steady_clock::now();
+			break;
+		case Lib::StopTime:
+			if (timers_.empty()) timers_.emplace_back(Timer{0, 0, 0});
+			timers_.back().endLine = args[0].i;
+			timers_.back().us += std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - timerBegin_).count();
+			break;
+		case Lib::GetInt:
+			if (scanf("%d", &ret.i) != 1) ret.i = 0;
+			break;
+		case Lib::GetCh:
+		{
+			char c = EOF;
+			if (scanf("%c", &c) != 1) c = EOF;
+			ret.i = c;
+			break;
+		}
+		case Lib::GetFloat:
+			if (scanf("%a", &ret.f) != 1) ret.f = 0;
+			break;
+		case Lib::GetArray:
+		case Lib::GetFArray:
+		{
+			int n = 0;
+			if (scanf("%d", &n) != 1) n = 0;
+			char* a = access(args[0].p, 4LL * std::max(n, 0));
+			for (int i = 0; i < n; i++)
+			{
+				Slot v{};
+				if (lib == Lib::GetArray ? scanf("%d", &v.i) != 1 : scanf("%a", &v.f) != 1) break;
+				memcpy(a + 4LL * i, &v.i, 4);
+			}
+			ret.i = n;
+			break;
+		}
+		case Lib::PutInt:
+			printf("%d", args[0].i);
+			break;
+		case Lib::PutCh:
+			putchar(args[0].i);
+			break;
+		case Lib::PutFloat:
+			printf("%a", static_cast<double>(args[0].f));
+			break;
+		case Lib::PutArray:
+		case Lib::PutFArray:
+		{
+			const int n = args[0].i;
+			const char* a = access(args[1].p, 4LL * std::max(n, 0));
+			printf("%d:", n);
+			for (int i = 0; i < n; i++)
+			{
+				Slot v{};
+				memcpy(&v.i, a + 4LL * i, 4);
+				if (lib == Lib::PutArray) printf(" %d", v.i);
+				else printf(" %a", static_cast<double>(v.f));
+			}
+			printf("\n");
+			break;
+		}
+	}
+	return ret;
+}
+
+void Interpret::printTimers() const
+{
+	// 与 sylib 退出时的输出一致
+	long long total = 0;
+	for (auto& t : timers_)
+	{
+		fprintf(stderr, "Timer@%04d-%04d: %lldH-%lldM-%lldS-%lldus\n", t.beginLine, t.endLine, t.us / 3600000000LL,
+		        t.us / 60000000LL % 60, t.us / 1000000LL % 60, t.us % 1000000LL);
+		total += t.us;
+	}
+	fprintf(stderr, "TOTAL: %lldH-%lldM-%lldS-%lldus\n", total / 3600000000LL, total / 60000000LL % 60,
+	        total / 1000000LL % 60, total % 1000000LL);
+}
+
+void Interpret::report(std::ostream& out) const
+{
+	std::array<long long, Instruction::mneg + 1> opcodes{};
+	long long instructions = 0, calls = 0;
+	long long loads = 0, stores = 0, loadBytes = 0, storeBytes = 0;
+	long long memcpys = 0, memclears = 0, memcpyBytes = 0, memclearBytes = 0;
+	std::vector<std::tuple<long long, long long, const LoweredFunction*>> funcs;
+	std::vector<std::tuple<long long, long long, const LoweredFunction*, const Block*>> blocks;
+	for (auto fn : functions_)
+	{
+		long long fnInstructions = 0;
+		for (size_t i = 0; i < fn->blocks.size(); i++)
+		{
+			const Block& b = fn->blocks[i];
+			const long long n = fn->blockCounts[i];
+			if (n == 0) continue;
+			for (int op = 0; op <= Instruction::mneg; op++) opcodes[op] += n * b.opcodes[op];
+			fnInstructions += n * b.instructions;
+			loads += n * b.loads;
+			stores += n * b.stores;
+			loadBytes += n * b.loadBytes;
+			storeBytes += n * b.storeBytes;
+			memcpys += n * b.memcpys;
+			memclears += n * b.memclears;
+			memcpyBytes += n * b.memcpyBytes;
+			memclearBytes += n * b.memclearBytes;
+			blocks.emplace_back(n * b.instructions, n, fn, &b);
+		}
+		instructions += fnInstructions;
+		calls += fn->calls;
+		if (fn->calls > 0) funcs.emplace_back(fnInstructions, fn->calls, fn);
+	}
+	auto hotter = [](const auto& l, const auto& r) { return std::get<0>(l) > std::get<0>(r); };
+	std::stable_sort(funcs.begin(), funcs.end(), hotter);
+	std::stable_sort(blocks.begin(), blocks.end(), hotter);
+
+	out << "interp-total instructions " << instructions << " calls " << calls << "\n";
+	std::vector<int> order;
+	for (int op = 0; op <= Instruction::mneg; op++) if (opcodes[op] > 0) order.emplace_back(op);
+	std::stable_sort(order.begin(), order.end(), [&opcodes](const int l, const int r) { return opcodes[l] > opcodes[r]; });
+	for (int op : order) out << "interp-opcode " << opcodeName(op) << " " << opcodes[op] << "\n";
+	for (auto& [n, c, fn] : funcs) out << "interp-function " << fn->f->get_name() << " " << c << " " << n << "\n";
+	// 只输出最热的基本块, 完整的计数见 profile
+	constexpr size_t HOT_BLOCKS = 32;
+	for (size_t i = 0; i < blocks.size() && i < HOT_BLOCKS; i++)
+	{
+		auto& [n, c, fn, b] = blocks[i];
+		out << "interp-block " << fn->f->get_name() << " " << b->bb->get_name() << " " << c << " " << n << "\n";
+	}
+	out << "interp-memory load " << loads << " " << loadBytes << "\n";
+	out << "interp-memory store " << stores << " " << storeBytes << "\n";
+	out << "interp-memory memcpy " << memcpys << " " << memcpyBytes << "\n";
+	out << "interp-memory memclear " << memclears << " " << memclearBytes << "\n";
+}
+
+void Interpret::writeProfile(std::ostream& out) const
+{
+	for (auto fn : functions_)
+	{
+		out << "function " << fn->f->get_name() << " " << fn->calls << "\n";
+		for (size_t i = 0; i < fn->blocks.size(); i++)
+			out << "block " << fn->blocks[i].bb->get_name() << " " << fn->blockCounts[i] << "\n";
+	}
+}
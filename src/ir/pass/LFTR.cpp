@@ -0,0 +1,235 @@
+#include "LFTR.hpp"
+
+#include "BasicBlock.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "Instruction.hpp"
+#include "LoopDetection.hpp"
+#include "Type.hpp"
+
+#define DEBUG 0
+#include "Util.hpp"
+
+using namespace std;
+
+namespace
+{
+	Instruction::OpID invertCmpOp(Instruction::OpID op)
+	{
+		switch (op) // NOLINT(clang-diagnostic-switch-enum)
+		{
+			case Instruction::ge: return Instruction::lt;
+			case Instruction::gt: return Instruction::le;
+			case Instruction::le: return Instruction::gt;
+			case Instruction::lt: return Instruction::ge;
+			case Instruction::eq: return Instruction::ne;
+			case Instruction::ne: return Instruction::eq;
+			default: break;
+		}
+		ASSERT(false);
+		return op;
+	}
+
+	// 交换比较的两个操作数后的条件
+	Instruction::OpID swapCmpOp(Instruction::OpID op)
+	{
+		switch (op) // NOLINT(clang-diagnostic-switch-enum)
+		{
+			case Instruction::ge: return Instruction::le;
+			case Instruction::gt: return Instruction::lt;
+			case Instruction::le: return Instruction::ge;
+			case Instruction::lt: return Instruction::gt;
+			default: break;
+		}
+		return op;
+	}
+
+	ICmpInst* createCmp(Instruction::OpID op, Value* l, Value* r)
+	{
+		switch (op) // NOLINT(clang-diagnostic-switch-enum)
+		{
+			case Instruction::ge: return ICmpInst::create_ge(l, r, nullptr);
+			case Instruction::gt: return ICmpInst::create_gt(l, r, nullptr);
+			case Instruction::le: return ICmpInst::create_le(l, r, nullptr);
+			case Instruction::lt: return ICmpInst::create_lt(l, r, nullptr);
+			case Instruction::eq: return ICmpInst::create_eq(l, r, nullptr);
+			default: break;
+		}
+		return ICmpInst::create_ne(l, r, nullptr);
+	}
+
+	// 插入到 bb 的终止指令之前
+	void insertBeforeTerminator(BasicBlock* bb, Instruction* inst)
+	{
+		bb->get_instructions().emplace_common_inst_from_end(inst, 1);
+		inst->set_parent(bb);
+	}
+
+	// inst 只被 a 或 b 使用
+	bool onlyUsedBy(const Value* inst, const Value* a, const Value* b)
+	{
+		for (auto& use : inst->get_use_list())
+			if (use.val_ != a && use.val_ != b) return false;
+		return true;
+	}
+
+	void eraseInst(Instruction* inst)
+	{
+		inst->remove_all_operands();
+		inst->get_parent()->erase_instr(inst);
+		delete inst;
+	}
+}
+
+void LinearFunctionTestReplace::run()
+{
+	PREPARE_PASS_MSG;
+	LOG(color::cyan("Run LinearFunctionTestReplace Pass"));
+	PUSH;
+	for (auto f : m_->get_functions())
+	{
+		if (f->is_lib_) continue;
+		f_ = f;
+		auto loops = manager_->getFuncInfo<LoopDetection>(f_);
+		bool changed = false;
+		for (auto l : loops->get_loops())
+		{
+			if (l->get_parent() != nullptr) continue;
+			changed |= runOnLoops(l->get_sub_loops());
+			loop_ = l;
+			changed |= runOnLoop();
+		}
+		if (changed) manager_->flushFuncInfo(f_);
+	}
+	POP;
+	PASS_SUFFIX;
+	LOG(color::cyan("LinearFunctionTestReplace Done"));
+}
+
+bool LinearFunctionTestReplace::runOnLoops(const std::vector<Loop*>& loops)
+{
+	bool ret = false;
+	for (auto loop : loops)
+	{
+		ret |= runOnLoops(loop->get_sub_loops());
+		loop_ = loop;
+		ret |= runOnLoop();
+	}
+	return ret;
+}
+
+bool LinearFunctionTestReplace::runOnLoop()
+{
+	auto header = loop_->get_header();
+	auto pre = loop_->get_preheader();
+	// getIterator 要求判断变量是循环头两个前驱的 phi, 条件是比较指令
+	auto br = header->get_terminator();
+	if (pre == nullptr || header->get_pre_basic_blocks().size() != 2 || br == nullptr || !br->is_br() ||
+		br->get_num_operand() != 3)
+		return false;
+	auto cond = dynamic_cast<Instruction*>(br->get_operand(0));
+	if (cond == nullptr || !cond->is_cmp()) return false;
+	auto msg = loop_->getIterator();
+	if (msg.notHaveIterator_ || msg.outIterateInsteadOfIn_ || msg.phiDefinedByOut_)
+	{
+		remark(Remarks::Missed, "NoCounter", "exit test not replaced",
+		       "the exit test does not compare an induction variable with a loop invariant");
+		return false;
+	}
+	auto phi = dynamic_cast<PhiInst*>(msg.iterator_);
+	auto cmp = msg.cmp_;
+	if (phi == nullptr || phi->get_parent() != header || phi->get_type() != Types::INT) return false;
+	auto pairs = phi->get_phi_pairs();
+	auto latch = pairs[0].second == pre ? pairs[1].second : pairs[0].second;
+	auto step = dynamic_cast<Instruction*>(phi->get_phi_val(latch));
+	if (step == nullptr || !(step->is_add() || step->is_sub()) ||
+		(step->get_operand(0) != phi && step->get_operand(1) != phi))
+		return false;
+	auto c = dynamic_cast<Constant*>(step->get_operand(step->get_operand(0) == phi ? 1 : 0));
+	if (c == nullptr || !c->isIntConstant() || (step->is_sub() && step->get_operand(0) != phi)) return false;
+	int stride = step->is_sub() ? -c->getIntConstant() : c->getIntConstant();
+	if (stride != 1 && stride != -1)
+	{
+		remark(Remarks::Missed, "NoCounter", "exit test not replaced", "the induction variable does not step by 1");
+		return false;
+	}
+	if (!onlyUsedBy(phi, cmp, step) || !onlyUsedBy(step, phi, phi) || !onlyUsedBy(cmp, br, br))
+	{
+		remark(Remarks::Missed, "NoCounter", "exit test not replaced",
+		       "the induction variable is used besides its exit test");
+		return false;
+	}
+
+	// 继续循环的条件, 归纳变量在左边
+	auto op = cmp->get_instr_type();
+	if (cmp->get_operand(0) != phi) op = swapCmpOp(op);
+	bool continueIfTrue = loop_->have(dynamic_cast<BasicBlock*>(br->get_operand(1)));
+	if (!continueIfTrue) op = invertCmpOp(op);
+	Value* start = msg.start_;
+	Value* end = msg.end_;
+	// 剩余次数 to - from, 比较包含等号时再加 1
+	Value* from;
+	Value* to;
+	if (stride == 1 && (op == Instruction::lt || op == Instruction::le || op == Instruction::ne))
+	{
+		from = start;
+		to = end;
+	}
+	else if (stride == -1 && (op == Instruction::gt || op == Instruction::ge || op == Instruction::ne))
+	{
+		from = end;
+		to = start;
+	}
+	else
+	{
+		remark(Remarks::Missed, "NoCounter", "exit test not replaced",
+		       "the induction variable does not move toward the bound");
+		return false;
+	}
+	LOG(color::green("Replace exit test ") + cmp->print());
+
+	auto one = Constant::create(m_, 1);
+	auto zero = Constant::create(m_, 0);
+	Value* count = IBinaryInst::create_sub(to, from, nullptr);
+	insertBeforeTerminator(pre, dynamic_cast<Instruction*>(count));
+	if (op == Instruction::le || op == Instruction::ge)
+	{
+		count = IBinaryInst::create_add(count, one, nullptr);
+		insertBeforeTerminator(pre, dynamic_cast<Instruction*>(count));
+	}
+	// 第一次判断就退出时次数为 0, != 的循环一定由次数减到 0 退出
+	if (op != Instruction::ne)
+	{
+		auto enter = createCmp(op, start, end);
+		insertBeforeTerminator(pre, enter);
+		count = SelectInst::create_select(enter, count, zero, nullptr);
+		insertBeforeTerminator(pre, dynamic_cast<Instruction*>(count));
+	}
+	auto counter = PhiInst::create_phi(Types::INT, header);
+	auto next = IBinaryInst::create_sub(counter, one, nullptr);
+	insertBeforeTerminator(latch, next);
+	counter->add_phi_pair_operand(count, pre);
+	counter->add_phi_pair_operand(next, latch);
+	auto test = continueIfTrue
+		            ? ICmpInst::create_ne(counter, zero, nullptr)
+		            : ICmpInst::create_eq(counter, zero, nullptr);
+	insertBeforeTerminator(header, test);
+	br->set_operand(0, test);
+	test->set_line(cmp->get_line());
+	eraseInst(cmp);
+	eraseInst(step);
+	eraseInst(phi);
+	remark(Remarks::Passed, "ExitTestReplaced", "exit test replaced by a down counter", "");
+	return true;
+}
+
+void LinearFunctionTestReplace::remark(Remarks::Kind kind, const char* name, const std::string& message,
+                                       const std::string& reason) const
+{
+	if (!Remarks::enabled(kind, "lftr")) return;
+	auto header = loop_->get_header();
+	Remarks::emit({
+		kind, "lftr", name, f_->get_name(), header->get_diagnostic_name(), header->get_source_line(), message,
+		reason
+	});
+}
@@ -12,6 +12,7 @@
 #include "Function.hpp"
 #include "Instruction.hpp"
 #include "PassManager.hpp"
+#include "Remarks.hpp"
 #include "Value.hpp"
 
 #define DEBUG 0
@@ -199,6 +200,8 @@ void LoopInvariantCodeMotion::run_on_loop(Loop* loop) const
 			{
 				if (dirtyValues.count(ptrFrom(inst->get_operand(0))))
 				{
+					remark(Remarks::Missed, "LoadClobbered", inst, "load not hoisted",
+					       "the loaded memory is written in the loop");
 					loop_variant.insert(inst);
 					it.remove_pre();
 					PUSH;
@@ -238,6 +241,8 @@ void LoopInvariantCodeMotion::run_on_loop(Loop* loop) const
 				auto func = dynamic_cast<Function*>(call->get_operand(0));
 				if (func_info_->useOrIsImpureLib(func))
 				{
+					remark(Remarks::Missed, "CallHasSideEffects", inst, "call to '" + func->get_name() + "' not hoisted",
+					       "it calls a library function with side effects");
 					PUSH;
 					LOG(color::yellow("Impure function call"));
 					POP;
@@ -247,6 +252,8 @@ void LoopInvariantCodeMotion::run_on_loop(Loop* loop) const
 				}
 				if (!func_info_->storeDetail(func).empty())
 				{
+					remark(Remarks::Missed, "CallWritesMemory", inst, "call to '" + func->get_name() + "' not hoisted",
+					       "it writes memory");
 					PUSH;
 					LOG(color::yellow("Dirty function call"));
 					POP;
@@ -284,6 +291,8 @@ void LoopInvariantCodeMotion::run_on_loop(Loop* loop) const
 				}
 				if (!ok)
 				{
+					remark(Remarks::Missed, "CallReadsClobbered", inst, "call to '" + func->get_name() + "' not hoisted",
+					       "it reads memory written in the loop");
 					PUSH;
 					LOG(color::yellow("Load dirty function call"));
 					POP;
@@ -364,6 +373,7 @@ void LoopInvariantCodeMotion::run_on_loop(Loop* loop) const
 		for (auto ins : invariant_as_list) // NOLINT(bugprone-nondeterministic-pointer-iteration-order)
 		{
 			LOG("From " + ins->get_parent()->get_name() + " to " + preheader->get_name());
+			remark(Remarks::Passed, "Hoisted", ins, ins->get_instr_op_name() + " hoisted out of the loop", "");
 			ins->get_parent()->erase_instr(ins);
 			preheader->add_instruction(ins);
 			ins->set_parent(preheader);
@@ -391,6 +401,7 @@ void LoopInvariantCodeMotion::run_on_loop(Loop* loop) const
 		for (auto ins : invariant_as_list) // NOLINT(bugprone-nondeterministic-pointer-iteration-order)
 		{
 			LOG("From " + ins->get_parent()->get_name() + " to " + preheader->get_name());
+			remark(Remarks::Passed, "Hoisted", ins, ins->get_instr_op_name() + " hoisted out of the loop", "");
 			ins->get_parent()->erase_instr(ins);
 			preheader->add_instruction(ins);
 			ins->set_parent(preheader);
@@ -400,3 +411,13 @@ void LoopInvariantCodeMotion::run_on_loop(Loop* loop) const
 	}
 	POP;
 }
+
+void LoopInvariantCodeMotion::remark(Remarks::Kind kind, const char* name, Instruction* inst,
+                                     const std::string& message, const std::string& reason)
+{
+	if (!Remarks::enabled(kind, "licm")) return;
+	auto bb = inst->get_parent();
+	Remarks::emit({
+		kind, "licm", name, bb->get_parent()->get_name(), bb->get_diagnostic_name(), inst->get_diagnostic_line(), message, reason
+	});
+}
@@ -3,6 +3,7 @@
 
 #define DEBUG 0
 #include "Config.hpp"
+#include "Remarks.hpp"
 #include "Util.hpp"
 using namespace std;
 
@@ -31,6 +32,9 @@ void LoopRotate::run()
 void LoopRotate::runOnFunc()
 {
 	LOG(color::cyan("Run LoopRotate On ") + f_->get_name());
+	f_->number_values();
+	vmap_.reset(f_);
+	phiReplace_.reset(f_);
 	auto lps = loops_->get_loops();
 	bool ret = false;
 	for (auto l : lps)
@@ -76,7 +80,7 @@ void LoopRotate::splicePreheader() const
 }
 
 void LoopRotate::copyInst2(const BasicBlock* enter, BasicBlock* from, BasicBlock* to,
-                           unordered_map<Value*, Value*>& v_map)
+                           ValueMap<Value*>& v_map)
 {
 	auto ed = to->get_instructions().back();
 	to->get_instructions().pop_back();
@@ -90,6 +94,7 @@ void LoopRotate::copyInst2(const BasicBlock* enter, BasicBlock* from, BasicBlock
 		auto cp = ins->copy(v_map);
 		if (cp != nullptr)
 		{
+			cp->set_line(ins->get_line());
 			cp->set_parent(to);
 			to->add_instruction(cp);
 		}
@@ -99,7 +104,7 @@ void LoopRotate::copyInst2(const BasicBlock* enter, BasicBlock* from, BasicBlock
 
 
 // 当旋转后, head 不能执行它的指令第二次, 而是应该推迟到 latch 执行
-void LoopRotate::moveHeadInst2Latch(const unordered_map<Value*, Value*>& v_map) const
+void LoopRotate::moveHeadInst2Latch(const ValueMap<Value*>& v_map)
 {
 	auto latch = loop_->get_latch();
 
@@ -119,7 +124,8 @@ void LoopRotate::moveHeadInst2Latch(const unordered_map<Value*, Value*>& v_map)
 	}
 
 	// 收集 phi 在循环内的值
-	unordered_map<Value*, Value*> moveDownInstPhiReplace;
+	auto& moveDownInstPhiReplace = phiReplace_;
+	moveDownInstPhiReplace.clear();
 	for (auto pi : loop_->get_header()->get_instructions().phi_and_allocas())
 	{
 		auto phi = dynamic_cast<PhiInst*>(pi);
@@ -130,7 +136,7 @@ void LoopRotate::moveHeadInst2Latch(const unordered_map<Value*, Value*>& v_map)
 	// 插入值的 Phi, 更改使用
 	for (auto i : needPhi)
 	{
-		auto outCorrespond = getOrDefault(v_map, i);
+		auto outCorrespond = getOrSelf(v_map, i);
 		auto phi = PhiInst::create_phi(i->get_type(), loop_->get_header());
 		phi->add_phi_pair_operand(outCorrespond, loop_->get_preheader());
 		phi->add_phi_pair_operand(i, latch);
@@ -153,9 +159,9 @@ void LoopRotate::moveHeadInst2Latch(const unordered_map<Value*, Value*>& v_map)
 		for (int i = 0; i < size; i++)
 		{
 			auto op = inst->get_operand(i);
-			if (moveDownInstPhiReplace.count(op))
+			if (auto rep = moveDownInstPhiReplace.find(op))
 			{
-				inst->set_operand(i, moveDownInstPhiReplace.at(op));
+				inst->set_operand(i, *rep);
 			}
 		}
 		it.remove_pre();
@@ -187,7 +193,7 @@ void LoopRotate::moveHeadInst2Latch(const unordered_map<Value*, Value*>& v_map)
 				auto bb = phi->get_operand(i + 1);
 				if (bb == loop_->get_header())
 				{
-					phi->set_operand(i, getOrDefault(moveDownInstPhiReplace, phi->get_operand(i)));
+					phi->set_operand(i, getOrSelf(moveDownInstPhiReplace, phi->get_operand(i)));
 					phi->set_operand(i + 1, latch);
 				}
 			}
@@ -200,29 +206,24 @@ void LoopRotate::moveHeadInst2Latch(const unordered_map<Value*, Value*>& v_map)
 	}
 }
 
-Value* LoopRotate::getOrDefault(const unordered_map<Value*, Value*>& vmap, Value* val)
-{
-	if (vmap.count(val)) return vmap.at(val);
-	return val;
-}
-
-void LoopRotate::toWhileTrue(const Loop::Iterator& msg) const
+void LoopRotate::toWhileTrue(const Loop::Iterator& msg)
 {
 	LOG(color::yellow("Loop To While True"));
 	auto pre = loop_->get_preheader();
 	auto pp = pre;
 	splicePreheader();
 	pre = loop_->get_preheader();
-	unordered_map<Value*, Value*> vmap;
+	auto& vmap = vmap_;
+	vmap.clear();
 	copyInst2(pre, loop_->get_header(), pp, vmap);
-	pp->reset_suc_basic_block(getOrDefault(vmap, msg.br_->get_operand(0)),
+	pp->reset_suc_basic_block(getOrSelf(vmap, msg.br_->get_operand(0)),
 	                          dynamic_cast<BasicBlock*>(msg.br_->get_operand(1)),
 	                          dynamic_cast<BasicBlock*>(msg.br_->get_operand(2)));
 	pp->redirect_suc_basic_block(msg.toLoop(loop_), pre);
 	for (auto inst : loop_->exits().at(loop_->get_header())->get_instructions().phi_and_allocas())
 	{
 		auto phi = dynamic_cast<PhiInst*>(inst);
-		dynamic_cast<PhiInst*>(inst)->add_phi_pair_operand(getOrDefault(vmap, phi->get_phi_val(loop_->get_header())),
+		dynamic_cast<PhiInst*>(inst)->add_phi_pair_operand(getOrSelf(vmap, phi->get_phi_val(loop_->get_header())),
 		                                                   pp);
 		dynamic_cast<PhiInst*>(inst)->remove_phi_operand(loop_->get_header());
 	}
@@ -233,23 +234,24 @@ void LoopRotate::toWhileTrue(const Loop::Iterator& msg) const
 	LOG(color::green("Get ") + loop_->print());
 }
 
-void LoopRotate::erasePhi(const Loop::Iterator& msg) const
+void LoopRotate::erasePhi(const Loop::Iterator& msg)
 {
 	LOG(color::yellow("Erase Loop Phi"));
 	auto pre = loop_->get_preheader();
 	auto pp = pre;
 	splicePreheader();
 	pre = loop_->get_preheader();
-	unordered_map<Value*, Value*> vmap;
+	auto& vmap = vmap_;
+	vmap.clear();
 	copyInst2(pre, loop_->get_header(), pp, vmap);
-	pp->reset_suc_basic_block(getOrDefault(vmap, msg.br_->get_operand(0)),
+	pp->reset_suc_basic_block(getOrSelf(vmap, msg.br_->get_operand(0)),
 	                          dynamic_cast<BasicBlock*>(msg.br_->get_operand(1)),
 	                          dynamic_cast<BasicBlock*>(msg.br_->get_operand(2)));
 	pp->redirect_suc_basic_block(msg.toLoop(loop_), pre);
 	for (auto inst : loop_->exits().at(loop_->get_header())->get_instructions().phi_and_allocas())
 	{
 		auto phi = dynamic_cast<PhiInst*>(inst);
-		dynamic_cast<PhiInst*>(inst)->add_phi_pair_operand(getOrDefault(vmap, phi->get_phi_val(loop_->get_header())),
+		dynamic_cast<PhiInst*>(inst)->add_phi_pair_operand(getOrSelf(vmap, phi->get_phi_val(loop_->get_header())),
 		                                                   pp);
 	}
 	msg.cmp_->replaceAllOperandMatchs(msg.iterator_, msg.toLoopIterateValue(loop_));
@@ -258,23 +260,24 @@ void LoopRotate::erasePhi(const Loop::Iterator& msg) const
 	LOG(color::green("Get ") + loop_->print());
 }
 
-void LoopRotate::rotate(const Loop::Iterator& msg) const
+void LoopRotate::rotate(const Loop::Iterator& msg)
 {
 	LOG(color::yellow("Rotate Loop"));
 	auto pre = loop_->get_preheader();
 	auto pp = pre;
 	splicePreheader();
 	pre = loop_->get_preheader();
-	unordered_map<Value*, Value*> vmap;
+	auto& vmap = vmap_;
+	vmap.clear();
 	copyInst2(pre, loop_->get_header(), pp, vmap);
-	pp->reset_suc_basic_block(getOrDefault(vmap, msg.br_->get_operand(0)),
+	pp->reset_suc_basic_block(getOrSelf(vmap, msg.br_->get_operand(0)),
 	                          dynamic_cast<BasicBlock*>(msg.br_->get_operand(1)),
 	                          dynamic_cast<BasicBlock*>(msg.br_->get_operand(2)));
 	pp->redirect_suc_basic_block(msg.toLoop(loop_), pre);
 	for (auto inst : loop_->exits().at(loop_->get_header())->get_instructions().phi_and_allocas())
 	{
 		auto phi = dynamic_cast<PhiInst*>(inst);
-		dynamic_cast<PhiInst*>(inst)->add_phi_pair_operand(getOrDefault(vmap, phi->get_phi_val(loop_->get_header())),
+		dynamic_cast<PhiInst*>(inst)->add_phi_pair_operand(getOrSelf(vmap, phi->get_phi_val(loop_->get_header())),
 		                                                   pp);
 	}
 	moveHeadInst2Latch(vmap);
@@ -282,7 +285,7 @@ void LoopRotate::rotate(const Loop::Iterator& msg) const
 	LOG(color::green("Get ") + loop_->print());
 }
 
-void LoopRotate::forceRotate() const
+void LoopRotate::forceRotate()
 {
 	LOG(color::yellow("ForceRotate Loop"));
 	auto head = loop_->get_header();
@@ -291,17 +294,18 @@ void LoopRotate::forceRotate() const
 	auto pp = pre;
 	splicePreheader();
 	pre = loop_->get_preheader();
-	unordered_map<Value*, Value*> vmap;
+	auto& vmap = vmap_;
+	vmap.clear();
 	copyInst2(pre, loop_->get_header(), pp, vmap);
 	auto b1 = dynamic_cast<BasicBlock*>(br->get_operand(1));
 	auto b2 = dynamic_cast<BasicBlock*>(br->get_operand(2));
-	pp->reset_suc_basic_block(getOrDefault(vmap, br->get_operand(0)), b1, b2);
+	pp->reset_suc_basic_block(getOrSelf(vmap, br->get_operand(0)), b1, b2);
 	if (b1 == loop_->exits().at(head)) b1 = b2;
 	pp->redirect_suc_basic_block(b1, pre);
 	for (auto inst : loop_->exits().at(loop_->get_header())->get_instructions().phi_and_allocas())
 	{
 		auto phi = dynamic_cast<PhiInst*>(inst);
-		dynamic_cast<PhiInst*>(inst)->add_phi_pair_operand(getOrDefault(vmap, phi->get_phi_val(loop_->get_header())),
+		dynamic_cast<PhiInst*>(inst)->add_phi_pair_operand(getOrSelf(vmap, phi->get_phi_val(loop_->get_header())),
 		                                                   pp);
 	}
 	moveHeadInst2Latch(vmap);
@@ -309,7 +313,7 @@ void LoopRotate::forceRotate() const
 	LOG(color::green("Get ") + loop_->print());
 }
 
-bool LoopRotate::runOnLoop() const
+bool LoopRotate::runOnLoop()
 {
 	LOG("");
 	LOG(color::blue("Run On Loop ") + loop_->print());
@@ -317,6 +321,7 @@ bool LoopRotate::runOnLoop() const
 	auto pre = loop_->get_preheader();
 	if (pre == nullptr)
 	{
+		remark(Remarks::Missed, "NoPreheader", "loop not rotated", "it has no preheader");
 		POP;
 		return false;
 	}
@@ -326,26 +331,36 @@ bool LoopRotate::runOnLoop() const
 	{
 		if (!rotateLoopEvenIfNotHaveInvariant)
 		{
+			if (Remarks::enabled(Remarks::Missed, "loop-rotate"))
+				remark(Remarks::Missed, "TooFewInvariants", "loop not rotated",
+				       "its preheader has " + std::to_string(pre->get_instructions().commonInstSize() - 1) +
+				       " hoisted instructions, fewer than invariantNeed2RotateLoop (" +
+				       std::to_string(invariantNeed2RotateLoop) + ")");
 			POP;
 			return false;
 		}
 		if (msg.notHaveIterator_)
 		{
+			remark(Remarks::Missed, "NoIterator", "loop not rotated", "no induction variable decides the exit");
 			POP;
 			return false;
 		}
 		if (msg.outIterateInsteadOfIn_)
 		{
+			remark(Remarks::Passed, "Rotated", "loop rotated into guard + while(true)", "");
 			toWhileTrue(msg);
 			POP;
 			return true;
 		}
 		if (msg.phiDefinedByOut_)
 		{
+			remark(Remarks::Passed, "Rotated", "loop rotated, the header phi is removed", "");
 			erasePhi(msg);
 			POP;
 			return true;
 		}
+		remark(Remarks::Missed, "NotRotatable", "loop not rotated",
+		       "the exit condition depends on values computed in the loop");
 		POP;
 		return false;
 	}
@@ -354,18 +369,43 @@ bool LoopRotate::runOnLoop() const
 	{
 		if (loop_->exits().count(loop_->get_header()))
 		{
+			remark(Remarks::Passed, "Rotated", "loop rotated without a guard", "");
 			forceRotate();
 			POP;
 			return true;
 		}
+		remark(Remarks::Missed, "NoIterator", "loop not rotated",
+		       "no induction variable decides the exit and the header does not exit the loop");
 		POP;
 		return false;
 	}
 	// 插入 guard, 改为 while true
-	if (msg.outIterateInsteadOfIn_) toWhileTrue(msg);
+	if (msg.outIterateInsteadOfIn_)
+	{
+		remark(Remarks::Passed, "Rotated", "loop rotated into guard + while(true)", "");
+		toWhileTrue(msg);
+	}
 		// 插入 guard, 消除 phi
-	else if (msg.phiDefinedByOut_) erasePhi(msg);
+	else if (msg.phiDefinedByOut_)
+	{
+		remark(Remarks::Passed, "Rotated", "loop rotated, the header phi is removed", "");
+		erasePhi(msg);
+	}
 	//else rotate(msg);
+	else
+		remark(Remarks::Missed, "NotRotatable", "loop not rotated",
+		       "the exit condition depends on values computed in the loop");
 	POP;
 	return true;
 }
+
+void LoopRotate::remark(Remarks::Kind kind, const char* name, const std::string& message,
+                        const std::string& reason) const
+{
+	if (!Remarks::enabled(kind, "loop-rotate")) return;
+	auto header = loop_->get_header();
+	Remarks::emit({
+		kind, "loop-rotate", name, f_->get_name(), header->get_diagnostic_name(), header->get_source_line(), message,
+		reason
+	});
+}
@@ -37,7 +37,9 @@ void SCCP::run(Function* f)
 {
 	GAP;
 	LOG(color::green("Run SCCP on function "+f->get_name()));
-	value_map.clear();
+	f->number_values();
+	value_map.reset(f);
+	executable.reset(f);
 	visited.clear();
 	flow_worklist.clear();
 	value_worklist.clear();
@@ -69,9 +71,9 @@ void SCCP::run(Function* f)
 			std::tie(pre, cur) = flow_worklist[flow_id++];
 			LOG(color::pink("Visiting basic block "+std::to_string(flow_id)+
 				"/"+std::to_string(flow_worklist.size())));
-			if (visited.count({pre, cur}))
+			if (!visited.insert({pre, cur}).second)
 				continue;
-			visited.insert({pre, cur});
+			executable[cur] = true;
 			for (auto i : cur->get_instructions())
 				visitor_->visit(i);
 		}
@@ -79,15 +81,8 @@ void SCCP::run(Function* f)
 		while (value_id < u2iNegThrow(value_worklist.size()))
 		{
 			auto inst = value_worklist[value_id++];
-			auto bb = inst->get_parent();
-			for (auto pre : bb->get_pre_basic_blocks())
-			{
-				if (visited.count({pre, bb}))
-				{
-					visitor_->visit(inst);
-					break;
-				}
-			}
+			if (executable.get_or(inst->get_parent(), false))
+				visitor_->visit(inst);
 		}
 	}
 	// 常量传播
@@ -261,6 +256,8 @@ void SCCPVisitor::visit(Instruction* i)
 		visit_br(dynamic_cast<BranchInst*>(i));
 	else if (i->is_phi())
 		visit_phi(dynamic_cast<PhiInst*>(i));
+	else if (i->is_select())
+		visit_select(dynamic_cast<SelectInst*>(i));
 	else if (IS_BINARY(i) || IS_UNARY(i))
 		visit_fold(i);
 	else
@@ -325,6 +322,23 @@ void SCCPVisitor::visit_phi(PhiInst* i)
 	LOG(color::green(i->get_name())+" is "+ cur_.print());
 }
 
+void SCCPVisitor::visit_select(const SelectInst* i)
+{
+	LOG(color::cyan("Visiting Select: ")+ i->print());
+	auto cond = val_map.get(i->get_cond());
+	if (cond.is_const())
+	{
+		cur_ = val_map.get(cond.const_val_->getBoolConstant() ? i->get_true_value() : i->get_false_value());
+		LOG(color::green(i->get_name())+" is "+ cur_.print());
+		return;
+	}
+	// 条件不是常数时与 phi 相同, 两个值是相同的常数才是常数
+	cur_ = cond.not_const() ? ValStatus{ValStatus::INIT, nullptr} : cond;
+	cur_ &= val_map.get(i->get_true_value());
+	cur_ &= val_map.get(i->get_false_value());
+	LOG(color::green(i->get_name())+" is "+ cur_.print());
+}
+
 void SCCPVisitor::visit_br(const BranchInst* i)
 {
 	if (!i->is_cond_br())
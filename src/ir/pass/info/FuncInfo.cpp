@@ -37,9 +37,11 @@ FuncInfo::FuncInfo(PassManager* mng, Module* m): GlobalInfoPass(mng, m)
 
 void FuncInfo::run()
 {
-	std::unordered_map<Value*, Value*> spMap;
+	// 每次分析只编号一次, flush 复用这张表; 之后新建或重新编号的值退回到哈希表
+	m_->number_values();
+	spMap_.reset(m_);
 	for (auto glob : m_->get_global_variable())
-		spread(glob, spMap);
+		spread(glob, spMap_);
 	std::queue<Function*> worklist;
 	std::unordered_set<Function*> visited;
 	for (auto& func : m_->get_functions())
@@ -52,7 +54,7 @@ void FuncInfo::run()
 		{
 			if (arg->get_type()->isPointerType())
 			{
-				spread(arg, spMap);
+				spread(arg, spMap_);
 			}
 		}
 	}
@@ -78,9 +80,9 @@ void FuncInfo::run()
 				if (arg->get_type()->isPointerType())
 				{
 					auto carg = ops[arg->get_arg_no() + 1];
-					auto traceP = spMap.find(carg);
-					if (traceP == spMap.end()) continue;
-					auto trace = traceP->second;
+					auto traceP = spMap_.find(carg);
+					if (traceP == nullptr) continue;
+					auto trace = *traceP;
 					if (rld.have(arg)) lld.add(trace);
 					if (rst.have(arg)) lst.add(trace);
 				}
@@ -153,9 +155,9 @@ void FuncInfo::flushAbout(std::unordered_set<Function*>& f)
 			}
 		}
 	}
-	std::unordered_map<Value*, Value*> spMap;
+	spMap_.clear();
 	for (auto glob : m_->get_global_variable())
-		spreadGlobalIn(glob, spMap, f);
+		spreadGlobalIn(glob, spMap_, f);
 	std::unordered_set<Function*> visited;
 	for (auto& func : f)
 	{
@@ -165,7 +167,7 @@ void FuncInfo::flushAbout(std::unordered_set<Function*>& f)
 		{
 			if (arg->get_type()->isPointerType())
 			{
-				spread(arg, spMap);
+				spread(arg, spMap_);
 			}
 		}
 	}
@@ -191,9 +193,9 @@ void FuncInfo::flushAbout(std::unordered_set<Function*>& f)
 				if (arg->get_type()->isPointerType())
 				{
 					auto carg = ops[arg->get_arg_no() + 1];
-					auto traceP = spMap.find(carg);
-					if (traceP == spMap.end()) continue;
-					auto trace = traceP->second;
+					auto traceP = spMap_.find(carg);
+					if (traceP == nullptr) continue;
+					auto trace = *traceP;
 					if (rld.have(arg)) lld.add(trace);
 					if (rst.have(arg)) lst.add(trace);
 				}
@@ -275,9 +277,9 @@ void FuncInfo::flushLoadsAbout(std::unordered_set<Function*>& f)
 			}
 		}
 	}
-	std::unordered_map<Value*, Value*> spMap;
+	spMap_.clear();
 	for (auto glob : m_->get_global_variable())
-		spreadLoadsIn(glob, spMap, f);
+		spreadLoadsIn(glob, spMap_, f);
 	std::unordered_set<Function*> visited;
 	for (auto& func : f)
 	{
@@ -287,7 +289,7 @@ void FuncInfo::flushLoadsAbout(std::unordered_set<Function*>& f)
 		{
 			if (arg->get_type()->isPointerType())
 			{
-				spreadLoadsIn(arg, spMap, f);
+				spreadLoadsIn(arg, spMap_, f);
 			}
 		}
 	}
@@ -310,9 +312,9 @@ void FuncInfo::flushLoadsAbout(std::unordered_set<Function*>& f)
 				if (arg->get_type()->isPointerType())
 				{
 					auto carg = ops[arg->get_arg_no() + 1];
-					auto traceP = spMap.find(carg);
-					if (traceP == spMap.end()) continue;
-					auto trace = traceP->second;
+					auto traceP = spMap_.find(carg);
+					if (traceP == nullptr) continue;
+					auto trace = *traceP;
 					if (rld.have(arg)) lld.add(trace);
 				}
 			}
@@ -350,7 +352,7 @@ bool FuncInfo::useOrIsImpureLib(Function* function)
 	return useImpureLibs[function];
 }
 
-void FuncInfo::spread(Value* val, std::unordered_map<Value*, Value*>& spMap)
+void FuncInfo::spread(Value* val, ValueMap<Value*>& spMap)
 {
 	auto glob = dynamic_cast<GlobalVariable*>(val);
 	if (glob != nullptr && glob->is_const()) return;
@@ -437,7 +439,7 @@ void FuncInfo::spread(Value* val, std::unordered_map<Value*, Value*>& spMap)
 	}
 }
 
-void FuncInfo::spreadLoadsIn(Value* val, std::unordered_map<Value*, Value*>& spMap, std::unordered_set<Function*>& fs)
+void FuncInfo::spreadLoadsIn(Value* val, ValueMap<Value*>& spMap, std::unordered_set<Function*>& fs)
 {
 	auto glob = dynamic_cast<GlobalVariable*>(val);
 	if (glob != nullptr && glob->is_const()) return;
@@ -515,7 +517,7 @@ void FuncInfo::spreadLoadsIn(Value* val, std::unordered_map<Value*, Value*>& spM
 	}
 }
 
-void FuncInfo::spreadGlobalIn(Value* val, std::unordered_map<Value*, Value*>& spMap, std::unordered_set<Function*>& fs)
+void FuncInfo::spreadGlobalIn(Value* val, ValueMap<Value*>& spMap, std::unordered_set<Function*>& fs)
 {
 	std::unordered_set<Value*> visited;
 	std::queue<Value*> q;
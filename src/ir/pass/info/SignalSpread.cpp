@@ -74,6 +74,7 @@ void SignalSpread::signalSpread()
 				case Instruction::fdiv:
 				case Instruction::load:
 				case Instruction::phi:
+				case Instruction::select:
 				case Instruction::fptosi:
 				case Instruction::sitofp:
 				case Instruction::call:
@@ -155,6 +156,9 @@ void SignalSpread::signalSpread()
 		case Instruction::phi:
 			spreadPhi(work);
 			break;
+		case Instruction::select:
+			spreadSelect(work);
+			break;
 		case Instruction::fptosi:
 			spreadFP2SI(work);
 			break;
@@ -511,6 +515,12 @@ void SignalSpread::spreadPhi(Instruction* inst)
 	if (sig != 0) spreadUseIfSetSig(inst, sig);
 }
 
+void SignalSpread::spreadSelect(Instruction* inst)
+{
+	auto sig = signalOf2Spread(inst->get_operand(1)) | signalOf2Spread(inst->get_operand(2));
+	if (sig != 0) spreadUseIfSetSig(inst, sig);
+}
+
 void SignalSpread::spreadFP2SI(Instruction* inst)
 {
 	auto sig0 = signalOf2Spread(inst->get_operand(0));
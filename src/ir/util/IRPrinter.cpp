@@ -109,6 +109,8 @@ std::string print_instr_op_name(Instruction::OpID id)
 			return "fptosi";
 		case Instruction::sitofp:
 			return "sitofp";
+		case Instruction::select:
+			return "select";
 		case Instruction::global_fix:
 			return "globalFix";
 		case Instruction::nump2charp:
@@ -406,6 +408,22 @@ std::string ZextInst::print()
 	return instr_ir;
 }
 
+std::string SelectInst::print()
+{
+	std::string instr_ir;
+	instr_ir += "%";
+	instr_ir += this->get_name();
+	instr_ir += " = ";
+	instr_ir += get_instr_op_name();
+	instr_ir += " ";
+	instr_ir += print_as_op(this->get_operand(0), true);
+	instr_ir += ", ";
+	instr_ir += print_as_op(this->get_operand(1), true);
+	instr_ir += ", ";
+	instr_ir += print_as_op(this->get_operand(2), true);
+	return instr_ir;
+}
+
 std::string FpToSiInst::print()
 {
 	std::string instr_ir;
@@ -23,6 +23,74 @@ namespace
 		if (instruction->is_fcmp()) return static_cast<Instruction::OpID>(ty - 6);
 		return ty;
 	}
+
+	Instruction::OpID invertCmpOp(Instruction::OpID op)
+	{
+		switch (op) // NOLINT(clang-diagnostic-switch-enum)
+		{
+			case Instruction::ge: return Instruction::lt;
+			case Instruction::gt: return Instruction::le;
+			case Instruction::le: return Instruction::gt;
+			case Instruction::lt: return Instruction::ge;
+			case Instruction::eq: return Instruction::ne;
+			case Instruction::ne: return Instruction::eq;
+			default: break;
+		}
+		ASSERT(false);
+		return op;
+	}
+
+	// inst 是 base + 1 时返回 CSINC, 是 0 - base 时返回 CSNEG, 否则返回 SELECT
+	MCSEL::Kind foldKind(const Value* inst, const Value* base, const SelectInst* select)
+	{
+		auto i = dynamic_cast<const Instruction*>(inst);
+		if (i == nullptr || i->get_type() != Types::INT || i->get_parent() != select->get_parent() ||
+			i->get_use_list().size() != 1)
+			return MCSEL::SELECT;
+		auto c = dynamic_cast<const Constant*>(i->get_operand(i->is_sub() ? 0 : 1));
+		if (c == nullptr || !c->isIntConstant()) return MCSEL::SELECT;
+		if (i->is_add() && c->getIntConstant() == 1 && i->get_operand(0) == base) return MCSEL::INCREMENT;
+		if (i->is_sub() && c->getIntConstant() == 0 && i->get_operand(1) == base) return MCSEL::NEGATE;
+		return MCSEL::SELECT;
+	}
+
+	// select 的一个操作数由另一个加 1 或取负得到时, 两者合并为一条 CSINC 或 CSNEG, 返回被合并而不必翻译的指令.
+	// base 是剩下的操作数, inverse 表示条件需要取反
+	const Value* selectFold(const SelectInst* select, Value*& base, MCSEL::Kind& kind, bool& inverse)
+	{
+		auto t = select->get_true_value();
+		auto f = select->get_false_value();
+		base = t;
+		inverse = false;
+		kind = foldKind(f, t, select);
+		if (kind != MCSEL::SELECT) return f;
+		kind = foldKind(t, f, select);
+		if (kind == MCSEL::SELECT) return nullptr;
+		base = f;
+		inverse = true;
+		return t;
+	}
+
+	// 指令是否被合并进了使用它的 select
+	bool foldedIntoSelect(const Instruction* instruction)
+	{
+		if (instruction->get_use_list().size() != 1) return false;
+		auto select = dynamic_cast<const SelectInst*>(instruction->get_use_list().front().val_);
+		if (select == nullptr || dynamic_cast<const Constant*>(select->get_cond()) != nullptr) return false;
+		Value* base;
+		MCSEL::Kind kind;
+		bool inverse;
+		return selectFold(select, base, kind, inverse) == instruction;
+	}
+
+	// 比较的使用者都是 select 时, 比较在每个 select 前重新生成
+	bool onlySelectUse(const Instruction* instruction)
+	{
+		if (instruction->get_use_list().empty()) return false;
+		for (auto& use : instruction->get_use_list())
+			if (dynamic_cast<const SelectInst*>(use.val_) == nullptr) return false;
+		return true;
+	}
 }
 
 
@@ -89,6 +157,9 @@ void MBasicBlock::accept(BasicBlock* block,
 			case Instruction::zext:
 				acceptZextInst(inst, opMap, this);
 				break;
+			case Instruction::select:
+				acceptSelectInst(inst, opMap, this);
+				break;
 			case Instruction::fptosi:
 				acceptFpToSiInst(inst, opMap, this);
 				break;
@@ -162,6 +233,7 @@ void MBasicBlock::acceptBranchInst(Instruction* instruction, std::map<BasicBlock
 
 void MBasicBlock::acceptMathInst(Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block)
 {
+	if (foldedIntoSelect(instruction)) return;
 	auto l0 = instruction->get_operand(0);
 	auto r0 = instruction->get_operand(1);
 	auto l = block->function()->getOperandFor(l0, opMap);
@@ -232,6 +304,7 @@ void MBasicBlock::acceptStoreInst(const Instruction* instruction, std::map<Value
 
 void MBasicBlock::acceptCmpInst(const Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block)
 {
+	if (onlySelectUse(instruction)) return;
 	auto l = block->function()->getOperandFor(instruction->get_operand(0), opMap);
 	auto r = block->function()->getOperandFor(instruction->get_operand(1), opMap);
 	auto ret = new MCMP{block, l, r, instruction->get_operand(0)->get_type() != Types::FLOAT};
@@ -684,6 +757,51 @@ void MBasicBlock::acceptZextInst(Instruction* instruction, std::map<Value*, MOpe
 	instructions_.emplace_back(cmp);
 }
 
+void MBasicBlock::acceptSelectInst(Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block)
+{
+	auto select = dynamic_cast<SelectInst*>(instruction);
+	auto t = dynamic_cast<VirtualRegister*>(function()->getOperandFor(instruction, opMap));
+	ASSERT(t != nullptr);
+	t->sinked = true;
+	auto cond = select->get_cond();
+	if (auto c = dynamic_cast<Constant*>(cond); c != nullptr)
+	{
+		auto v = c->getBoolConstant() ? select->get_true_value() : select->get_false_value();
+		instructions_.emplace_back(new MCopy{block, function()->getOperandFor(v, opMap), t, 32});
+		return;
+	}
+	auto cmpInst = dynamic_cast<Instruction*>(cond);
+	ASSERT(cmpInst != nullptr && (cmpInst->is_cmp() || cmpInst->is_fcmp()));
+	// 比较可能已被 CmpCombine 移到基本块末尾, 在此按它的操作数重新生成.
+	// 连续的 select 使用相同的比较时共用一条 MCMP
+	auto l = function()->getOperandFor(cmpInst->get_operand(0), opMap);
+	auto r = function()->getOperandFor(cmpInst->get_operand(1), opMap);
+	bool itff = cmpInst->get_operand(0)->get_type() != Types::FLOAT;
+	MCMP* cmp = nullptr;
+	if (auto last = instructions_.empty() ? nullptr : dynamic_cast<MCSEL*>(instructions_.back()); last != nullptr)
+	{
+		auto pre = last->tiedWith_;
+		if (pre->operand(0) == l && pre->operand(1) == r && pre->itff_ == itff) cmp = pre;
+	}
+	if (cmp == nullptr)
+	{
+		cmp = new MCMP{block, l, r, itff};
+		instructions_.emplace_back(cmp);
+	}
+	Value* base;
+	MCSEL::Kind kind;
+	bool inverse;
+	auto folded = selectFold(select, base, kind, inverse);
+	auto op = asCmpGetOp(cmpInst);
+	if (inverse) op = invertCmpOp(op);
+	auto a = function()->getOperandFor(base, opMap);
+	auto b = folded == nullptr ? function()->getOperandFor(select->get_false_value(), opMap) : a;
+	auto sel = new MCSEL{block, op, kind, t, a, b, 32};
+	cmp->tiedS_.emplace_back(sel);
+	sel->tiedWith_ = cmp;
+	instructions_.emplace_back(sel);
+}
+
 void MBasicBlock::acceptFpToSiInst(Instruction* instruction, std::map<Value*, MOperand*>& opMap, MBasicBlock* block)
 {
 	auto fp = function()->getOperandFor(instruction->get_operand(0), opMap);
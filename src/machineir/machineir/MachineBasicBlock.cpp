@@ -101,7 +101,8 @@ int MBasicBlock::collapseBranch()
 	if (l == r)
 	{
 		b->removeR();
-		if (b->tiedWith_->tiedC_ == nullptr)
+		// FlagFold 删除比较后 NZCV 由 ADDS/SUBS/ANDS 设置, 它的结果可能还有其他使用
+		if (b->tiedWith_ != nullptr && b->tiedWith_->tiedC_ == nullptr)
 		{
 			c = b->tiedWith_->str->lines();
 			removeInst(b->tiedWith_);
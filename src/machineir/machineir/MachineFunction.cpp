@@ -33,6 +33,30 @@ MFunction::~MFunction()
 	delete funcPrefix_;
 }
 
+void MFunction::releaseBody()
+{
+	for (auto bb : blocks_) delete bb;
+	for (auto [i, j] : ba_cache_) delete j;
+	for (auto i : stack_) delete i;
+	for (auto i : virtual_iregs_) delete i;
+	for (auto i : virtual_fregs_) delete i;
+	delete funcSuffix_;
+	delete funcPrefix_;
+	funcSuffix_ = nullptr;
+	funcPrefix_ = nullptr;
+	lrGuard_ = nullptr;
+	// 用 swap 归还容量, clear 不释放内存
+	vector<MBasicBlock*>().swap(blocks_);
+	map<MBasicBlock*, BlockAddress*>().swap(ba_cache_);
+	vector<FrameIndex*>().swap(stack_);
+	vector<VirtualRegister*>().swap(virtual_iregs_);
+	vector<VirtualRegister*>().swap(virtual_fregs_);
+	unordered_map<MOperand*, unordered_set<MInstruction*>>().swap(useList_);
+	vector<MBL*>().swap(calls_);
+	unordered_set<GlobalAddress*>().swap(constGlobals_);
+	string().swap(sizeSuffix_);
+}
+
 MFunction::MFunction(std::string name, MModule* module)
 	: module_(module),
 	  name_(std::move(name))
@@ -118,6 +142,7 @@ void MFunction::accept(Function* function, std::map<Function*, MFunction*>& func
 		ASSERT(bb != nullptr);
 		const auto mbb = MBasicBlock::createBasicBlock(name_ + "_" + bb->get_name() + "_" + to_string(bbc), this);
 		mbb->id_ = bbc++;
+		mbb->line_ = bb->get_source_line();
 		blocks_.emplace_back(mbb);
 		cache.emplace(bb, mbb);
 	}
@@ -384,6 +409,21 @@ void MFunction::spill(VirtualRegister* vreg, LiveMessage* message)
 	}
 }
 
+void MFunction::removeBlock(MBasicBlock* bb)
+{
+	ASSERT(bb->instructions_.empty() && bb->pre_bbs_.empty());
+	blocks_.erase(std::find(blocks_.begin(), blocks_.end(), bb));
+	if (auto fd = ba_cache_.find(bb); fd != ba_cache_.end())
+	{
+		useList_.erase(fd->second);
+		delete fd->second;
+		ba_cache_.erase(fd);
+	}
+	delete bb;
+	int id = 0;
+	for (auto i : blocks_) i->id_ = id++;
+}
+
 void MFunction::replaceAllOperands(MOperand* from, MOperand* to)
 {
 	for (auto i : useList_[from])
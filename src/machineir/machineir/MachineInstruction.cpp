@@ -382,10 +382,31 @@ MInstruction* MMathInst::createOptimizedNNegMul(MBasicBlock* block,  MOperand* l
 	return new MMathInst{block, Instruction::mul, l, r, t, width};
 }
 
+std::string printShift(OperandShift shift, int amount)
+{
+	switch (shift)
+	{
+		case OperandShift::lsl: return "LSL #" + to_string(amount);
+		case OperandShift::asr: return "ASR #" + to_string(amount);
+		case OperandShift::sxtw: return amount == 0 ? "SXTW" : "SXTW #" + to_string(amount);
+		case OperandShift::none: break;
+	}
+	return "";
+}
+
+void MMathInst::setFlags()
+{
+	ASSERT(!setFlags_);
+	setFlags_ = true;
+	imp_def_.emplace_back(Register::getNZCV(block_->module()));
+}
+
 std::string MMathInst::print()
 {
-	return operands_[0]->print() + " = " + print_instr_op_name(op_) + " " + operands_[1]->print() + " " + operands_[2]->
-	       print() + " [" + to_string(width_) + "]";
+	auto r = operands_[2]->print();
+	if (shift_ != OperandShift::none) r += " " + printShift(shift_, shiftAmount_);
+	return operands_[0]->print() + " = " + print_instr_op_name(op_) + " " + operands_[1]->print() + " " + r + " [" +
+	       to_string(width_) + "]" + (setFlags_ ? "\t\t\t;imp_def NZCV" : "");
 }
 
 MLDR::MLDR(MBasicBlock* block, MOperand* regLike, MOperand* stackLike, int width): MInstruction(block),
@@ -445,6 +466,127 @@ void MSTR::stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent)
 		use_.pop_back();
 }
 
+MIndexedMem::MIndexedMem(MBasicBlock* block, MOperand* regLike, MOperand* base, MOperand* offset, int width,
+                         int shift, bool sxtw, bool isLoad) : MInstruction(block), width_(width), shift_(shift),
+                                                              sxtw_(sxtw), firstUse_(isLoad ? 1 : 0)
+{
+	operands_.resize(3);
+	operands_[0] = regLike;
+	operands_[1] = base;
+	operands_[2] = offset;
+	if (isLoad) def_.emplace_back(0);
+	resetUses();
+	auto func = block->function();
+	func->addUse(regLike, this);
+	func->addUse(base, this);
+	func->addUse(offset, this);
+}
+
+void MIndexedMem::resetUses()
+{
+	use_.clear();
+	for (int i = firstUse_; i < 3; i++)
+	{
+		bool same = false;
+		for (auto u : use_) same = same || operands_[u] == operands_[i];
+		if (!same) use_.emplace_back(i);
+	}
+}
+
+std::string MIndexedMem::printAddress() const
+{
+	auto ret = "[" + operands_[1]->print() + ", " + operands_[2]->print();
+	if (dynamic_cast<Immediate*>(operands_[2]) == nullptr)
+		ret += string{sxtw_ ? " SXTW" : " LSL"} + " #" + to_string(shift_);
+	return ret + "] [" + to_string(width_) + "]";
+}
+
+void MIndexedMem::replace(MOperand* from, MOperand* to, MFunction* parent)
+{
+	MInstruction::replace(from, to, parent);
+	resetUses();
+}
+
+void MIndexedMem::onlyAddUseReplace(const MOperand* from, MOperand* to, MFunction* parent)
+{
+	MInstruction::onlyAddUseReplace(from, to, parent);
+	resetUses();
+}
+
+void MIndexedMem::stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent)
+{
+	MInstruction::stayUseReplace(from, to, parent);
+	resetUses();
+}
+
+MLDRIdx::MLDRIdx(MBasicBlock* block, MOperand* regLike, MOperand* base, MOperand* offset, int width, int shift,
+                 bool sxtw) : MIndexedMem(block, regLike, base, offset, width, shift, sxtw, true)
+{
+}
+
+std::string MLDRIdx::print()
+{
+	return operands_[0]->print() + " = LDR " + printAddress();
+}
+
+MSTRIdx::MSTRIdx(MBasicBlock* block, MOperand* regLike, MOperand* base, MOperand* offset, int width, int shift,
+                 bool sxtw) : MIndexedMem(block, regLike, base, offset, width, shift, sxtw, false)
+{
+}
+
+std::string MSTRIdx::print()
+{
+	return "STR " + operands_[0]->print() + " " + printAddress();
+}
+
+MPairMem::MPairMem(MBasicBlock* block, MOperand* first, MOperand* second, MOperand* stackLike, MOperand* offset,
+                   int width, bool isLoad) : MInstruction(block), width_(width), firstUse_(isLoad ? 2 : 0)
+{
+	operands_.resize(4);
+	operands_[0] = first;
+	operands_[1] = second;
+	operands_[2] = stackLike;
+	operands_[3] = offset;
+	if (isLoad)
+	{
+		def_.emplace_back(0);
+		def_.emplace_back(1);
+	}
+	for (int i = firstUse_; i < 4; i++)
+	{
+		bool same = false;
+		for (auto u : use_) same = same || operands_[u] == operands_[i];
+		if (!same) use_.emplace_back(i);
+	}
+	auto func = block->function();
+	for (auto op : operands_) func->addUse(op, this);
+}
+
+std::string MPairMem::printAddress() const
+{
+	return "[" + operands_[2]->print() + ", " + operands_[3]->print() + "] [" + to_string(width_) + "]";
+}
+
+MLDP::MLDP(MBasicBlock* block, MOperand* first, MOperand* second, MOperand* stackLike, MOperand* offset,
+           int width) : MPairMem(block, first, second, stackLike, offset, width, true)
+{
+}
+
+std::string MLDP::print()
+{
+	return operands_[0]->print() + ", " + operands_[1]->print() + " = LDP " + printAddress();
+}
+
+MSTP::MSTP(MBasicBlock* block, MOperand* first, MOperand* second, MOperand* stackLike, MOperand* offset,
+           int width) : MPairMem(block, first, second, stackLike, offset, width, false)
+{
+}
+
+std::string MSTP::print()
+{
+	return "STP " + operands_[0]->print() + ", " + operands_[1]->print() + " " + printAddress();
+}
+
 MCMP::MCMP(MBasicBlock* block, MOperand* l, MOperand* r, bool itff) : MInstruction(block)
 {
 	operands_.resize(2);
@@ -470,7 +612,9 @@ MCMP::MCMP(MBasicBlock* block, MOperand* l, MOperand* r, bool itff) : MInstructi
 
 std::string MCMP::print()
 {
-	return "CMP " + operands_[0]->print() + " " + operands_[1]->print() + "\t\t\t;imp_def NZCV";
+	auto r = operands_[1]->print();
+	if (shift_ != OperandShift::none) r += " " + printShift(shift_, shiftAmount_);
+	return "CMP " + operands_[0]->print() + " " + r + "\t\t\t;imp_def NZCV";
 }
 
 void MCMP::replace(MOperand* from, MOperand* to, MFunction* parent)
@@ -494,6 +638,18 @@ void MCMP::stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent)
 		use_.pop_back();
 }
 
+MCCMP::MCCMP(MBasicBlock* block, MOperand* l, MOperand* r, bool itff, Instruction::OpID cond,
+             bool skipValue) : MCMP(block, l, r, itff), cond_(cond), skipValue_(skipValue)
+{
+	imp_use_.emplace_back(Register::getNZCV(block->module()));
+}
+
+std::string MCCMP::print()
+{
+	return "CCMP." + print_instr_op_name(cond_) + " " + operands_[0]->print() + " " + operands_[1]->print() +
+	       " skip " + (skipValue_ ? "true" : "false") + "\t\t\t;imp_use NZCV imp_def NZCV";
+}
+
 MBL::MBL(MBasicBlock* block, FuncAddress* addr, Function* function) : MInstruction(block)
 {
 	block->function()->addCall(this);
@@ -564,6 +720,56 @@ std::string MCSET::print()
 	return operands_[0]->print() + " = CSET." + print_instr_op_name(op_) + "\t\t\t;imp_use NZCV";
 }
 
+MCSEL::MCSEL(MBasicBlock* block, Instruction::OpID op, Kind kind, MOperand* t, MOperand* a, MOperand* b,
+             int width): MInstruction(block), op_(op), kind_(kind), width_(width)
+{
+	ASSERT(t->isRegisterLike());
+	operands_.resize(3);
+	operands_[0] = t;
+	operands_[1] = a;
+	operands_[2] = b;
+	def_.resize(1);
+	def_[0] = 0;
+	resetUse();
+	imp_use_.emplace_back(Register::getNZCV(block->module()));
+	auto func = block->function();
+	func->addUse(t, this);
+	func->addUse(a, this);
+	func->addUse(b, this);
+}
+
+std::string MCSEL::print()
+{
+	static const char* names[] = {"CSEL.", "CSINC.", "CSNEG."};
+	return operands_[0]->print() + " = " + names[kind_] + print_instr_op_name(op_) + " " + operands_[1]->print() + " " +
+	       operands_[2]->print() + "\t\t\t;imp_use NZCV";
+}
+
+void MCSEL::replace(MOperand* from, MOperand* to, MFunction* parent)
+{
+	MInstruction::replace(from, to, parent);
+	resetUse();
+}
+
+void MCSEL::onlyAddUseReplace(const MOperand* from, MOperand* to, MFunction* parent)
+{
+	MInstruction::onlyAddUseReplace(from, to, parent);
+	resetUse();
+}
+
+void MCSEL::stayUseReplace(const MOperand* from, MOperand* to, MFunction* parent)
+{
+	MInstruction::stayUseReplace(from, to, parent);
+	resetUse();
+}
+
+void MCSEL::resetUse()
+{
+	use_.clear();
+	use_.emplace_back(1);
+	if (operands_[2] != operands_[1]) use_.emplace_back(2);
+}
+
 MFCVTZS::MFCVTZS(MBasicBlock* block, MOperand* fp, MOperand* si) : MInstruction(block)
 {
 	operands_.resize(2);
@@ -708,6 +914,32 @@ std::string MSXTW::print()
 	return operands_[1]->print() + " = SXTW " + operands_[0]->print();
 }
 
+MBitField::MBitField(MBasicBlock* block, MOperand* from, MOperand* to, int width, bool isSigned, bool insert,
+                     int lsb, int bits) : MInstruction(block), width_(width), signed_(isSigned), insert_(insert),
+                                          lsb_(lsb), bits_(bits)
+{
+	ASSERT(lsb >= 0 && bits > 0 && lsb + bits <= width);
+	operands_.resize(2);
+	operands_[0] = to;
+	operands_[1] = from;
+	def_.emplace_back(0);
+	use_.emplace_back(1);
+	auto func = block->function();
+	func->addUse(to, this);
+	func->addUse(from, this);
+}
+
+std::string MBitField::name() const
+{
+	return string{signed_ ? "SBF" : "UBF"} + (insert_ ? "IZ" : "X");
+}
+
+std::string MBitField::print()
+{
+	return operands_[0]->print() + " = " + name() + " " + operands_[1]->print() + " " + to_string(lsb_) + " " +
+	       to_string(bits_) + " [" + to_string(width_) + "]";
+}
+
 MMAddSUB::MMAddSUB(MBasicBlock* block, MOperand* t, MOperand* l, MOperand* r, MOperand* s, bool isAdd, int width) : MInstruction(
 	block), width_(width), add_(isAdd)
 {
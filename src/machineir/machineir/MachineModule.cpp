@@ -1,12 +1,15 @@
 #include "MachineModule.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <stdexcept>
 #include <ostream>
+#include <unordered_map>
 
 #include "MachineFunction.hpp"
 #include "BasicBlock.hpp"
 #include "Constant.hpp"
+#include "CompilationContext.hpp"
 #include "CountLZ.hpp"
 #include "Instruction.hpp"
 #include "MachineBasicBlock.hpp"
@@ -18,7 +21,7 @@
 using namespace std;
 
 
-MModule::MModule()
+MModule::MModule() : context_(CompilationContext::current())
 {
 	Register* r;
 	for (int i = 0; i < 8; i++)
@@ -107,15 +110,23 @@ MModule::MModule()
 }
 
 void MModule::accept(Module* module)
+{
+	declare(module);
+	for (auto& [bb, mbb] : funcMap_)
+	{
+		if (bb->is_lib_) continue;
+		mbb->accept(bb, funcMap_, globalMap_);
+	}
+}
+
+void MModule::declare(Module* module)
 {
 	module->set_print_name();
-	std::map<GlobalVariable*, GlobalAddress*> global_address;
 	for (auto& g : module->get_global_variable())
 	{
-		global_address.emplace(g, new GlobalAddress{this, g});
+		globalMap_.emplace(g, new GlobalAddress{this, g});
 	}
 	const auto& funcs = module->get_functions();
-	std::map<Function*, MFunction*> cache;
 	for (const auto& func : funcs)
 	{
 		auto* mfunc = MFunction::createFunc(func->get_name(), this);
@@ -129,23 +140,102 @@ void MModule::accept(Module* module)
 		for (int i = 0; i < 32; i++)
 			if (fregs_[i]->callerSave_)
 				mfunc->destroyRegs_.set(i + IRegisterCount());
-		cache.emplace(func, mfunc);
+		funcMap_.emplace(func, mfunc);
 	}
 
 	for (auto& f : allFuncs_) f->called_ = DynamicBitset{u2iNegThrow(allFuncs_.size())};
 
-	for (auto& [bb,mbb] : cache)
+	for (auto& [bb,mbb] : funcMap_)
 	{
 		if (bb->is_lib_) continue;
 		mbb->preprocess(bb);
 	}
-	for (auto& [bb, mbb] : cache)
+}
+
+void MModule::lower(const std::vector<Function*>& window)
+{
+	functions_.clear();
+	for (auto func : window)
 	{
-		if (bb->is_lib_) continue;
-		mbb->accept(bb, cache, global_address);
+		auto mfunc = funcMap_.at(func);
+		mfunc->accept(func, funcMap_, globalMap_);
+		functions_.emplace_back(mfunc);
 	}
 }
 
+void MModule::release()
+{
+	for (auto f : functions_) f->releaseBody();
+	functions_.clear();
+}
+
+std::vector<std::vector<Function*>> MModule::callGraphOrder(Module* module)
+{
+	// Tarjan 算法, 强连通分量按完成的顺序输出, 恰好是被调用者在前
+	struct Node
+	{
+		std::vector<Function*> callees;
+		int index = -1;
+		int low = 0;
+		bool onStack = false;
+	};
+	std::unordered_map<Function*, Node> nodes;
+	const auto& funcs = module->get_functions();
+	for (auto func : funcs)
+		if (!func->is_lib_) nodes[func];
+	for (auto func : funcs)
+	{
+		if (func->is_lib_) continue;
+		for (auto& use : func->get_use_list())
+		{
+			auto call = dynamic_cast<CallInst*>(use.val_);
+			if (call == nullptr) continue;
+			auto& callees = nodes[call->get_parent()->get_parent()].callees;
+			if (callees.empty() || callees.back() != func) callees.emplace_back(func);
+		}
+	}
+	std::vector<std::vector<Function*>> ret;
+	std::vector<Function*> stack;
+	int index = 0;
+	std::function<void(Function*)> connect = [&](Function* func)
+	{
+		auto& node = nodes[func];
+		node.index = node.low = index++;
+		node.onStack = true;
+		stack.emplace_back(func);
+		for (auto callee : node.callees)
+		{
+			auto& next = nodes[callee];
+			if (next.index < 0)
+			{
+				connect(callee);
+				node.low = min(node.low, next.low);
+			}
+			else if (next.onStack) node.low = min(node.low, next.index);
+		}
+		if (node.low != node.index) return;
+		std::vector<Function*> scc;
+		Function* top;
+		do
+		{
+			top = stack.back();
+			stack.pop_back();
+			nodes[top].onStack = false;
+			scc.emplace_back(top);
+		}
+		while (top != func);
+		ret.emplace_back(std::move(scc));
+	};
+	for (auto func : funcs)
+		if (!func->is_lib_ && nodes[func].index < 0) connect(func);
+	// 分量内按模块中的顺序
+	std::unordered_map<Function*, int> order;
+	for (auto func : funcs) order.emplace(func, u2iNegThrow(order.size()));
+	for (auto& scc : ret)
+		sort(scc.begin(), scc.end(), [&order](Function* l, Function* r) { return order[l] < order[r]; });
+	return ret;
+}
+
 std::string MModule::print() const
 {
 	string ret;
@@ -253,14 +343,16 @@ MModule::~MModule()
 	delete modulePrefix_;
 }
 
-std::ostream& operator<<(std::ostream& os, const MModule* module)
+void MModule::printFunctions(std::ostream& os) const
 {
-	if (module->modulePrefix_) os << module->modulePrefix_;
-	for (auto f : module->functions_)
+	for (auto f : functions_)
 	{
+		if (f->alignLog2_) os << "\t.p2align " << f->alignLog2_ << '\n';
 		if (f->funcPrefix_) os << f->funcPrefix_;
 		for (auto bb : f->blocks())
 		{
+			if (bb->alignLog2_)
+				os << "\t.p2align " << bb->alignLog2_ << ",," << bb->alignMaxPadding_ << '\n';
 			if (!f->useList()[BlockAddress::get(bb)].empty())
 			{
 				if (bb->name() == "search_2")
@@ -277,7 +369,10 @@ std::ostream& operator<<(std::ostream& os, const MModule* module)
 				auto br = dynamic_cast<MB*>(bb->instructions().back());
 				if (br->isCondBranch())
 				{
-					os << "\tB." + condName(br->op()) + " " + br->block2GoL()->name() + '\n';
+					if (!br->zeroTest_.empty())
+						os << (br->op() == Instruction::eq ? "\tCBZ " : "\tCBNZ ") + br->zeroTest_ + ", " +
+							br->block2GoL()->name() + '\n';
+					else os << "\tB." + condName(br->op()) + " " + br->block2GoL()->name() + '\n';
 					if (c > 1) os << "\tB " + br->block2GoR()->name() + '\n';
 				}
 				else os << "\tB " + br->block2GoL()->name() + '\n';
@@ -286,6 +381,12 @@ std::ostream& operator<<(std::ostream& os, const MModule* module)
 		if (f->funcSuffix_) os << f->funcSuffix_;
 		os << f->sizeSuffix_ << '\n';
 	}
+}
+
+std::ostream& operator<<(std::ostream& os, const MModule* module)
+{
+	if (module->modulePrefix_) os << module->modulePrefix_;
+	module->printFunctions(os);
 	if (module->moduleSuffix_) os << module->moduleSuffix_;
 	return os;
 }
@@ -0,0 +1,179 @@
+#include "AddressFold.hpp"
+
+#include <algorithm>
+
+#include "CodeGen.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "MachineInstruction.hpp"
+#include "MachineOperand.hpp"
+
+#define DEBUG 0
+#include "Util.hpp"
+
+using namespace std;
+
+namespace
+{
+	// 访存宽度对应的下标左移量, 即元素大小的对数
+	int scaleOf(int width)
+	{
+		return width == 64 ? 3 : 2;
+	}
+
+	int widthOf(const MInstruction* inst)
+	{
+		if (auto ld = dynamic_cast<const MLDR*>(inst); ld != nullptr) return ld->width();
+		return dynamic_cast<const MSTR*>(inst)->width();
+	}
+}
+
+void AddressFold::run()
+{
+	for (auto f : m_->functions())
+	{
+		f_ = f;
+		LOG(color::cyan("AddressFold of Func ") + f->name());
+		for (auto bb : f->blocks())
+		{
+			// 合并只删除 add 之前的左移与 SXTW, 先收集所有 add
+			vector<MMathInst*> adds;
+			for (auto inst : bb->instructions())
+			{
+				auto add = dynamic_cast<MMathInst*>(inst);
+				if (add != nullptr && add->op() == Instruction::add && add->width() == 64) adds.emplace_back(add);
+			}
+			for (auto add : adds) fold(bb, add);
+		}
+	}
+}
+
+int AddressFold::defBefore(MBasicBlock* bb, int before, const MOperand* op)
+{
+	auto& insts = bb->instructions();
+	for (int i = before - 1; i >= 0; i--)
+	{
+		for (auto d : insts[i]->def())
+			if (insts[i]->operand(d) == op) return i;
+	}
+	return -1;
+}
+
+bool AddressFold::unchanged(MBasicBlock* bb, int from, int to, const MOperand* op)
+{
+	auto& insts = bb->instructions();
+	for (int i = from + 1; i < to; i++)
+	{
+		for (auto d : insts[i]->def())
+			if (insts[i]->operand(d) == op) return false;
+	}
+	return true;
+}
+
+bool AddressFold::fold(MBasicBlock* bb, MMathInst* add) const
+{
+	auto& insts = bb->instructions();
+	auto t = add->operand(0);
+	auto base = add->operand(1);
+	auto offset = add->operand(2);
+	auto baseReg = dynamic_cast<VirtualRegister*>(base);
+	auto glob = dynamic_cast<GlobalAddress*>(base);
+	bool isFrame = dynamic_cast<FrameIndex*>(base) != nullptr;
+	bool baseOk = baseReg != nullptr ? baseReg->size() == 64 : isFrame || (glob != nullptr && !f_->constGlobals_.count(glob));
+	if (!baseOk || base == offset || t == base || t == offset) return false;
+
+	// 结果只被同一块中之后的 LDR/STR 用作地址
+	auto& ul = f_->useList(t);
+	for (auto u : ul)
+	{
+		if (u == add) continue;
+		auto st = dynamic_cast<MSTR*>(u);
+		if (dynamic_cast<MLDR*>(u) == nullptr && (st == nullptr || st->forCall_)) return false;
+		if (u->block() != bb || u->operand(1) != t || u->operand(0) == t) return false;
+	}
+	int at = u2iNegThrow(find(insts.begin(), insts.end(), add) - insts.begin());
+	vector<int> users;
+	for (int i = at + 1; i < u2iNegThrow(insts.size()); i++)
+		if (ul.count(insts[i])) users.emplace_back(i);
+	if (users.empty() || users.size() + 1 != ul.size()) return false;
+	int last = users.back();
+
+	MOperand* index = offset;
+	int shift = 0;
+	bool sxtw = false;
+	// 被合并的 SXTW 与左移, 从 add 向前排列
+	vector<MInstruction*> chain;
+	if (auto imm = dynamic_cast<Immediate*>(offset); imm != nullptr)
+	{
+		long long o = imm->as64BitsInt();
+		for (auto i : users)
+		{
+			int width = widthOf(insts[i]);
+			if (o % (width >> 3) != 0 || (!isFrame && !CodeGen::ldrOffsetCanInline(o, width))) return false;
+		}
+		if (!unchanged(bb, at, last, base)) return false;
+	}
+	else
+	{
+		auto vr = dynamic_cast<VirtualRegister*>(offset);
+		if (vr == nullptr) return false;
+		// 下标由只在这里使用的加 0, SXTW 与左移得到时一并合并, 左移量要等于所有访存的元素大小
+		int from = at;
+		for (int d = defBefore(bb, at, index); d >= 0 && f_->useList(index).size() == 2; d = defBefore(bb, d, index))
+		{
+			auto inst = insts[d];
+			auto math = dynamic_cast<MMathInst*>(inst);
+			auto imm = math != nullptr ? dynamic_cast<Immediate*>(math->operand(1)) : nullptr;
+			auto amount = math != nullptr ? dynamic_cast<Immediate*>(math->operand(2)) : nullptr;
+			MOperand* next = nullptr;
+			int nextShift = 0;
+			if (dynamic_cast<MSXTW*>(inst) != nullptr) next = inst->operand(0);
+			else if (math != nullptr && math->op() == Instruction::add && imm != nullptr && imm->as64BitsInt() == 0)
+				next = math->operand(2);
+			else if (math != nullptr && math->op() == Instruction::shl && amount != nullptr &&
+				all_of(users.begin(), users.end(), [&](int i)
+				{
+					return amount->as64BitsInt() == scaleOf(widthOf(insts[i]));
+				}))
+			{
+				next = math->operand(1);
+				nextShift = u2iNegThrow(amount->as64BitsInt());
+			}
+			if (dynamic_cast<VirtualRegister*>(next) == nullptr) break;
+			chain.emplace_back(inst);
+			index = next;
+			shift = nextShift;
+			from = d;
+			if (shift != 0) break;
+		}
+		if (!unchanged(bb, from, last, base) || !unchanged(bb, from, last, index))
+		{
+			chain.clear();
+			index = offset;
+			shift = 0;
+			if (!unchanged(bb, at, last, base) || !unchanged(bb, at, last, index)) return false;
+		}
+		sxtw = dynamic_cast<VirtualRegister*>(index)->size() == 32;
+	}
+	LOG(color::green("Fold address ") + add->print());
+
+	for (auto i : users)
+	{
+		auto u = insts[i];
+		MInstruction* rep;
+		if (auto ld = dynamic_cast<MLDR*>(u); ld != nullptr)
+			rep = new MLDRIdx{bb, ld->operand(0), base, index, ld->width(), shift, sxtw};
+		else rep = new MSTRIdx{bb, u->operand(0), base, index, widthOf(u), shift, sxtw};
+		u->removeAllUse();
+		delete u;
+		insts[i] = rep;
+		LOG(rep->print());
+	}
+	bb->removeInst(add);
+	for (auto inst : chain)
+	{
+		if (f_->useList(inst->def(0)).size() != 1) break;
+		bb->removeInst(inst);
+	}
+	return true;
+}
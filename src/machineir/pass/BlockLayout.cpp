@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 
+#include "Config.hpp"
 #include "MachineInstruction.hpp"
 #include "MachineLoopDetection.hpp"
 #include "MachineOperand.hpp"
@@ -32,6 +33,11 @@ std::string BlockLayout::BBNode::print() const
 
 namespace
 {
+	// Cortex-A72 每周期取指 16 字节
+	constexpr int fetchAlignLog2 = 4;
+	// 更大的循环跨越取指块边界时多取指的一次可以忽略
+	constexpr unsigned maxAlignedLoopLines = 64;
+
 	bool checkFunc(MFunction* f)
 	{
 		int idx = 0;
@@ -52,6 +58,8 @@ void BlockLayout::runOnFunc()
 	ASSERT(checkFunc(f_));
 	collectBlocks();
 	auto& loops = detect.get_loops();
+	innerLoops_.clear();
+	for (auto i : loops) if (i->get_sub_loops().empty()) innerLoops_.emplace_back(i->get_header(), i->get_blocks());
 	if (!loops.empty())
 	{
 		vector<MachineLoop*> tops;
@@ -61,6 +69,7 @@ void BlockLayout::runOnFunc()
 	auto nodes = DynamicBitset{blockCount_};
 	nodes.rangeSet(0, blockCount_);
 	runOnNodes(nodes);
+	alignLoops();
 	nodes.reset();
 	auto n2 = blocks_[0]->block_;
 	vector<MBasicBlock*> v2;
@@ -76,7 +85,19 @@ void BlockLayout::runOnFunc()
 	{
 		if (!nodes.test(i))
 		{
-			delete f_->blocks()[i];
+			// 被跳过的空块, 把它的前驱直接连到它的后继, 之后的 pass 仍能使用 CFG
+			auto bb = f_->blocks()[i];
+			for (auto p : bb->pre_bbs_)
+			{
+				p->suc_bbs_.erase(bb);
+				for (auto s : bb->suc_bbs_) if (s != bb) p->suc_bbs_.emplace(s);
+			}
+			for (auto s : bb->suc_bbs_)
+			{
+				s->pre_bbs_.erase(bb);
+				for (auto p : bb->pre_bbs_) if (p != bb) s->pre_bbs_.emplace(p);
+			}
+			delete bb;
 		}
 	}
 	f_->blocks() = v2;
@@ -107,6 +128,37 @@ void BlockLayout::runOnLoop(MachineLoop* loop)
 	POP;
 }
 
+void BlockLayout::alignLoops() const
+{
+	f_->alignLog2_ = fetchAlignLog2;
+	if (loopAlignMaxPadding <= 0) return;
+	// 布局中的前一个块, 按排序前的编号
+	vector<MBasicBlock*> prev(blockCount_, nullptr);
+	for (auto bb = blocks_[0]->block_; bb->next_ != nullptr; bb = bb->next_) prev[bb->next_->id_] = bb;
+	for (auto& [header, body] : innerLoops_)
+	{
+		unsigned lines = 0;
+		for (auto i : body)
+		{
+			auto bb = f_->blocks()[i];
+			for (auto j : bb->instructions()) lines += j->str->lines();
+			lines += bb->needBranchCount();
+		}
+		if (lines > maxAlignedLoopLines) continue;
+		if (auto p = prev[header->id_]; p != nullptr && !p->instructions_.empty())
+		{
+			auto b = dynamic_cast<MB*>(p->instructions_.back());
+			bool fallsInto = b != nullptr && (b->isCondBranch() ? b->block2GoR() : b->block2GoL()) == header;
+			if (fallsInto && (body.test(p->id_) ||
+				p->weight_ * static_cast<float>(useMultiplierPerLoop) > header->weight_))
+				continue;
+		}
+		LOG(color::green("Align loop header ") + header->name() + ", " + to_string(lines) + " lines");
+		header->alignLog2_ = fetchAlignLog2;
+		header->alignMaxPadding_ = loopAlignMaxPadding;
+	}
+}
+
 std::string BlockLayout::logNodes(const DynamicBitset& nodes) const
 {
 	string ret;
@@ -11,6 +11,8 @@
 #include "CodeString.hpp"
 
 #define DEBUG 0
+#include <algorithm>
+#include <fstream>
 #include <iomanip>
 
 #include "CountLZ.hpp"
@@ -77,6 +79,26 @@ namespace
 		return i < 4096;
 	}
 
+	// 32 位逻辑立即数: 不是全 0 或全 1, 由一段循环移位的连续 1 重复得到
+	bool logicalImmediate32(unsigned v)
+	{
+		if (v == 0 || v == ~0u) return false;
+		unsigned size = 32;
+		while (size > 2)
+		{
+			unsigned half = size >> 1;
+			unsigned mask = (1u << half) - 1;
+			if ((v & mask) != ((v >> half) & mask)) break;
+			size = half;
+		}
+		unsigned mask = size == 32 ? ~0u : (1u << size) - 1;
+		unsigned e = v & mask;
+		// 最低位是 1 时取反, 之后的 1 不跨过重复单元的边界
+		if (e & 1) e = ~e & mask;
+		unsigned t = e + (e & (~e + 1));
+		return (t & (t - 1)) == 0;
+	}
+
 	bool inImm7L2(int i)
 	{
 		if (i < -256) return false;
@@ -114,6 +136,16 @@ namespace
 		return !(i & 0b111);
 	}
 
+	// 大小为 bytes 字节的全局变量的对齐, 与 CodeString::addAlign(bytes, true) 一致
+	long long globalAlignment(long long bytes)
+	{
+		if (bytes > alignTo16NeedBytes || bytes > 8) return 16;
+		if (bytes > 4) return 8;
+		if (bytes > 2) return 4;
+		if (bytes > 1) return 2;
+		return 1;
+	}
+
 	bool floatMovSupport(unsigned u) noexcept
 	{
 		const unsigned exp = u & (0xFFu << 23u);
@@ -140,15 +172,54 @@ namespace
 		}
 		throw runtime_error("invalid op");
 	}
+
+	// 条件码取反
+	Instruction::OpID invertCond(Instruction::OpID op)
+	{
+		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+		// ReSharper disable once CppIncompleteSwitchStatement
+		switch (op) // NOLINT(clang-diagnostic-switch)
+		{
+			case Instruction::ge: return Instruction::lt;
+			case Instruction::gt: return Instruction::le;
+			case Instruction::le: return Instruction::gt;
+			case Instruction::lt: return Instruction::ge;
+			case Instruction::eq: return Instruction::ne;
+			case Instruction::ne: return Instruction::eq;
+		}
+		throw runtime_error("invalid op");
+	}
+
+	// 使条件 op 取 value 的 NZCV, 只用 0(大于), 4(相等, Z), 8(小于, N) 三种, 整数与浮点比较相同
+	int nzcvFor(Instruction::OpID op, bool value)
+	{
+		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+		// ReSharper disable once CppIncompleteSwitchStatement
+		switch (op) // NOLINT(clang-diagnostic-switch)
+		{
+			case Instruction::ge: return value ? 0 : 8;
+			case Instruction::gt: return value ? 0 : 4;
+			case Instruction::le: return value ? 4 : 0;
+			case Instruction::lt: return value ? 8 : 0;
+			case Instruction::eq: return value ? 4 : 0;
+			case Instruction::ne: return value ? 0 : 4;
+		}
+		throw runtime_error("invalid op");
+	}
 }
 
 
 std::string CodeGen::word(const std::vector<ConstantValue>* v)
+{
+	return word(*v, 0, u2iNegThrow(v->size()));
+}
+
+std::string CodeGen::word(const std::vector<ConstantValue>& v, int begin, int end)
 {
 	string ret = "\t.word ";
-	for (auto& i : *v)
+	for (int i = begin; i < end; i++)
 	{
-		ret += to_string(i.bits2Unsigned()) + ", ";
+		ret += to_string(v[i].bits2Unsigned()) + ", ";
 	}
 	ret.pop_back();
 	ret.pop_back();
@@ -160,6 +231,11 @@ std::string CodeGen::zero(int count)
 	return "\t.zero " + to_string(count);
 }
 
+std::string CodeGen::fill(int count, const ConstantValue& v)
+{
+	return "\t.fill " + to_string(count) + ", 4, " + to_string(v.bits2Unsigned());
+}
+
 std::string CodeGen::size(const std::string& globName, int bytes)
 {
 	return "\t.size " + globName + ", " + to_string(bytes);
@@ -170,7 +246,7 @@ std::string CodeGen::size(const std::string& globName, long long bytes)
 	return "\t.size " + globName + ", " + to_string(bytes);
 }
 
-void CodeGen::makeGlobal(const GlobalAddress* address) const
+void CodeGen::makeGlobal(const GlobalAddress* address)
 {
 	auto allSize = logicalRightShift(address->size_, 3);
 	m_->modulePrefix_->addAlign(allSize, true);
@@ -178,16 +254,89 @@ void CodeGen::makeGlobal(const GlobalAddress* address) const
 	m_->modulePrefix_->objectTypeDeclare(address->name_);
 	m_->modulePrefix_->addLabel(address->name_);
 	auto init = address->data_;
+	// 较短的默认值段合并到相邻的附加值中一起输出
+	vector<ConstantValue> words;
 	for (int i = 0, segCount = init->segmentCount(); i < segCount; i++)
 	{
 		auto [iv, dc] = init->segment(i);
 		if (dc == 0)
-			m_->modulePrefix_->addCommonStr(word(iv));
-		else m_->modulePrefix_->addCommonStr(zero(dc << 2));
+			words.insert(words.end(), iv->begin(), iv->end());
+		else if (dc <= globalDataZeroMergeGate)
+			words.insert(words.end(), dc, init->default_value());
+		else
+		{
+			makeGlobalWords(words);
+			words.clear();
+			m_->modulePrefix_->addCommonStr(zero(dc << 2));
+		}
 	}
+	makeGlobalWords(words);
 	m_->modulePrefix_->addCommonStr(size(address->name_, allSize));
 }
 
+void CodeGen::makeGlobalWords(const std::vector<ConstantValue>& v)
+{
+	const int n = u2iNegThrow(v.size());
+	if (n == 0) return;
+	const auto toStr = m_->modulePrefix_;
+	if (emitGlobalDataAsIncbin && n >= globalDataIncbinGate)
+	{
+		// 目标架构是小端
+		const auto offset = incbinData_.size();
+		for (auto& i : v)
+		{
+			const unsigned u = i.bits2Unsigned();
+			for (int b = 0; b < 32; b += 8) incbinData_ += static_cast<char>(u >> b & 0xFFu);
+		}
+		toStr->addCommonStr("\t.incbin \"" + globalDataIncbinFile + "\", " + to_string(offset) + ", " +
+		                    to_string(n << 2));
+		return;
+	}
+	// [pending, i) 是尚未输出的普通数据
+	int pending = 0;
+	int i = 0;
+	while (i < n)
+	{
+		int run = 1;
+		while (i + run < n && v[i + run] == v[i]) run++;
+		if (run >= globalDataFillGate)
+		{
+			if (i > pending) toStr->addCommonStr(word(v, pending, i));
+			toStr->addCommonStr(v[i].bits2Unsigned() == 0 ? zero(run << 2) : fill(run, v[i]));
+			i += run;
+			pending = i;
+			continue;
+		}
+		// 寻找从 i 开始覆盖数据最多的重复模式
+		int bestLen = 0;
+		int bestCount = 0;
+		for (int len = 2; len <= globalDataReptMaxPattern && i + (len << 1) <= n; len++)
+		{
+			int count = 1;
+			while (i + (count + 1) * len <= n &&
+			       equal(v.begin() + i, v.begin() + i + len, v.begin() + i + count * len))
+				count++;
+			if (count >= 2 && count * len >= globalDataFillGate && count * len > bestCount * bestLen)
+			{
+				bestLen = len;
+				bestCount = count;
+			}
+		}
+		if (bestCount > 0)
+		{
+			if (i > pending) toStr->addCommonStr(word(v, pending, i));
+			toStr->addCommonStr("\t.rept " + to_string(bestCount));
+			toStr->addCommonStr(word(v, i, i + bestLen));
+			toStr->addCommonStr("\t.endr");
+			i += bestCount * bestLen;
+			pending = i;
+			continue;
+		}
+		i++;
+	}
+	if (n > pending) toStr->addCommonStr(word(v, pending, n));
+}
+
 void CodeGen::makeFunction()
 {
 	for (auto i : func_->blocks_) i->blockPrefix_ = new CodeString{};
@@ -349,8 +498,8 @@ void CodeGen::fdiv(const Register* to, const Register* l, const Register* r, Cod
 
 void CodeGen::stp(const Register* a, const Register* b, const Register* c, int offset, int len, CodeString* toStr)
 {
-	ASSERT(len == 32 || len == 64);
-	ASSERT(len == 32 ? inImm7L2(offset) : inImm7L3(offset));
+	ASSERT(len == 32 || len == 64 || len == 128);
+	ASSERT(pairOffsetCanInline(offset, len));
 	return toStr->addInstruction("STP", regName(a, len), regName(b, len), regDataOffset(c, offset));
 }
 
@@ -383,10 +532,8 @@ void CodeGen::str(const MOperand* regLike, const MOperand* stackLike, int len, C
 	if (const GlobalAddress* i = dynamic_cast<const GlobalAddress*>(stackLike); i != nullptr)
 	{
 		const Register* l = op2reg(regLike, len, toStr);
-		auto r = op2reg(i, 64, toStr);
-		str(l, r, 0ll, len, toStr);
+		globalMem("STR", l, i, 0, len, toStr);
 		releaseIP(l);
-		releaseIP(r);
 		return;
 	}
 	if (const FrameIndex* i = dynamic_cast<const FrameIndex*>(stackLike); i != nullptr)
@@ -471,8 +618,8 @@ const Register* CodeGen::op2reg(const MOperand* op, int len, CodeString* appendS
 
 void CodeGen::ldp(const Register* a, const Register* b, const Register* c, int offset, int len, CodeString* toStr)
 {
-	ASSERT(len == 32 || len == 64);
-	ASSERT(len == 32 ? inImm7L2(offset) : inImm7L3(offset));
+	ASSERT(len == 32 || len == 64 || len == 128);
+	ASSERT(pairOffsetCanInline(offset, len));
 	return toStr->addInstruction("LDP", regName(a, len), regName(b, len), regDataOffset(c, offset));
 }
 
@@ -505,6 +652,19 @@ int CodeGen::ldrNeedInstCount(long long offset, int len)
 	return 4 + makeI64ImmediateNeedInstCount(offset);
 }
 
+bool CodeGen::ldrOffsetCanInline(long long offset, int len)
+{
+	if (inImm9(offset)) return true;
+	long long bytes = len >> 3;
+	return offset >= 0 && offset % bytes == 0 && inUImm12(offset / bytes);
+}
+
+bool CodeGen::pairOffsetCanInline(long long offset, int len)
+{
+	long long bytes = len >> 3;
+	return offset % bytes == 0 && offset / bytes >= -64 && offset / bytes < 64;
+}
+
 int CodeGen::copyFrameNeedInstCount(long long offset)
 {
 	if (offset == 0) return 0;
@@ -525,9 +685,7 @@ void CodeGen::ldr(const MOperand* a, const MOperand* stackLike, int len, CodeStr
 	ASSERT(dynamic_cast<const Immediate*>(stackLike) == nullptr);
 	if (const GlobalAddress* i = dynamic_cast<const GlobalAddress*>(stackLike); i != nullptr)
 	{
-		auto r = op2reg(i, 64, toStr);
-		ldr(l, r, 0, len, toStr);
-		releaseIP(r);
+		globalMem("LDR", l, i, 0, len, toStr);
 		return;
 	}
 	if (const FrameIndex* i = dynamic_cast<const FrameIndex*>(stackLike); i != nullptr)
@@ -539,6 +697,108 @@ void CodeGen::ldr(const MOperand* a, const MOperand* stackLike, int len, CodeStr
 	throw runtime_error("unexpected");
 }
 
+void CodeGen::globalMem(const char* op, const Register* value, const GlobalAddress* glob, long long offset, int len,
+                        CodeString* toStr)
+{
+	auto sym = globalSymbol(glob, offset);
+	bool load = string{op} == "LDR";
+	auto page = load && value->isIntegerRegister() ? value : getIP();
+	toStr->addInstruction("ADRP", regName(page, 64), sym);
+	// :lo12: 作为按访存宽度缩放的偏移时, 符号地址必须按宽度对齐, 否则先加上页内偏移
+	long long bytes = len >> 3;
+	if (offset % bytes == 0 && globalAlignment(logicalRightShift(glob->size_, 3)) % bytes == 0)
+		toStr->addInstruction(op, regName(value, len), "[" + regName(page, 64) + ", #:lo12:" + sym + "]");
+	else
+	{
+		toStr->addInstruction("ADD", regName(page, 64), regName(page, 64), ":lo12:" + sym);
+		toStr->addInstruction(op, regName(value, len), regData(page));
+	}
+	if (page != value) releaseIP(page);
+}
+
+void CodeGen::indexedMem(const MIndexedMem* inst, bool isLoad, CodeString* toStr)
+{
+	int len = inst->width();
+	auto base = inst->operand(1);
+	const char* op = isLoad ? "LDR" : "STR";
+	const Register* l;
+	if (isLoad) l = dynamic_cast<const Register*>(inst->operand(0));
+	else l = op2reg(inst->operand(0), len, toStr);
+	ASSERT(l != nullptr);
+	if (auto imm = dynamic_cast<const Immediate*>(inst->operand(2)); imm != nullptr)
+	{
+		long long offset = imm->as64BitsInt();
+		const Register* b;
+		if (auto glob = dynamic_cast<const GlobalAddress*>(base); glob != nullptr)
+		{
+			// 偏移并入 ADRP 与 :lo12: 的符号表达式
+			globalMem(op, l, glob, offset, len, toStr);
+			if (!isLoad) releaseIP(l);
+			return;
+		}
+		if (auto fi = dynamic_cast<const FrameIndex*>(base); fi != nullptr)
+		{
+			offset += frameOffset(fi, false, toStr);
+			b = sp();
+		}
+		else b = op2reg(base, 64, toStr);
+		if (ldrOffsetCanInline(offset, len))
+			toStr->addInstruction(op, regName(l, len), regDataOffset(b, u2iNegThrow(offset)));
+		else if (isLoad) ldr(l, b, offset, len, toStr);
+		else str(l, b, offset, len, toStr);
+		releaseIP(b);
+	}
+	else
+	{
+		auto idx = dynamic_cast<const Register*>(inst->operand(2));
+		ASSERT(idx != nullptr);
+		auto b = op2reg(base, 64, toStr);
+		toStr->addInstruction(op, regName(l, len), regDataRegExtendOffset(b, idx, inst->sxtw(), inst->shift()));
+		releaseIP(b);
+	}
+	if (!isLoad) releaseIP(l);
+}
+
+void CodeGen::pairMem(const MPairMem* inst, bool isLoad, CodeString* toStr)
+{
+	int len = inst->width();
+	auto a = dynamic_cast<const Register*>(inst->operand(0));
+	auto b = dynamic_cast<const Register*>(inst->operand(1));
+	ASSERT(a != nullptr && b != nullptr);
+	long long offset = dynamic_cast<const Immediate*>(inst->operand(3))->as64BitsInt();
+	const Register* base;
+	if (auto fi = dynamic_cast<const FrameIndex*>(inst->operand(2)); fi != nullptr)
+	{
+		offset += frameOffset(fi, inst->forCall_, toStr);
+		base = sp();
+	}
+	else base = dynamic_cast<const Register*>(inst->operand(2));
+	ASSERT(base != nullptr);
+	if (pairOffsetCanInline(offset, len))
+	{
+		if (isLoad) ldp(a, b, base, u2iNegThrow(offset), len, toStr);
+		else stp(a, b, base, u2iNegThrow(offset), len, toStr);
+		return;
+	}
+	// 偏移超出范围时拆回两条访存, 覆盖基址的加载放在后面
+	long long next = offset + (len >> 3);
+	if (!isLoad)
+	{
+		str(a, base, offset, len, toStr);
+		str(b, base, next, len, toStr);
+	}
+	else if (a == base)
+	{
+		ldr(b, base, next, len, toStr);
+		ldr(a, base, offset, len, toStr);
+	}
+	else
+	{
+		ldr(a, base, offset, len, toStr);
+		ldr(b, base, next, len, toStr);
+	}
+}
+
 void CodeGen::ld1(const MOperand* stackLike, int count, int offset, CodeString* toStr)
 {
 	if (const Register* i = dynamic_cast<const Register*>(stackLike); i != nullptr)
@@ -883,11 +1143,9 @@ void CodeGen::mathInst(const MOperand* t, const MOperand* l, const MOperand* r,
 				makeImmediate(immR, false, 32, rr, toStr);
 				toStr->addInstruction("SDIV", regName(ip, 32), regName(regL, 32),
 				                      regName(rr, 32));
-				lsl32(rr, ip, m_countr_zero(av), toStr);
-				if (val < 0)
-					mathRRInst(target, regL, rr, Instruction::add, 32, toStr);
-				else
-					mathRRInst(target, regL, rr, Instruction::sub, 32, toStr);
+				// 商左移后从被除数中减去, 左移合并进 SUB 的移位寄存器操作数
+				mathRRInst(target, regL, ip, val < 0 ? Instruction::add : Instruction::sub, 32, OperandShift::lsl,
+				           m_countr_zero(av), toStr);
 				releaseIP(rr);
 				releaseIP(ip);
 				return;
@@ -922,11 +1180,8 @@ void CodeGen::mathInst(const MOperand* t, const MOperand* l, const MOperand* r,
 				makeImmediate(immR, false, 64, rr, toStr);
 				toStr->addInstruction("SDIV", regName(ip, 64), regName(regL, 64),
 				                      regName(rr, 64));
-				lsl64(rr, ip, m_countr_zero(av), toStr);
-				if (val < 0)
-					mathRRInst(target, regL, rr, Instruction::add, 64, toStr);
-				else
-					mathRRInst(target, regL, rr, Instruction::sub, 64, toStr);
+				mathRRInst(target, regL, ip, val < 0 ? Instruction::add : Instruction::sub, 64, OperandShift::lsl,
+				           m_countr_zero(av), toStr);
 				releaseIP(rr);
 				releaseIP(ip);
 				return;
@@ -1292,6 +1547,88 @@ void CodeGen::cset(const MOperand* to, Instruction::OpID cond, CodeString* toStr
 	return toStr->addInstruction("CSET", regName(bb, 32), condName(cond));
 }
 
+void CodeGen::csel(const MCSEL* inst, CodeString* toStr)
+{
+	auto t = dynamic_cast<const Register*>(inst->operand(0));
+	ASSERT(t != nullptr);
+	auto a = inst->operand(1);
+	auto b = inst->operand(2);
+	auto am = dynamic_cast<const Immediate*>(a);
+	auto bm = dynamic_cast<const Immediate*>(b);
+	int len = inst->width_;
+	// 比较结果在编译期已知, 由 decideCond 决定
+	if (inst->op_ == Instruction::add || inst->op_ == Instruction::sub)
+	{
+		if (inst->op_ == Instruction::add) return copy(t, a, len, toStr);
+		switch (inst->kind_)
+		{
+			case MCSEL::SELECT: return copy(t, b, len, toStr);
+			case MCSEL::INCREMENT:
+				if (am) return makeI32Immediate(am->asInt() + 1, t, toStr);
+				return add32(t, dynamic_cast<const Register*>(a), 1, toStr);
+			case MCSEL::NEGATE:
+				if (am) return makeI32Immediate(-am->asInt(), t, toStr);
+				return toStr->addInstruction("NEG", regName(t, len), regName(dynamic_cast<const Register*>(a), len));
+		}
+	}
+	auto cond = inst->op_;
+	if (!t->isIntegerRegister())
+	{
+		auto ar = op2reg(a, len, false, toStr);
+		auto br = op2reg(b, len, false, toStr);
+		toStr->addInstruction("FCSEL", regName(t, len), regName(ar, len), regName(br, len), condName(cond));
+		releaseIP(ar);
+		releaseIP(br);
+		return;
+	}
+	const char* name = "CSEL";
+	if (inst->kind_ != MCSEL::SELECT)
+	{
+		name = inst->kind_ == MCSEL::INCREMENT ? "CSINC" : "CSNEG";
+	}
+	else if (am && bm)
+	{
+		int x = am->asInt();
+		int y = bm->asInt();
+		if (x == y) return copy(t, a, len, toStr);
+		if (y == 0 && (x == 1 || x == -1))
+			return toStr->addInstruction(x == 1 ? "CSET" : "CSETM", regName(t, len), condName(cond));
+		if (x == 0 && (y == 1 || y == -1))
+			return toStr->addInstruction(y == 1 ? "CSET" : "CSETM", regName(t, len), condName(invertCond(cond)));
+		// 两个立即数之差为 1, 互为相反数或按位取反时只需要一个临时寄存器
+		const char* fold = nullptr;
+		if (y == x + 1) fold = "CSINC";
+		else if (y == -x) fold = "CSNEG";
+		else if (y == ~x) fold = "CSINV";
+		if (fold != nullptr)
+		{
+			auto ar = op2reg(a, len, true, toStr);
+			toStr->addInstruction(fold, regName(t, len), regName(ar, len), regName(ar, len), condName(cond));
+			releaseIP(ar);
+			return;
+		}
+	}
+	else if (am)
+	{
+		// 立即数放在第二个操作数, 它可以用 WZR 与 CSINC, CSINV 表示
+		swap(a, b);
+		swap(am, bm);
+		cond = invertCond(cond);
+	}
+	if (inst->kind_ == MCSEL::SELECT && bm && (bm->asInt() == 1 || bm->asInt() == -1))
+	{
+		auto ar = op2reg(a, len, true, toStr);
+		toStr->addInstruction(bm->asInt() == 1 ? "CSINC" : "CSINV", regName(t, len), regName(ar, len),
+		                      regName(zeroRegister(), len), condName(cond));
+		releaseIP(ar);
+		return;
+	}
+	auto ar = am && am->asInt() == 0 ? zeroRegister() : op2reg(a, len, true, toStr);
+	auto br = inst->kind_ != MCSEL::SELECT ? ar : bm && bm->asInt() == 0 ? zeroRegister() : op2reg(b, len, true, toStr);
+	toStr->addInstruction(name, regName(t, len), regName(ar, len), regName(br, len), condName(cond));
+	releaseIP(ar);
+	releaseIP(br);
+}
 
 void CodeGen::extend32To64(const MOperand* from, const MOperand* to, CodeString* toStr)
 {
@@ -1307,6 +1644,16 @@ void CodeGen::extend32To64(const MOperand* from, const MOperand* to, CodeString*
 	return toStr->addInstruction("SXTW", regName(t, 64), regName(f, 32));
 }
 
+void CodeGen::bitField(const MBitField* inst, CodeString* toStr)
+{
+	auto t = dynamic_cast<const Register*>(inst->operand(0));
+	ASSERT(t != nullptr);
+	int len = inst->width_;
+	auto f = op2reg(inst->operand(1), len, true, toStr);
+	toStr->addInstruction(inst->name(), regName(t, len), regName(f, len), immediate(inst->lsb_), immediate(inst->bits_));
+	releaseIP(f);
+}
+
 void CodeGen::f2i(const MOperand* from, const MOperand* to, CodeString* toStr)
 {
 	auto f = dynamic_cast<const Register*>(from);
@@ -1343,9 +1690,10 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 	auto rr = dynamic_cast<const Register*>(r);
 	ASSERT(lm != nullptr || lr != nullptr);
 	ASSERT(rm != nullptr || rr != nullptr);
+	// 条件比较要使用这次比较设置的 NZCV, 两边都是立即数时也要真正比较
 	if (flt)
 	{
-		if (lm && rm)
+		if (lm && rm && inst->tiedCC_ == nullptr)
 		{
 			bool b = lm->asFloat() > rm->asFloat();
 			bool e = lm->asFloat() == rm->asFloat();
@@ -1355,6 +1703,8 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 					decideCond(inst->tiedB_, 1);
 				if (inst->tiedC_)
 					decideCond(inst->tiedC_, 1);
+				for (auto sel : inst->tiedS_)
+					decideCond(sel, 1);
 			}
 			else if (e)
 			{
@@ -1362,6 +1712,8 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 					decideCond(inst->tiedB_, 0);
 				if (inst->tiedC_)
 					decideCond(inst->tiedC_, 0);
+				for (auto sel : inst->tiedS_)
+					decideCond(sel, 0);
 			}
 			else
 			{
@@ -1369,10 +1721,12 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 					decideCond(inst->tiedB_, -1);
 				if (inst->tiedC_)
 					decideCond(inst->tiedC_, -1);
+				for (auto sel : inst->tiedS_)
+					decideCond(sel, -1);
 			}
 			return;
 		}
-		if (lm && lm->isZero(true, 32))
+		if (lm && rr && lm->isZero(true, 32))
 		{
 			reverseCmpOp(inst);
 			auto reg = getFIP();
@@ -1381,7 +1735,7 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 			releaseIP(reg);
 			return;
 		}
-		if (rm && rm->isZero(true, 32))
+		if (rm && lr && rm->isZero(true, 32))
 		{
 			auto reg = getFIP();
 			copy(reg, zeroRegister(), 32, toStr);
@@ -1396,7 +1750,23 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 		releaseIP(rr);
 		return;
 	}
-	if (lm && rm)
+	if (inst->shift_ != OperandShift::none)
+	{
+		// ShiftFold 合并的移位, 右操作数是寄存器, 不能交换
+		ASSERT(rr != nullptr);
+		lr = op2reg(l, 32, true, toStr);
+		auto shift = printShift(inst->shift_, inst->shiftAmount_);
+		if (inst->tiedC_)
+		{
+			toStr->addInstruction("SUBS", regName(dynamic_cast<const Register*>(inst->tiedC_->def(0)), 32),
+			                      regName(lr, 32), regName(rr, 32), shift);
+			inst->tiedC_->disable_ = true;
+		}
+		toStr->addInstruction("CMP", regName(lr, 32), regName(rr, 32), shift);
+		releaseIP(lr);
+		return;
+	}
+	if (lm && rm && inst->tiedCC_ == nullptr)
 	{
 		bool b = lm->asInt() > rm->asInt();
 		bool e = lm->asInt() == rm->asInt();
@@ -1406,6 +1776,8 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 				decideCond(inst->tiedB_, 1);
 			if (inst->tiedC_)
 				decideCond(inst->tiedC_, 1);
+			for (auto sel : inst->tiedS_)
+				decideCond(sel, 1);
 		}
 		else if (e)
 		{
@@ -1413,6 +1785,8 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 				decideCond(inst->tiedB_, 0);
 			if (inst->tiedC_)
 				decideCond(inst->tiedC_, 0);
+			for (auto sel : inst->tiedS_)
+				decideCond(sel, 0);
 		}
 		else
 		{
@@ -1420,10 +1794,27 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 				decideCond(inst->tiedB_, -1);
 			if (inst->tiedC_)
 				decideCond(inst->tiedC_, -1);
+			for (auto sel : inst->tiedS_)
+				decideCond(sel, -1);
 		}
 		return;
 	}
-	if (lm && (inUImm12(lm->asInt()) || inUImm12L12(lm->asInt())))
+	// 只被跳转使用的与 0 的相等比较不输出, 跳转输出为 CBZ/CBNZ
+	if (inst->tiedB_ && inst->tiedC_ == nullptr && inst->tiedS_.empty() && inst->tiedCC_ == nullptr &&
+		(inst->tiedB_->op_ == Instruction::eq || inst->tiedB_->op_ == Instruction::ne))
+	{
+		if (rm && lr && rm->isZero(false, 32))
+		{
+			inst->tiedB_->zeroTest_ = regName(lr, 32);
+			return;
+		}
+		if (lm && rr && lm->isZero(false, 32))
+		{
+			inst->tiedB_->zeroTest_ = regName(rr, 32);
+			return;
+		}
+	}
+	if (lm && rr && (inUImm12(lm->asInt()) || inUImm12L12(lm->asInt())))
 	{
 		reverseCmpOp(inst);
 		if (inst->tiedC_)
@@ -1436,7 +1827,7 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 			toStr->addInstruction("CMP", regName(rr, 32), immediate(lm->asInt()));
 		return;
 	}
-	if (rm && (inUImm12(rm->asInt()) || inUImm12L12(rm->asInt())))
+	if (rm && lr && (inUImm12(rm->asInt()) || inUImm12L12(rm->asInt())))
 	{
 		if (inst->tiedC_)
 		{
@@ -1461,8 +1852,66 @@ void CodeGen::compare(const MCMP* inst, const MOperand* l, const MOperand* r, bo
 	releaseIP(rr);
 }
 
+void CodeGen::condCompare(const MCCMP* inst, CodeString* toStr)
+{
+	const MOperand* l = inst->operand(0);
+	const MOperand* r = inst->operand(1);
+	// 只有左操作数是立即数时交换, 与 compare 相同
+	if (dynamic_cast<const Immediate*>(l) != nullptr && dynamic_cast<const Immediate*>(r) == nullptr)
+	{
+		reverseCmpOp(inst);
+		swap(l, r);
+	}
+	// 跳过比较时直接设置的 NZCV 由使用者最终的条件决定, 所以在 reverseCmpOp 之后计算
+	auto use = inst->tiedCC_ != nullptr ? inst->tiedCC_->cond_ : inst->tiedB_->op_;
+	auto nzcv = immediate(nzcvFor(use, inst->skipValue_));
+	auto cond = condName(inst->cond_);
+	if (!inst->itff_)
+	{
+		// FCCMP 没有立即数形式, 0 从 WZR 复制
+		auto freg = [this, toStr](const MOperand* op)
+		{
+			if (auto m = dynamic_cast<const Immediate*>(op); m != nullptr && m->isZero(true, 32))
+			{
+				const Register* reg = getFIP();
+				copy(reg, zeroRegister(), 32, toStr);
+				return reg;
+			}
+			return op2reg(op, 32, false, toStr);
+		};
+		auto lr = freg(l);
+		auto rr = freg(r);
+		toStr->addInstruction("FCCMP", regName(lr, 32), regName(rr, 32), nzcv, cond);
+		releaseIP(lr);
+		releaseIP(rr);
+		return;
+	}
+	auto lr = op2reg(l, 32, true, toStr);
+	// CCMP 与 CCMN 的立即数只有 5 位
+	if (auto rm = dynamic_cast<const Immediate*>(r); rm != nullptr && rm->asInt() >= -31 && rm->asInt() <= 31)
+	{
+		if (rm->asInt() >= 0)
+			toStr->addInstruction("CCMP", regName(lr, 32), immediate(rm->asInt()), nzcv, cond);
+		else
+			toStr->addInstruction("CCMN", regName(lr, 32), immediate(-rm->asInt()), nzcv, cond);
+		releaseIP(lr);
+		return;
+	}
+	auto rr = op2reg(r, 32, true, toStr);
+	toStr->addInstruction("CCMP", regName(lr, 32), regName(rr, 32), nzcv, cond);
+	releaseIP(lr);
+	releaseIP(rr);
+}
+
 void CodeGen::reverseCmpOp(const MCMP* inst)
 {
+	if (inst->tiedCC_ != nullptr)
+	{
+		inst->tiedCC_->cond_ = lrShiftOp(inst->tiedCC_->cond_);
+		return;
+	}
+	for (auto sel : inst->tiedS_) sel->op_ = lrShiftOp(sel->op_);
+	if (!inst->tiedS_.empty()) return;
 	auto cset = inst->tiedC_;
 	if (cset != nullptr)
 	{
@@ -1503,6 +1952,77 @@ void CodeGen::sub(const Register* to, const Register* l, const Register* r, int
 	toStr->addInstruction("SUB", regName(to, len), regName(l, len), regName(r, len));
 }
 
+void CodeGen::mathRRInst(const Register* to, const Register* l, const Register* r,
+                         Instruction::OpID op, int len, OperandShift shift, int amount, CodeString* toStr)
+{
+	ASSERT(op == Instruction::add || op == Instruction::sub);
+	ASSERT(shift == OperandShift::sxtw ? len == 64 && amount <= 4 : amount < len);
+	toStr->addInstruction(op == Instruction::add ? "ADD" : "SUB", regName(to, len), regName(l, len),
+	                      regName(r, shift == OperandShift::sxtw ? 32 : len), printShift(shift, amount));
+}
+
+void CodeGen::shiftedMathInst(const MMathInst* inst, CodeString* toStr)
+{
+	auto target = dynamic_cast<const Register*>(inst->operand(0));
+	ASSERT(target != nullptr);
+	int len = inst->width();
+	auto regL = op2reg(inst->operand(1), len, true, toStr);
+	auto regR = dynamic_cast<const Register*>(inst->operand(2));
+	ASSERT(regR != nullptr);
+	mathRRInst(target, regL, regR, inst->op(), len, inst->shift_, inst->shiftAmount_, toStr);
+	releaseIP(regL);
+}
+
+void CodeGen::flagMathInst(const MMathInst* inst, CodeString* toStr)
+{
+	auto target = dynamic_cast<const Register*>(inst->operand(0));
+	ASSERT(target != nullptr && inst->width() == 32);
+	auto op = inst->op();
+	const MOperand* l = inst->operand(1);
+	const MOperand* r = inst->operand(2);
+	// 移位只作用于右操作数, 没有移位的 add 把立即数放到右边
+	if (op == Instruction::add && inst->shift_ == OperandShift::none && dynamic_cast<const Immediate*>(l) != nullptr)
+		swap(l, r);
+	auto name = [](Instruction::OpID o)
+	{
+		return o == Instruction::add ? "ADDS" : o == Instruction::sub ? "SUBS" : "ANDS";
+	};
+	auto regL = op2reg(l, 32, true, toStr);
+	if (auto imm = dynamic_cast<const Immediate*>(r); imm != nullptr)
+	{
+		int v = imm->asInt();
+		auto o = op;
+		// 使用者只看 N 与 Z, 加上负数与减去它的相反数相同
+		if (op != Instruction::and_ && v < 0 && v != INT_MIN)
+		{
+			v = -v;
+			o = op == Instruction::add ? Instruction::sub : Instruction::add;
+		}
+		if (op != Instruction::and_ && inUImm12(v))
+			toStr->addInstruction(name(o), regName(target, 32), regName(regL, 32), immediate(v));
+		else if (op != Instruction::and_ && inUImm12L12(v))
+			toStr->addInstruction(name(o), regName(target, 32), regName(regL, 32), immediate(v >> 12), leftShift12());
+		else if (op == Instruction::and_ && v > 0 && logicalImmediate32(static_cast<unsigned>(v)))
+			toStr->addInstruction(name(op), regName(target, 32), regName(regL, 32), immediate(v));
+		else
+		{
+			auto ip = getIP();
+			makeI32Immediate(imm->asInt(), ip, toStr);
+			toStr->addInstruction(name(op), regName(target, 32), regName(regL, 32), regName(ip, 32));
+			releaseIP(ip);
+		}
+		releaseIP(regL);
+		return;
+	}
+	auto regR = op2reg(r, 32, true, toStr);
+	if (inst->shift_ != OperandShift::none)
+		toStr->addInstruction(name(op), regName(target, 32), regName(regL, 32), regName(regR, 32),
+		                      printShift(inst->shift_, inst->shiftAmount_));
+	else toStr->addInstruction(name(op), regName(target, 32), regName(regL, 32), regName(regR, 32));
+	releaseIP(regL);
+	releaseIP(regR);
+}
+
 void CodeGen::mathRRInst(const Register* to, const Register* l, const Register* r,
                          Instruction::OpID op, int len, CodeString* toStr)
 {
@@ -1629,7 +2149,8 @@ void CodeGen::copy(const MOperand* to, const MOperand* from, int len, CodeString
 void CodeGen::copy(const Register* to, const GlobalAddress* from, int len, CodeString* toStr)
 {
 	ASSERT(len == 64);
-	return toStr->addInstruction("LDR", regName(to, 64), "=" + from->name_);
+	toStr->addInstruction("ADRP", regName(to, 64), from->name_);
+	toStr->addInstruction("ADD", regName(to, 64), regName(to, 64), ":lo12:" + from->name_);
 }
 
 void CodeGen::copy(const Register* to, const FrameIndex* from, int len, CodeString* toStr)
@@ -1653,6 +2174,10 @@ void CodeGen::makeInstruction(MInstruction* instruction)
 	}
 	else if (auto i3 = dynamic_cast<MLDR*>(instruction); i3 != nullptr)
 		ldr(instruction->operands()[0], instruction->operands()[1], (i3->width()), toStr);
+	else if (auto i21 = dynamic_cast<MIndexedMem*>(instruction); i21 != nullptr)
+		indexedMem(i21, dynamic_cast<MLDRIdx*>(instruction) != nullptr, toStr);
+	else if (auto i22 = dynamic_cast<MPairMem*>(instruction); i22 != nullptr)
+		pairMem(i22, dynamic_cast<MLDP*>(instruction) != nullptr, toStr);
 	else if (auto i4 = dynamic_cast<MST1V16B*>(instruction); i4 != nullptr)
 		st1(instruction->operands()[0], i4->storeCount_, i4->offset_, toStr);
 	else if (auto i5 = dynamic_cast<MLD1V16B*>(instruction); i5 != nullptr)
@@ -1660,13 +2185,22 @@ void CodeGen::makeInstruction(MInstruction* instruction)
 	else if (auto i6 = dynamic_cast<MST1ZTV16B*>(instruction); i6 != nullptr)
 		clearV(i6->loadCount_, toStr);
 	else if (auto i7 = dynamic_cast<MMathInst*>(instruction); i7 != nullptr)
-		mathInst(instruction->operands()[0], instruction->operands()[1], instruction->operands()[2], i7->op(),
-		         (i7->width()),
-		         toStr);
+	{
+		if (i7->setFlags_)
+			flagMathInst(i7, toStr);
+		else if (i7->shift_ != OperandShift::none)
+			shiftedMathInst(i7, toStr);
+		else
+			mathInst(instruction->operands()[0], instruction->operands()[1], instruction->operands()[2], i7->op(),
+			         (i7->width()),
+			         toStr);
+	}
 	else if (auto i8 = dynamic_cast<MBL*>(instruction); i8 != nullptr)
 		call(instruction->operands()[0], toStr);
 	else if (auto i9 = dynamic_cast<MRet*>(instruction); i9 != nullptr)
 		ret(toStr);
+	else if (auto i20 = dynamic_cast<MCCMP*>(instruction); i20 != nullptr)
+		condCompare(i20, toStr);
 	else if (auto i12 = dynamic_cast<MCMP*>(instruction); i12 != nullptr)
 		compare(i12, i12->operands()[0], i12->operands()[1], !i12->itff_, toStr);
 	else if (auto i13 = dynamic_cast<MCSET*>(instruction); i13 != nullptr)
@@ -1674,12 +2208,16 @@ void CodeGen::makeInstruction(MInstruction* instruction)
 		if (!i13->disable_)
 			cset(i13->operands()[0], i13->op_, toStr);
 	}
+	else if (auto i19 = dynamic_cast<MCSEL*>(instruction); i19 != nullptr)
+		csel(i19, toStr);
 	else if (auto i14 = dynamic_cast<MFCVTZS*>(instruction); i14 != nullptr)
 		f2i(i14->operands()[1], i14->operands()[0], toStr);
 	else if (auto i15 = dynamic_cast<MSCVTF*>(instruction); i15 != nullptr)
 		i2f(i15->operands()[1], i15->operands()[0], toStr);
 	else if (auto i16 = dynamic_cast<MSXTW*>(instruction); i16 != nullptr)
 		extend32To64(i16->operands()[0], i16->operands()[1], toStr);
+	else if (auto i23 = dynamic_cast<MBitField*>(instruction); i23 != nullptr)
+		bitField(i23, toStr);
 	else if (auto i10 = dynamic_cast<MB*>(instruction); i10 != nullptr)
 	{
 	}
@@ -1756,7 +2294,9 @@ void CodeGen::decideCond(MInstruction* instruction, int cond)
 	Instruction::OpID op;
 	auto b = dynamic_cast<MB*>(instruction);
 	auto cset = dynamic_cast<MCSET*>(instruction);
+	auto sel = dynamic_cast<MCSEL*>(instruction);
 	if (b != nullptr) op = b->op_;
+	else if (sel != nullptr) op = sel->op_;
 	else
 	{
 		ASSERT(cset);
@@ -1799,7 +2339,8 @@ void CodeGen::decideCond(MInstruction* instruction, int cond)
 	}
 	op = Instruction::add;
 	if (!ok) op = Instruction::sub;
-	if (b == nullptr) cset->op_ = op;
+	if (sel != nullptr) sel->op_ = op;
+	else if (b == nullptr) cset->op_ = op;
 	else
 	{
 		if (!ok) b->removeL();
@@ -2060,11 +2601,25 @@ std::string CodeGen::regDataOffset(const Register* reg, int offset)
 	return "[" + reg->name_ + ", " + immediate(offset) + "]";
 }
 
+std::string CodeGen::globalSymbol(const GlobalAddress* glob, long long offset)
+{
+	if (offset == 0) return glob->name_;
+	return glob->name_ + (offset > 0 ? "+" : "") + to_string(offset);
+}
+
 std::string CodeGen::regDataRegLSLOffset(const Register* reg, const Register* regofs, int offset)
 {
 	return "[" + reg->name_ + ", " + regofs->name_ + ", " + leftShift(offset) + "]";
 }
 
+std::string CodeGen::regDataRegExtendOffset(const Register* reg, const Register* regofs, bool sxtw, int shift)
+{
+	auto ret = "[" + reg->name_ + ", " + regName(regofs, sxtw ? 32 : 64);
+	if (sxtw) ret += shift == 0 ? ", SXTW" : ", SXTW #" + to_string(shift);
+	else if (shift != 0) ret += ", " + leftShift(shift);
+	return ret + "]";
+}
+
 std::string CodeGen::regData(const Register* reg)
 {
 	return "[" + reg->name_ + "]";
@@ -2274,14 +2829,27 @@ void CodeGen::releaseBuf(int id)
 	opbuffer[id] = nullptr;
 }
 
-CodeGen::CodeGen(MModule* m): MachinePass(m)
+CodeGen::CodeGen(MModule* m, const Part part): MachinePass(m), part_(part)
 {
 }
 
 void CodeGen::run()
+{
+	if (part_ == WHOLE_MODULE || part_ == GLOBALS) makeGlobals();
+	if (part_ == WHOLE_MODULE || part_ == FUNCTIONS)
+	{
+		for (auto& f : m_->functions())
+		{
+			func_ = f;
+			makeFunction();
+		}
+	}
+	if (part_ == WHOLE_MODULE || part_ == LIBRARY) makeLibrary();
+}
+
+void CodeGen::makeGlobals()
 {
 	m_->modulePrefix_ = new CodeString{};
-	m_->moduleSuffix_ = new CodeString{};
 	if (const auto globalConstants = m_->constGlobalAddresses(); !globalConstants.empty())
 	{
 		m_->modulePrefix_->addSection("section .rodata, \"a\", @progbits");
@@ -2302,14 +2870,24 @@ void CodeGen::run()
 	}
 	m_->modulePrefix_->addSection("text");
 	m_->modulePrefix_->addAlign(4, false);
+	if (!incbinData_.empty())
+	{
+		ofstream bin{globalDataIncbinFile, ios::binary};
+		if (!bin) throw runtime_error("can not open file " + globalDataIncbinFile);
+		bin.write(incbinData_.data(), static_cast<streamsize>(incbinData_.size()));
+	}
+}
+
+void CodeGen::makeLibrary()
+{
+	m_->moduleSuffix_ = new CodeString{};
+	// 逐函数编译时调用者的函数体可能已经释放, 但调用关系仍然保留
 	bool haveMemcpy = false;
 	bool haveMemclr = false;
 	int cpid = m_->memcpy_->id();
 	int clid = m_->memclr_->id();
-	for (auto& f : m_->functions())
+	for (auto& f : m_->all_funcs())
 	{
-		func_ = f;
-		makeFunction();
 		if (!haveMemcpy && f->called().test(cpid)) haveMemcpy = true;
 		if (!haveMemclr && f->called().test(clid)) haveMemclr = true;
 	}
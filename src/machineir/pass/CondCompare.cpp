@@ -0,0 +1,161 @@
+#include "CondCompare.hpp"
+
+#include <stdexcept>
+
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "MachineInstruction.hpp"
+#include "MachineOperand.hpp"
+
+#define DEBUG 0
+#include "Util.hpp"
+
+using namespace std;
+
+namespace
+{
+	// 条件取反
+	Instruction::OpID invertOp(Instruction::OpID op)
+	{
+		switch (op) // NOLINT(clang-diagnostic-switch-enum)
+		{
+			case Instruction::ge: return Instruction::lt;
+			case Instruction::gt: return Instruction::le;
+			case Instruction::le: return Instruction::gt;
+			case Instruction::lt: return Instruction::ge;
+			case Instruction::eq: return Instruction::ne;
+			case Instruction::ne: return Instruction::eq;
+			default: break;
+		}
+		throw runtime_error("invalid op");
+	}
+
+	// a 与 b 都只有一个前驱, 只做相同的复制后跳转到同一个块时, 经过它们的效果相同.
+	// 跳转的目标有 phi 时 CriticalEdgeRemove 为每条边插入这样的块
+	bool sameForward(MBasicBlock* a, MBasicBlock* b)
+	{
+		if (a == b || a->pre_bbs().size() != 1 || b->pre_bbs().size() != 1) return false;
+		auto& ai = a->instructions();
+		auto& bi = b->instructions();
+		if (ai.empty() || ai.size() != bi.size()) return false;
+		for (size_t i = 0; i + 1 < ai.size(); i++)
+		{
+			auto ac = dynamic_cast<MCopy*>(ai[i]);
+			auto bc = dynamic_cast<MCopy*>(bi[i]);
+			if (ac == nullptr || bc == nullptr || ac->operand(0) != bc->operand(0) || ac->operand(1) != bc->operand(1) ||
+				ac->copy_len() != bc->copy_len())
+				return false;
+		}
+		auto ab = dynamic_cast<MB*>(ai.back());
+		auto bb = dynamic_cast<MB*>(bi.back());
+		return ab != nullptr && bb != nullptr && !ab->isCondBranch() && !bb->isCondBranch() &&
+			ab->block2GoL() == bb->block2GoL();
+	}
+
+	// 两边都是立即数的比较由 CodeGen 在编译期决定, 不参与合并
+	bool bothImmediate(const MCMP* cmp)
+	{
+		return dynamic_cast<Immediate*>(cmp->operand(0)) != nullptr &&
+			dynamic_cast<Immediate*>(cmp->operand(1)) != nullptr;
+	}
+}
+
+void CondCompare::run()
+{
+	for (auto f : m_->functions())
+	{
+		if (f->blocks().empty()) continue;
+		f_ = f;
+		LOG(color::cyan("CondCompare of Func ") + f->name());
+		// 合并会删除块, 按下标遍历, 被删除的总是当前块之外的块
+		for (size_t i = 0; i < f->blocks().size(); i++)
+		{
+			auto bb = f->blocks()[i];
+			while (runOnBlock(bb))
+			{
+			}
+			i = static_cast<size_t>(bb->id());
+		}
+	}
+}
+
+MB* CondCompare::condBranch(MBasicBlock* bb)
+{
+	auto& insts = bb->instructions();
+	if (insts.size() < 2) return nullptr;
+	auto b = dynamic_cast<MB*>(insts.back());
+	if (b == nullptr || !b->isCondBranch() || b->block2GoL() == b->block2GoR()) return nullptr;
+	auto cmp = b->tiedWith_;
+	if (cmp == nullptr || insts[insts.size() - 2] != cmp) return nullptr;
+	if (cmp->tiedB_ != b || cmp->tiedC_ != nullptr || !cmp->tiedS_.empty() || bothImmediate(cmp)) return nullptr;
+	return b;
+}
+
+bool CondCompare::runOnBlock(MBasicBlock* bb) const
+{
+	auto b1 = condBranch(bb);
+	if (b1 == nullptr) return false;
+	auto l1 = b1->block2GoL();
+	auto r1 = b1->block2GoR();
+	// next 是 bb 跳转到的比较块, skip 是 bb 直接跳转到的块
+	for (auto [next, skip] : {pair{l1, r1}, pair{r1, l1}})
+	{
+		if (next == bb || next->pre_bbs().size() != 1 || next->instructions().size() != 2) continue;
+		auto b2 = condBranch(next);
+		if (b2 == nullptr || dynamic_cast<MCCMP*>(b2->tiedWith_) != nullptr) continue;
+		// dup 是 next 中与 skip 等价的目标, 合并后 next 的跳转改为去往 skip, dup 随之删除
+		auto l2 = b2->block2GoL();
+		auto r2 = b2->block2GoR();
+		MBasicBlock* dup = nullptr;
+		if (l2 != skip && r2 != skip)
+		{
+			if (sameForward(skip, l2)) dup = l2;
+			else if (sameForward(skip, r2)) dup = r2;
+			else continue;
+		}
+		LOG(color::green("Merge compare of ") + next->name() + color::green(" into ") + bb->name());
+
+		// bb 的比较满足 cond 时去往 next, 此时才比较; 否则 next 的跳转应去往 skip
+		auto cmp1 = b1->tiedWith_;
+		auto cmp2 = b2->tiedWith_;
+		auto cond = next == l1 ? b1->op() : invertOp(b1->op());
+		auto l = l2 == dup ? skip : l2;
+		auto r = r2 == dup ? skip : r2;
+		auto cc = new MCCMP{bb, cmp2->operand(0), cmp2->operand(1), cmp2->itff_, cond, l == skip};
+		auto b = new MB{bb, b2->op(), BlockAddress::get(l), BlockAddress::get(r)};
+		// cmp1 也是条件比较时, 它跳过时要使 b1 的条件取的值, 对 cond 而言可能相反
+		if (auto cc1 = dynamic_cast<MCCMP*>(cmp1); cc1 != nullptr && next != l1) cc1->skipValue_ = !cc1->skipValue_;
+		cmp1->tiedB_ = nullptr;
+		cmp1->tiedCC_ = cc;
+		cc->tiedWith_ = cmp1;
+		cc->tiedB_ = b;
+		b->tiedWith_ = cc;
+		b1->tiedWith_ = nullptr;
+		bb->removeInst(b1);
+		bb->instructions().emplace_back(cc);
+		bb->instructions().emplace_back(b);
+		next->removeInst(b2);
+		next->removeInst(cmp2);
+
+		bb->suc_bbs().erase(next);
+		next->pre_bbs().clear();
+		for (auto suc : next->suc_bbs())
+		{
+			suc->pre_bbs().erase(next);
+			if (suc == dup) continue;
+			suc->pre_bbs().emplace(bb);
+			bb->suc_bbs().emplace(suc);
+		}
+		next->suc_bbs().clear();
+		f_->removeBlock(next);
+		if (dup != nullptr)
+		{
+			while (!dup->instructions().empty()) dup->removeInst(dup->instructions().back());
+			for (auto suc : dup->suc_bbs()) suc->pre_bbs().erase(dup);
+			dup->suc_bbs().clear();
+			f_->removeBlock(dup);
+		}
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,479 @@
+#include "CostModel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "CodeString.hpp"
+#include "Config.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "MachineInstruction.hpp"
+#include "MachineModule.hpp"
+
+using namespace std;
+
+namespace
+{
+	// 寄存器编号: X0-X30 为 0-30, SP 为 31, V0-V31 为 32-63, NZCV 为 64
+	constexpr int SP_REG = 31;
+	constexpr int FLOAT_REG_BEGIN = 32;
+	constexpr int NZCV = 64;
+	constexpr int REG_COUNT = 65;
+	constexpr int NOT_REG = -2;
+	constexpr int ZERO_REG = -1;
+	// 每周期发射的指令数与重排序缓冲的大小
+	constexpr int DISPATCH_WIDTH = 3;
+	constexpr int ROB_SIZE = 128;
+	// 循环体的模拟次数
+	constexpr int LOOP_ITERATIONS = 100;
+
+	constexpr unsigned bit(const CostModel::Port p)
+	{
+		return 1u << p;
+	}
+
+	constexpr unsigned INT_PORTS = bit(CostModel::I0) | bit(CostModel::I1);
+	constexpr unsigned FP_PORTS = bit(CostModel::F0) | bit(CostModel::F1);
+
+	string trim(const string& s)
+	{
+		size_t b = 0, e = s.size();
+		while (b < e && isspace(static_cast<unsigned char>(s[b]))) b++;
+		while (e > b && isspace(static_cast<unsigned char>(s[e - 1]))) e--;
+		return s.substr(b, e - b);
+	}
+
+	// 解析寄存器名, 不是寄存器返回 NOT_REG, 零寄存器返回 ZERO_REG
+	int regId(const string& token)
+	{
+		string t;
+		for (char c : token)
+		{
+			if (c == '.' || c == '[') break;
+			t += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+		}
+		if (t == "SP" || t == "WSP") return SP_REG;
+		if (t == "WZR" || t == "XZR") return ZERO_REG;
+		if (t.size() < 2 || !all_of(t.begin() + 1, t.end(), [](const char c) { return isdigit(c) != 0; }))
+			return NOT_REG;
+		const int n = stoi(t.substr(1));
+		switch (t[0])
+		{
+			case 'W':
+			case 'X':
+				return n <= 30 ? n : NOT_REG;
+			case 'B':
+			case 'H':
+			case 'S':
+			case 'D':
+			case 'Q':
+			case 'V':
+				return n <= 31 ? FLOAT_REG_BEGIN + n : NOT_REG;
+			default:
+				return NOT_REG;
+		}
+	}
+
+	bool isFloatReg(const int r)
+	{
+		return r >= FLOAT_REG_BEGIN && r < NZCV;
+	}
+
+	// 按顶层的逗号切分操作数, 不切分 [] 与 {} 内部
+	vector<string> splitOperands(const string& s)
+	{
+		vector<string> ret;
+		int depth = 0;
+		string cur;
+		for (char c : s)
+		{
+			if (c == '[' || c == '{') depth++;
+			else if (c == ']' || c == '}') depth--;
+			if (c == ',' && depth == 0)
+			{
+				ret.emplace_back(trim(cur));
+				cur.clear();
+				continue;
+			}
+			cur += c;
+		}
+		if (!trim(cur).empty()) ret.emplace_back(trim(cur));
+		return ret;
+	}
+
+	// 操作数中的所有寄存器
+	vector<int> regsIn(const string& operand)
+	{
+		vector<int> ret;
+		string token;
+		auto flush = [&]
+		{
+			const int r = regId(token);
+			if (r >= 0) ret.emplace_back(r);
+			token.clear();
+		};
+		for (char c : operand)
+		{
+			if (c == '[' || c == ']' || c == '{' || c == '}' || c == ',' || c == '!' || isspace(
+				static_cast<unsigned char>(c)))
+				flush();
+			else token += c;
+		}
+		flush();
+		return ret;
+	}
+
+	bool startsWith(const string& s, const char* prefix)
+	{
+		return s.compare(0, strlen(prefix), prefix) == 0;
+	}
+
+	bool oneOf(const string& s, const unordered_set<string>& set)
+	{
+		return set.count(s) != 0;
+	}
+}
+
+CostModel::CostModel(MModule* m) : MachinePass(m), detect_(m)
+{
+	if (mcaReportFile.empty()) out_ = &cerr;
+	else
+	{
+		file_.open(mcaReportFile);
+		out_ = &file_;
+	}
+}
+
+string CostModel::portName(const int port)
+{
+	static const char* names[] = {"B", "I0", "I1", "M", "L", "S", "F0", "F1"};
+	return names[port];
+}
+
+bool CostModel::parse(const string& line, Uop& uop)
+{
+	const string text = trim(line);
+	if (text.empty() || text[0] == '.' || text.back() == ':' || text[0] == '/' || text[0] == '#') return false;
+	size_t split = 0;
+	while (split < text.size() && !isspace(static_cast<unsigned char>(text[split]))) split++;
+	string op = text.substr(0, split);
+	transform(op.begin(), op.end(), op.begin(), [](const unsigned char c) { return static_cast<char>(toupper(c)); });
+	const auto operands = splitOperands(text.substr(split));
+
+	uop = Uop{1, INT_PORTS, 1, {}, {}};
+	// 操作数的读写
+	static const unordered_set<string> compares = {"CMP", "CMN", "TST", "FCMP", "FCMPE", "CCMP", "CCMN", "FCCMP"};
+	static const unordered_set<string> readFlags = {
+		"CSEL", "CSET", "CSETM", "CSINC", "CSINV", "CSNEG", "CINC", "CINV", "CNEG", "FCSEL", "ADC", "SBC", "ADCS",
+		"SBCS", "CCMP", "CCMN", "FCCMP"
+	};
+	static const unordered_set<string> writeFlags = {"ADDS", "SUBS", "ANDS", "BICS", "NEGS", "ADCS", "SBCS"};
+	static const unordered_set<string> readDst = {"MOVK", "BFI", "BFXIL", "INS"};
+	const bool isBranch = op == "B" || op == "BL" || op == "BLR" || op == "BR" || op == "RET" || op == "CBZ" || op
+		== "CBNZ" || op == "TBZ" || op == "TBNZ" || startsWith(op, "B.");
+	const bool isLoad = startsWith(op, "LD");
+	const bool isStore = startsWith(op, "ST");
+	const bool isCompare = oneOf(op, compares);
+
+	int dstCount = 1;
+	if (isBranch || isStore || isCompare) dstCount = 0;
+	else if (op == "LDP" || op == "LDNP" || op == "LDPSW") dstCount = 2;
+	bool afterMemory = false;
+	for (size_t i = 0; i < operands.size(); i++)
+	{
+		const string& o = operands[i];
+		auto regs = regsIn(o);
+		if (o[0] == '[')
+		{
+			// 地址寄存器, 前变址 [Xn, #i]! 与后变址 [Xn], #i 会写回基址
+			for (int r : regs) uop.srcs.emplace_back(r);
+			const bool writeBack = o.back() == '!' || (i + 1 < operands.size() && operands[i + 1][0] == '#');
+			if (writeBack && !regs.empty()) uop.dsts.emplace_back(regs.front());
+			afterMemory = true;
+			continue;
+		}
+		if (o[0] == '{')
+		{
+			for (int r : regs)
+			{
+				if (isLoad) uop.dsts.emplace_back(r);
+				else uop.srcs.emplace_back(r);
+			}
+			continue;
+		}
+		if (afterMemory) continue;
+		for (int r : regs)
+		{
+			if (static_cast<int>(i) < dstCount)
+			{
+				uop.dsts.emplace_back(r);
+				if (oneOf(op, readDst)) uop.srcs.emplace_back(r);
+			}
+			else uop.srcs.emplace_back(r);
+		}
+	}
+	if (isCompare || oneOf(op, writeFlags)) uop.dsts.emplace_back(NZCV);
+	if (oneOf(op, readFlags) || startsWith(op, "B.")) uop.srcs.emplace_back(NZCV);
+	if (op == "RET") uop.srcs.emplace_back(30);
+	if (op == "BL" || op == "BLR")
+	{
+		// 调用的内部不做分析, 只认为它定义了返回值与 LR
+		uop.dsts = {0, FLOAT_REG_BEGIN, 30};
+	}
+
+	// 第一个操作数的寄存器决定宽度与类别
+	const int first = operands.empty() ? NOT_REG : regId(operands[0]);
+	const bool wide = !operands.empty() && toupper(static_cast<unsigned char>(operands[0][0])) == 'X';
+	const bool floatDst = isFloatReg(first);
+	bool gprSrc = false;
+	bool fpSrc = false;
+	for (size_t i = 1; i < operands.size(); i++)
+	{
+		const int r = regId(operands[i]);
+		if (r >= 0 && !isFloatReg(r)) gprSrc = true;
+		if (isFloatReg(r)) fpSrc = true;
+	}
+	bool shifted = false;
+	for (auto& o : operands)
+		if (startsWith(o, "LSL #") || startsWith(o, "LSR #") || startsWith(o, "ASR #") || startsWith(o, "ROR #") ||
+			startsWith(o, "SXTW") || startsWith(o, "UXTW") || startsWith(o, "SXTB") || startsWith(o, "SXTH") ||
+			startsWith(o, "UXTB") || startsWith(o, "UXTH"))
+			shifted = true;
+
+	auto set = [&uop](const int latency, const unsigned ports, const int occupancy = 1)
+	{
+		uop.latency = latency;
+		uop.ports = ports;
+		uop.occupancy = occupancy;
+	};
+	if (isBranch) set(1, bit(B));
+	else if (isLoad) set(floatDst ? 5 : 4, bit(L), op == "LDP" && operands[0][0] == 'Q' ? 2 : 1);
+	else if (isStore) set(1, bit(S), op == "STP" && operands[0][0] == 'Q' ? 2 : 1);
+	else if (op == "MUL" || op == "MADD" || op == "MSUB" || op == "MNEG" || op == "SMULL" || op == "UMULL" ||
+		op == "SMADDL" || op == "UMADDL" || op == "SMSUBL" || op == "SMULH" || op == "UMULH")
+		set(wide ? 5 : 3, bit(M), wide ? 3 : 1);
+	else if (op == "SDIV" || op == "UDIV") set(wide ? 12 : 8, bit(M), wide ? 12 : 8);
+	else if (op == "FDIV")
+	{
+		const int latency = !operands.empty() && toupper(static_cast<unsigned char>(operands[0][0])) == 'D' ? 12 : 8;
+		set(latency, bit(F0), latency);
+	}
+	else if (op == "FSQRT") set(12, bit(F0), 12);
+	else if (op == "FMADD" || op == "FMSUB" || op == "FNMADD" || op == "FNMSUB" || op == "FMLA" || op == "FMLS")
+		set(7, FP_PORTS);
+	else if (op == "FADD" || op == "FSUB" || op == "FMUL" || op == "FNMUL" || op == "FABD" || op == "FMAX" || op ==
+		"FMIN" || op == "FMAXNM" || op == "FMINNM")
+		set(4, FP_PORTS);
+	else if (op == "FCMP" || op == "FCMPE" || op == "FCCMP") set(3, bit(F1));
+	else if (op == "FMOV")
+	{
+		// 通用寄存器与浮点寄存器之间的传送
+		if (floatDst != fpSrc && (gprSrc || !floatDst)) set(5, bit(L));
+		else set(3, FP_PORTS);
+	}
+	else if (startsWith(op, "FCVT") && !floatDst) set(10, bit(F0));
+	else if ((op == "SCVTF" || op == "UCVTF") && gprSrc) set(10, bit(F0));
+	else if (op[0] == 'F' || op == "SCVTF" || op == "UCVTF" || floatDst) set(3, FP_PORTS);
+	else if (op == "UMOV" || op == "SMOV" || (op == "MOV" && fpSrc)) set(5, bit(L));
+	else if (op == "NOP") set(0, INT_PORTS);
+	else if (shifted) set(2, bit(M));
+	return true;
+}
+
+CostModel::Estimate CostModel::simulate(const vector<Uop>& uops, const int iterations)
+{
+	Estimate est;
+	est.instructions = static_cast<int>(uops.size());
+	if (uops.empty() || iterations <= 0) return est;
+	array<long long, REG_COUNT> regReady{};
+	array<long long, PORT_COUNT> portFree{};
+	array<long long, PORT_COUNT> portBusy{};
+	vector<long long> rob(ROB_SIZE, 0);
+	long long cycle = 0, end = 0;
+	int slots = 0;
+	long long index = 0;
+	for (int it = 0; it < iterations; it++)
+	{
+		for (auto& u : uops)
+		{
+			// 按程序顺序每周期发射 DISPATCH_WIDTH 条, 且重排序缓冲已满时等待最旧的指令完成
+			long long& oldest = rob[index++ % ROB_SIZE];
+			if (slots == DISPATCH_WIDTH)
+			{
+				cycle++;
+				slots = 0;
+			}
+			if (oldest > cycle)
+			{
+				cycle = oldest;
+				slots = 0;
+			}
+			slots++;
+			long long ready = cycle;
+			for (int r : u.srcs) ready = max(ready, regReady[r]);
+			int port = -1;
+			long long issue = 0;
+			for (int p = 0; p < PORT_COUNT; p++)
+			{
+				if (!(u.ports & 1u << p)) continue;
+				// 同时可用时选累计占用较少的端口, 使 I0/I1, F0/F1 的压力均衡
+				const long long at = max(ready, portFree[p]);
+				if (port < 0 || at < issue || (at == issue && portBusy[p] < portBusy[port]))
+				{
+					port = p;
+					issue = at;
+				}
+			}
+			portFree[port] = issue + u.occupancy;
+			portBusy[port] += u.occupancy;
+			const long long done = issue + u.latency;
+			for (int r : u.dsts) regReady[r] = done;
+			oldest = max(done, issue + 1);
+			end = max(end, oldest);
+		}
+	}
+	est.cycles = static_cast<double>(end) / iterations;
+	for (int p = 0; p < PORT_COUNT; p++) est.pressure[p] = static_cast<double>(portBusy[p]) / iterations;
+	// 一组端口的下界: 只能在这组端口上执行的指令的总占用平均分到每个端口
+	unsigned hottest = 0;
+	double bound = 0;
+	unordered_map<unsigned, int> demands;
+	for (auto& u : uops) demands[u.ports] += u.occupancy;
+	for (auto& [group, ignored] : demands)
+	{
+		int demand = 0;
+		for (auto& [ports, occupancy] : demands) if ((ports & ~group) == 0) demand += occupancy;
+		int width = 0;
+		for (int p = 0; p < PORT_COUNT; p++) if (group & 1u << p) width++;
+		const double b = static_cast<double>(demand) / width;
+		if (b > bound)
+		{
+			bound = b;
+			hottest = group;
+		}
+	}
+	if (bound >= 0.95 * est.cycles)
+	{
+		for (int p = 0; p < PORT_COUNT; p++)
+		{
+			if (!(hottest & 1u << p)) continue;
+			if (!est.bottleneck.empty()) est.bottleneck += "+";
+			est.bottleneck += portName(p);
+		}
+	}
+	else if (static_cast<double>(est.instructions) / DISPATCH_WIDTH >= 0.95 * est.cycles) est.bottleneck = "dispatch";
+	else est.bottleneck = "latency";
+	return est;
+}
+
+void CostModel::run()
+{
+	for (auto f : m_->functions())
+	{
+		func_ = f;
+		runOnFunc();
+	}
+}
+
+void CostModel::collectBlock(MBasicBlock* bb)
+{
+	// 与 MModule 的输出一致: 块前缀, 每条指令, 以及布局决定的跳转
+	ostringstream os;
+	if (bb->blockPrefix_) os << bb->blockPrefix_;
+	for (auto inst : bb->instructions()) os << inst->str;
+	if (int c = bb->instructions().empty() ? 0 : bb->needBranchCount())
+	{
+		auto br = dynamic_cast<MB*>(bb->instructions().back());
+		if (br->isCondBranch())
+		{
+			if (!br->zeroTest_.empty()) os << "\tCBZ " << br->zeroTest_ << '\n';
+			else os << "\tB.cond\n";
+			if (c > 1) os << "\tB\n";
+		}
+		else os << "\tB\n";
+	}
+	auto& uops = blockUops_[bb->id()];
+	istringstream in{os.str()};
+	string line;
+	Uop uop;
+	while (getline(in, line)) if (parse(line, uop)) uops.emplace_back(uop);
+}
+
+double CostModel::runOnLoop(MachineLoop* loop, const int depth)
+{
+	DynamicBitset own = loop->get_blocks();
+	for (auto sub : loop->get_sub_loops()) own -= sub->get_blocks();
+	vector<Uop> body;
+	int blocks = 0;
+	for (auto bb : own)
+	{
+		body.insert(body.end(), blockUops_[bb].begin(), blockUops_[bb].end());
+		blocks++;
+	}
+	const Estimate est = simulate(body, LOOP_ITERATIONS);
+	auto& out = *out_;
+	out << "mca-loop " << func_->name() << " " << names_[loop->get_header()->id()] << " depth " << depth << " blocks " <<
+		blocks << " instructions " << est.instructions << " cycles/iter " << est.cycles << " ipc " <<
+		(est.cycles > 0 ? est.instructions / est.cycles : 0) << " bottleneck " << est.bottleneck << " pressure";
+	for (int p = 0; p < PORT_COUNT; p++) out << " " << portName(p) << "=" << est.pressure[p];
+	out << "\n";
+	double perIteration = est.cycles;
+	for (auto sub : MachineLoopDetection::byHeader(loop->get_sub_loops())) perIteration += runOnLoop(sub, depth + 1);
+	return perIteration * useMultiplierPerLoop;
+}
+
+void CostModel::runOnFunc()
+{
+	auto& blocks = func_->blocks();
+	const MachineLoopDetection::PreserveBlocks preserve{func_};
+	names_ = preserve.names();
+	detect_.run_on_func(func_);
+
+	blockUops_.assign(blocks.size(), {});
+	int instructions = 0;
+	for (auto bb : blocks)
+	{
+		collectBlock(bb);
+		instructions += static_cast<int>(blockUops_[bb->id()].size());
+	}
+	// 循环之外的代码(含序言与尾声)只执行一次, 按延迟计算
+	vector<Uop> straight;
+	auto append = [&straight](const CodeString* str)
+	{
+		if (str == nullptr) return;
+		ostringstream os;
+		os << str;
+		istringstream in{os.str()};
+		string line;
+		Uop uop;
+		while (getline(in, line)) if (parse(line, uop)) straight.emplace_back(uop);
+	};
+	append(func_->funcPrefix_);
+	DynamicBitset inLoop{static_cast<int>(blocks.size())};
+	for (auto loop : detect_.get_loops()) inLoop |= loop->get_blocks();
+	for (auto bb : blocks)
+		if (!inLoop.test(bb->id()))
+			straight.insert(straight.end(), blockUops_[bb->id()].begin(), blockUops_[bb->id()].end());
+	append(func_->funcSuffix_);
+
+	// 函数的总计写在各个循环的报告之前
+	ostringstream loops;
+	auto out = out_;
+	out_ = &loops;
+	loops << fixed << setprecision(2);
+	double total = simulate(straight, 1).cycles;
+	vector<MachineLoop*> tops;
+	for (auto loop : detect_.get_loops()) if (loop->get_parent() == nullptr) tops.emplace_back(loop);
+	for (auto loop : MachineLoopDetection::byHeader(tops)) total += runOnLoop(loop, 1);
+	out_ = out;
+	*out_ << fixed << setprecision(2) << "mca-function " << func_->name() << " blocks " << blocks.size() <<
+		" loops " << detect_.get_loops().size() << " instructions " << instructions << " cycles " << total << "\n" <<
+		loops.str();
+}
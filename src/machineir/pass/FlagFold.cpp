@@ -0,0 +1,102 @@
+#include "FlagFold.hpp"
+
+#include <algorithm>
+
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "MachineInstruction.hpp"
+#include "MachineOperand.hpp"
+
+#define DEBUG 0
+#include "Util.hpp"
+
+using namespace std;
+
+namespace
+{
+	bool isZero(const MOperand* op)
+	{
+		auto imm = dynamic_cast<const Immediate*>(op);
+		return imm != nullptr && imm->isZero(false, 32);
+	}
+
+	bool defines(MInstruction* inst, const MOperand* op)
+	{
+		for (auto d : inst->def()) if (inst->operand(d) == op) return true;
+		for (auto r : inst->imp_def()) if (r == op) return true;
+		return false;
+	}
+
+	bool usesOrDefines(MInstruction* inst, const Register* reg)
+	{
+		for (auto r : inst->imp_use()) if (r == reg) return true;
+		return defines(inst, reg);
+	}
+
+	// 用 op 设置的 NZCV 代替与 0 比较的结果时, 条件 cond 不变
+	bool compatible(Instruction::OpID cond, Instruction::OpID op)
+	{
+		return cond == Instruction::eq || cond == Instruction::ne || op == Instruction::and_;
+	}
+}
+
+void FlagFold::run()
+{
+	nzcv_ = Register::getNZCV(m_);
+	for (auto f : m_->functions())
+	{
+		LOG(color::cyan("FlagFold of Func ") + f->name());
+		for (auto bb : f->blocks())
+		{
+			vector<MCMP*> cmps;
+			for (auto inst : bb->instructions())
+			{
+				auto cmp = dynamic_cast<MCMP*>(inst);
+				// CSET 由 CodeGen 与比较一起输出为 SUBS, 条件比较链的第一个比较还被 CCMP 记录
+				if (cmp == nullptr || dynamic_cast<MCCMP*>(inst) != nullptr || !cmp->itff_ ||
+					cmp->shift_ != OperandShift::none || cmp->tiedC_ != nullptr || cmp->tiedCC_ != nullptr)
+					continue;
+				cmps.emplace_back(cmp);
+			}
+			for (auto cmp : cmps) fold(bb, cmp);
+		}
+	}
+}
+
+bool FlagFold::fold(MBasicBlock* bb, MCMP* cmp) const
+{
+	auto& insts = bb->instructions();
+	// 0 在左边时只合并 eq/ne, 不需要交换条件
+	bool reversed = isZero(cmp->operand(0));
+	if (!reversed && !isZero(cmp->operand(1))) return false;
+	auto value = cmp->operand(reversed ? 1 : 0);
+	if (!value->isRegisterLike()) return false;
+	vector<Instruction::OpID> conds;
+	if (cmp->tiedB_ != nullptr) conds.emplace_back(cmp->tiedB_->op_);
+	for (auto sel : cmp->tiedS_) conds.emplace_back(sel->op_);
+	if (conds.empty()) return false;
+
+	int at = u2iNegThrow(find(insts.begin(), insts.end(), cmp) - insts.begin());
+	int d = at - 1;
+	for (; d >= 0; d--)
+	{
+		if (defines(insts[d], value)) break;
+		// 之前的比较的使用者在这里, 或者中间有调用与其他比较
+		if (usesOrDefines(insts[d], nzcv_)) return false;
+	}
+	if (d < 0) return false;
+	auto math = dynamic_cast<MMathInst*>(insts[d]);
+	if (math == nullptr || math->width() != 32 || math->setFlags_ || math->operand(0) != value ||
+		(math->op() != Instruction::add && math->op() != Instruction::sub && math->op() != Instruction::and_))
+		return false;
+	for (auto cond : conds)
+		if (!compatible(cond, math->op()) || (reversed && cond != Instruction::eq && cond != Instruction::ne))
+			return false;
+	LOG(color::green("Fold ") + cmp->print() + color::green(" into ") + math->print());
+
+	math->setFlags();
+	if (cmp->tiedB_ != nullptr) cmp->tiedB_->tiedWith_ = nullptr;
+	for (auto sel : cmp->tiedS_) sel->tiedWith_ = nullptr;
+	bb->removeInst(cmp);
+	return true;
+}
@@ -133,6 +133,17 @@ void LoadStoreEliminate::runInner()
 			updateReg(def);
 			continue;
 		}
+		// 合并了地址计算的写入可能写到任何数组元素, 只保留 spill 栈帧的记录
+		if (dynamic_cast<MSTRIdx*>(inst) != nullptr)
+		{
+			for (auto it = stackData_.begin(); it != stackData_.end();)
+			{
+				auto frame = dynamic_cast<FrameIndex*>(it->first);
+				if (frame != nullptr && frame->spilledFrame_) ++it;
+				else it = stackData_.erase(it);
+			}
+			continue;
+		}
 		for (auto def : inst->def())
 		{
 			updateReg(inst->operand(def));
@@ -0,0 +1,184 @@
+#include "LoadStorePair.hpp"
+
+#include <algorithm>
+
+#include "CodeGen.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "MachineInstruction.hpp"
+#include "MachineOperand.hpp"
+
+#define DEBUG 0
+#include "Util.hpp"
+
+using namespace std;
+
+namespace
+{
+	// 一次可以成对的访存
+	struct Access
+	{
+		MInstruction* inst_ = nullptr;
+		bool load_ = false;
+		Register* reg_ = nullptr;
+		// 栈帧或基址寄存器
+		MOperand* stackLike_ = nullptr;
+		// 相对 stackLike_ 的字节偏移
+		long long imm_ = 0;
+		// 用于比较相邻的偏移, 栈帧加上它在函数中的偏移
+		long long offset_ = 0;
+		int width_ = 0;
+		bool forCall_ = false;
+	};
+
+	bool access(MInstruction* inst, Access& acc, const MModule* m)
+	{
+		MOperand* value;
+		if (auto ld = dynamic_cast<MLDR*>(inst); ld != nullptr)
+		{
+			acc = {inst, true, nullptr, inst->operand(1), 0, 0, ld->width(), false};
+			value = inst->operand(0);
+		}
+		else if (auto st = dynamic_cast<MSTR*>(inst); st != nullptr)
+		{
+			acc = {inst, false, nullptr, inst->operand(1), 0, 0, st->width(), st->forCall_};
+			value = inst->operand(0);
+		}
+		else if (auto idx = dynamic_cast<MIndexedMem*>(inst); idx != nullptr)
+		{
+			auto imm = dynamic_cast<Immediate*>(inst->operand(2));
+			if (imm == nullptr) return false;
+			acc = {inst, dynamic_cast<MLDRIdx*>(inst) != nullptr, nullptr, inst->operand(1), imm->as64BitsInt(), 0,
+			       idx->width(), false};
+			value = inst->operand(0);
+		}
+		else return false;
+		if (acc.width_ != 32 && acc.width_ != 64 && acc.width_ != 128) return false;
+		acc.reg_ = dynamic_cast<Register*>(value);
+		// 写入 0 的存储使用零寄存器
+		if (auto imm = dynamic_cast<Immediate*>(value); imm != nullptr && !acc.load_ && acc.width_ != 128 &&
+			imm->as64BitsInt() == 0)
+			acc.reg_ = Register::getZERO(m);
+		if (acc.reg_ == nullptr) return false;
+		acc.offset_ = acc.imm_;
+		if (auto frame = dynamic_cast<FrameIndex*>(acc.stackLike_); frame != nullptr)
+		{
+			acc.offset_ += frame->offset();
+			return true;
+		}
+		return dynamic_cast<Register*>(acc.stackLike_) != nullptr;
+	}
+
+	// 两次访存使用同一个基址: 同一个寄存器, 或都是本函数的栈帧, 或都是同一个被调用函数的参数
+	bool sameBase(const Access& a, const Access& b)
+	{
+		auto fa = dynamic_cast<FrameIndex*>(a.stackLike_);
+		auto fb = dynamic_cast<FrameIndex*>(b.stackLike_);
+		if (fa == nullptr || fb == nullptr) return a.stackLike_ == b.stackLike_;
+		return a.forCall_ == b.forCall_ && fa->func() == fb->func();
+	}
+
+	// 不访问内存, 也不改变 SP 的指令
+	bool pure(const MInstruction* inst)
+	{
+		return dynamic_cast<const MMathInst*>(inst) != nullptr || dynamic_cast<const MCopy*>(inst) != nullptr ||
+			dynamic_cast<const M2SIMDCopy*>(inst) != nullptr || dynamic_cast<const MCMP*>(inst) != nullptr ||
+			dynamic_cast<const MCSET*>(inst) != nullptr || dynamic_cast<const MCSEL*>(inst) != nullptr ||
+			dynamic_cast<const MFCVTZS*>(inst) != nullptr || dynamic_cast<const MSCVTF*>(inst) != nullptr ||
+			dynamic_cast<const MSXTW*>(inst) != nullptr || dynamic_cast<const MMAddSUB*>(inst) != nullptr ||
+			dynamic_cast<const MNeg*>(inst) != nullptr || dynamic_cast<const MBitField*>(inst) != nullptr;
+	}
+
+	bool readOnly(const MInstruction* inst)
+	{
+		return dynamic_cast<const MLDR*>(inst) != nullptr || dynamic_cast<const MLDRIdx*>(inst) != nullptr ||
+			dynamic_cast<const MLD1V16B*>(inst) != nullptr || dynamic_cast<const MLDP*>(inst) != nullptr;
+	}
+
+	bool defines(MInstruction* inst, const MOperand* op)
+	{
+		for (auto d : inst->def()) if (inst->operand(d) == op) return true;
+		for (auto r : inst->imp_def()) if (r == op) return true;
+		return false;
+	}
+
+	bool touches(MInstruction* inst, const MOperand* op)
+	{
+		for (auto o : inst->operands()) if (o == op) return true;
+		for (auto r : inst->imp_use()) if (r == op) return true;
+		return defines(inst, op);
+	}
+}
+
+void LoadStorePair::run()
+{
+	for (auto f : m_->functions())
+	{
+		LOG(color::cyan("LoadStorePair of Func ") + f->name());
+		for (auto bb : f->blocks()) runOnBlock(bb);
+	}
+}
+
+void LoadStorePair::runOnBlock(MBasicBlock* bb) const
+{
+	auto& insts = bb->instructions();
+	// 正在传递栈上参数的被调用函数, CodeGen 此时已经移动了 SP, 本函数栈帧的偏移随之增加
+	MFunction* callee = nullptr;
+	for (int i = 0; i < u2iNegThrow(insts.size()); i++)
+	{
+		if (dynamic_cast<MBL*>(insts[i]) != nullptr) callee = nullptr;
+		Access a;
+		if (!access(insts[i], a, m_)) continue;
+		if (a.forCall_) callee = dynamic_cast<FrameIndex*>(a.stackLike_)->func();
+		int bytes = a.width_ >> 3;
+		Access b;
+		int j = i + 1;
+		int end = min(u2iNegThrow(insts.size()), i + window + 2);
+		for (; j < end; j++)
+		{
+			auto inst = insts[j];
+			if (access(inst, b, m_) && b.load_ == a.load_ && b.width_ == a.width_ && sameBase(a, b) &&
+				(b.offset_ == a.offset_ + bytes || b.offset_ == a.offset_ - bytes) &&
+				b.reg_->isIntegerRegister() == a.reg_->isIntegerRegister() && (!a.load_ || b.reg_ != a.reg_))
+				break;
+			if (!pure(inst) && !(a.load_ && readOnly(inst))) j = end;
+		}
+		if (j >= end) continue;
+
+		// 加载对提前 b, 存储对推迟 a
+		auto& moved = a.load_ ? b : a;
+		bool ok = true;
+		for (int k = i + 1; k < j && ok; k++)
+		{
+			auto inst = insts[k];
+			if (a.load_ && touches(inst, moved.reg_)) ok = false;
+			if (!a.load_ && defines(inst, moved.reg_)) ok = false;
+			if (defines(inst, moved.stackLike_)) ok = false;
+		}
+		// a 加载的结果不能是 b 使用的基址
+		if (!ok || (a.load_ && a.reg_ == b.stackLike_)) continue;
+		auto& low = a.offset_ < b.offset_ ? a : b;
+		auto& high = a.offset_ < b.offset_ ? b : a;
+		long long offset = low.imm_;
+		if (auto frame = dynamic_cast<FrameIndex*>(low.stackLike_); frame != nullptr)
+		{
+			if (low.forCall_) offset += frame->offset() - frame->func()->stack_move_offset();
+			else offset += frame->offset() + (callee != nullptr ? callee->fix_move_offset() : 0);
+		}
+		if (!CodeGen::pairOffsetCanInline(offset, a.width_)) continue;
+
+		auto imm = Immediate::getImmediate(low.imm_, m_);
+		MPairMem* pair;
+		if (a.load_) pair = new MLDP{bb, low.reg_, high.reg_, low.stackLike_, imm, a.width_};
+		else pair = new MSTP{bb, low.reg_, high.reg_, low.stackLike_, imm, a.width_};
+		pair->forCall_ = a.forCall_;
+		LOG(color::green("Pair ") + a.inst_->print() + color::green(" with ") + b.inst_->print());
+		a.inst_->removeAllUse();
+		b.inst_->removeAllUse();
+		delete a.inst_;
+		delete b.inst_;
+		insts[a.load_ ? i : j] = pair;
+		insts.erase(insts.begin() + (a.load_ ? j : i));
+		if (!a.load_) i = j - 1;
+	}
+}
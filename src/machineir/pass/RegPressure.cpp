@@ -0,0 +1,236 @@
+#include "RegPressure.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "Config.hpp"
+#include "DynamicBitset.hpp"
+#include "LiveMessage.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "MachineInstruction.hpp"
+#include "MachineModule.hpp"
+#include "MachineOperand.hpp"
+
+using namespace std;
+
+namespace
+{
+	// spill/reload 访问的栈槽, 其他指令返回 nullptr
+	FrameIndex* spilledFrameOf(MInstruction* inst)
+	{
+		if (dynamic_cast<MLDR*>(inst) == nullptr && dynamic_cast<MSTR*>(inst) == nullptr) return nullptr;
+		auto frame = dynamic_cast<FrameIndex*>(inst->operand(1));
+		return frame != nullptr && frame->spilled_frame() ? frame : nullptr;
+	}
+
+	const char* markName(const RegPressure::Mark mark)
+	{
+		switch (mark)
+		{
+			case RegPressure::NONE: return "";
+			case RegPressure::SPILL: return "spill";
+			case RegPressure::RELOAD: return "reload";
+			case RegPressure::SPILL_FPR: return "spill-fpr";
+			case RegPressure::RELOAD_FPR: return "reload-fpr";
+		}
+		return "";
+	}
+}
+
+RegPressure::RegPressure(MModule* m) : MachinePass(m), detect_(m)
+{
+	if (regPressureReportFile.empty()) out_ = &cerr;
+	else
+	{
+		file_.open(regPressureReportFile);
+		out_ = &file_;
+	}
+}
+
+void RegPressure::run()
+{
+	for (auto f : m_->functions())
+	{
+		if (f->blocks().empty()) continue;
+		func_ = f;
+		runOnFunc();
+	}
+}
+
+void RegPressure::collectRegs(const bool isInt)
+{
+	LiveMessage message{func_};
+	message.flush(isInt);
+	for (auto reg : isInt ? m_->IRegs() : m_->FRegs())
+		if (reg->canAllocate()) message.addRegister(reg);
+	(isInt ? intRegs_ : floatRegs_) = message.regCount();
+	message.calculateLiveMessage();
+	for (auto bb : func_->blocks())
+	{
+		DynamicBitset live = message.live_out()[bb->id()];
+		auto& insts = bb->instructions();
+		auto& points = points_[bb->id()];
+		// 逆序扫描, 与 InterfereGraph::build 相同
+		for (int i = static_cast<int>(insts.size()) - 1; i >= 0; i--)
+		{
+			auto inst = insts[i];
+			auto use = message.translate(inst->operands(), inst->use()) | message.translate(inst->imp_use());
+			auto def = message.translate(inst->operands(), inst->def());
+			// 调用的隐式定值是被破坏的 caller save 寄存器, 它们不占用寄存器, 只结束活跃
+			(isInt ? points[i].ints : points[i].floats) = (live | def | use).count();
+			live -= def;
+			live -= message.translate(inst->imp_def());
+			live |= use;
+		}
+	}
+}
+
+void RegPressure::collectSpills()
+{
+	FrameLiveMessage message{func_};
+	message.calculateLiveMessage();
+	for (auto bb : func_->blocks())
+	{
+		DynamicBitset live = message.live_out()[bb->id()];
+		auto& insts = bb->instructions();
+		auto& points = points_[bb->id()];
+		for (int i = static_cast<int>(insts.size()) - 1; i >= 0; i--)
+		{
+			auto inst = insts[i];
+			auto& point = points[i];
+			if (auto copy = dynamic_cast<M2SIMDCopy*>(inst); copy != nullptr)
+				point.mark = copy->isLoad() ? RELOAD_FPR : SPILL_FPR;
+			auto frame = spilledFrameOf(inst);
+			if (frame == nullptr)
+			{
+				point.slots = live.count();
+				continue;
+			}
+			if (auto ld = dynamic_cast<MLDR*>(inst); ld != nullptr)
+			{
+				point.mark = RELOAD;
+				point.bytes = ld->width() / 8;
+				live.set(frame->index());
+				point.slots = live.count();
+			}
+			else
+			{
+				point.mark = SPILL;
+				point.bytes = dynamic_cast<MSTR*>(inst)->width() / 8;
+				point.slots = live.count();
+				live.reset(frame->index());
+			}
+		}
+	}
+}
+
+void RegPressure::add(Summary& summary, const int bb) const
+{
+	const float weight = func_->blocks()[bb]->weight_;
+	for (auto& point : points_[bb])
+	{
+		summary.maxInts = max(summary.maxInts, point.ints);
+		summary.maxFloats = max(summary.maxFloats, point.floats);
+		switch (point.mark)
+		{
+			case SPILL: summary.spills++;
+				break;
+			case RELOAD: summary.reloads++;
+				break;
+			case SPILL_FPR:
+			case RELOAD_FPR: summary.fprMoves++;
+				break;
+			case NONE: break;
+		}
+		summary.bytes += point.bytes;
+		summary.weightedBytes += point.bytes * static_cast<double>(weight);
+	}
+}
+
+void RegPressure::print(ostream& out, const Summary& summary)
+{
+	out << " max-int " << summary.maxInts << " max-float " << summary.maxFloats << " spills " << summary.spills <<
+		" reloads " << summary.reloads << " fpr-moves " << summary.fprMoves << " spill-bytes " << summary.bytes <<
+		" weighted-spill-bytes " << summary.weightedBytes;
+}
+
+void RegPressure::printLoop(MachineLoop* loop, const int depth, const vector<string>& names)
+{
+	Summary summary;
+	int blocks = 0;
+	for (auto bb : loop->get_blocks())
+	{
+		add(summary, bb);
+		blocks++;
+	}
+	auto& out = *out_;
+	out << "reg-pressure-loop " << func_->name() << " " << names[loop->get_header()->id()] << " depth " << depth <<
+		" blocks " << blocks;
+	print(out, summary);
+	out << "\n";
+	for (auto sub : MachineLoopDetection::byHeader(loop->get_sub_loops())) printLoop(sub, depth + 1, names);
+}
+
+void RegPressure::runOnFunc()
+{
+	const MachineLoopDetection::PreserveBlocks preserve{func_};
+	detect_.run_on_func(func_);
+	auto& blocks = func_->blocks();
+	const int bs = static_cast<int>(blocks.size());
+	points_.assign(bs, {});
+	int instructions = 0;
+	for (auto bb : blocks)
+	{
+		points_[bb->id()].resize(bb->instructions().size());
+		instructions += static_cast<int>(bb->instructions().size());
+	}
+	depth_.assign(bs, 0);
+	int maxDepth = 0;
+	for (auto loop : detect_.get_loops())
+		for (auto bb : loop->get_blocks())
+			maxDepth = max(maxDepth, ++depth_[bb]);
+	collectRegs(true);
+	collectRegs(false);
+	collectSpills();
+
+	auto& out = *out_;
+	Summary total;
+	vector<Summary> byDepth(maxDepth + 1);
+	for (int i = 0; i < bs; i++)
+	{
+		add(total, i);
+		add(byDepth[depth_[i]], i);
+	}
+	out << "reg-pressure-function " << func_->name() << " blocks " << bs << " loops " << detect_.get_loops().size() <<
+		" instructions " << instructions << " int-regs " << intRegs_ << " float-regs " << floatRegs_;
+	print(out, total);
+	out << "\n";
+	vector<MachineLoop*> tops;
+	for (auto loop : detect_.get_loops()) if (loop->get_parent() == nullptr) tops.emplace_back(loop);
+	for (auto loop : MachineLoopDetection::byHeader(tops)) printLoop(loop, 1, preserve.names());
+	for (int d = 0; d <= maxDepth; d++)
+	{
+		out << "reg-pressure-depth " << func_->name() << " " << d;
+		print(out, byDepth[d]);
+		out << "\n";
+	}
+
+	// 指令清单: 整数寄存器, 浮点寄存器, spill 栈槽的压力, spill/reload 标记, 指令
+	for (auto bb : blocks)
+	{
+		out << preserve.names()[bb->id()] << ": weight " << bb->weight_ << " depth " << depth_[bb->id()];
+		if (bb->line_ != 0) out << " line " << bb->line_;
+		out << "\n";
+		auto& points = points_[bb->id()];
+		auto& insts = bb->instructions();
+		for (size_t i = 0; i < insts.size(); i++)
+		{
+			auto& point = points[i];
+			out << setw(5) << point.ints << setw(4) << point.floats << setw(4) << point.slots << "  " << left <<
+				setw(11) << markName(point.mark) << right << insts[i]->print() << "\n";
+		}
+	}
+}
@@ -136,26 +136,32 @@ RegisterAllocate::RegisterAllocate(MModule* module): MachinePass(module), interf
 {
 }
 
+RegisterAllocate::~RegisterAllocate()
+{
+	delete dominator_;
+}
+
 void RegisterAllocate::run()
 {
 	auto& funcs = module_->all_funcs();
-	std::vector<DynamicBitset> callChain;
-	callChain.resize(funcs.size());
-	int idx = 0;
-	for (auto all_func : funcs)
-	{
-		callChain[idx++] = all_func->called();
-	}
+	int idx = u2iNegThrow(funcs.size());
 
+	// 只分配 functions() 中的函数, 其余函数是库函数, 或者已经分配过(逐函数编译时), 视为叶子
 	DynamicBitset leaf{(idx)};
 	DynamicBitset workList{(idx)};
-	workList.rangeSet(0, (idx));
+	leaf.rangeSet(0, (idx));
+	for (auto func : module_->functions())
+	{
+		leaf.reset(func->id());
+		workList.set(func->id());
+	}
+	idx = u2iNegThrow(module_->functions().size());
 	while (idx > 0)
 	{
 		bool changed = false;
 		for (auto i : workList)
 		{
-			if (leaf.include(callChain[i]))
+			if (leaf.include(funcs[i]->called()))
 			{
 				idx--;
 				changed = true;
@@ -177,7 +183,6 @@ void RegisterAllocate::run()
 		func->rewriteCallsDefList();
 		runOn(func);
 	}
-	delete dominator_;
 	GAP;
 	LOG(m_->print());
 	GAP;
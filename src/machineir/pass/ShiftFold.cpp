@@ -0,0 +1,249 @@
+#include "ShiftFold.hpp"
+
+#include <algorithm>
+
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "MachineInstruction.hpp"
+#include "MachineOperand.hpp"
+
+#define DEBUG 0
+#include "Util.hpp"
+
+using namespace std;
+
+namespace
+{
+	// bb 中 before 之前最近的定义 op 的指令的下标, 没有时返回 -1
+	int defBefore(MBasicBlock* bb, int before, const MOperand* op)
+	{
+		auto& insts = bb->instructions();
+		for (int i = before - 1; i >= 0; i--)
+		{
+			for (auto d : insts[i]->def())
+				if (insts[i]->operand(d) == op) return i;
+		}
+		return -1;
+	}
+
+	// bb 中 (from, to) 之间的指令都不定义 op
+	bool unchanged(MBasicBlock* bb, int from, int to, const MOperand* op)
+	{
+		auto& insts = bb->instructions();
+		for (int i = from + 1; i < to; i++)
+		{
+			for (auto d : insts[i]->def())
+				if (insts[i]->operand(d) == op) return false;
+		}
+		return true;
+	}
+
+	// 可以带移位操作数的整数比较, 条件比较没有移位寄存器形式
+	MCMP* shiftableCompare(MInstruction* inst)
+	{
+		auto cmp = dynamic_cast<MCMP*>(inst);
+		if (cmp == nullptr || dynamic_cast<MCCMP*>(inst) != nullptr || !cmp->itff_) return nullptr;
+		return cmp->shift_ == OperandShift::none ? cmp : nullptr;
+	}
+
+	MMathInst* shiftableMath(MInstruction* inst)
+	{
+		auto math = dynamic_cast<MMathInst*>(inst);
+		if (math == nullptr || (math->op() != Instruction::add && math->op() != Instruction::sub)) return nullptr;
+		return math->shift_ == OperandShift::none ? math : nullptr;
+	}
+
+	// 右操作数是立即数的 and, shl 或 ashr, 返回立即数
+	Immediate* bitOperation(MInstruction* inst)
+	{
+		auto math = dynamic_cast<MMathInst*>(inst);
+		if (math == nullptr || math->shift_ != OperandShift::none || (math->op() != Instruction::and_ && math->op() !=
+			Instruction::shl && math->op() != Instruction::ashr))
+			return nullptr;
+		auto imm = dynamic_cast<Immediate*>(math->operand(2));
+		if (imm == nullptr) return nullptr;
+		long long v = imm->as64BitsInt();
+		if (math->width() == 32) v = imm->asInt();
+		if (math->op() != Instruction::and_ && (v <= 0 || v >= math->width())) return nullptr;
+		return imm;
+	}
+
+	// 掩码 2^n - 1 的位数 n, 不是这样的掩码时返回 0
+	int maskBits(const MMathInst* inst, const Immediate* imm)
+	{
+		unsigned long long v = inst->width() == 32 ? static_cast<unsigned>(imm->asInt()) : imm->as64BitsInt();
+		if (v == 0 || (v & (v + 1)) != 0) return 0;
+		int n = 0;
+		while (v != 0)
+		{
+			v >>= 1;
+			n++;
+		}
+		return n < inst->width() ? n : 0;
+	}
+}
+
+void ShiftFold::run()
+{
+	for (auto f : m_->functions())
+	{
+		f_ = f;
+		LOG(color::cyan("ShiftFold of Func ") + f->name());
+		for (auto bb : f->blocks())
+		{
+			// 合并只删除使用者之前的指令, 先收集所有使用者
+			vector<MInstruction*> users;
+			for (auto inst : bb->instructions())
+				if (shiftableMath(inst) != nullptr || shiftableCompare(inst) != nullptr) users.emplace_back(inst);
+			for (auto user : users)
+			{
+				if (auto math = shiftableMath(user); math != nullptr)
+				{
+					// add 可交换, 右操作数不能合并时再尝试左操作数
+					if (!fold(bb, user, 2) && math->op() == Instruction::add) fold(bb, user, 1);
+				}
+				else fold(bb, user, 1);
+			}
+			// 剩下的移位与掩码合并为位域指令, 只替换使用者并删除它之前的定义
+			vector<MMathInst*> bits;
+			for (auto inst : bb->instructions())
+				if (bitOperation(inst) != nullptr) bits.emplace_back(dynamic_cast<MMathInst*>(inst));
+			for (auto inst : bits) foldBitField(bb, inst);
+		}
+	}
+}
+
+bool ShiftFold::fold(MBasicBlock* bb, MInstruction* user, int idx) const
+{
+	auto& insts = bb->instructions();
+	auto math = dynamic_cast<MMathInst*>(user);
+	// 另一个操作数留在第一个源操作数的位置, 它是立即数时合并省不下指令
+	int other = math != nullptr ? 3 - idx : 1 - idx;
+	int width = math != nullptr ? math->width() : 32;
+	auto op = dynamic_cast<VirtualRegister*>(user->operand(idx));
+	if (op == nullptr || user->operand(other) == op || dynamic_cast<Immediate*>(user->operand(other)) != nullptr)
+		return false;
+	if (math != nullptr && math->operand(0) == op) return false;
+	if (f_->useList(op).size() != 2) return false;
+	int at = u2iNegThrow(find(insts.begin(), insts.end(), user) - insts.begin());
+	int d = defBefore(bb, at, op);
+	if (d < 0) return false;
+
+	auto def = insts[d];
+	OperandShift shift;
+	int amount = 0;
+	MOperand* from;
+	// 被合并的指令, 从使用者向前排列
+	vector<MInstruction*> chain{def};
+	if (auto sxtw = dynamic_cast<MSXTW*>(def); sxtw != nullptr)
+	{
+		if (math == nullptr || width != 64) return false;
+		shift = OperandShift::sxtw;
+		from = sxtw->operand(0);
+	}
+	else
+	{
+		auto sh = dynamic_cast<MMathInst*>(def);
+		if (sh == nullptr || sh->width() != width || sh->shift_ != OperandShift::none ||
+			(sh->op() != Instruction::shl && sh->op() != Instruction::ashr))
+			return false;
+		auto imm = dynamic_cast<Immediate*>(sh->operand(2));
+		if (imm == nullptr || imm->as64BitsInt() < 0 || imm->as64BitsInt() >= width) return false;
+		shift = sh->op() == Instruction::shl ? OperandShift::lsl : OperandShift::asr;
+		amount = u2iNegThrow(imm->as64BitsInt());
+		from = sh->operand(1);
+		// SXTW 之后左移, 扩展寄存器形式的左移量最多为 4
+		auto src = dynamic_cast<VirtualRegister*>(from);
+		int e = src != nullptr ? defBefore(bb, d, src) : -1;
+		if (e >= 0 && math != nullptr && shift == OperandShift::lsl && amount <= 4 &&
+			dynamic_cast<MSXTW*>(insts[e]) != nullptr && f_->useList(src).size() == 2 &&
+			dynamic_cast<VirtualRegister*>(insts[e]->operand(0)) != nullptr &&
+			unchanged(bb, e, at, insts[e]->operand(0)))
+		{
+			shift = OperandShift::sxtw;
+			from = insts[e]->operand(0);
+			chain.emplace_back(insts[e]);
+		}
+	}
+	if (dynamic_cast<VirtualRegister*>(from) == nullptr || !unchanged(bb, d, at, from)) return false;
+	LOG(color::green("Fold ") + def->print() + color::green(" into ") + user->print());
+
+	if (idx != (math != nullptr ? 2 : 1)) swap(user->operands()[idx], user->operands()[other]);
+	user->replace(op, from, f_);
+	if (math != nullptr)
+	{
+		math->shift_ = shift;
+		math->shiftAmount_ = amount;
+	}
+	else
+	{
+		auto cmp = dynamic_cast<MCMP*>(user);
+		cmp->shift_ = shift;
+		cmp->shiftAmount_ = amount;
+	}
+	for (auto inst : chain) bb->removeInst(inst);
+	LOG(user->print());
+	return true;
+}
+
+bool ShiftFold::foldBitField(MBasicBlock* bb, MMathInst* inst) const
+{
+	auto& insts = bb->instructions();
+	int width = inst->width();
+	auto op = dynamic_cast<VirtualRegister*>(inst->operand(1));
+	if (op == nullptr || inst->operand(0) == op || f_->useList(op).size() != 2) return false;
+	int at = u2iNegThrow(find(insts.begin(), insts.end(), inst) - insts.begin());
+	int d = defBefore(bb, at, op);
+	if (d < 0) return false;
+	auto imm = bitOperation(inst);
+	// 移位量, 已经检查过在 (0, width) 中
+	auto amountOf = [width](const Immediate* i)
+	{
+		return width == 32 ? i->asInt() : static_cast<int>(i->as64BitsInt());
+	};
+	auto def = insts[d];
+	auto math = dynamic_cast<MMathInst*>(def);
+	auto defImm = bitOperation(def);
+	// 填满高位的 UBFIZ 就是左移, 例如 (x & 1023) << 22 之后再右移
+	auto ins = dynamic_cast<MBitField*>(def);
+	bool defShl = (defImm != nullptr && math->op() == Instruction::shl) ||
+		(ins != nullptr && ins->insert_ && !ins->signed_ && ins->lsb_ + ins->bits_ == width);
+	if ((defImm == nullptr && !defShl) || (defImm != nullptr && math->width() != width) ||
+		(ins != nullptr && ins->width_ != width))
+		return false;
+	auto from = dynamic_cast<VirtualRegister*>(def->operand(1));
+	if (from == nullptr || !unchanged(bb, d, at, from)) return false;
+
+	MBitField* field = nullptr;
+	if (inst->op() == Instruction::and_ && defImm != nullptr && math->op() == Instruction::ashr)
+	{
+		// (x >> a) & (2^n - 1), 取到的位不能超过最高位, 否则高位是符号位而不是 0
+		int a = amountOf(defImm);
+		int n = maskBits(inst, imm);
+		if (n != 0 && a + n <= width) field = new MBitField{bb, from, inst->operand(0), width, false, false, a, n};
+	}
+	else if (inst->op() == Instruction::shl && defImm != nullptr && math->op() == Instruction::and_)
+	{
+		// (x & (2^n - 1)) << b, 移出最高位的部分丢弃
+		int b = amountOf(imm);
+		int n = maskBits(math, defImm);
+		if (n != 0)
+			field = new MBitField{bb, from, inst->operand(0), width, false, true, b, min(n, width - b)};
+	}
+	else if (inst->op() == Instruction::ashr && defShl)
+	{
+		// (x << a) >> b, 保留 x 的低 width - a 位并做符号扩展
+		int a = ins != nullptr ? ins->lsb_ : amountOf(defImm);
+		int b = amountOf(imm);
+		if (b >= a) field = new MBitField{bb, from, inst->operand(0), width, true, false, b - a, width - b};
+		else field = new MBitField{bb, from, inst->operand(0), width, true, true, a - b, width - a};
+	}
+	if (field == nullptr) return false;
+	LOG(color::green("Fold ") + def->print() + color::green(" and ") + inst->print());
+	LOG(field->print());
+	inst->removeAllUse();
+	delete inst;
+	insts[at] = field;
+	bb->removeInst(def);
+	return true;
+}
@@ -1,10 +1,12 @@
 #include "MachineLoopDetection.hpp"
 #include "BasicBlock.hpp"
 #include "Dominators.hpp"
+#include <algorithm>
 #include <iostream>
 #include <ostream>
 #include <queue>
 #include <stack>
+#include <unordered_set>
 
 #include "MachineFunction.hpp"
 
@@ -24,6 +26,57 @@ void MachineLoopDetection::run()
 {
 }
 
+MachineLoopDetection::PreserveBlocks::PreserveBlocks(MFunction* f) : func_(f)
+{
+	auto& blocks = f->blocks();
+	all_ = blocks;
+	for (auto bb : all_) saved_.emplace_back(bb->id_, bb->name_);
+	std::unordered_set<MBasicBlock*> reachable{all_.front()};
+	std::queue<MBasicBlock*> work;
+	work.emplace(all_.front());
+	while (!work.empty())
+	{
+		auto bb = work.front();
+		work.pop();
+		for (auto suc : bb->suc_bbs()) if (reachable.insert(suc).second) work.emplace(suc);
+	}
+	blocks.clear();
+	for (auto bb : all_) if (reachable.count(bb)) blocks.emplace_back(bb);
+	// 删除不可达块后编号要连续, 循环检测以编号作为位集与数组的下标; 不可达的前驱也暂时去掉
+	for (int i = 0; i < static_cast<int>(blocks.size()); i++)
+	{
+		auto bb = blocks[i];
+		names_.emplace_back(bb->name());
+		bb->id_ = i;
+		auto& pres = bb->pre_bbs();
+		if (std::all_of(pres.begin(), pres.end(), [&reachable](MBasicBlock* pre) { return reachable.count(pre); }))
+			continue;
+		preds_.emplace_back(bb, pres);
+		for (auto it = pres.begin(); it != pres.end();)
+			it = reachable.count(*it) ? std::next(it) : pres.erase(it);
+	}
+}
+
+MachineLoopDetection::PreserveBlocks::~PreserveBlocks()
+{
+	func_->blocks() = all_;
+	for (size_t i = 0; i < all_.size(); i++)
+	{
+		all_[i]->id_ = saved_[i].first;
+		all_[i]->name_ = saved_[i].second;
+	}
+	for (auto& [bb, pres] : preds_) bb->pre_bbs() = pres;
+}
+
+std::vector<MachineLoop*> MachineLoopDetection::byHeader(std::vector<MachineLoop*> loops)
+{
+	std::sort(loops.begin(), loops.end(), [](const MachineLoop* l, const MachineLoop* r)
+	{
+		return l->get_header()->id() < r->get_header()->id();
+	});
+	return loops;
+}
+
 void MachineLoopDetection::discover_loop_and_sub_loops(const MBasicBlock* bb, const DynamicBitset& latches,
                                                        MachineLoop* loop)
 {
@@ -12,10 +12,12 @@
 #include "MachineInstruction.hpp"
 #include "MachineFunction.hpp"
 #include "MachineOperand.hpp"
+#include "Remarks.hpp"
 
 #define DEBUG 0
 #include <algorithm>
 #include <iostream>
+#include <sstream>
 
 #include "MachineDominator.hpp"
 #include "Util.hpp"
@@ -34,6 +36,17 @@ InterfereGraph::InterfereGraph(RegisterAllocate* parent) : parent_(parent), work
 {
 }
 
+namespace
+{
+	// 备注中的权重用最短的形式, 不带 to_string 的 6 位小数
+	std::string number(const double value)
+	{
+		std::ostringstream os;
+		os << value;
+		return os.str();
+	}
+}
+
 void InterfereGraphNode::add(InterfereGraphNode* target)
 {
 	if (graphColoringWeakNodeCheck && target->parent_ == this)
@@ -535,6 +548,10 @@ bool InterfereGraph::selectSpill()
 		}
 	}
 	ASSERT(m != nullptr);
+	if (Remarks::enabled(Remarks::Analysis, "regalloc"))
+		remark(Remarks::Analysis, "SpillCandidate", m, m->reg_->print() + " chosen as a potential spill",
+		       "lowest weight/degree " + number(mw) + " (weight " + number(m->weight_) + ", degree " +
+		       std::to_string(m->degree_) + ")");
 	spillWorklist_.remove(m);
 	simplifyWorklist_.add(m);
 	freezeMove(m);
@@ -567,6 +584,13 @@ void InterfereGraph::assignColors()
 		}
 		if (oks.allZeros())
 		{
+			if (Remarks::enabled(Remarks::Missed, "regalloc"))
+				remark(Remarks::Missed, "Spilled", n, n->reg_->print() + " spilled",
+				       "all " + std::to_string(K_) + " registers are taken by its " +
+				       std::to_string(n->adjList_.size()) + " interfering neighbours" +
+				       (n->hottest_ != nullptr && n->hottest_->weight_ > 1
+					        ? ", it is used in a loop (block weight " + number(n->hottest_->weight_) + ")"
+					        : ""));
 			spilledNode_.add(n);
 		}
 		else
@@ -578,6 +602,16 @@ void InterfereGraph::assignColors()
 	}
 }
 
+void InterfereGraph::remark(Remarks::Kind kind, const char* name, const InterfereGraphNode* node,
+                            const std::string& message, const std::string& reason) const
+{
+	auto bb = node->hottest_;
+	Remarks::emit({
+		kind, "regalloc", name, parent_->currentFunc()->name(), bb == nullptr ? "" : bb->name(),
+		bb == nullptr ? 0 : bb->line_, message, reason
+	});
+}
+
 bool InterfereGraph::needRewrite() const
 {
 	return !spilledNode_.empty();
@@ -735,6 +769,16 @@ void InterfereGraph::applyChanges()
 }
 
 
+namespace
+{
+	// 累加节点的重要性, 并记录最热的基本块
+	void addWeight(InterfereGraphNode* node, MBasicBlock* bb)
+	{
+		node->weight_ += bb->weight_;
+		if (node->hottest_ == nullptr || bb->weight_ > node->hottest_->weight_) node->hottest_ = bb;
+	}
+}
+
 void InterfereGraph::build()
 {
 	auto& message = *parent_->live_message();
@@ -752,14 +796,14 @@ void InterfereGraph::build()
 			{
 				if (message.careVirtual(inst->operand(i)))
 				{
-					getOrCreateRegNode(dynamic_cast<RegisterLike*>(inst->operand(i)))->weight_ += bb->weight_;
+					addWeight(getOrCreateRegNode(dynamic_cast<RegisterLike*>(inst->operand(i))), bb);
 				}
 			}
 			for (auto i : inst->def())
 			{
 				if (message.care(inst->operand(i)))
 				{
-					getOrCreateRegNode(dynamic_cast<RegisterLike*>(inst->operand(i)))->weight_ += bb->weight_;
+					addWeight(getOrCreateRegNode(dynamic_cast<RegisterLike*>(inst->operand(i))), bb);
 				}
 			}
 			// 指令所有用到的寄存器
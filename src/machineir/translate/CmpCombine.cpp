@@ -53,7 +53,16 @@ void CmpCombine::run()
 				auto inst = *it;
 				if (inst->is_cmp() || inst->is_fcmp())
 				{
-					bool useOnce = inst->get_use_list().size() <= 1;
+					// select 在翻译时重新生成比较, 只考虑分支的使用
+					int branchUses = 0;
+					for (auto& use : inst->get_use_list())
+						if (dynamic_cast<BranchInst*>(use.val_) != nullptr) branchUses++;
+					if (branchUses == 0 && !inst->get_use_list().empty())
+					{
+						++it;
+						continue;
+					}
+					bool useOnce = branchUses <= 1;
 					bool inBB = backUse == inst;
 					useList.emplace(inst, pair{it, getUseType(useOnce, inBB)});
 				}
@@ -97,6 +106,7 @@ void CmpCombine::run()
 						for (auto use : uses)
 						{
 							auto usr = dynamic_cast<BranchInst*>(use.val_);
+							if (usr == nullptr) continue;
 							auto bb = usr->get_parent();
 							if (bb != inst->get_parent())
 							{
@@ -120,6 +130,7 @@ void CmpCombine::run()
 						for (auto use : uses)
 						{
 							auto usr = dynamic_cast<BranchInst*>(use.val_);
+							if (usr == nullptr) continue;
 							auto bb = usr->get_parent();
 							auto load = ICmpInst::create_eq(store, Constant::create(m_, 1), nullptr);
 							load->set_parent(bb);
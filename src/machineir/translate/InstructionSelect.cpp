@@ -4,12 +4,18 @@
 #include "Config.hpp"
 #include "Constant.hpp"
 #include "Instruction.hpp"
+#include "Remarks.hpp"
 
 #define DEBUG 0
 #include "Util.hpp"
 
 using namespace std;
 
+namespace
+{
+	const char* constantOperandReason = "the add/sub has a constant operand and onlyMergeMulAndASWhenASUseAllReg is on";
+}
+
 void InstructionSelect::runInner() const
 {
 	LOG(color::cyan("InstructionSelect On ") + f_->get_name() + color::cyan(" Block ") + b_->get_name());
@@ -19,10 +25,19 @@ void InstructionSelect::runInner() const
 	while (it != ed)
 	{
 		auto inst = it.get_and_add();
-		if (inst->get_use_list().size() != 1) continue;
+		if (inst->get_use_list().size() != 1)
+		{
+			if (inst->get_use_list().size() > 1 && Remarks::enabled(Remarks::Missed, "isel"))
+				notFused(inst, "its result has " + std::to_string(inst->get_use_list().size()) + " uses");
+			continue;
+		}
 		auto u = inst->get_use_list().front();
 		auto use = dynamic_cast<Instruction*>(u.val_);
-		if (use->get_parent() != b_) continue;
+		if (use->get_parent() != b_)
+		{
+			notFused(inst, "its user is in another basic block");
+			continue;
+		}
 		int id = u.arg_no_;
 		if (inst->is_gep())
 		{
@@ -39,6 +54,7 @@ void InstructionSelect::runInner() const
 			for (int i = 2; i < size; i++) nidx.emplace_back(opu[i]);
 			auto ninst = GetElementPtrInst::create_gep(inst->get_operand(0), nidx, nullptr);
 			ninst->set_parent(b_);
+			fused(inst, use, ninst, "FoldGEP");
 			use->replace_all_use_with(ninst);
 			LOG(color::green("Get"));
 			LOG(ninst->print());
@@ -55,11 +71,19 @@ void InstructionSelect::runInner() const
 			{
 				if (use->is_sub())
 				{
-					if (id != 1) continue;
+					if (id != 1)
+					{
+						notFused(inst, "the product is the first operand of the sub");
+						continue;
+					}
 					if (onlyMergeMulAndASWhenASUseAllReg)
 					{
 						auto c = dynamic_cast<Constant*>(use->get_operand(0));
-						if (c != nullptr && c->getIntConstant() != 0) continue;
+						if (c != nullptr && c->getIntConstant() != 0)
+						{
+							notFused(inst, constantOperandReason);
+							continue;
+						}
 					}
 					LOG(color::yellow("Merge"));
 					LOG(inst->print());
@@ -68,6 +92,7 @@ void InstructionSelect::runInner() const
 					                                            use->get_operand(0),
 					                                            nullptr);
 					ninst->set_parent(b_);
+					fused(inst, use, ninst, "FuseMulSub");
 					use->replace_all_use_with(ninst);
 					LOG(color::green("Get"));
 					LOG(ninst->print());
@@ -91,7 +116,11 @@ void InstructionSelect::runInner() const
 						if (onlyMergeMulAndASWhenASUseAllReg)
 						{
 							auto c = dynamic_cast<Constant*>(use->get_operand(0));
-							if (c != nullptr && c->getIntConstant() != 0) continue;
+							if (c != nullptr && c->getIntConstant() != 0)
+							{
+								notFused(inst, constantOperandReason);
+								continue;
+							}
 						}
 						LOG(color::yellow("Merge"));
 						LOG(inst->print());
@@ -100,6 +129,7 @@ void InstructionSelect::runInner() const
 							use->get_operand(0),
 							nullptr);
 						ninst->set_parent(b_);
+						fused(inst, use, ninst, "FuseMulAdd");
 						use->replace_all_use_with(ninst);
 						LOG(color::green("Get"));
 						LOG(ninst->print());
@@ -121,7 +151,11 @@ void InstructionSelect::runInner() const
 						if (onlyMergeMulAndASWhenASUseAllReg)
 						{
 							auto c = dynamic_cast<Constant*>(use->get_operand(1));
-							if (c != nullptr && c->getIntConstant() != 0) continue;
+							if (c != nullptr && c->getIntConstant() != 0)
+							{
+								notFused(inst, constantOperandReason);
+								continue;
+							}
 						}
 						LOG(color::yellow("Merge"));
 						LOG(inst->print());
@@ -130,6 +164,7 @@ void InstructionSelect::runInner() const
 							use->get_operand(1),
 							nullptr);
 						ninst->set_parent(b_);
+						fused(inst, use, ninst, "FuseMulAdd");
 						use->replace_all_use_with(ninst);
 						LOG(color::green("Get"));
 						LOG(ninst->print());
@@ -163,6 +198,7 @@ void InstructionSelect::runInner() const
 						                                            use->get_operand(0),
 						                                            nullptr);
 						ninst->set_parent(b_);
+						fused(inst, use, ninst, "FuseMulSub");
 						use->replace_all_use_with(ninst);
 						LOG(color::green("Get"));
 						LOG(ninst->print());
@@ -183,6 +219,7 @@ void InstructionSelect::runInner() const
 						                                            use->get_operand(0),
 						                                            nullptr);
 						ninst->set_parent(b_);
+						fused(inst, use, ninst, "FuseMulAdd");
 						use->replace_all_use_with(ninst);
 						LOG(color::green("Get"));
 						LOG(ninst->print());
@@ -199,12 +236,16 @@ void InstructionSelect::runInner() const
 					if (id != 1) continue;
 					if (auto c = dynamic_cast<Constant*>(use->get_operand(0));
 						c == nullptr || c->getFloatConstant() != 0.0f)
+					{
+						notFused(inst, "mergeFloatBinaryInst is off, a fused result may round differently");
 						continue;
+					}
 					LOG(color::yellow("Merge"));
 					LOG(inst->print());
 					LOG(use->print());
 					auto ninst = MulIntegratedInst::create_mneg(inst->get_operand(0), inst->get_operand(1), nullptr);
 					ninst->set_parent(b_);
+					fused(inst, use, ninst, "FuseMulNeg");
 					use->replace_all_use_with(ninst);
 					LOG(color::green("Get"));
 					LOG(ninst->print());
@@ -215,11 +256,41 @@ void InstructionSelect::runInner() const
 					delete it.replaceWith(ninst);
 					continue;
 				}
+				if (use->is_fadd())
+					notFused(inst, "mergeFloatBinaryInst is off, a fused result may round differently");
 			}
 		}
 	}
 }
 
+void InstructionSelect::fused(const Instruction* inst, Instruction* use, Instruction* ninst, const char* name) const
+{
+	ninst->set_line(use->get_line());
+	if (!Remarks::enabled(Remarks::Passed, "isel")) return;
+	Remarks::emit({
+		Remarks::Passed, "isel", name, f_->get_name(), b_->get_diagnostic_name(), use->get_diagnostic_line(),
+		inst->get_instr_op_name() + " and " + use->get_instr_op_name() + " combined into " + ninst->get_instr_op_name(), ""
+	});
+}
+
+void InstructionSelect::notFused(Instruction* inst, const std::string& reason) const
+{
+	if (!inst->is_mul() && !inst->is_fmul()) return;
+	if (!Remarks::enabled(Remarks::Missed, "isel")) return;
+	// 只关心可能与乘法合并的加减
+	bool addOrSub = false;
+	for (auto& u : inst->get_use_list())
+	{
+		auto use = dynamic_cast<Instruction*>(u.val_);
+		addOrSub |= use->is_add() || use->is_sub() || use->is_fadd() || use->is_fsub();
+	}
+	if (!addOrSub) return;
+	Remarks::emit({
+		Remarks::Missed, "isel", "MulNotFused", f_->get_name(), b_->get_diagnostic_name(), inst->get_diagnostic_line(),
+		inst->get_instr_op_name() + " not combined with its add/sub", reason
+	});
+}
+
 void InstructionSelect::run()
 {
 	PASS_SUFFIX;
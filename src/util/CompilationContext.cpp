@@ -0,0 +1,58 @@
+#include "CompilationContext.hpp"
+
+#include "Type.hpp"
+
+namespace
+{
+	thread_local CompilationContext* currentContext = nullptr;
+}
+
+CompilationOptions CompilationOptions::capture()
+{
+	CompilationOptions options;
+#define SYSY_CONFIG_OPTION_CAPTURE(type, name) options.name = ::name;
+	SYSY_CONFIG_OPTIONS(SYSY_CONFIG_OPTION_CAPTURE)
+#undef SYSY_CONFIG_OPTION_CAPTURE
+	return options;
+}
+
+void CompilationOptions::apply() const
+{
+#define SYSY_CONFIG_OPTION_APPLY(type, name) ::name = name;
+	SYSY_CONFIG_OPTIONS(SYSY_CONFIG_OPTION_APPLY)
+#undef SYSY_CONFIG_OPTION_APPLY
+}
+
+CompilationContext::CompilationContext() : CompilationContext(CompilationOptions::capture())
+{
+}
+
+CompilationContext::CompilationContext(const CompilationOptions& options) : options_(options),
+	types_(Types::createTypeTable())
+{
+}
+
+CompilationContext::~CompilationContext()
+{
+	Types::destroyTypeTable(types_);
+}
+
+CompilationContext* CompilationContext::current()
+{
+	return currentContext;
+}
+
+CompilationContext::Bind::Bind(CompilationContext* context) : context_(context), previous_(currentContext),
+                                                              previousOptions_(CompilationOptions::capture())
+{
+	if (context_ == nullptr) return;
+	currentContext = context_;
+	context_->options_.apply();
+}
+
+CompilationContext::Bind::~Bind()
+{
+	if (context_ == nullptr) return;
+	currentContext = previous_;
+	previousOptions_.apply();
+}
@@ -0,0 +1,292 @@
+#include "CompileCache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Config.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define COMPILE_CACHE_USE_FLOCK 1
+#else
+#define COMPILE_CACHE_USE_FLOCK 0
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace
+{
+	// 两个独立的 64 位哈希拼成的 128 位哈希, 第一个是 FNV-1a, 第二个按 8 字节一组乘法混合
+	class Hasher
+	{
+	public:
+		void update(const char* begin, const char* end)
+		{
+			for (auto p = begin; p != end; ++p)
+			{
+				h1_ ^= static_cast<unsigned char>(*p);
+				h1_ *= 0x100000001b3ULL;
+			}
+			auto p = begin;
+			for (; end - p >= 8; p += 8)
+			{
+				uint64_t w;
+				memcpy(&w, p, 8);
+				mix(w);
+			}
+			uint64_t w = 0;
+			memcpy(&w, p, end - p);
+			mix(w ^ static_cast<uint64_t>(end - p) << 56);
+		}
+
+		void update(const string& s)
+		{
+			update(s.data(), s.data() + s.size());
+		}
+
+		[[nodiscard]] string hex() const
+		{
+			ostringstream os;
+			os << std::hex << setfill('0') << setw(16) << h1_ << setw(16) << h2_;
+			return os.str();
+		}
+
+	private:
+		uint64_t h1_ = 0xcbf29ce484222325ULL;
+		uint64_t h2_ = 0x243f6a8885a308d3ULL;
+
+		void mix(uint64_t w)
+		{
+			w *= 0x9e3779b97f4a7c15ULL;
+			w ^= w >> 29;
+			h2_ = (h2_ ^ w) * 0xbf58476d1ce4e5b9ULL;
+			h2_ ^= h2_ >> 32;
+		}
+	};
+
+	// 编译器构建的标识, 可执行文件变化后缓存自然失效
+	const string& buildId()
+	{
+		static const string id = []
+		{
+			ostringstream os;
+			os << __DATE__ << ' ' << __TIME__;
+			error_code ec;
+			const fs::path exe = fs::read_symlink("/proc/self/exe", ec);
+			if (!ec)
+			{
+				const auto size = fs::file_size(exe, ec);
+				if (!ec) os << ' ' << size;
+				const auto time = fs::last_write_time(exe, ec);
+				if (!ec) os << ' ' << time.time_since_epoch().count();
+			}
+			return os.str();
+		}();
+		return id;
+	}
+
+	// 只影响缓存本身而不影响输出的选项不参与键的计算
+	bool affectsOutput(const char* name)
+	{
+		return strcmp(name, "compileCacheDir") != 0 && strcmp(name, "compileCacheMaxMegabytes") != 0 &&
+			strcmp(name, "printCompileCacheStats") != 0 && strcmp(name, "globalDataIncbinFile") != 0 &&
+			strcmp(name, "printTimeReport") != 0 && strcmp(name, "interpretReportFile") != 0 &&
+			strcmp(name, "interpretProfileFile") != 0 && strcmp(name, "printMcaReport") != 0 &&
+			strcmp(name, "mcaReportFile") != 0 && strcmp(name, "printRegPressureReport") != 0 &&
+			strcmp(name, "regPressureReportFile") != 0 && strcmp(name, "remarkPassFilter") != 0 &&
+			strcmp(name, "remarkMissedFilter") != 0 && strcmp(name, "remarkAnalysisFilter") != 0 &&
+			strcmp(name, "remarkFile") != 0;
+	}
+
+	// 在作用域内持有缓存目录的排他锁, 同一进程的不同线程之间也互斥
+	class DirectoryLock
+	{
+	public:
+		explicit DirectoryLock(const string& dir)
+		{
+#if COMPILE_CACHE_USE_FLOCK
+			fd_ = open((dir + "/lock").c_str(), O_RDWR | O_CREAT, 0644);
+			if (fd_ >= 0) flock(fd_, LOCK_EX);
+#endif
+		}
+
+		~DirectoryLock()
+		{
+#if COMPILE_CACHE_USE_FLOCK
+			if (fd_ >= 0)
+			{
+				flock(fd_, LOCK_UN);
+				close(fd_);
+			}
+#endif
+		}
+
+		DirectoryLock(const DirectoryLock&) = delete;
+		DirectoryLock& operator=(const DirectoryLock&) = delete;
+
+	private:
+		int fd_ = -1;
+	};
+
+	struct CacheStats
+	{
+		long long hits = 0;
+		long long misses = 0;
+		long long evictions = 0;
+	};
+
+	CacheStats readStats(const string& path)
+	{
+		CacheStats stats;
+		ifstream in{path};
+		string name;
+		long long value;
+		while (in >> name >> value)
+		{
+			if (name == "hits") stats.hits = value;
+			else if (name == "misses") stats.misses = value;
+			else if (name == "evictions") stats.evictions = value;
+		}
+		return stats;
+	}
+
+	bool isEntry(const fs::directory_entry& e)
+	{
+		return e.is_regular_file() && e.path().extension() == ".out";
+	}
+}
+
+CompileCache::CompileCache(string dir, const long long maxBytes) : dir_(std::move(dir)), maxBytes_(maxBytes)
+{
+	error_code ec;
+	fs::create_directories(dir_, ec);
+}
+
+string CompileCache::key(const char* begin, const char* end)
+{
+	Hasher h;
+	h.update(buildId());
+	ostringstream os;
+	os << setprecision(9);
+#define SYSY_CONFIG_OPTION_KEY(type, name) if (affectsOutput(#name)) os << #name << '=' << (name) << ';';
+	SYSY_CONFIG_OPTIONS(SYSY_CONFIG_OPTION_KEY)
+#undef SYSY_CONFIG_OPTION_KEY
+	h.update(os.str());
+	h.update(begin, end);
+	return h.hex();
+}
+
+string CompileCache::entryPath(const string& key) const
+{
+	return dir_ + "/" + key + ".out";
+}
+
+bool CompileCache::fetch(const string& key, const string& outfile) const
+{
+	const string path = entryPath(key);
+	error_code ec;
+	// 条目可能正被其它进程淘汰, 复制失败视为未命中
+	const bool hit = fs::copy_file(path, outfile, fs::copy_options::overwrite_existing, ec) && !ec;
+	if (hit) fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+	addStats(hit, !hit, 0);
+	return hit;
+}
+
+void CompileCache::store(const string& key, const string& outfile) const
+{
+	const string path = entryPath(key);
+	ostringstream tmp;
+	tmp << path << ".tmp." << this_thread::get_id();
+#if COMPILE_CACHE_USE_FLOCK
+	tmp << '.' << getpid();
+#endif
+	error_code ec;
+	// 先写入临时文件再改名, 读者不会看到写了一半的条目
+	if (!fs::copy_file(outfile, tmp.str(), fs::copy_options::overwrite_existing, ec) || ec) return;
+	fs::rename(tmp.str(), path, ec);
+	if (ec)
+	{
+		fs::remove(tmp.str(), ec);
+		return;
+	}
+	evict();
+}
+
+void CompileCache::addStats(const long long hits, const long long misses, const long long evictions) const
+{
+	DirectoryLock lock{dir_};
+	const string path = dir_ + "/stats";
+	auto stats = readStats(path);
+	stats.hits += hits;
+	stats.misses += misses;
+	stats.evictions += evictions;
+	ofstream out{path, ios::trunc};
+	out << "hits " << stats.hits << "\nmisses " << stats.misses << "\nevictions " << stats.evictions << "\n";
+}
+
+void CompileCache::evict() const
+{
+	long long evicted = 0;
+	{
+		DirectoryLock lock{dir_};
+		vector<pair<fs::file_time_type, fs::path>> entries;
+		long long total = 0;
+		error_code ec;
+		for (const auto& e : fs::directory_iterator{dir_, ec})
+		{
+			if (!isEntry(e)) continue;
+			total += static_cast<long long>(e.file_size(ec));
+			entries.emplace_back(e.last_write_time(ec), e.path());
+		}
+		if (total <= maxBytes_) return;
+		sort(entries.begin(), entries.end());
+		for (auto& [time, path] : entries)
+		{
+			if (total <= maxBytes_) break;
+			const auto size = static_cast<long long>(fs::file_size(path, ec));
+			if (fs::remove(path, ec))
+			{
+				total -= size;
+				++evicted;
+			}
+		}
+	}
+	if (evicted > 0) addStats(0, 0, evicted);
+}
+
+string CompileCache::stats() const
+{
+	CacheStats stats;
+	long long entries = 0;
+	long long bytes = 0;
+	{
+		DirectoryLock lock{dir_};
+		stats = readStats(dir_ + "/stats");
+		error_code ec;
+		for (const auto& e : fs::directory_iterator{dir_, ec})
+		{
+			if (!isEntry(e)) continue;
+			++entries;
+			bytes += static_cast<long long>(e.file_size(ec));
+		}
+	}
+	ostringstream os;
+	const long long lookups = stats.hits + stats.misses;
+	os << "compile cache " << dir_ << ": " << stats.hits << " hits, " << stats.misses << " misses";
+	if (lookups > 0) os << " (" << fixed << setprecision(1) << 100.0 * static_cast<double>(stats.hits) / static_cast<
+		double>(lookups) << "% hit rate)";
+	os << ", " << stats.evictions << " evictions, " << entries << " entries, " << bytes << "/" << maxBytes_ <<
+		" bytes";
+	return os.str();
+}
@@ -1,46 +1,85 @@
 #include "Config.hpp"
 
-int replaceGlobalAddressWithRegisterNeedUseCount = 2;
-float replaceAllocaAddressWithRegisterNeedTotalCost = 10;
-int replaceAllocaAddressWithRegisterNeedUseCount = 3;
-float prefillConstantNeedTotalCost = 100.0;
-int useMultiplierPerLoop = 10;
-float globalRegisterSpillPriority = 1.0f;
-float constGlobalRegisterSpillPriority = 1.5f;
-float bigAllocaRegisterSpillPriority = 0.8f;
-float smallAllocaRegisterSpillPriority = 0.6f;
-int bigAllocaVariableGate = 12;
-bool mergeStackFrameSpilledWithGraphColoring = true;
-bool useCallerSaveRegsFirst = true;
-bool useLDRInsteadOfMovFMove2CreateFloat = true;
-int useLDRInsteadOfMov2CreateIntegerWhenMovCountBiggerThan = 3;
-int useLDRInsteadOfMov2CreateFloatWhenMovCountBiggerThan = 2;
-float fixFrameIndexParameterRegisterSpillPriority = 0.9f;
-int alignTo16NeedBytes = 8;
-int maxCopyInstCountToInlineMemcpy = 12;
-int maxCopyInstCountToInlineMemclr = 8;
-bool use64BitsMathOperationInPointerOp = false;
-bool useZRRegisterAsCommonRegister = false;
-bool graphColoringWeakNodeCheck = false;
-bool emitAST = false;
-bool emitIR = false;
-bool o1Optimization = true;
-bool testArchi = false;
-int funcInlineGate = 8;
-int epilogShouldMerge = 9;
-bool dangerousSignalInfer = true;
-bool ignoreNegativeArrayIndexes = true;
-bool useSinkForVirtualRegister = true;
-bool useBinaryInstMerge = true;
-bool mergeFloatBinaryInst = false;
-bool onlyMergeMulAndASWhenASUseAllReg = true;
-bool useStackOffset2GetspillCost = false;
-bool loopRotateAndAddGuardInAST = false;
-bool rotateLoopEvenIfNotHaveInvariant = false;
-int invariantNeed2RotateLoop = 4;
-bool disableCondLICM = true;
-bool disableCondGVN = true;
-int useSinkGate = 8;
-bool useFloatRegAsStack2Spill = true;
-bool useSignalInfer = false;
-bool removeTailRecursive = true;
\ No newline at end of file
+#include "OptionRegistry.hpp"
+
+// 定义选项并注册到 OptionRegistry, 说明与 Config.hpp 中的注释相同
+#define SYSY_OPTION(type, name, value, description) \
+	thread_local type name = value; \
+	static const OptionRegistry::Registrar name##Registrar{{ \
+		#name, #type, OptionRegistry::toString(static_cast<type>(value)), description, \
+		[] { return OptionRegistry::toString(name); }, \
+		[](const std::string& text) { OptionRegistry::parse(text, name); } \
+	}};
+
+SYSY_OPTION(int, replaceGlobalAddressWithRegisterNeedUseCount, 2, "全局变量在函数的使用次数大于等于这个阈值时，它的地址在函数开始时会加载到寄存器中，而非直接寻址")
+SYSY_OPTION(float, replaceAllocaAddressWithRegisterNeedTotalCost, 10, "alloca 对象的地址在函数的使用次数 * spill 开销大于等于这个阈值时，它的地址在函数开始时会加载到寄存器中，而非直接寻址")
+SYSY_OPTION(int, replaceAllocaAddressWithRegisterNeedUseCount, 3, "alloca 对象的地址在函数的使用次数大于等于这个阈值时，它的地址在函数开始时会加载到寄存器中，而非直接寻址, 这只在不使用 stackOffset 计算 cost 时有效")
+SYSY_OPTION(float, prefillConstantNeedTotalCost, 100.0, "常量的使用次数 * spill 开销大于等于这个阈值时, 它会被加载到寄存器而非每次使用拼凑")
+SYSY_OPTION(int, useMultiplierPerLoop, 10, "假定每个循环会运行几次, 在循环内的一次使用就相当于循环外的几次使用")
+SYSY_OPTION(float, globalRegisterSpillPriority, 1.0f, "全局变量存在寄存器中的地址在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高(全局变量一般使用文字池加载地址)")
+SYSY_OPTION(float, constGlobalRegisterSpillPriority, 1.5f, "常全局变量存在寄存器中的地址在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高(全局变量一般使用文字池加载地址)")
+SYSY_OPTION(float, bigAllocaRegisterSpillPriority, 0.8f, "大的 alloca 变量存在寄存器中的地址在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高")
+SYSY_OPTION(float, smallAllocaRegisterSpillPriority, 0.6f, "小的 alloca 变量存在寄存器中的地址在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高")
+SYSY_OPTION(int, bigAllocaVariableGate, 12, "多大的 alloca 变量被视为大的. 通常越大的变量离 sp 越远(因为栈排序), 使用单指令完成寻址越困难")
+SYSY_OPTION(bool, mergeStackFrameSpilledWithGraphColoring, true, "在溢出之后, 是否使用图着色尝试合并不冲突的 FrameIndex, 以缩减栈的大小")
+SYSY_OPTION(bool, useCallerSaveRegsFirst, true, "是否在图着色时首先使用调用者保存的寄存器. 对于较为简单的函数调用可以省去保存寄存器的工作, 但这会造成更大的编译器运行压力.")
+SYSY_OPTION(bool, useLDRInsteadOfMovFMove2CreateFloat, true, "对于不能用一条 FMOV 拼凑的浮点数, 使用一条 LDR 而非两条 MOV 一条 FMOV 拼凑.")
+SYSY_OPTION(int, useLDRInsteadOfMov2CreateIntegerWhenMovCountBiggerThan, 3, "对于要用 MOV 拼凑的整数, 当需要的 MOV 数量大于这个数量, 改为用 LDR.")
+SYSY_OPTION(int, useLDRInsteadOfMov2CreateFloatWhenMovCountBiggerThan, 2, "对于要用 MOV 拼凑的浮点数, 当需要的 MOV 数量大于这个数量, 改为用 LDR. 如果不用 LDR, 会多一条 FMOV, 所以这个值一般比整数小 1.")
+SYSY_OPTION(float, fixFrameIndexParameterRegisterSpillPriority, 0.9f, "栈中传递的参数在寄存器不够时放弃使用寄存器加载地址的优先级, 值越低则优先级越高")
+SYSY_OPTION(int, alignTo16NeedBytes, 8, "大于多少字节的数组需要对齐到 16 字节(ABI 强制要求大于 8 字节全局数组对齐到 16 字节, 不受该选项控制)")
+SYSY_OPTION(int, maxCopyInstCountToInlineMemcpy, 12, "当 memcpy 的字节数小于等于这个选项 x 16 时, 使用内联实现而非调用函数(一般而言这个数字 -4, 指令减少 2 条, 12 的时候是 8 条)")
+SYSY_OPTION(int, maxCopyInstCountToInlineMemclr, 8, "当 memset 的字节数小于等于这个选项 x 16 时, 使用内联实现而非调用函数(一般而言这个数字 -4, 指令减少 1 条, 8 的时候是 8 条)")
+SYSY_OPTION(bool, use64BitsMathOperationInPointerOp, false, "当开启该选项时, 对指针偏移量的运算使用 64 位计算(例如 getelement), 否则使用 32 位 (由于没做上游支持, 大概率都达不到预期功能)")
+SYSY_OPTION(bool, useZRRegisterAsCommonRegister, false, "是否像普通寄存器一样使用零寄存器, 因此生成的一些指令 ADD W0, WZR, #2 在某些环境下会报错")
+SYSY_OPTION(bool, graphColoringWeakNodeCheck, false, "当开启时, 忽略图着色中的部分 ASSERT 检查")
+SYSY_OPTION(bool, emitAST, false, "测试 AST, 生成 C 文件")
+SYSY_OPTION(bool, emitIR, false, "测试 IR, 生成 LLVM 文件")
+SYSY_OPTION(int, globalDataFillGate, 8, "连续相同的全局数据达到这个数量时使用 .fill 输出; 重复模式覆盖的全局数据达到这个数量时使用 .rept 输出")
+SYSY_OPTION(int, globalDataReptMaxPattern, 8, "全局数据中检测的重复模式的最大长度")
+SYSY_OPTION(int, globalDataZeroMergeGate, 4, "全局数据中长度不超过这个数量的默认值段合并到相邻的 .word 中, 而不是单独输出 .zero")
+SYSY_OPTION(bool, emitGlobalDataAsIncbin, false, "将较长的全局数据写入旁路文件, 在汇编中通过 .incbin 引用, 以减小汇编文件体积")
+SYSY_OPTION(int, globalDataIncbinGate, 256, "长度大于等于这个数量的全局数据才写入旁路文件")
+SYSY_OPTION(std::string, globalDataIncbinFile, "", "旁路文件的路径, 由命令行根据输出文件设置")
+SYSY_OPTION(bool, useFastFrontend, false, "使用手写的词法与语法分析器而非 antlr 生成 AST, 源文件通过内存映射读取")
+SYSY_OPTION(bool, streamFunctions, true, "IR 优化后按调用图逐批降级, 分配寄存器, 输出并释放函数, 峰值内存只与最大的一批函数有关; 关闭时整个模块一起处理")
+SYSY_OPTION(std::string, compileCacheDir, "", "编译缓存目录, 为空时不使用缓存")
+SYSY_OPTION(int, compileCacheMaxMegabytes, 256, "编译缓存目录的大小上限(MB), 超过时淘汰最久未使用的条目")
+SYSY_OPTION(bool, printCompileCacheStats, false, "编译结束后打印编译缓存的统计信息")
+SYSY_OPTION(bool, printTimeReport, false, "编译结束后打印各阶段的耗时与峰值内存")
+SYSY_OPTION(bool, interpretModule, false, "不生成输出文件, 而是用 Interpret pass 解释执行程序并报告动态计数")
+SYSY_OPTION(std::string, interpretStage, "ir", "解释执行的时机: ast2ir(不运行任何 pass), ir(IR 优化之后), lower(IR2MIR 的准备 pass 之后)")
+SYSY_OPTION(std::string, interpretReportFile, "", "动态计数报告的输出文件, 为空时输出到标准错误")
+SYSY_OPTION(std::string, interpretProfileFile, "", "每个基本块执行次数的 profile 输出文件, 为空时不输出")
+SYSY_OPTION(bool, printMcaReport, false, "代码生成后打印静态耗时估计(CostModel)的报告")
+SYSY_OPTION(std::string, mcaReportFile, "", "静态耗时估计报告的输出文件, 为空时输出到标准错误")
+SYSY_OPTION(bool, printRegPressureReport, false, "寄存器分配后打印每条指令的寄存器压力与 spill 位置的报告")
+SYSY_OPTION(std::string, regPressureReportFile, "", "寄存器压力报告的输出文件, 为空时输出到标准错误")
+SYSY_OPTION(std::string, remarkPassFilter, "", "优化备注: 输出 pass 名匹配这个正则的 pass 完成的变换, 为空时不输出")
+SYSY_OPTION(std::string, remarkMissedFilter, "", "优化备注: 输出 pass 名匹配这个正则的 pass 没能完成的变换及原因, 为空时不输出")
+SYSY_OPTION(std::string, remarkAnalysisFilter, "", "优化备注: 输出 pass 名匹配这个正则的 pass 的分析结果, 为空时不输出")
+SYSY_OPTION(std::string, remarkFile, "", "所有优化备注的输出文件, 以 .json 结尾时输出 JSON, 否则输出 YAML, 为空时不输出")
+SYSY_OPTION(bool, o1Optimization, true, "使用 O1 优化")
+SYSY_OPTION(bool, testArchi, false, "进行运行前检查, 检测目标架构的某些功能是否符合预期")
+SYSY_OPTION(int, funcInlineGate, 8, "当函数的指令数(无跳转)小于等于该值时(包括 ret), 它会被内联")
+SYSY_OPTION(int, epilogShouldMerge, 9, "函数的所有函数结束尾声加起来大于等于这个数字, 需要单独开辟一个返回基本块, 而不是将尾声内联到 RET")
+SYSY_OPTION(bool, dangerousSignalInfer, true, "推断 srem 的左操作数和结果符号保持相同, 这并不总是有效的, 尤其是当 ar[op % 4], 此时推断 op >= 0, 但是其可能是 -4 的倍数")
+SYSY_OPTION(bool, ignoreNegativeArrayIndexes, true, "忽略可能存在的负数组偏移, 这代表不再使用 SXTW 将 getelement 的偏移计算从 32 拓展到 64 位")
+SYSY_OPTION(bool, useSinkForVirtualRegister, true, "在一个虚拟寄存器需要 spill 时, 首先尝试将它的定值放置到尽可能靠后的地方(这称为 sink) 而非存入栈")
+SYSY_OPTION(bool, useBinaryInstMerge, true, "是否使用算数指令合并")
+SYSY_OPTION(bool, mergeFloatBinaryInst, false, "是否尝试合并浮点指令, 例如将 FMUL 和 FSUB 合并为 FMSUB, 这可能导致与分开时不同的结果(由于舍入误差)")
+SYSY_OPTION(bool, onlyMergeMulAndASWhenASUseAllReg, true, "只有当加减指令的操作数全是寄存器, 才尝试与乘法合并, 这样可以确保合并不会增加指令")
+SYSY_OPTION(bool, useStackOffset2GetspillCost, false, "使用 stackOffset 来计算 spill 的消耗")
+SYSY_OPTION(bool, loopRotateAndAddGuardInAST, false, "在 AST 中就进行循环旋转和添加 loop guard")
+SYSY_OPTION(bool, rotateLoopEvenIfNotHaveInvariant, false, "即使没有循环不变量, 只要循环旋转可以消除 phi 或 cbr, 就进行旋转")
+SYSY_OPTION(int, invariantNeed2RotateLoop, 4, "大于等于这个数量的循环不变量才会导致循环被旋转")
+SYSY_OPTION(bool, disableCondLICM, true, "禁止条件比较变量的循环外提, 因为 i1 外提后还必须 cset 再在比较处用到")
+SYSY_OPTION(bool, disableCondGVN, true, "禁止条件比较变量的 GVN, 出于 disableCondLICM 同样的原因")
+SYSY_OPTION(int, useSinkGate, 8, "使用 sink 并不能就很有效的在少量 spill 下减小寄存器压力(因为使用相同操作数的概率较小), 只有在 spill 大于等于这个数字才使用 sink")
+SYSY_OPTION(bool, useFloatRegAsStack2Spill, true, "使用浮点寄存器进行 spill, 使用 FMOV 而非 LDR/STR")
+SYSY_OPTION(bool, useSignalInfer, false, "使用符号推断来发掘隐藏的强度削弱机会，符号推断会在存在有符号数字溢出时出错")
+SYSY_OPTION(bool, removeTailRecursive, true, "使用尾递归消除")
+SYSY_OPTION(int, ifConversionMaxInsts, 4, "IfConversion 把分支合并为 select 时, 两个分支中可以提前执行的指令总数上限, 负数表示不合并")
+SYSY_OPTION(int, loopAlignMaxPadding, 12, "BlockLayout 把最内层循环头对齐到 16 字节时最多填充的字节数, 0 表示不对齐循环头")
+SYSY_OPTION(std::string, irPassPipeline, "", "以逗号分隔的 IR 优化 pass 序列, 替换 addPasses4IR 中的默认流水线, 为空时使用默认流水线")
+SYSY_OPTION(std::string, disabledPasses, "", "以逗号分隔的 pass 名, 这些 pass 在流水线中被跳过")
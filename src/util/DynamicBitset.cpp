@@ -234,6 +234,14 @@ bool DynamicBitset::include(const DynamicBitset& bit) const
 	return true;
 }
 
+int DynamicBitset::count() const
+{
+	int ret = 0;
+	for (int i = 0; i < dataSize_; i++)
+		ret += m_popcount(data_[i]);
+	return ret;
+}
+
 unsigned DynamicBitset::len() const
 {
 	return bitlen_;
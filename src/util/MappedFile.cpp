@@ -0,0 +1,63 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_USE_MMAP 1
+#else
+#define MAPPED_FILE_USE_MMAP 0
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const std::string& path)
+{
+#if MAPPED_FILE_USE_MMAP
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) throw runtime_error("can not open file " + path);
+	struct stat st{};
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		throw runtime_error("can not stat file " + path);
+	}
+	size_ = static_cast<size_t>(st.st_size);
+	// 空文件不能映射
+	if (size_ > 0)
+	{
+		void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			madvise(p, size_, MADV_SEQUENTIAL);
+			data_ = static_cast<const char*>(p);
+			mapped_ = true;
+		}
+	}
+	close(fd);
+	if (mapped_ || size_ == 0) return;
+#endif
+	ifstream in(path, ios::binary | ios::ate);
+	if (!in) throw runtime_error("can not open file " + path);
+	size_ = static_cast<size_t>(in.tellg());
+	in.seekg(0);
+	const auto buf = new char[size_ + 1];
+	in.read(buf, static_cast<streamsize>(size_));
+	data_ = buf;
+}
+
+MappedFile::~MappedFile()
+{
+#if MAPPED_FILE_USE_MMAP
+	if (mapped_)
+	{
+		munmap(const_cast<char*>(data_), size_);
+		return;
+	}
+#endif
+	delete[] data_;
+}
@@ -0,0 +1,150 @@
+#include "OptionRegistry.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+	vector<OptionRegistry::Option>& registry()
+	{
+		static vector<OptionRegistry::Option> options;
+		return options;
+	}
+
+	string trim(const string& s)
+	{
+		const auto b = s.find_first_not_of(" \t\r");
+		if (b == string::npos) return {};
+		const auto e = s.find_last_not_of(" \t\r");
+		return s.substr(b, e - b + 1);
+	}
+}
+
+OptionRegistry::Registrar::Registrar(const Option& option)
+{
+	registry().emplace_back(option);
+}
+
+const vector<OptionRegistry::Option>& OptionRegistry::options()
+{
+	return registry();
+}
+
+const OptionRegistry::Option* OptionRegistry::find(const string& name)
+{
+	for (auto& option : registry()) if (name == option.name) return &option;
+	return nullptr;
+}
+
+void OptionRegistry::assign(const string& assignment)
+{
+	const auto eq = assignment.find('=');
+	if (eq == string::npos) throw runtime_error("Expected <option>=<value>, got " + assignment + ".");
+	const string name = trim(assignment.substr(0, eq));
+	auto option = find(name);
+	if (option == nullptr) throw runtime_error("Unknown option " + name + ".");
+	try
+	{
+		option->set(trim(assignment.substr(eq + 1)));
+	}
+	catch (const exception& e)
+	{
+		throw runtime_error("Invalid value for " + name + " (" + option->type + "): " + e.what());
+	}
+}
+
+vector<string> OptionRegistry::load(const string& path)
+{
+	ifstream in{path};
+	if (!in) throw runtime_error("Can not open option file " + path + ".");
+	vector<string> assignments;
+	string line;
+	while (getline(in, line))
+	{
+		line = trim(line);
+		if (line.empty() || line[0] == '#') continue;
+		assignments.emplace_back(line);
+	}
+	return assignments;
+}
+
+void OptionRegistry::print(ostream& os)
+{
+	for (auto& option : registry())
+	{
+		os << option.name << " (" << option.type << ") = " << option.get();
+		if (option.get() != option.defaultValue) os << " [default " << option.defaultValue << "]";
+		os << "\n    " << option.description << "\n";
+	}
+}
+
+string OptionRegistry::toString(const int value)
+{
+	return to_string(value);
+}
+
+string OptionRegistry::toString(const float value)
+{
+	ostringstream os;
+	os << value;
+	return os.str();
+}
+
+string OptionRegistry::toString(const bool value)
+{
+	return value ? "true" : "false";
+}
+
+string OptionRegistry::toString(const string& value)
+{
+	return value;
+}
+
+void OptionRegistry::parse(const string& text, int& value)
+{
+	size_t used = 0;
+	long long v = 0;
+	try
+	{
+		v = stoll(text, &used);
+	}
+	catch (const logic_error&)
+	{
+		used = 0;
+	}
+	if (used == 0 || used != text.size() || v < INT32_MIN || v > INT32_MAX)
+		throw invalid_argument("expected an integer");
+	value = static_cast<int>(v);
+}
+
+void OptionRegistry::parse(const string& text, float& value)
+{
+	size_t used = 0;
+	float v = 0;
+	try
+	{
+		v = stof(text, &used);
+	}
+	catch (const logic_error&)
+	{
+		used = 0;
+	}
+	if (used == 0 || used != text.size()) throw invalid_argument("expected a number");
+	value = v;
+}
+
+void OptionRegistry::parse(const string& text, bool& value)
+{
+	if (text == "true" || text == "1" || text == "on") value = true;
+	else if (text == "false" || text == "0" || text == "off") value = false;
+	else throw invalid_argument("expected true or false");
+}
+
+void OptionRegistry::parse(const string& text, string& value)
+{
+	value = text;
+}
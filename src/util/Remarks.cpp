@@ -0,0 +1,199 @@
+#include "Remarks.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <regex>
+#include <unordered_set>
+#include <vector>
+
+#include "Config.hpp"
+
+using namespace std;
+
+namespace
+{
+	struct State
+	{
+		bool active = false;
+		string file;
+		// 按 Kind 下标, 为空时不输出这类备注
+		bool hasFilter[3]{};
+		regex filters[3];
+		vector<Remarks::Remark> records;
+		// 同一个 pass 会多次运行, 相同的备注只记录一次
+		unordered_set<string> seen;
+	};
+
+	thread_local State state;
+	// 批量模式下多个线程同时结束编译时, 避免标准错误与备注文件上的备注交错
+	mutex outputMutex;
+	// 本进程写过的备注文件. 批量模式中每次编译都输出备注, 只有第一次清空文件, 之后追加
+	unordered_set<string> openedFiles;
+
+	const char* kindName(const Remarks::Kind kind)
+	{
+		switch (kind)
+		{
+			case Remarks::Passed: return "Passed";
+			case Remarks::Missed: return "Missed";
+			case Remarks::Analysis: return "Analysis";
+		}
+		return "";
+	}
+
+	const char* flagName(const Remarks::Kind kind)
+	{
+		switch (kind)
+		{
+			case Remarks::Passed: return "-Rpass";
+			case Remarks::Missed: return "-Rpass-missed";
+			case Remarks::Analysis: return "-Rpass-analysis";
+		}
+		return "";
+	}
+
+	// YAML 的单引号字符串, 单引号写两次
+	string yamlQuote(const string& s)
+	{
+		string ret = "'";
+		for (char c : s)
+		{
+			if (c == '\'') ret += '\'';
+			ret += c;
+		}
+		return ret + "'";
+	}
+
+	string jsonQuote(const string& s)
+	{
+		string ret = "\"";
+		for (char c : s)
+		{
+			switch (c)
+			{
+				case '"': ret += "\\\"";
+					break;
+				case '\\': ret += "\\\\";
+					break;
+				case '\n': ret += "\\n";
+					break;
+				case '\t': ret += "\\t";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						char buf[8];
+						snprintf(buf, sizeof buf, "\\u%04x", c);
+						ret += buf;
+					}
+					else ret += c;
+			}
+		}
+		return ret + "\"";
+	}
+
+	void printText(ostream& os, const Remarks::Remark& r)
+	{
+		os << state.file;
+		if (r.line != 0) os << ':' << r.line;
+		os << ": remark: " << r.function;
+		if (!r.block.empty()) os << '/' << r.block;
+		os << ": " << r.message;
+		if (!r.reason.empty()) os << ": " << r.reason;
+		os << " [" << flagName(r.kind) << '=' << r.pass << "]\n";
+	}
+
+	void printYaml(ostream& os, const Remarks::Remark& r)
+	{
+		os << "--- !" << kindName(r.kind) << "\n";
+		os << "Pass:            " << r.pass << "\n";
+		os << "Name:            " << r.name << "\n";
+		if (r.line != 0)
+			os << "DebugLoc:        { File: " << yamlQuote(state.file) << ", Line: " << r.line << ", Column: 0 }\n";
+		os << "Function:        " << yamlQuote(r.function) << "\n";
+		if (!r.block.empty()) os << "Block:           " << yamlQuote(r.block) << "\n";
+		os << "Args:\n";
+		os << "  - String:          " << yamlQuote(r.message) << "\n";
+		if (!r.reason.empty()) os << "  - Reason:          " << yamlQuote(r.reason) << "\n";
+		os << "...\n";
+	}
+
+	void printJson(ostream& os, const Remarks::Remark& r)
+	{
+		os << "{\"kind\":\"" << kindName(r.kind) << "\",\"pass\":" << jsonQuote(r.pass) << ",\"name\":" <<
+			jsonQuote(r.name) << ",\"file\":" << jsonQuote(state.file) << ",\"line\":" << r.line << ",\"function\":" <<
+			jsonQuote(r.function) << ",\"block\":" << jsonQuote(r.block) << ",\"message\":" << jsonQuote(r.message) <<
+			",\"reason\":" << jsonQuote(r.reason) << "}\n";
+	}
+
+	bool endsWith(const string& s, const string& suffix)
+	{
+		return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	bool matches(const Remarks::Kind kind, const char* pass)
+	{
+		return state.hasFilter[kind] && regex_search(pass, state.filters[kind]);
+	}
+}
+
+Remarks::Scope::Scope(const string& file)
+{
+	state.active = false;
+	state.records.clear();
+	state.seen.clear();
+	if (!requested()) return;
+	state.file = file;
+	const string* filters[3] = {&remarkPassFilter, &remarkMissedFilter, &remarkAnalysisFilter};
+	for (int i = 0; i < 3; i++)
+	{
+		state.hasFilter[i] = !filters[i]->empty();
+		if (state.hasFilter[i]) state.filters[i] = regex{*filters[i]};
+	}
+	state.active = true;
+}
+
+Remarks::Scope::~Scope()
+{
+	if (!state.active) return;
+	state.active = false;
+	lock_guard<mutex> lock{outputMutex};
+	for (auto& r : state.records)
+		if (matches(r.kind, r.pass)) printText(cerr, r);
+	if (!remarkFile.empty())
+	{
+		const bool first = openedFiles.insert(remarkFile).second;
+		ofstream out{remarkFile, first ? ios::trunc : ios::app};
+		if (!out) cerr << "Can not open remarks file " << remarkFile << "\n";
+		const bool json = endsWith(remarkFile, ".json");
+		for (auto& r : state.records)
+		{
+			if (json) printJson(out, r);
+			else printYaml(out, r);
+		}
+	}
+	state.records.clear();
+	state.seen.clear();
+}
+
+bool Remarks::requested()
+{
+	return !remarkPassFilter.empty() || !remarkMissedFilter.empty() || !remarkAnalysisFilter.empty() ||
+		!remarkFile.empty();
+}
+
+bool Remarks::enabled(const Kind kind, const char* pass)
+{
+	return state.active && (!remarkFile.empty() || matches(kind, pass));
+}
+
+void Remarks::emit(Remark remark)
+{
+	if (!enabled(remark.kind, remark.pass)) return;
+	string key = to_string(remark.kind) + '\0' + remark.pass + '\0' + remark.name + '\0' + remark.function + '\0' +
+		remark.block + '\0' + to_string(remark.line) + '\0' + remark.message + '\0' + remark.reason;
+	if (!state.seen.insert(std::move(key)).second) return;
+	state.records.emplace_back(std::move(remark));
+}
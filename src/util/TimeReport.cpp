@@ -0,0 +1,74 @@
+#include "TimeReport.hpp"
+
+#include <cstring>
+
+#include "Config.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define TIME_REPORT_USE_RUSAGE 1
+#else
+#define TIME_REPORT_USE_RUSAGE 0
+#endif
+
+using namespace std;
+
+namespace
+{
+	struct StageRecord
+	{
+		const char* name;
+		double ms;
+	};
+
+	// 按首次出现的顺序保存
+	thread_local vector<StageRecord> records;
+
+	long long peakRssKb()
+	{
+#if TIME_REPORT_USE_RUSAGE
+		rusage usage{};
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1024;
+#else
+		return usage.ru_maxrss;
+#endif
+#else
+		return 0;
+#endif
+	}
+}
+
+TimeReport::Stage::Stage(const char* name) : name_(printTimeReport ? name : nullptr)
+{
+	if (name_ != nullptr) begin_ = chrono::steady_clock::now();
+}
+
+TimeReport::Stage::~Stage()
+{
+	if (name_ == nullptr) return;
+	const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - begin_).count();
+	for (auto& [name, total] : records)
+	{
+		if (strcmp(name, name_) == 0)
+		{
+			total += ms;
+			return;
+		}
+	}
+	records.push_back({name_, ms});
+}
+
+void TimeReport::print(ostream& os)
+{
+	double total = 0;
+	for (auto& [name, ms] : records)
+	{
+		os << "time-report " << name << ' ' << ms << '\n';
+		total += ms;
+	}
+	os << "time-report total " << total << '\n';
+	os << "time-report peak-rss-kb " << peakRssKb() << '\n';
+	records.clear();
+}
@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 
+#include "CompilationContext.hpp"
 #include "System.hpp"
 
 namespace error
@@ -118,7 +119,26 @@ public:
 
 namespace
 {
+	// 基础类型在所有编译间共享, 程序结束时释放
 	TypeAllocator allocator{};
+	// 没有绑定编译上下文的线程使用的类型表
+	thread_local TypeAllocator threadAllocator{};
+
+	TypeAllocator& typeTable()
+	{
+		if (auto* context = CompilationContext::current()) return *context->types();
+		return threadAllocator;
+	}
+}
+
+TypeAllocator* Types::createTypeTable()
+{
+	return new TypeAllocator{};
+}
+
+void Types::destroyTypeTable(const TypeAllocator* table)
+{
+	delete table;
 }
 
 std::string to_string(const TypeIDs e)
@@ -243,10 +263,11 @@ PointerType* Types::pointerType(Type* contained)
 	if (contained == Types::VOID || contained == Types::LABEL)
 		throw std::runtime_error("void or label can not have pointer");
 	auto type = new PointerType(contained);
-	const auto i = allocator.pointerTypes_.find(type);
-	if (i == allocator.pointerTypes_.end())
+	auto& table = typeTable().pointerTypes_;
+	const auto i = table.find(type);
+	if (i == table.end())
 	{
-		allocator.pointerTypes_.emplace(type);
+		table.emplace(type);
 		return type;
 	}
 	delete type;
@@ -520,10 +541,11 @@ namespace Types
 			if (dims.size() == 0 && !inParameter)
 				throw std::runtime_error("Array Not in Parameter must have at least one certain dimension");
 			auto type = new ArrayType(contained, inParameter, dims);
-			const auto i = allocator.arrayTypes_.find(type);
-			if (i == allocator.arrayTypes_.end())
+			auto& table = typeTable().arrayTypes_;
+			const auto i = table.find(type);
+			if (i == table.end())
 			{
-				allocator.arrayTypes_.emplace(type);
+				table.emplace(type);
 				if (type->getTypeID() == TypeIDs::Array)
 					for (const int dim : type->_arrayDims)
 						type->_size *= dim;
@@ -542,10 +564,11 @@ namespace Types
 			if (dims.empty() && !inParameter)
 				throw std::runtime_error("Array Not in Parameter must have at least one certain dimension");
 			auto type = new ArrayType(contained, inParameter, dims);
-			const auto i = allocator.arrayTypes_.find(type);
-			if (i == allocator.arrayTypes_.end())
+			auto& table = typeTable().arrayTypes_;
+			const auto i = table.find(type);
+			if (i == table.end())
 			{
-				allocator.arrayTypes_.emplace(type);
+				table.emplace(type);
 				if (type->getTypeID() == TypeIDs::Array)
 					for (const int dim : type->_arrayDims)
 						type->_size *= dim;
@@ -594,10 +617,11 @@ namespace Types
 				}
 			}
 			auto type = new FuncType(simpleType(returnType), argTypes);
-			const auto i = allocator.funcTypes_.find(type);
-			if (i == allocator.funcTypes_.end())
+			auto& table = typeTable().funcTypes_;
+			const auto i = table.find(type);
+			if (i == table.end())
 			{
-				allocator.funcTypes_.emplace(type);
+				table.emplace(type);
 				return type;
 			}
 			delete type;
@@ -625,10 +649,11 @@ namespace Types
 				}
 			}
 			auto type = new FuncType(simpleType(returnType), argTypes);
-			const auto i = allocator.funcTypes_.find(type);
-			if (i == allocator.funcTypes_.end())
+			auto& table = typeTable().funcTypes_;
+			const auto i = table.find(type);
+			if (i == table.end())
 			{
-				allocator.funcTypes_.emplace(type);
+				table.emplace(type);
 				return type;
 			}
 			delete type;
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// 编译期性能基准: 生成压力测试输入, 记录编译器各阶段耗时与峰值内存, 并与基线比较
+
+const string benchDir = "build/bench";
+// 输入规模的缩放比例, 1 对应请求中的完整规模(例如一个函数 10^5 条语句)
+double scale = 1;
+
+int scaled(int n) { return max(1, static_cast<int>(n * scale)); }
+// 单次编译的时间上限(秒), 超时视为失败
+unsigned timeoutSeconds = 300;
+
+// ---------------------------------------------------------------- 输入生成
+
+// 一个函数中 10^5 条语句
+void genLongFunction(ostream &os) {
+  const int statements = scaled(100000);
+  os << "int a[64];\nint main() {\n  int x0 = getint(), x1 = 1, x2 = 2, x3 = "
+        "3;\n";
+  for (int i = 0; i < statements; i++) {
+    switch (i % 5) {
+    case 0:
+      os << "  x1 = x0 + " << i % 97 << ";\n";
+      break;
+    case 1:
+      os << "  x2 = x1 * " << i % 13 + 1 << " - x3;\n";
+      break;
+    case 2:
+      os << "  a[" << i % 64 << "] = x2 + x0;\n";
+      break;
+    case 3:
+      os << "  x3 = a[" << (i * 7) % 64 << "] / " << i % 11 + 1 << ";\n";
+      break;
+    default:
+      os << "  x0 = x0 + x3 % " << i % 17 + 1 << ";\n";
+      break;
+    }
+  }
+  os << "  putint(x0 + x1 + x2 + x3);\n  return 0;\n}\n";
+}
+
+// 深层嵌套的 if 与 while
+void genDeepNesting(ostream &os) {
+  const int depth = scaled(64);
+  os << "int main() {\n  int s = 0, n = getint();\n";
+  // 所有循环共用递增的 s 作为条件, 避免活跃变量随深度增加
+  for (int i = 0; i < depth; i++) {
+    string indent(i + 1, ' ');
+    if (i % 2 == 0)
+      os << indent << "if (n > " << i << ") {\n";
+    else
+      os << indent << "while (s < " << i * 4 << ") {\n";
+    os << indent << " s = s + " << i % 3 + 1 << ";\n";
+  }
+  for (int i = depth - 1; i >= 0; i--)
+    os << string(i + 1, ' ') << "}\n";
+  os << "  putint(s);\n  return 0;\n}\n";
+}
+
+// 数千个小函数
+void genManyFunctions(ostream &os) {
+  const int functions = scaled(5000);
+  os << "int f0(int a, int b) { return a + b; }\n";
+  for (int i = 1; i < functions; i++) {
+    os << "int f" << i << "(int a, int b) {\n  if (a > " << i % 50
+       << ") return f" << i - 1 << "(a - 1, b + " << i % 7 << ");\n"
+       << "  return a * " << i % 9 + 1 << " + b;\n}\n";
+  }
+  os << "int main() {\n  putint(f" << functions - 1
+     << "(getint(), 1));\n  return 0;\n}\n";
+}
+
+// 巨大的有初始值的全局与局部数组
+void genHugeArrays(ostream &os) {
+  const int globalSize = scaled(1000000);
+  const int localSize = scaled(20000);
+  os << "int g[" << globalSize << "] = {";
+  for (int i = 0; i < globalSize; i++) {
+    if (i % 1000 == 0)
+      os << "\n";
+    // 混合重复段, 零段与随机数据
+    int v = i % 10000 < 3000 ? 0 : (i % 10000 < 6000 ? 7 : (i * 2654435761u) % 1000);
+    os << (i ? "," : "") << v;
+  }
+  os << "};\nconst int c[100][100] = {";
+  for (int i = 0; i < 100; i++) {
+    os << (i ? ",{" : "{");
+    for (int j = 0; j < 100; j += 3)
+      os << (j ? "," : "") << i * j;
+    os << "}";
+  }
+  os << "};\nint main() {\n  int l[" << localSize << "] = {";
+  for (int i = 0; i < localSize; i++)
+    os << (i ? "," : "") << (i % 5 == 0 ? 0 : i);
+  os << "};\n  putint(g[getint()] + l[" << localSize - 1 << "] + c[99][99]);\n  return 0;\n}\n";
+}
+
+// 循环中同时活跃的大量变量
+void genRegisterPressure(ostream &os) {
+  const int vars = 96;
+  os << "int main() {\n  int n = getint(), i = 0;\n";
+  for (int v = 0; v < vars; v++)
+    os << "  int v" << v << " = n + " << v << ";\n";
+  os << "  while (i < n) {\n";
+  for (int v = 0; v < vars; v++)
+    os << "    v" << v << " = v" << (v + 1) % vars << " * " << v % 5 + 1
+       << " + v" << (v + 7) % vars << ";\n";
+  os << "    i = i + 1;\n  }\n  putint(v0";
+  for (int v = 1; v < vars; v++)
+    os << " + v" << v;
+  os << ");\n  return 0;\n}\n";
+}
+
+const vector<pair<string, function<void(ostream &)>>> generators = {
+    {"long_function", genLongFunction},
+    {"deep_nesting", genDeepNesting},
+    {"many_functions", genManyFunctions},
+    {"huge_arrays", genHugeArrays},
+    {"register_pressure", genRegisterPressure},
+};
+
+// ---------------------------------------------------------------- 运行与计时
+
+struct Measure {
+  double wallMs = 0;
+  long long peakKb = 0;
+  // 被 -T 的时间上限终止
+  bool timedOut = false;
+  // 编译器 -ftime-report 给出的各阶段耗时
+  vector<pair<string, double>> stages;
+};
+
+// 运行编译器, 用 wait4 取得子进程的峰值内存, 失败时返回 false
+bool runCompiler(const vector<string> &args, Measure &m, string &err) {
+  int errpipe[2];
+  if (pipe(errpipe) != 0) {
+    err = "pipe() 调用失败";
+    return false;
+  }
+  auto begin = chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == -1) {
+    err = "fork() 调用失败";
+    return false;
+  }
+  if (pid == 0) {
+    close(errpipe[0]);
+    dup2(errpipe[1], STDERR_FILENO);
+    // alarm 在 exec 后仍然有效, 超时的编译器会被 SIGALRM 终止
+    alarm(timeoutSeconds);
+    vector<char *> argv;
+    for (auto &a : args)
+      argv.emplace_back(const_cast<char *>(a.c_str()));
+    argv.emplace_back(nullptr);
+    execv(argv[0], argv.data());
+    perror("execv");
+    _exit(127);
+  }
+  close(errpipe[1]);
+  string output;
+  char buffer[1024];
+  ssize_t bytes;
+  while ((bytes = read(errpipe[0], buffer, sizeof(buffer))) > 0)
+    output.append(buffer, bytes);
+  close(errpipe[0]);
+  int status;
+  rusage usage{};
+  wait4(pid, &status, 0, &usage);
+  m.wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() -
+                                             begin)
+                 .count();
+  m.peakKb = usage.ru_maxrss;
+  if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+    err = "超过 " + to_string(timeoutSeconds) + " 秒";
+    m.timedOut = true;
+    return false;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    err = output.empty() ? "编译器异常退出" : output;
+    return false;
+  }
+  istringstream in{output};
+  string line;
+  while (getline(in, line)) {
+    istringstream ls{line};
+    string tag, name;
+    double value;
+    if (ls >> tag >> name >> value && tag == "time-report" &&
+        name != "peak-rss-kb" && name != "total")
+      m.stages.emplace_back(name, value);
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------- 基线
+
+struct Baseline {
+  double wallMs;
+  long long peakKb;
+};
+
+map<string, Baseline> readBaseline(const string &path) {
+  map<string, Baseline> ret;
+  ifstream in{path};
+  string name;
+  Baseline b{};
+  while (in >> name >> b.wallMs >> b.peakKb)
+    ret[name] = b;
+  return ret;
+}
+
+int main(int argc, char *argv[]) {
+  string compiler = "./build/compiler";
+  string baselinePath = benchDir + "/baseline.txt";
+  string only;
+  int repeat = 3;
+  double timeTolerance = 0.25;
+  double memoryTolerance = 0.10;
+  bool update = false;
+  vector<string> extra;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) {
+        cerr << arg << " 缺少参数" << endl;
+        exit(-1);
+      }
+      return string{argv[++i]};
+    };
+    if (arg == "-c")
+      compiler = value();
+    else if (arg == "-b")
+      baselinePath = value();
+    else if (arg == "-r")
+      repeat = max(1, stoi(value()));
+    else if (arg == "-t")
+      timeTolerance = stod(value());
+    else if (arg == "-m")
+      memoryTolerance = stod(value());
+    else if (arg == "-k")
+      only = value();
+    else if (arg == "-s")
+      scale = stod(value());
+    else if (arg == "-T")
+      timeoutSeconds = stoul(value());
+    else if (arg == "--update")
+      update = true;
+    else if (arg == "--") {
+      extra.assign(argv + i + 1, argv + argc);
+      break;
+    } else {
+      cerr << R"(参数错误, 可用的参数:
+-c <编译器路径>   默认 ./build/compiler
+-b <基线文件>     默认 build/bench/baseline.txt
+-r <次数>         每项重复运行的次数, 取最快的一次, 默认 3
+-t <比例>         耗时允许超出基线的比例, 默认 0.25
+-m <比例>         峰值内存允许超出基线的比例, 默认 0.10
+-k <样例名>       只运行名称包含该字符串的样例
+-s <比例>         输入规模的缩放比例, 默认 1
+-T <秒>           单次编译的时间上限, 默认 300
+--update          将本次结果写为新的基线
+-- <参数...>      之后的参数原样传给编译器, 例如 -- -frontend=fast)"
+           << endl;
+      exit(-1);
+    }
+  }
+  if (!filesystem::exists(compiler)) {
+    cerr << "编译器 " << compiler << " 不存在" << endl;
+    exit(-1);
+  }
+  filesystem::create_directories(benchDir);
+
+  auto baseline = readBaseline(baselinePath);
+  map<string, Baseline> results;
+  int regressions = 0, failures = 0, skipped = 0;
+  for (auto &[name, gen] : generators) {
+    if (!only.empty() && name.find(only) == string::npos)
+      continue;
+    string source = benchDir + "/" + name + ".sy";
+    {
+      ofstream out{source};
+      gen(out);
+    }
+    // -O0 已经超时的样例, -O1 也不会在时限内完成
+    bool timedOut = false;
+    for (string opt : {"O0", "O1"}) {
+      string key = name + "/" + opt;
+      auto b = baseline.find(key);
+      if (timedOut && b == baseline.end()) {
+        skipped++;
+        cout << left << setw(28) << key << "跳过" << endl;
+        continue;
+      }
+      vector<string> args = {compiler, "-S", "-o", benchDir + "/" + name + "." + opt + ".s",
+                             source, "-ftime-report"};
+      if (opt == "O1")
+        args.emplace_back("-O1");
+      args.insert(args.end(), extra.begin(), extra.end());
+      Measure best;
+      bool ok = true;
+      string err;
+      for (int r = 0; r < repeat && ok; r++) {
+        Measure m;
+        ok = runCompiler(args, m, err);
+        timedOut = timedOut || m.timedOut;
+        if (ok && (r == 0 || m.wallMs < best.wallMs)) {
+          long long peak = r == 0 ? m.peakKb : min(best.peakKb, m.peakKb);
+          best = m;
+          best.peakKb = peak;
+        }
+      }
+      cout << left << setw(28) << key;
+      // 基线中没有记录的样例超时只是规模太大, 跳过而不算失败;
+      // 有记录的样例超时说明编译器变慢了
+      if (!ok && timedOut && b == baseline.end()) {
+        skipped++;
+        cout << "超时, 跳过 (" << err << ")" << endl;
+        continue;
+      }
+      if (!ok) {
+        failures++;
+        cout << "编译失败\n" << err << endl;
+        continue;
+      }
+      results[key] = {best.wallMs, best.peakKb};
+      cout << right << fixed << setprecision(1) << setw(10) << best.wallMs
+           << " ms" << setw(10) << best.peakKb << " KB";
+      if (b != baseline.end()) {
+        // 给极小的数值留出绝对余量, 避免噪声导致失败
+        bool slow = best.wallMs > b->second.wallMs * (1 + timeTolerance) + 5;
+        bool big =
+            best.peakKb > b->second.peakKb * (1 + memoryTolerance) + 1024;
+        cout << "  基线 " << b->second.wallMs << " ms " << b->second.peakKb
+             << " KB";
+        if (slow || big) {
+          regressions++;
+          cout << (slow ? "  耗时退化" : "") << (big ? "  内存退化" : "");
+        }
+      }
+      cout << "\n   ";
+      for (auto &[stage, ms] : best.stages)
+        cout << " " << stage << "=" << setprecision(1) << ms;
+      cout << endl;
+    }
+  }
+
+  if (update) {
+    for (auto &[key, r] : results)
+      baseline[key] = r;
+    ofstream out{baselinePath};
+    for (auto &[key, b] : baseline)
+      out << key << " " << fixed << setprecision(3) << b.wallMs << " "
+          << b.peakKb << "\n";
+    cout << "基线已写入 " << baselinePath << endl;
+    return failures == 0 ? 0 : 1;
+  }
+  if (skipped)
+    cout << skipped << " 项超时跳过, 可以用 -s 缩小输入规模" << endl;
+  if (baseline.empty())
+    cout << "没有基线, 使用 --update 记录当前结果作为基线" << endl;
+  if (regressions || failures) {
+    cout << regressions << " 项退化, " << failures << " 项失败" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,8 @@
+source_file="$1"
+target_file="$2"
+
+mid_file_s="${target_file}.s"
+
+# 使用手写的词法与语法分析器代替 ANTLR 前端
+./build/compiler -S -o "$mid_file_s" "$source_file" -O1 -frontend=fast
+aarch64-linux-gnu-gcc "$mid_file_s"  -L build/lib -l:sylib.a -static -g -o "$target_file"
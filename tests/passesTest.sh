@@ -6,6 +6,17 @@ mid_file_s="${target_file}.s"
 
 ./build/compiler -S -o "$mid_file_ll" "$source_file" -O1 -ir
 
+# 违反 pass 前置要求的流水线曾使编译器崩溃, 现在应当报错并以 1 退出
+for flags in "-O1 -disable-pass=Mem2Reg" "-O1 -disable-pass=LoopSimplify" \
+    "-disable-pass=DeadCode" "-passes=DeadCode" \
+    "-passes=Mem2Reg,LoopSimplify,LCSSA,LoopRotate,LinearFunctionTestReplace,DeadCode"; do
+    ./build/compiler -S -o "${target_file}.rejected.s" "$source_file" $flags 2>/dev/null
+    status=$?
+    if [ $status -ne 1 ]; then
+        echo "pipeline $flags exited with $status instead of being rejected" >&2
+    fi
+done
+
 llc -march=aarch64 -mcpu=cortex-a53 -filetype=asm "$mid_file_ll" -o "${mid_file_s}"
 
 aarch64-linux-gnu-g++ "$mid_file_s" -include lib/sylib.h -L build/lib -l:sylib.a -o "$target_file" 
\ No newline at end of file
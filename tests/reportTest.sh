@@ -0,0 +1,38 @@
+#!/bin/bash
+# 分析报告的回归测试: 在 -O0 与 -O1 下输出 -mca-report 与 -reg-pressure-report, 编译器必须正常退出.
+# 在项目根目录执行
+
+COMPILER=./build/compiler
+
+tmp=./build/ReportTest
+
+rm -rf $tmp
+mkdir -p $tmp
+
+# 名称与源代码
+CASES=(
+    # 短路求值留下不可达的机器基本块, 报告删除它们后块编号必须连续
+    "unreachable" "int main(){int i=getint();int s=0;if(i==0&&s<0)s=1;return s;}"
+    "loop" "int a[100];int main(){int n=getint();int i=0;int s=0;while(i<n){s=s+a[i];i=i+1;}putint(s);return 0;}"
+)
+
+fails=0
+for ((i = 0; i < ${#CASES[@]}; i += 2)); do
+    base=${CASES[i]}
+    echo "${CASES[i + 1]}" > $tmp/$base.sy
+    for opt in "" "-O1"; do
+        if ! $COMPILER -S -o $tmp/$base.s $tmp/$base.sy $opt -mca-report=$tmp/$base.mca.txt \
+            -reg-pressure-report=$tmp/$base.reg.txt 2>$tmp/$base.err; then
+            echo "ERROR: $base ${opt:--O0}"
+            cat $tmp/$base.err
+            fails=$((fails + 1))
+        elif [ ! -s $tmp/$base.mca.txt ] || [ ! -s $tmp/$base.reg.txt ]; then
+            echo "ERROR: $base ${opt:--O0} report is empty"
+            fails=$((fails + 1))
+        else
+            echo "OK: $base ${opt:--O0}"
+        fi
+    done
+done
+
+exit $fails
@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// 选项自动调优: 在一组 .sy 基准上先随机搜索再坐标下降, 寻找 Config 选项的最优取值, 输出可用于 -opt-file 的选项文件
+
+const string tuneDir = "build/tune";
+// 单次编译或运行的时间上限(秒), 超时的候选视为失败
+unsigned timeoutSeconds = 60;
+
+// 一个可调的选项与它的候选值
+struct Knob {
+  string name;
+  vector<string> values;
+};
+
+// 默认的搜索空间, 可以用 -k 指定的文件替换, 文件每行为 "选项名 值1 值2 ..."
+// 只影响 IR 的选项, 解释执行 -interp=lower 的动态指令数可以反映它们的效果
+const vector<Knob> irSpace = {
+    {"funcInlineGate", {"0", "4", "8", "12", "16", "24", "32"}},
+    {"invariantNeed2RotateLoop", {"1", "2", "4", "6", "8"}},
+    {"rotateLoopEvenIfNotHaveInvariant", {"false", "true"}},
+    {"ifConversionMaxInsts", {"-1", "0", "2", "4", "6", "8"}},
+};
+
+// 只影响后端(机器指令, 寄存器分配与布局)的选项, 只有按运行时间评分时才能观察到
+const vector<Knob> backendSpace = {
+    {"useMultiplierPerLoop", {"2", "4", "8", "10", "16", "32"}},
+    {"bigAllocaVariableGate", {"4", "8", "12", "16", "32"}},
+    {"useSinkGate", {"2", "4", "8", "16"}},
+    {"prefillConstantNeedTotalCost", {"25", "50", "100", "200", "400"}},
+    {"replaceGlobalAddressWithRegisterNeedUseCount", {"1", "2", "3", "4", "8"}},
+    {"replaceAllocaAddressWithRegisterNeedTotalCost", {"5", "10", "20", "40"}},
+    {"maxCopyInstCountToInlineMemcpy", {"4", "8", "12", "16", "24"}},
+    {"maxCopyInstCountToInlineMemclr", {"4", "8", "12", "16"}},
+    {"epilogShouldMerge", {"3", "6", "9", "12", "1000"}},
+    {"useCallerSaveRegsFirst", {"false", "true"}},
+};
+
+struct Benchmark {
+  string name;
+  string source;
+  // 没有 .in 时为 /dev/null
+  string input;
+  // 默认选项下的分数与程序输出, 候选的输出必须与之相同
+  double baseScore = 0;
+  string baseOutput;
+};
+
+// ---------------------------------------------------------------- 进程
+
+// 运行 args, 标准输入输出重定向到文件, 返回退出码; 超时返回 -1, 被信号终止返回 -2
+int runProcess(const vector<string> &args, const string &input,
+               const string &output, const string &error) {
+  pid_t pid = fork();
+  if (pid == -1)
+    return -2;
+  if (pid == 0) {
+    auto redirect = [](const string &path, int fd, int flags) {
+      int f = open(path.c_str(), flags, 0644);
+      if (f < 0 || dup2(f, fd) < 0)
+        _exit(127);
+      close(f);
+    };
+    redirect(input, STDIN_FILENO, O_RDONLY);
+    redirect(output, STDOUT_FILENO, O_WRONLY | O_CREAT | O_TRUNC);
+    redirect(error, STDERR_FILENO, O_WRONLY | O_CREAT | O_TRUNC);
+    // alarm 在 exec 后仍然有效, 超时的进程会被 SIGALRM 终止
+    alarm(timeoutSeconds);
+    vector<char *> argv;
+    for (auto &a : args)
+      argv.emplace_back(const_cast<char *>(a.c_str()));
+    argv.emplace_back(nullptr);
+    execvp(argv[0], argv.data());
+    _exit(127);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  if (WIFSIGNALED(status))
+    return WTERMSIG(status) == SIGALRM ? -1 : -2;
+  return WEXITSTATUS(status);
+}
+
+string readFile(const string &path) {
+  ifstream in{path, ios::binary};
+  return {istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+}
+
+vector<string> splitWords(const string &s) {
+  vector<string> words;
+  istringstream in{s};
+  string w;
+  while (in >> w)
+    words.emplace_back(w);
+  return words;
+}
+
+// ---------------------------------------------------------------- 评分
+
+struct Tuner {
+  string compiler = "./build/compiler";
+  vector<string> extra;
+  // 不为空时按实际运行时间评分: link 把汇编链接为可执行文件, exec 是运行它的前缀(例如 qemu-aarch64)
+  string link;
+  string exec;
+  int repeat = 3;
+  vector<Benchmark> benchmarks;
+  // 已评估的候选, 键是选项文件的内容
+  map<string, double> evaluated;
+  int evaluations = 0;
+
+  // 写出候选的选项文件
+  static string optionText(const vector<Knob> &space,
+                           const vector<int> &choice) {
+    string text;
+    for (size_t k = 0; k < space.size(); k++)
+      text += space[k].name + "=" + space[k].values[choice[k]] + "\n";
+    return text;
+  }
+
+  // 以 optionFile 编译并运行 b, 成功时返回分数, 程序输出写入 output
+  bool measure(const Benchmark &b, const string &optionFile, double &score,
+               string &output) {
+    const string base = tuneDir + "/" + b.name;
+    const string out = base + ".stdout", err = base + ".stderr";
+    if (link.empty()) {
+      // 在 IR2MIR 之前解释执行, 分数是动态指令数
+      const string report = base + ".report";
+      vector<string> args = {compiler,      "-interp=lower",
+                             "-O1",         "-opt-file=" + optionFile,
+                             "-interp-report=" + report, b.source};
+      args.insert(args.end(), extra.begin(), extra.end());
+      int rc = runProcess(args, b.input, out, err);
+      if (rc < 0)
+        return false;
+      output = readFile(out) + "\n" + to_string(rc);
+      istringstream in{readFile(report)};
+      string tag, key;
+      long long count;
+      while (in >> tag >> key >> count)
+        if (tag == "interp-total" && key == "instructions") {
+          score = static_cast<double>(count);
+          return true;
+        }
+      return false;
+    }
+    const string asmFile = base + ".s", exe = base + ".out";
+    vector<string> args = {compiler, "-S", "-o", asmFile, b.source, "-O1",
+                           "-opt-file=" + optionFile};
+    args.insert(args.end(), extra.begin(), extra.end());
+    if (runProcess(args, "/dev/null", out, err) != 0)
+      return false;
+    auto linkArgs = splitWords(link);
+    linkArgs.insert(linkArgs.end(), {asmFile, exe});
+    if (runProcess(linkArgs, "/dev/null", out, err) != 0)
+      return false;
+    auto runArgs = splitWords(exec);
+    runArgs.emplace_back(exe);
+    score = 0;
+    for (int r = 0; r < repeat; r++) {
+      auto begin = chrono::steady_clock::now();
+      int rc = runProcess(runArgs, b.input, out, err);
+      double ms = chrono::duration<double, milli>(chrono::steady_clock::now() -
+                                                  begin)
+                      .count();
+      if (rc < 0)
+        return false;
+      output = readFile(out) + "\n" + to_string(rc);
+      score = r == 0 ? ms : min(score, ms);
+    }
+    return true;
+  }
+
+  // 候选相对默认选项的分数, 为各基准比值的几何平均, 越小越好; 失败或输出改变时为无穷大
+  double evaluate(const vector<Knob> &space, const vector<int> &choice) {
+    const string text = optionText(space, choice);
+    auto found = evaluated.find(text);
+    if (found != evaluated.end())
+      return found->second;
+    const string optionFile = tuneDir + "/candidate.opt";
+    ofstream{optionFile} << text;
+    evaluations++;
+    double logSum = 0;
+    for (auto &b : benchmarks) {
+      double score;
+      string output;
+      if (!measure(b, optionFile, score, output) || output != b.baseOutput) {
+        logSum = INFINITY;
+        break;
+      }
+      logSum += log(max(score, 1e-9) / max(b.baseScore, 1e-9));
+    }
+    double ratio = exp(logSum / max<size_t>(1, benchmarks.size()));
+    evaluated.emplace(text, ratio);
+    return ratio;
+  }
+};
+
+// 从 compiler -opt-list 读取选项的当前(默认)值
+map<string, string> readDefaults(const string &compiler) {
+  const string list = tuneDir + "/options.txt";
+  map<string, string> ret;
+  if (runProcess({compiler, "-opt-list"}, "/dev/null", list, "/dev/null") != 0)
+    return ret;
+  istringstream in{readFile(list)};
+  string line;
+  while (getline(in, line)) {
+    istringstream ls{line};
+    string name, type, eq, value;
+    if (line[0] != ' ' && ls >> name >> type >> eq >> value && eq == "=")
+      ret[name] = value;
+  }
+  return ret;
+}
+
+vector<Knob> readSpace(const string &path) {
+  vector<Knob> space;
+  ifstream in{path};
+  string line;
+  while (getline(in, line)) {
+    auto words = splitWords(line);
+    if (words.size() < 2 || words[0][0] == '#')
+      continue;
+    space.push_back({words[0], {words.begin() + 1, words.end()}});
+  }
+  return space;
+}
+
+int main(int argc, char *argv[]) {
+  Tuner tuner;
+  string dir, spacePath, outPath = tuneDir + "/tuned.opt";
+  int samples = 32;
+  int rounds = 3;
+  unsigned seed = 1;
+  // 坐标下降中, 只有分数降低超过这个比例才接受, 按运行时间评分时用于过滤噪声
+  double threshold = -1;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) {
+        cerr << arg << " 缺少参数" << endl;
+        exit(-1);
+      }
+      return string{argv[++i]};
+    };
+    if (arg == "-d")
+      dir = value();
+    else if (arg == "-c")
+      tuner.compiler = value();
+    else if (arg == "-o")
+      outPath = value();
+    else if (arg == "-k")
+      spacePath = value();
+    else if (arg == "-n")
+      samples = max(0, stoi(value()));
+    else if (arg == "-R")
+      rounds = max(0, stoi(value()));
+    else if (arg == "-r")
+      tuner.repeat = max(1, stoi(value()));
+    else if (arg == "-s")
+      seed = stoul(value());
+    else if (arg == "-e")
+      threshold = stod(value());
+    else if (arg == "-T")
+      timeoutSeconds = stoul(value());
+    else if (arg == "--link")
+      tuner.link = value();
+    else if (arg == "--exec")
+      tuner.exec = value();
+    else if (arg == "--") {
+      tuner.extra.assign(argv + i + 1, argv + argc);
+      break;
+    } else {
+      cerr << R"(参数错误, 可用的参数:
+-d <目录>         基准目录, 使用其中所有 .sy 文件, 同名的 .in 作为输入
+-c <编译器路径>   默认 ./build/compiler
+-o <文件>         输出的选项文件, 默认 build/tune/tuned.opt
+-k <文件>         搜索空间, 每行 "选项名 值1 值2 ...", 默认使用内置的搜索空间;
+                  解释执行评分时只搜索 IR 选项, 后端选项需要 --link
+-n <次数>         随机搜索的候选数, 默认 32
+-R <轮数>         坐标下降的最大轮数, 默认 3
+-s <种子>         随机搜索的种子, 默认 1
+-e <比例>         坐标下降接受改进的最小比例, 默认解释执行时为 0, 按运行时间时为 0.01
+-T <秒>           单次编译或运行的时间上限, 默认 60
+--link <命令>     按运行时间评分, 以 "<命令> <汇编> <可执行文件>" 链接, 例如 "aarch64-linux-gnu-gcc -static build/lib/sylib.a"
+--exec <前缀>     运行可执行文件的前缀, 例如 "qemu-aarch64"
+-r <次数>         按运行时间评分时每个基准运行的次数, 取最快的一次, 默认 3
+-- <参数...>      之后的参数原样传给编译器, 例如 -- -frontend=fast)"
+          << endl;
+      exit(-1);
+    }
+  }
+  if (dir.empty() || !filesystem::is_directory(dir)) {
+    cerr << "需要用 -d 指定基准目录" << endl;
+    exit(-1);
+  }
+  if (!filesystem::exists(tuner.compiler)) {
+    cerr << "编译器 " << tuner.compiler << " 不存在" << endl;
+    exit(-1);
+  }
+  if (threshold < 0)
+    threshold = tuner.link.empty() ? 0 : 0.01;
+  filesystem::create_directories(tuneDir);
+
+  auto defaults = readDefaults(tuner.compiler);
+  if (defaults.empty()) {
+    cerr << "无法通过 -opt-list 读取编译器的选项" << endl;
+    exit(-1);
+  }
+  vector<Knob> space = spacePath.empty() ? irSpace : readSpace(spacePath);
+  if (spacePath.empty() && !tuner.link.empty())
+    space.insert(space.end(), backendSpace.begin(), backendSpace.end());
+  // 解释执行的分数不受后端选项影响, 搜索它们只会浪费预算并随机地报告"最优"值
+  if (tuner.link.empty()) {
+    auto backend = [](const Knob &knob) {
+      for (auto &b : backendSpace)
+        if (b.name == knob.name)
+          return true;
+      return false;
+    };
+    for (auto &knob : space)
+      if (backend(knob))
+        cerr << "警告: " << knob.name
+             << " 只影响后端, 解释执行无法评价它, 保持默认值; 用 --link "
+                "按运行时间评分才会搜索它"
+             << endl;
+    space.erase(remove_if(space.begin(), space.end(), backend), space.end());
+  }
+  if (space.empty()) {
+    cerr << "搜索空间为空" << endl;
+    exit(-1);
+  }
+  // 默认值总是候选之一, 搜索从默认选项出发
+  vector<int> best;
+  for (auto &knob : space) {
+    auto found = defaults.find(knob.name);
+    if (found == defaults.end()) {
+      cerr << "编译器没有选项 " << knob.name << endl;
+      exit(-1);
+    }
+    auto it = find(knob.values.begin(), knob.values.end(), found->second);
+    if (it == knob.values.end()) {
+      knob.values.emplace_back(found->second);
+      it = knob.values.end() - 1;
+    }
+    best.emplace_back(static_cast<int>(it - knob.values.begin()));
+  }
+
+  for (auto &entry : filesystem::directory_iterator(dir)) {
+    if (entry.path().extension() != ".sy")
+      continue;
+    auto input = entry.path();
+    input.replace_extension(".in");
+    Benchmark b;
+    b.name = entry.path().stem().string();
+    b.source = entry.path().string();
+    b.input = filesystem::exists(input) ? input.string() : "/dev/null";
+    tuner.benchmarks.push_back(b);
+  }
+  sort(tuner.benchmarks.begin(), tuner.benchmarks.end(),
+       [](const Benchmark &a, const Benchmark &b) { return a.name < b.name; });
+  if (tuner.benchmarks.empty()) {
+    cerr << dir << " 中没有 .sy 文件" << endl;
+    exit(-1);
+  }
+
+  // 默认选项的分数是所有候选的比较基准
+  {
+    const string optionFile = tuneDir + "/candidate.opt";
+    ofstream{optionFile} << Tuner::optionText(space, best);
+    for (auto &b : tuner.benchmarks) {
+      if (!tuner.measure(b, optionFile, b.baseScore, b.baseOutput)) {
+        cerr << b.name << " 在默认选项下失败, 见 " << tuneDir << "/" << b.name
+             << ".stderr" << endl;
+        exit(-1);
+      }
+      cout << left << setw(28) << b.name << fixed << setprecision(0)
+           << b.baseScore << (tuner.link.empty() ? " 条指令" : " ms") << endl;
+    }
+  }
+  double bestScore = tuner.evaluate(space, best);
+  // 比值相同的候选不替换当前最优, 避免无关的选项随机漂移
+  auto better = [&](double score) {
+    return score < bestScore * (1 - max(threshold, 1e-9));
+  };
+
+  // 随机搜索, 每个选项独立均匀地取候选值
+  mt19937 rng{seed};
+  for (int s = 0; s < samples; s++) {
+    vector<int> choice;
+    for (auto &knob : space)
+      choice.emplace_back(static_cast<int>(rng() % knob.values.size()));
+    double score = tuner.evaluate(space, choice);
+    if (better(score)) {
+      bestScore = score;
+      best = choice;
+      cout << "random " << s << "  " << setprecision(6) << bestScore << endl;
+    }
+  }
+
+  // 坐标下降, 依次对每个选项尝试所有候选值, 一轮没有改进时停止
+  for (int r = 0; r < rounds; r++) {
+    bool improved = false;
+    for (size_t k = 0; k < space.size(); k++) {
+      for (int v = 0; v < static_cast<int>(space[k].values.size()); v++) {
+        if (v == best[k])
+          continue;
+        auto choice = best;
+        choice[k] = v;
+        double score = tuner.evaluate(space, choice);
+        if (better(score)) {
+          bestScore = score;
+          best = choice;
+          improved = true;
+          cout << "round " << r << "  " << space[k].name << "="
+               << space[k].values[v] << "  " << setprecision(6) << bestScore
+               << endl;
+        }
+      }
+    }
+    if (!improved)
+      break;
+  }
+
+  ofstream out{outPath};
+  out << "# tests/tune.cpp 在 " << dir << " 的 " << tuner.benchmarks.size()
+      << " 个基准上的调优结果, 按"
+      << (tuner.link.empty() ? "解释执行的动态指令数" : "运行时间")
+      << "评分\n# 相对默认选项的几何平均比值 " << setprecision(6) << bestScore
+      << ", 共评估 " << tuner.evaluations << " 个候选\n";
+  for (size_t k = 0; k < space.size(); k++)
+    if (space[k].values[best[k]] != defaults[space[k].name])
+      out << space[k].name << "=" << space[k].values[best[k]] << "\n";
+  cout << "评估 " << tuner.evaluations << " 个候选, 最优比值 "
+       << setprecision(6) << bestScore << ", 选项写入 " << outPath << endl;
+  return 0;
+}